@@ -33,9 +33,7 @@ using namespace opencog;
 void BindLink::init(void)
 {
 	extract_variables(_outgoing);
-	unbundle_clauses(_body);
-	common_init();
-	setup_components();
+	analyze();
 	_pat.redex_name = "anonymous BindLink";
 }
 
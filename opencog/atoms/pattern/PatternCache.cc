@@ -0,0 +1,153 @@
+/*
+ * PatternCache.cc
+ *
+ * Copyright (C) 2015 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <opencog/atomspace/Link.h>
+
+#include "PatternCache.h"
+
+using namespace opencog;
+
+// The default number of plans to keep.
+#define DEFAULT_CAPACITY 1024
+
+PatternCache::PatternCache()
+	: _capacity(DEFAULT_CAPACITY), _hits(0), _misses(0)
+{
+}
+
+typedef std::unordered_map<const Atom*, size_t> Seen;
+
+static void shape_rec(const std::set<Handle>& vars, const Handle& h,
+                      Seen& seen, HandleSeq& atoms, std::string& shp)
+{
+	// An atom that appeared before is given by its number; the
+	// sharing of atoms is part of the shape.
+	auto it = seen.find(h.operator->());
+	if (seen.end() != it)
+	{
+		shp += '@';
+		shp += std::to_string(it->second);
+		shp += ';';
+		return;
+	}
+	seen.insert({h.operator->(), atoms.size()});
+	atoms.emplace_back(h);
+
+	shp += std::to_string(h->getType());
+	LinkPtr lp(LinkCast(h));
+	if (nullptr == lp)
+	{
+		shp += vars.end() == vars.find(h) ? ';' : '$';
+		return;
+	}
+	shp += '(';
+	for (const Handle& ho : lp->getOutgoingSet())
+		shape_rec(vars, ho, seen, atoms, shp);
+	shp += ')';
+}
+
+std::string PatternCache::shape(const std::set<Handle>& vars,
+                                const Handle& body, HandleSeq& atoms)
+{
+	// Variables that are declared, but do not appear in the body,
+	// make the pattern invalid; count them, so that such a pattern
+	// does not share its shape with a valid one.
+	std::string shp(std::to_string(vars.size()));
+	shp += ':';
+
+	Seen seen;
+	shape_rec(vars, body, seen, atoms, shp);
+	return shp;
+}
+
+PatternPlanPtr PatternCache::find(const std::string& shp)
+{
+	std::lock_guard<std::mutex> lck(_mtx);
+	auto it = _plans.find(shp);
+	if (_plans.end() == it)
+	{
+		_misses++;
+		return PatternPlanPtr();
+	}
+	_hits++;
+	_lru.splice(_lru.begin(), _lru, it->second);
+	return it->second->second;
+}
+
+void PatternCache::insert(const std::string& shp, const PatternPlanPtr& plan)
+{
+	std::lock_guard<std::mutex> lck(_mtx);
+	if (0 == _capacity) return;
+	auto it = _plans.find(shp);
+	if (_plans.end() != it)
+	{
+		it->second->second = plan;
+		_lru.splice(_lru.begin(), _lru, it->second);
+		return;
+	}
+	_lru.emplace_front(shp, plan);
+	_plans[shp] = _lru.begin();
+	evict();
+}
+
+// Drop the least recently used plans, until there are no more than
+// the capacity.  The caller holds the lock.
+void PatternCache::evict(void)
+{
+	while (_capacity < _plans.size())
+	{
+		_plans.erase(_lru.back().first);
+		_lru.pop_back();
+	}
+}
+
+void PatternCache::set_capacity(size_t cap)
+{
+	std::lock_guard<std::mutex> lck(_mtx);
+	_capacity = cap;
+	evict();
+}
+
+size_t PatternCache::size(void)
+{
+	std::lock_guard<std::mutex> lck(_mtx);
+	return _plans.size();
+}
+
+void PatternCache::clear(void)
+{
+	std::lock_guard<std::mutex> lck(_mtx);
+	_plans.clear();
+	_lru.clear();
+	_hits = 0;
+	_misses = 0;
+}
+
+PatternCache& opencog::pattern_cache(void)
+{
+	// Never deleted: the plans hold atoms, which may outlive static
+	// destruction order otherwise.
+	static PatternCache* instance = new PatternCache();
+	return *instance;
+}
+
+/* ===================== END OF FILE ===================== */
@@ -0,0 +1,122 @@
+/*
+ * PatternCache.h
+ *
+ * Copyright (C) 2015 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _OPENCOG_PATTERN_CACHE_H
+#define _OPENCOG_PATTERN_CACHE_H
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <opencog/atomspace/Handle.h>
+#include <opencog/query/Pattern.h>
+
+namespace opencog
+{
+/** \addtogroup grp_atomspace
+ *  @{
+ */
+
+/// The result of analysing the body of a PatternLink: everything that
+/// PatternLink::common_init() computes, except for the term trees,
+/// which are cheap to rebuild.  The atoms are those of the pattern
+/// that was analysed, listed in the order of its shape (see below).
+struct PatternPlan
+{
+	Pattern pat;
+	HandleSeq fixed;
+	size_t num_virts;
+	HandleSeq virtuals;
+	size_t num_comps;
+	std::vector<HandleSeq> components;
+	std::vector<std::set<Handle>> component_vars;
+
+	HandleSeq atoms;
+};
+
+typedef std::shared_ptr<const PatternPlan> PatternPlanPtr;
+
+/**
+ * Cache of pattern analyses, keyed on the shape of the pattern.
+ *
+ * The shape of a pattern is its tree of atom types, with the nodes
+ * numbered in order of first appearance, and the bound variables
+ * marked as such; node names do not enter into it.  Two patterns of
+ * the same shape differ only in the names of their variables and of
+ * their constants; the analysis of one is the analysis of the other,
+ * after swapping the atoms of the one for the atoms of the other.
+ * Rule engines issue the same few patterns over and over, with just
+ * the constants changed; those get analysed only once.
+ *
+ * The number of cached plans is bounded; when full, the plan that
+ * was least recently used is dropped to make room.  A capacity of
+ * zero turns the cache off.
+ */
+class PatternCache
+{
+	private:
+		std::mutex _mtx;
+
+		// Most recently used first.
+		typedef std::list<std::pair<std::string, PatternPlanPtr>> PlanList;
+		PlanList _lru;
+		std::unordered_map<std::string, PlanList::iterator> _plans;
+		void evict(void);
+		size_t _capacity;
+
+		std::atomic<size_t> _hits;
+		std::atomic<size_t> _misses;
+
+	public:
+		PatternCache();
+
+		/// Return the shape of the pattern with the given bound
+		/// variables and body. The distinct atoms of the body are
+		/// appended to atoms, in the order that they appear in the
+		/// shape.
+		static std::string shape(const std::set<Handle>& vars,
+		                         const Handle& body, HandleSeq& atoms);
+
+		PatternPlanPtr find(const std::string& shape);
+		void insert(const std::string& shape, const PatternPlanPtr&);
+
+		void set_capacity(size_t);
+		size_t get_capacity(void) const { return _capacity; }
+		size_t size(void);
+		void clear(void);
+
+		size_t hits(void) const { return _hits; }
+		size_t misses(void) const { return _misses; }
+};
+
+/// The cache shared by all PatternLinks.
+PatternCache& pattern_cache(void);
+
+/** @}*/
+} // namespace opencog
+
+#endif // _OPENCOG_PATTERN_CACHE_H
@@ -127,11 +127,104 @@ void PatternLink::init(void)
 		      toString().c_str());
 	}
 
-	unbundle_clauses(_body);
-	common_init();
+	analyze();
+}
+
+/// Analyse the body. Rather than doing this from scratch, use the
+/// analysis of an earlier pattern of the same shape, if there is one.
+void PatternLink::analyze(void)
+{
+	HandleSeq atoms;
+	std::string shape(PatternCache::shape(_varlist.varset, _body, atoms));
+	PatternPlanPtr plan(pattern_cache().find(shape));
+	if (plan)
+		apply_plan(*plan, atoms);
+	else
+	{
+		unbundle_clauses(_body);
+		common_init();
+		pattern_cache().insert(shape, make_plan(atoms));
+	}
 	setup_components();
 }
 
+PatternPlanPtr PatternLink::make_plan(const HandleSeq& atoms) const
+{
+	std::shared_ptr<PatternPlan> plan(std::make_shared<PatternPlan>());
+	plan->pat = _pat;
+	plan->pat.connected_terms_map.clear();
+	plan->fixed = _fixed;
+	plan->num_virts = _num_virts;
+	plan->virtuals = _virtual;
+	plan->num_comps = _num_comps;
+	plan->components = _components;
+	plan->component_vars = _component_vars;
+	plan->atoms = atoms;
+	return plan;
+}
+
+/// Copy the plan, swapping each of its atoms for the atom in the
+/// same place in our own shape.
+void PatternLink::apply_plan(const PatternPlan& plan, const HandleSeq& atoms)
+{
+	std::unordered_map<const Atom*, Handle> swap;
+	for (size_t i=0; i<atoms.size(); i++)
+		swap.insert({plan.atoms[i].operator->(), atoms[i]});
+
+	auto sw = [&](const Handle& h) -> Handle {
+		auto it = swap.find(h.operator->());
+		return swap.end() == it ? h : it->second;
+	};
+	auto sw_seq = [&](const HandleSeq& hs) {
+		HandleSeq out;
+		out.reserve(hs.size());
+		for (const Handle& h : hs) out.emplace_back(sw(h));
+		return out;
+	};
+	auto sw_set = [&](const std::set<Handle>& hs) {
+		std::set<Handle> out;
+		for (const Handle& h : hs) out.insert(sw(h));
+		return out;
+	};
+	auto sw_mmap = [&](const std::unordered_multimap<Handle,Handle>& mm) {
+		std::unordered_multimap<Handle,Handle> out;
+		for (const auto& pr : mm) out.insert({sw(pr.first), sw(pr.second)});
+		return out;
+	};
+
+	const Pattern& pp = plan.pat;
+	_pat.body = sw(pp.body);
+	_pat.clauses = sw_seq(pp.clauses);
+	_pat.constants = sw_seq(pp.constants);
+	_pat.cnf_clauses = sw_seq(pp.cnf_clauses);
+	_pat.mandatory = sw_seq(pp.mandatory);
+	_pat.optionals = sw_set(pp.optionals);
+	_pat.black = sw_set(pp.black);
+	_pat.evaluatable_terms = sw_set(pp.evaluatable_terms);
+	_pat.evaluatable_holders = sw_set(pp.evaluatable_holders);
+	_pat.executable_terms = sw_set(pp.executable_terms);
+	_pat.executable_holders = sw_set(pp.executable_holders);
+	_pat.defined_terms = sw_set(pp.defined_terms);
+	_pat.globby_terms = sw_set(pp.globby_terms);
+	_pat.in_evaluatable = sw_mmap(pp.in_evaluatable);
+	_pat.in_executable = sw_mmap(pp.in_executable);
+	for (const auto& pr : pp.connectivity_map)
+		_pat.connectivity_map.insert({sw(pr.first), sw_seq(pr.second)});
+
+	_fixed = sw_seq(plan.fixed);
+	_num_virts = plan.num_virts;
+	_virtual = sw_seq(plan.virtuals);
+	_num_comps = plan.num_comps;
+	for (const HandleSeq& comp : plan.components)
+		_components.emplace_back(sw_seq(comp));
+	for (const std::set<Handle>& cvars : plan.component_vars)
+		_component_vars.emplace_back(sw_set(cvars));
+
+	// The term trees are not in the plan; make them afresh.
+	if (0 == _pat.defined_terms.size())
+		make_term_trees();
+}
+
 /* ================================================================= */
 
 /// Special constructor used during just-in-time pattern compilation.
@@ -145,9 +238,7 @@ PatternLink::PatternLink(const Variables& vars, const Handle& body)
 
 	_varlist = vars;
 	_body = body;
-	unbundle_clauses(_body);
-	common_init();
-	setup_components();
+	analyze();
 }
 
 /* ================================================================= */
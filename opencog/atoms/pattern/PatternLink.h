@@ -28,6 +28,7 @@
 #include <opencog/query/Pattern.h>
 #include <opencog/atoms/core/ScopeLink.h>
 #include <opencog/atoms/core/VariableList.h>
+#include <opencog/atoms/pattern/PatternCache.h>
 #include <opencog/query/PatternMatchCallback.h>
 
 namespace opencog
@@ -130,6 +131,12 @@ protected:
 	void common_init(void);
 	void setup_components(void);
 
+	// Analyse the body, or reuse the analysis of an earlier pattern
+	// of the same shape; see PatternCache.h
+	void analyze(void);
+	PatternPlanPtr make_plan(const HandleSeq&) const;
+	void apply_plan(const PatternPlan&, const HandleSeq&);
+
 	// Only derived classes can call this
 	PatternLink(Type, const HandleSeq&,
 	            TruthValuePtr tv = TruthValue::DEFAULT_TV(),
@@ -177,6 +184,11 @@ public:
 	const HandleSeq& get_fixed(void) const { return _fixed; }
 	const HandleSeq& get_virtual(void) const { return _virtual; }
 
+	// Return the PatternLinks of the connected components; empty,
+	// if there is only one component.
+	const HandleSeq& get_component_patterns(void) const
+		{ return _component_patterns; }
+
 	bool satisfy(PatternMatchCallback&) const;
 
 	void debug_log(void) const;
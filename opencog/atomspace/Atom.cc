@@ -58,21 +58,31 @@
 
 using namespace opencog;
 
-#define _avmtx _mtx
+std::mutex Atom::_atom_mutexes[Atom::NUM_ATOM_MUTEXES];
 
 Atom::~Atom()
 {
     _atomTable = NULL;
-    if (0 < getIncomingSetSize()) {
-        // This can't ever possibly happen. If it does, then there is
-        // some very sick bug with the reference counting that the
-        // shared pointers are doing. (Or someone explcitly called the
-        // destructor! Which they shouldn't do.)
-        OC_ASSERT(0 == getIncomingSet().size(),
-             "Atom deletion failure; incoming set not empty for %s h=%d",
-             classserver().getTypeName(_type).c_str(), _uuid);
+
+    // No locking here: nothing else can be holding this atom, and the
+    // lock is shared with other atoms, so that it might already be
+    // held by this very thread, e.g. if this atom is going away
+    // because a link that was the last to hold it is being released.
+    if (_incoming_set) {
+        for (const InSet::Bucket& b : _incoming_set->_buckets) {
+            for (const WinkPtr& w : b._links) {
+                // This can't ever possibly happen. If it does, then
+                // there is some very sick bug with the reference
+                // counting that the shared pointers are doing. (Or
+                // someone explcitly called the destructor! Which they
+                // shouldn't do.)
+                OC_ASSERT(w.expired(),
+                     "Atom deletion failure; incoming set not empty for %s h=%d",
+                     classserver().getTypeName(_type).c_str(), _uuid);
+            }
+        }
+        _incoming_set.reset();
     }
-    drop_incoming_set();
 }
 
 // ==============================================================
@@ -101,7 +111,7 @@ void Atom::setTruthValue(TruthValuePtr newTV)
     // writing this at a time. std:shared_ptr is NOT thread-safe against
     // multiple writers: see "Example 5" in
     // http://www.boost.org/doc/libs/1_53_0/libs/smart_ptr/shared_ptr.htm#ThreadSafety
-    std::unique_lock<std::mutex> lck (_mtx);
+    std::unique_lock<std::mutex> lck (_mtx());
     _truthValue = newTV;
     lck.unlock();
 
@@ -124,7 +134,7 @@ TruthValuePtr Atom::getTruthValue()
     // the multi-threaded async atom store in the SQL peristance backend.
     // Furthermore, we must make a copy while holding the lock! Got that?
 
-    std::lock_guard<std::mutex> lck(_mtx);
+    std::lock_guard<std::mutex> lck(_mtx());
     TruthValuePtr local(_truthValue);
     return local;
 }
@@ -155,54 +165,65 @@ void Atom::merge(TruthValuePtr tvn, const MergeCtrl& mc)
 
 AttentionValuePtr Atom::getAttentionValue()
 {
-    // OK. The atomic thread-safety of shared-pointers is subtle. See
-    // http://www.boost.org/doc/libs/1_53_0/libs/smart_ptr/shared_ptr.htm#ThreadSafety
-    // and http://cppwisdom.quora.com/shared_ptr-is-almost-thread-safe
-    // What it boils down to here is that we must *always* make a copy
-    // of _attentionValue before we use it, since it can go out of scope
-    // because it can get set in another thread.  Viz, using it to
-    // dereference can return a raw pointer to an object that has been
-    // deconstructed. Furthermore, we must make a copy while holding
-    // the lock! Got that?
+    // The attention value is stored inline, and so a new one has to
+    // be made. Most atoms have the default; hand out the shared one.
+    // The three parts must be read together, under the lock.
+    std::unique_lock<std::mutex> lck(_mtx());
+    AttentionValue::sti_t sti = _sti;
+    AttentionValue::lti_t lti = _lti;
+    AttentionValue::vlti_t vlti = _vlti;
+    lck.unlock();
 
-    std::lock_guard<std::mutex> lck(_mtx);
-    AttentionValuePtr local(_attentionValue);
-    return local;
+    if (AttentionValue::DEFAULTATOMSTI == sti and
+        AttentionValue::DEFAULTATOMLTI == lti and
+        AttentionValue::DEFAULTATOMVLTI == vlti)
+        return AttentionValue::DEFAULT_AV();
+    return createAV(sti, lti, vlti);
 }
 
 void Atom::setAttentionValue(AttentionValuePtr av)
 {
-    // Must obtain a local copy of the AV, since there may be
-    // parallel writers in other threads.
-    AttentionValuePtr local(getAttentionValue());
-    if (av == local) return;
-    if (*av == *local) return;
-
-    // Need to lock, shared_ptr is NOT atomic!
-    std::unique_lock<std::mutex> lck (_avmtx);
-    local = _attentionValue; // Get it again, to avoid races.
-    _attentionValue = av;
+    std::unique_lock<std::mutex> lck(_mtx());
+    if (av->getSTI() == _sti and av->getLTI() == _lti and
+        av->getVLTI() == _vlti) return;
+
+    // The old value is needed for the signal, below.
+    AttentionValuePtr local(createAV(_sti, _lti, _vlti));
+    int oldBin = ImportanceIndex::importanceBin(_sti);
+    int newBin = ImportanceIndex::importanceBin(av->getSTI());
+    _sti = av->getSTI();
+    _lti = av->getLTI();
+    _vlti = av->getVLTI();
+
+    // If the atom importance has changed its bin, update the
+    // importance index. This is done under the lock; otherwise, two
+    // threads changing the STI at once could leave the atom in the
+    // wrong bin.
+    if (NULL != _atomTable and oldBin != newBin)
+        _atomTable->updateImportanceIndex(this, oldBin, newBin);
     lck.unlock();
 
     // If the atom free-floating, we are done.
     if (NULL == _atomTable) return;
 
-    // Get old and new bins.
-    int oldBin = ImportanceIndex::importanceBin(local->getSTI());
-    int newBin = ImportanceIndex::importanceBin(av->getSTI());
-
-    // If the atom importance has changed its bin,
-    // update the importance index.
-    if (oldBin != newBin) {
-        AtomPtr a(shared_from_this());
-        _atomTable->updateImportanceIndex(a, oldBin);
-    }
-
     // Notify any interested parties that the AV changed.
     AVCHSigl& avch = _atomTable->AVChangedSignal();
     avch(getHandle(), local, av);
 }
 
+AttentionValue::sti_t Atom::exchangeSTI(AttentionValue::sti_t sti)
+{
+    std::lock_guard<std::mutex> lck(_mtx());
+    AttentionValue::sti_t old = _sti;
+    _sti = sti;
+
+    int oldBin = ImportanceIndex::importanceBin(old);
+    int newBin = ImportanceIndex::importanceBin(sti);
+    if (NULL != _atomTable and oldBin != newBin)
+        _atomTable->updateImportanceIndex(this, oldBin, newBin);
+    return old;
+}
+
 void Atom::chgVLTI(int unit)
 {
     AttentionValuePtr old_av = getAttentionValue();
@@ -273,14 +294,15 @@ void Atom::setAtomTable(AtomTable *tb)
 /// is made, those links won't show up in the incoming set.
 ///
 /// We don't automatically track incoming sets for two reasons:
-/// 1) std::set takes up 48 bytes
+/// 1) it takes up memory
 /// 2) adding and remoiving uses up cpu cycles.
 /// Thus, if the incoming set isn't needed, then don't bother
 /// tracking it.
 void Atom::keep_incoming_set()
 {
     if (_incoming_set) return;
-    _incoming_set = std::make_shared<InSet>();
+    _incoming_set.reset(new InSet());
+    _incoming_set->_live = 0;
 }
 
 /// Stop tracking the incoming set for this atom.
@@ -289,39 +311,117 @@ void Atom::keep_incoming_set()
 void Atom::drop_incoming_set()
 {
     if (NULL == _incoming_set) return;
-    std::lock_guard<std::mutex> lck (_mtx);
-    _incoming_set->_iset.clear();
-    // delete _incoming_set;
-    _incoming_set = NULL;
+    std::lock_guard<std::mutex> lck (_mtx());
+    _incoming_set.reset();
 }
 
 /// Add an atom to the incoming set.
-void Atom::insert_atom(LinkPtr a)
+void Atom::insert_atom(const LinkPtr& a)
 {
     if (NULL == _incoming_set) return;
-    std::lock_guard<std::mutex> lck (_mtx);
-    _incoming_set->_iset.insert(a);
+    std::lock_guard<std::mutex> lck (_mtx());
+
+    // If this atom occurs more than once in the outgoing set of the
+    // link, then the link might be here already.
+    size_t& slot = a->inslot(this);
+    if (Link::NO_SLOT != slot) return;
+
+    Type t = a->getType();
+    InSet::Bucket* b = _incoming_set->find(t);
+    if (NULL == b)
+    {
+        _incoming_set->_buckets.emplace_back();
+        b = &_incoming_set->_buckets.back();
+        b->_type = t;
+        b->_live = 0;
+    }
+
+    slot = b->_links.size();
+    b->_links.emplace_back(a);
+    b->_live++;
+    _incoming_set->_live++;
 #ifdef INCOMING_SET_SIGNALS
     _incoming_set->_addAtomSignal(shared_from_this(), a);
 #endif /* INCOMING_SET_SIGNALS */
 }
 
 /// Remove an atom from the incoming set.
-void Atom::remove_atom(LinkPtr a)
+void Atom::remove_atom(const LinkPtr& a)
 {
     if (NULL == _incoming_set) return;
-    std::lock_guard<std::mutex> lck (_mtx);
+    std::lock_guard<std::mutex> lck (_mtx());
+
+    size_t& slot = a->inslot(this);
+    if (Link::NO_SLOT == slot) return;
 #ifdef INCOMING_SET_SIGNALS
     _incoming_set->_removeAtomSignal(shared_from_this(), a);
 #endif /* INCOMING_SET_SIGNALS */
-    _incoming_set->_iset.erase(a);
+
+    // Leave a tombstone behind.
+    InSet::Bucket* b = _incoming_set->find(a->getType());
+    b->_links[slot].reset();
+    slot = Link::NO_SLOT;
+    b->_live--;
+    _incoming_set->_live--;
+
+    // A partition with nothing but tombstones in it can simply go;
+    // no link refers to any of its slots any more.
+    if (0 == b->_live)
+    {
+        std::swap(*b, _incoming_set->_buckets.back());
+        _incoming_set->_buckets.pop_back();
+    }
+    else if (2 * b->_live < b->_links.size())
+        _incoming_set->compact(*b, this);
+}
+
+/// Squeeze the tombstones out of one partition of the incoming set of
+/// atom, and tell the links that moved where they are now. Must be
+/// called with the atom lock held.
+void Atom::InSet::compact(Bucket& b, Atom* atom)
+{
+    size_t n = b._links.size();
+    size_t j = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        LinkPtr l(b._links[i].lock());
+        if (nullptr == l) continue;
+        if (i != j)
+        {
+            b._links[j] = b._links[i];
+            l->inslot(atom) = j;
+        }
+        j++;
+    }
+    b._links.resize(j);
+    b._live = j;
+
+    // Give back the memory, if we shrunk a lot.
+    if (4 * j < b._links.capacity())
+        b._links.shrink_to_fit();
 }
 
 size_t Atom::getIncomingSetSize()
 {
     if (NULL == _incoming_set) return 0;
-    std::lock_guard<std::mutex> lck (_mtx);
-    return _incoming_set->_iset.size();
+    std::lock_guard<std::mutex> lck (_mtx());
+    return _incoming_set->_live;
+}
+
+size_t Atom::getIncomingSetSizeByType(Type type, bool subclass)
+{
+    if (NULL == _incoming_set) return 0;
+    std::lock_guard<std::mutex> lck (_mtx());
+    if (not subclass)
+    {
+        InSet::Bucket* b = _incoming_set->find(type);
+        return b ? b->_live : 0;
+    }
+
+    size_t n = 0;
+    for (const InSet::Bucket& b : _incoming_set->_buckets)
+        if (classserver().isA(b._type, type)) n += b._live;
+    return n;
 }
 
 // We return a copy here, and not a reference, because the set itself
@@ -336,34 +436,53 @@ IncomingSet Atom::getIncomingSet(AtomSpace* as)
     if (as) {
         const AtomTable *atab = &as->get_atomtable();
         // Prevent update of set while a copy is being made.
-        std::lock_guard<std::mutex> lck (_mtx);
+        std::lock_guard<std::mutex> lck (_mtx());
         IncomingSet iset;
-        for (WinkPtr w : _incoming_set->_iset)
+        for (const InSet::Bucket& b : _incoming_set->_buckets)
         {
-            LinkPtr l(w.lock());
-            if (l and atab->in_environ(l))
-                iset.emplace_back(l);
+            for (const WinkPtr& w : b._links)
+            {
+                LinkPtr l(w.lock());
+                if (l and atab->in_environ(l))
+                    iset.emplace_back(l);
+            }
         }
         return iset;
     }
 
     // Prevent update of set while a copy is being made.
-    std::lock_guard<std::mutex> lck (_mtx);
+    std::lock_guard<std::mutex> lck (_mtx());
     IncomingSet iset;
-    for (WinkPtr w : _incoming_set->_iset)
+    iset.reserve(_incoming_set->_live);
+    for (const InSet::Bucket& b : _incoming_set->_buckets)
     {
-        LinkPtr l(w.lock());
-        if (l) iset.emplace_back(l);
+        for (const WinkPtr& w : b._links)
+        {
+            LinkPtr l(w.lock());
+            if (l) iset.emplace_back(l);
+        }
     }
     return iset;
 }
 
-IncomingSet Atom::getIncomingSetByType(Type type, bool subclass)
+IncomingSet Atom::getIncomingSetByType(Type type, bool subclass,
+                                       AtomSpace* as)
 {
-    HandleSeq inhs;
-    getIncomingSetByType(std::back_inserter(inhs), type, subclass);
     IncomingSet inlinks;
-    for (const Handle& h : inhs)
-        inlinks.emplace_back(LinkCast(h));
+    if (NULL == _incoming_set) return inlinks;
+    const AtomTable *atab = as ? &as->get_atomtable() : NULL;
+    std::lock_guard<std::mutex> lck (_mtx());
+    for (const InSet::Bucket& b : _incoming_set->_buckets)
+    {
+        if (type != b._type and
+            (not subclass or not classserver().isA(b._type, type)))
+            continue;
+        for (const WinkPtr& w : b._links)
+        {
+            LinkPtr l(w.lock());
+            if (l and (NULL == atab or atab->in_environ(l)))
+                inlinks.emplace_back(l);
+        }
+    }
     return inlinks;
 }
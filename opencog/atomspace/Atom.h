@@ -28,6 +28,7 @@
 #define _OPENCOG_ATOM_H
 
 #include <memory>
+#include <stdint.h>
 #include <mutex>
 #include <set>
 #include <string>
@@ -56,13 +57,13 @@ class Link;
 typedef std::shared_ptr<Link> LinkPtr;
 typedef std::vector<LinkPtr> IncomingSet; // use vector; see below.
 typedef std::weak_ptr<Link> WinkPtr;
-typedef std::set<WinkPtr, std::owner_less<WinkPtr> > WincomingSet;
+typedef std::vector<WinkPtr> WincomingSet;
 typedef boost::signals2::signal<void (AtomPtr, LinkPtr)> AtomPairSignal;
 
 // We use a std:vector instead of std::set for IncomingSet, because
 // virtually all access will be either insert, or iterate, so we get
-// O(1) performance. We use std::set for WincomingSet, because we want
-// both good insert and good remove performance.  Note that sometimes
+// O(1) performance. WincomingSet is a vector too, with tombstones
+// for the removed links; see Atom::InSet.  Note that sometimes
 // incoming sets can be huge (millions of atoms).
 
 /**
@@ -76,13 +77,15 @@ class Atom
 {
     friend class ::AtomUTest;     // Needs to call setFlag()
     friend class AtomStorage;     // Needs to set _uuid
+    friend class MmapStorage;     // Needs to set _uuid
     friend class AtomTable;       // Needs to call MarkedForRemoval()
     friend class AtomSpace;       // Needs to call getAtomTable()
-    friend class ImportanceIndex; // Needs to call setFlag()
+    friend class ImportanceIndex; // Needs to lock the atom
     friend class Handle;          // Needs to view _uuid
     friend class TLB;             // Needs to view _uuid
     friend class CreateLink;      // Needs to call getAtomTable();
     friend class DeleteLink;      // Needs to call getAtomTable();
+    friend class StandingQuery;   // Needs to call isMarkedForRemoval()
     friend class ProtocolBufferSerializer; // Needs to de/ser-ialize an Atom
 
 private:
@@ -101,15 +104,32 @@ protected:
     // Byte of bitflags (each bit is a flag, see AtomSpaceDefinites.h)
     char _flags;
 
+    // The attention value is kept inline; it is only six bytes, which
+    // fit in the padding after the type and flags.  This is much less
+    // than a pointer to a separately allocated AttentionValue.
+    AttentionValue::sti_t _sti;
+    AttentionValue::lti_t _lti;
+    AttentionValue::vlti_t _vlti;
+
     TruthValuePtr _truthValue;
-    AttentionValuePtr _attentionValue;
+
+    // Structural hash, set by the subclass constructors; see getHash().
+    // Kept here, rather than computed on demand, because hashing a link
+    // needs the hashes of all of its outgoing atoms.
+    size_t _hash;
 
     // Lock, used to serialize changes.
-    // This costs 40 bytes per atom.  Tried using a single, global lock,
-    // but there seemed to be too much contention for it, so instead,
-    // we are using a lock-per-atom, even though this makes the atom
-    // kind-of fat.
-    std::mutex _mtx;
+    // A std::mutex costs 40 bytes, which would make the atom fat.  A
+    // single, global lock has too much contention; so instead, there
+    // is a fixed array of locks, and each atom uses the one picked by
+    // its address.  Since atoms can share a lock, no code may take
+    // the lock of one atom, while holding that of another.
+    static const size_t NUM_ATOM_MUTEXES = 1024;
+    static std::mutex _atom_mutexes[NUM_ATOM_MUTEXES];
+    std::mutex& _mtx(void) const
+    {
+        return _atom_mutexes[(((uintptr_t) this) >> 4) % NUM_ATOM_MUTEXES];
+    }
 
     /**
      * Constructor for this class. Protected; no user should call this
@@ -127,8 +147,11 @@ protected:
         _atomTable(NULL),
         _type(t),
         _flags(0),
+        _sti(av->getSTI()),
+        _lti(av->getLTI()),
+        _vlti(av->getVLTI()),
         _truthValue(tv),
-        _attentionValue(av)
+        _hash(0)
     {}
 
     struct InSet
@@ -136,10 +159,40 @@ protected:
         // The incoming set is not tracked by the garbage collector;
         // this is required, in order to avoid cyclic references.
         // That is, we use weak pointers here, not strong ones.
-        // std::set<ptr> uses 48 bytes (per atom).  See the README file
-        // in this directory for a slightly longer explanation for why
-        // weak pointers are needed, and why bdgc cannot be used.
-        WincomingSet _iset;
+        // See the README file in this directory for a slightly longer
+        // explanation for why weak pointers are needed, and why bdgc
+        // cannot be used.
+        //
+        // The links are partitioned by their type; each partition is
+        // a contiguous vector, in the order that the links were added.
+        // This costs 16 bytes per link, makes iteration sequential,
+        // and lets a lookup by type skip over all links of the other
+        // types.  There are seldom more than a handful of distinct
+        // link types in any one incoming set, so the partitions are
+        // simply kept in a vector, and searched linearly.
+        //
+        // A removed link leaves an empty weak pointer behind (a
+        // tombstone); the tombstones of a partition are squeezed out
+        // once they outnumber its live links.  Each link remembers its
+        // slot in (the partition of) the incoming sets of its outgoing
+        // atoms (see Link::_inslot), so that removal does not need to
+        // search.
+        struct Bucket
+        {
+            Type _type;
+            size_t _live;
+            WincomingSet _links;
+        };
+        std::vector<Bucket> _buckets;
+        size_t _live;
+
+        Bucket* find(Type t)
+        {
+            for (Bucket& b : _buckets)
+                if (t == b._type) return &b;
+            return NULL;
+        }
+        void compact(Bucket&, Atom*);
 #ifdef INCOMING_SET_SIGNALS
         // Some people want to know if the incoming set has changed...
         // However, these make the atom quite fat, so this is disabled
@@ -149,14 +202,13 @@ protected:
         AtomPairSignal _removeAtomSignal;
 #endif /* INCOMING_SET_SIGNALS */
     };
-    typedef std::shared_ptr<InSet> InSetPtr;
-    InSetPtr _incoming_set;
+    std::unique_ptr<InSet> _incoming_set;
     void keep_incoming_set();
     void drop_incoming_set();
 
     // Insert and remove links from the incoming set.
-    void insert_atom(LinkPtr);
-    void remove_atom(LinkPtr);
+    void insert_atom(const LinkPtr&);
+    void remove_atom(const LinkPtr&);
 
 private:
     /** Returns whether this atom is marked for removal.
@@ -189,6 +241,14 @@ private:
     /** Change the Very-Long-Term Importance */
     void chgVLTI(int unit);
 
+    /** Change the Short-Term Importance, and the importance bin,
+     * without emitting the AV-changed signal; used by the batch
+     * update in the AtomTable, which emits a signal of its own.
+     *
+     * @return The old Short-Term Importance.
+     */
+    AttentionValue::sti_t exchangeSTI(AttentionValue::sti_t);
+
 public:
 
     virtual ~Atom();
@@ -230,19 +290,23 @@ public:
     void setAttentionValue(AttentionValuePtr);
 
     /// Handy-dandy convenience getters for attention values.
+    /// These do not need to make an AttentionValue.
     AttentionValue::sti_t getSTI()
     {
-        return getAttentionValue()->getSTI();
+        std::lock_guard<std::mutex> lck(_mtx());
+        return _sti;
     }
 
     AttentionValue::lti_t getLTI()
     {
-        return getAttentionValue()->getLTI();
+        std::lock_guard<std::mutex> lck(_mtx());
+        return _lti;
     }
 
     AttentionValue::vlti_t getVLTI()
     {
-        return getAttentionValue()->getVLTI();
+        std::lock_guard<std::mutex> lck(_mtx());
+        return _vlti;
     }
 
     /** Change the Short-Term Importance */
@@ -321,14 +385,16 @@ public:
     getIncomingSet(OutputIterator result)
     {
         if (NULL == _incoming_set) return result;
-        std::lock_guard<std::mutex> lck(_mtx);
+        std::lock_guard<std::mutex> lck(_mtx());
         // Sigh. I need to compose copy_if with transform. I could
         // do this wih boost range adaptors, but I don't feel like it.
-        auto end = _incoming_set->_iset.end();
-        for (auto w = _incoming_set->_iset.begin(); w != end; w++)
+        for (const InSet::Bucket& b : _incoming_set->_buckets)
         {
-            Handle h(w->lock());
-            if (h) { *result = h; result ++; }
+            for (const WinkPtr& w : b._links)
+            {
+                Handle h(w.lock());
+                if (h) { *result = h; result ++; }
+            }
         }
         return result;
     }
@@ -366,25 +432,37 @@ public:
                          Type type, bool subclass = false)
     {
         if (NULL == _incoming_set) return result;
-        std::lock_guard<std::mutex> lck(_mtx);
-        // Sigh. I need to compose copy_if with transform. I could
-        // do this wih boost range adaptors, but I don't feel like it.
-        auto end = _incoming_set->_iset.end();
-        for (auto w = _incoming_set->_iset.begin(); w != end; w++)
+        std::lock_guard<std::mutex> lck(_mtx());
+        // Only the partitions of the matching types need be visited.
+        for (const InSet::Bucket& b : _incoming_set->_buckets)
         {
-            Handle h(w->lock());
-            if (h and h->isType(type, subclass)) {
-                *result = h;
-                result ++;
+            if (type != b._type and
+                (not subclass or not classserver().isA(b._type, type)))
+                continue;
+            for (const WinkPtr& w : b._links)
+            {
+                Handle h(w.lock());
+                if (h) { *result = h; result ++; }
             }
         }
         return result;
     }
 
     /**
-     * Functional version of getIncomingSetByType
+     * Functional version of getIncomingSetByType.  As with
+     * getIncomingSet(), if the AtomSpace pointer is non-null, then
+     * only those links that belong to that atomspace are returned.
      */
-    IncomingSet getIncomingSetByType(Type type, bool subclass = false);
+    IncomingSet getIncomingSetByType(Type type, bool subclass = false,
+                                     AtomSpace* = NULL);
+
+    /**
+     * Return the number of links of the given type (and optionally,
+     * of its subtypes) in the incoming set.  This does not copy the
+     * incoming set; it is cheap, and meant for use in heuristics,
+     * such as picking the thinnest place to start a search at.
+     */
+    size_t getIncomingSetSizeByType(Type type, bool subclass = false);
 
     /** Returns a string representation of the node.
      *
@@ -412,6 +490,12 @@ public:
      */
     virtual bool operator!=(const Atom&) const = 0;
 
+    /** Returns the structural hash of the atom: it depends only on
+     * the type, and on the name or the outgoing set, so that atoms
+     * that are equal have the same hash.
+     */
+    size_t getHash() const { return _hash; }
+
 
 };
 
@@ -0,0 +1,191 @@
+/*
+ * opencog/atomspace/AtomHashIndex.cc
+ *
+ * Copyright (C) 2015 OpenCog Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <thread>
+
+#include <opencog/atomspace/AtomHashIndex.h>
+
+using namespace opencog;
+
+// Initial number of slots; must be a power of two.
+#define INITIAL_SLOTS 16
+
+const size_t AtomHashIndex::EMPTY;
+const size_t AtomHashIndex::TOMBSTONE;
+
+AtomHashIndex::AtomHashIndex(void)
+	: _table(new_table(INITIAL_SLOTS)), _size(0), _epoch(0)
+{
+	_readers[0] = 0;
+	_readers[1] = 0;
+}
+
+AtomHashIndex::~AtomHashIndex()
+{
+	free_table(_table.load());
+}
+
+AtomHashIndex::Table* AtomHashIndex::new_table(size_t nslots)
+{
+	Table* tab = new Table;
+	tab->mask = nslots - 1;
+	tab->used = 0;
+	tab->slots = new Slot[nslots];
+	for (size_t i = 0; i < nslots; i++)
+		tab->slots[i].key.store(EMPTY, std::memory_order_relaxed);
+	return tab;
+}
+
+void AtomHashIndex::free_table(Table* tab)
+{
+	delete[] tab->slots;
+	delete tab;
+}
+
+/// Fill the first empty slot on the probe path of the key. Must be
+/// called with the writer lock held.
+void AtomHashIndex::put(Table* tab, size_t hash, const std::weak_ptr<Atom>& w)
+{
+	size_t k = key(hash);
+	size_t i = mix(k) & tab->mask;
+	while (EMPTY != tab->slots[i].key.load(std::memory_order_relaxed))
+		i = (i + 1) & tab->mask;
+
+	// Fill in the slot before publishing it.
+	tab->slots[i].weak = w;
+	tab->slots[i].key.store(k, std::memory_order_release);
+	tab->used++;
+}
+
+void AtomHashIndex::insert(size_t hash, const AtomPtr& atom)
+{
+	std::lock_guard<std::mutex> lck(_mtx);
+	Table* tab = _table.load(std::memory_order_relaxed);
+
+	// Keep the load factor, tombstones included, at three-quarters
+	// or below; there must always be an empty slot to end a probe.
+	if (3 * (tab->mask + 1) <= 4 * (tab->used + 1))
+	{
+		rebuild();
+		tab = _table.load(std::memory_order_relaxed);
+	}
+	put(tab, hash, atom);
+	_size++;
+}
+
+/// Turn a slot into a tombstone. Must be called with the writer lock
+/// held.
+void AtomHashIndex::bury(Slot& slot)
+{
+	// Readers that are on this slot might still look at the weak
+	// pointer; it is released when the table is.
+	slot.key.store(TOMBSTONE, std::memory_order_release);
+	_size--;
+}
+
+void AtomHashIndex::remove(size_t hash, const AtomPtr& atom)
+{
+	std::lock_guard<std::mutex> lck(_mtx);
+	Table* tab = _table.load(std::memory_order_relaxed);
+
+	size_t k = key(hash);
+	for (size_t i = mix(k) & tab->mask; ; i = (i + 1) & tab->mask)
+	{
+		Slot& slot = tab->slots[i];
+		size_t sk = slot.key.load(std::memory_order_relaxed);
+		if (EMPTY == sk) break;
+		if (sk == k and not slot.weak.owner_before(atom)
+		            and not atom.owner_before(slot.weak))
+		{
+			bury(slot);
+			break;
+		}
+	}
+
+	// Tombstones keep the memory of removed atoms from being freed
+	// (the weak pointers hold on to it) and lengthen the probes;
+	// don't let them outnumber the atoms.
+	if (too_many_tombstones(tab))
+		rebuild();
+}
+
+void AtomHashIndex::remove_if(bool (*filter)(const Handle&))
+{
+	std::lock_guard<std::mutex> lck(_mtx);
+	Table* tab = _table.load(std::memory_order_relaxed);
+
+	for (size_t i = 0; i <= tab->mask; i++)
+	{
+		Slot& slot = tab->slots[i];
+		if (slot.key.load(std::memory_order_relaxed) < 2) continue;
+		Handle h(slot.weak.lock());
+		if (nullptr == h or filter(h))
+			bury(slot);
+	}
+	if (too_many_tombstones(tab))
+		rebuild();
+}
+
+bool AtomHashIndex::too_many_tombstones(const Table* tab) const
+{
+	return INITIAL_SLOTS / 2 < tab->used and _size < tab->used - _size;
+}
+
+/// Copy the atoms into a new table, big enough that it is at most
+/// half full, and retire the old one. The slots cannot be cleaned up
+/// in place, as readers might be probing them. Must be called with
+/// the writer lock held.
+void AtomHashIndex::rebuild(void)
+{
+	Table* old = _table.load(std::memory_order_relaxed);
+	size_t nslots = INITIAL_SLOTS;
+	while (nslots < 2 * (_size + 1)) nslots *= 2;
+
+	Table* tab = new_table(nslots);
+	for (size_t i = 0; i <= old->mask; i++)
+	{
+		const Slot& slot = old->slots[i];
+		size_t sk = slot.key.load(std::memory_order_relaxed);
+		if (sk < 2) continue;
+		put(tab, sk, slot.weak);
+	}
+	_table.store(tab, std::memory_order_release);
+
+	synchronize();
+	free_table(old);
+}
+
+/// Wait until all readers that might have seen the table before it
+/// was replaced have left. Must be called with the writer lock held.
+///
+/// The old table was unpublished before the epoch is advanced, so
+/// only readers that entered in the current epoch can still see it.
+/// Readers of the epoch before that were waited out the previous time
+/// around.
+void AtomHashIndex::synchronize(void)
+{
+	size_t e = _epoch.load();
+	_epoch.store(e + 1);
+	while (0 != _readers[e & 1].load())
+		std::this_thread::yield();
+}
+
+// ================================================================
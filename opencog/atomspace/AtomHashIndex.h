@@ -0,0 +1,168 @@
+/*
+ * opencog/atomspace/AtomHashIndex.h
+ *
+ * Copyright (C) 2015 OpenCog Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _OPENCOG_ATOM_HASH_INDEX_H
+#define _OPENCOG_ATOM_HASH_INDEX_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include <opencog/atomspace/Atom.h>
+
+namespace opencog
+{
+/** \addtogroup grp_atomspace
+ *  @{
+ */
+
+/**
+ * Implements a hash table of atoms, with lock-free lookup.
+ *
+ * Writers (insert and remove) are serialized by a mutex; readers never
+ * lock, and never wait for writers. The table uses open addressing,
+ * with linear probing: each slot holds the hash of an atom and a weak
+ * pointer to it, so that a probe walks a contiguous array, and there
+ * is no allocation per entry.
+ *
+ * A slot is filled only while it is empty, and, once filled, it is
+ * never written again: a removed atom leaves a tombstone behind.
+ * Thus, readers always see a consistent slot. When tombstones and
+ * atoms fill up too much of the table, it is rebuilt into a new
+ * table, which is then published with an atomic pointer store. The
+ * old table is freed only after all readers that might still see it
+ * have left (epoch-based reclamation, a simple form of RCU). Readers
+ * announce themselves in one of two counters, picked by the parity of
+ * the current epoch. To reclaim, a writer advances the epoch, and
+ * waits for the counter of the previous epoch to drain.
+ *
+ * The caller supplies the hash of each atom; lookups also need a
+ * predicate that recognizes the atom that is being looked for.
+ */
+class AtomHashIndex
+{
+	private:
+		// The key of a slot is the hash of the atom in it, or one of
+		// these; hashes that collide with them are moved out of the way.
+		static const size_t EMPTY = 0;
+		static const size_t TOMBSTONE = 1;
+		static size_t key(size_t hash)
+		{
+			return hash < 2 ? hash + 2 : hash;
+		}
+
+		struct Slot
+		{
+			std::atomic<size_t> key;
+			std::weak_ptr<Atom> weak;
+		};
+		struct Table
+		{
+			size_t mask;
+			size_t used;   // atoms and tombstones
+			Slot* slots;
+		};
+
+		std::atomic<Table*> _table;
+		std::atomic<size_t> _size;
+
+		// Serializes the writers.
+		mutable std::mutex _mtx;
+
+		// Epoch-based reclamation of retired tables.
+		std::atomic<size_t> _epoch;
+		mutable std::atomic<size_t> _readers[2];
+		void synchronize(void);
+		void rebuild(void);
+
+		size_t read_lock(void) const
+		{
+			while (true)
+			{
+				size_t e = _epoch.load();
+				_readers[e & 1]++;
+				if (_epoch.load() == e) return e;
+				_readers[e & 1]--;
+			}
+		}
+		void read_unlock(size_t e) const
+		{
+			_readers[e & 1]--;
+		}
+
+		// The low bits of the hash pick the first slot to probe; the
+		// caller's hash may be weak, so mix it up first.
+		static size_t mix(size_t h)
+		{
+			h ^= h >> 33;
+			h *= 0xff51afd7ed558ccdULL;
+			h ^= h >> 33;
+			return h;
+		}
+
+		static Table* new_table(size_t);
+		static void free_table(Table*);
+		static void put(Table*, size_t, const std::weak_ptr<Atom>&);
+		void bury(Slot&);
+		bool too_many_tombstones(const Table*) const;
+
+	public:
+		AtomHashIndex(void);
+		~AtomHashIndex();
+
+		void insert(size_t hash, const AtomPtr&);
+		void remove(size_t hash, const AtomPtr&);
+		void remove_if(bool (*)(const Handle&));
+		size_t size(void) const { return _size; }
+
+		/**
+		 * Return the atom with the given hash, for which match(atom)
+		 * is true, or the undefined handle if there is no such atom.
+		 * Never blocks.
+		 */
+		template <typename Match>
+		Handle find(size_t hash, Match match) const
+		{
+			Handle h;
+			size_t k = key(hash);
+			size_t e = read_lock();
+			const Table* tab = _table.load(std::memory_order_acquire);
+			for (size_t i = mix(k) & tab->mask; ; i = (i + 1) & tab->mask)
+			{
+				size_t sk = tab->slots[i].key.load(std::memory_order_acquire);
+				if (EMPTY == sk) break;
+				if (sk != k) continue;
+				AtomPtr atom(tab->slots[i].weak.lock());
+				if (atom and match(atom.operator->()))
+				{
+					h = Handle(atom);
+					break;
+				}
+			}
+			read_unlock(e);
+			return h;
+		}
+};
+
+/** @}*/
+} //namespace opencog
+
+#endif // _OPENCOG_ATOM_HASH_INDEX_H
@@ -142,6 +142,20 @@ Handle AtomSpace::add_atom(AtomPtr atom, bool async)
     return rh;
 }
 
+HandleSeq AtomSpace::add_atoms(const HandleSeq& atoms, bool async)
+{
+    // The backing store has to be asked about each atom, one at a
+    // time; there is nothing to be gained by batching.
+    if (backing_store) {
+        HandleSeq result;
+        for (const Handle& h : atoms)
+            result.emplace_back(add_atom(h, async));
+        return result;
+    }
+
+    return atomTable.add_atoms(atoms, async);
+}
+
 Handle AtomSpace::add_node(Type t, const string& name,
                            bool async)
 {
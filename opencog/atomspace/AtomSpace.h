@@ -55,6 +55,7 @@ class AtomSpace
 {
     friend class Atom;               // Needs to call get_atomtable()
     friend class SQLPersistSCM;
+    friend class MmapPersistSCM;
     friend class ZMQPersistSCM;
     friend class ::AtomTableUTest;
 
@@ -112,6 +113,35 @@ public:
      */
     Handle add_atom(AtomPtr atom, bool async=false);
 
+    /**
+     * Add a sequence of atoms to the Atom Table.  This is the same
+     * as calling add_atom() on each of them, but is cheaper for large
+     * batches. The returned handles are in the same order as the
+     * given atoms.  If async is set, then barrier() must be called
+     * before the atoms can be found by name or type.
+     */
+    HandleSeq add_atoms(const HandleSeq& atoms, bool async=false);
+
+    /**
+     * Write all of the atoms in this atomspace, with their truth
+     * values, to a snapshot file.  The atoms are written in order of
+     * their height, each after its outgoing set; names are written
+     * once each, and outgoing sets as packed arrays.  The file is
+     * written aside and then renamed, so that the file at path is
+     * always complete.  Attention values are not saved.
+     */
+    void save_snapshot(const std::string& path);
+
+    /**
+     * Add the atoms in a snapshot file, written by save_snapshot(), to
+     * this atomspace.  The file is mapped into memory, and the atoms
+     * made straight out of it, a height at a time, by several threads.
+     * If none of the UUID's in the snapshot have been issued yet, the
+     * atoms keep them, and they are reserved with the TLB; otherwise
+     * they are given new ones.  Returns the number of atoms read.
+     */
+    size_t load_snapshot(const std::string& path);
+
     /**
      * Add a node to the Atom Table.  If the atom already exists
      * then that is returned.
@@ -186,10 +216,10 @@ public:
 
     /**
      * Make sure all atom writes have completed, before returning.
-     * This only has an effect when the atomspace is backed by some
-     * sort of storage, or is sending atoms to some remote location
-     * asynchronously. This simply guarantees that the asynch
-     * operations have completed.
+     * This only has an effect when atoms were added asynchronously,
+     * or when the atomspace is backed by some sort of storage, or is
+     * sending atoms to some remote location asynchronously. This
+     * simply guarantees that the asynch operations have completed.
      * NB: at this time, we don't distinguish barrier and flush.
      */
     void barrier(void) {
@@ -568,6 +598,20 @@ public:
     long get_STI_funds() const { return bank.getSTIFunds(); }
     long get_LTI_funds() const { return bank.getLTIFunds(); }
 
+    /**
+     * Set the STI of many atoms at once; for attention allocation,
+     * which updates a great many STI values on each cycle.  Instead of
+     * one AV-changed signal per atom, a single STI-changed signal is
+     * emitted for the batch.  Unlike the single-atom setters, this
+     * also widens the min/max STI to cover the new values.
+     *
+     * @param hs The atoms to update
+     * @param stis Their new STI values; one for each atom
+     */
+    void set_STI(const HandleSeq& hs,
+                 const std::vector<AttentionValue::sti_t>& stis)
+    { atomTable.setSTI(hs, stis); }
+
     /* ----------------------------------------------------------- */
     // ---- Signals
 
@@ -587,6 +631,10 @@ public:
     {
         return atomTable.TVChangedSignal().connect(function);
     }
+    boost::signals2::connection STIChangedSignal(const STICHSigl::slot_type& function)
+    {
+        return atomTable.STIChangedSignal().connect(function);
+    }
     boost::signals2::connection AddAFSignal(const AVCHSigl::slot_type& function)
     {
         return bank.AddAFSignal().connect(function);
@@ -0,0 +1,642 @@
+/*
+ * opencog/atomspace/AtomSpaceSnapshot.cc
+ *
+ * Copyright (c) 2015 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <opencog/atomspace/ClassServer.h>
+#include <opencog/atomspace/Link.h>
+#include <opencog/atomspace/Node.h>
+#include <opencog/atomspace/TLB.h>
+#include <opencog/truthvalue/CountTruthValue.h>
+#include <opencog/truthvalue/IndefiniteTruthValue.h>
+#include <opencog/truthvalue/ProbabilisticTruthValue.h>
+#include <opencog/truthvalue/SimpleTruthValue.h>
+#include <opencog/util/exceptions.h>
+#include <opencog/util/Logger.h>
+#include <opencog/util/oc_assert.h>
+
+#include "AtomSpace.h"
+
+using namespace opencog;
+
+// ====================================================================
+//
+// The snapshot file is a header, followed by these sections, each a
+// packed array, in this order:
+//
+//   types     -- SnapString, the name of each type used; a type is
+//                stored as its number in this array.
+//   names     -- SnapString, each distinct node name, once.
+//   strings   -- the characters of the type and node names.
+//   heights   -- uint64_t, the number of atoms of each height and
+//                below; the atoms of height h are those from
+//                heights[h-1] to heights[h].
+//   atoms     -- SnapAtom, in order of height.
+//   outgoing  -- uint64_t, the outgoing sets, as the numbers of the
+//                atoms in the atoms array.
+//   tvs       -- SnapTV, the truth values that are not the default.
+//
+// The file is in the byte order of the machine that wrote it.  Links
+// refer to their outgoing set by position in the file, not by UUID,
+// so that loading needs no lookups; the UUID's are kept alongside.
+
+namespace {
+
+static const char SNAPSHOT_MAGIC[8] = "OCSNAP1";
+
+struct SnapHeader
+{
+    char magic[8];
+    uint64_t n_types, n_names, n_heights, n_atoms, n_outgoing, n_tvs;
+    uint64_t types_off, names_off, strings_off, heights_off,
+             atoms_off, outgoing_off, tvs_off, size;
+    UUID min_uuid, max_uuid;
+};
+
+struct SnapString
+{
+    uint64_t off;       // Offset in the strings section.
+    uint64_t len;
+};
+
+#define NODE_ATOM 0x1
+#define NO_TV ((uint64_t) -1)
+
+struct SnapAtom
+{
+    UUID uuid;
+    uint64_t body;      // Number of the name, or offset of the outgoing set.
+    uint64_t tv;        // Number of the truth value, or NO_TV.
+    uint32_t size;      // Arity.
+    uint16_t type;      // Number of the type.
+    uint16_t flags;
+};
+
+struct SnapTV
+{
+    uint32_t type;
+    uint32_t pad;
+    double mean;
+    double confidence;
+    double count;
+};
+
+static size_t align8(size_t n) { return (n + 7) & ~((size_t) 7); }
+
+/// The truth value as mean, confidence and count, the same as the
+/// persistence backends store it.  Returns false for the default TV.
+static bool tv_to_snap(const TruthValuePtr& tv, SnapTV& s)
+{
+    memset(&s, 0, sizeof(s));
+    if (nullptr == tv or tv->isDefaultTV()) return false;
+
+    s.type = tv->getType();
+    switch (s.type)
+    {
+        case NULL_TRUTH_VALUE:
+            return false;
+        case SIMPLE_TRUTH_VALUE:
+        case COUNT_TRUTH_VALUE:
+        case PROBABILISTIC_TRUTH_VALUE:
+            s.mean = tv->getMean();
+            s.confidence = tv->getConfidence();
+            s.count = tv->getCount();
+            return true;
+        case INDEFINITE_TRUTH_VALUE:
+        {
+            IndefiniteTruthValuePtr itv =
+                std::static_pointer_cast<IndefiniteTruthValue>(tv);
+            s.mean = itv->getL();
+            s.count = itv->getU();
+            s.confidence = itv->getConfidenceLevel();
+            return true;
+        }
+        default:
+            throw RuntimeException(TRACE_INFO,
+                "save_snapshot: Unknown truth value type %u", s.type);
+    }
+}
+
+static TruthValuePtr snap_to_tv(const SnapTV& s)
+{
+    switch (s.type)
+    {
+        case SIMPLE_TRUTH_VALUE:
+            return SimpleTruthValue::createTV(s.mean, s.count);
+        case COUNT_TRUTH_VALUE:
+            return CountTruthValue::createTV(s.mean, s.confidence, s.count);
+        case INDEFINITE_TRUTH_VALUE:
+            return IndefiniteTruthValue::createTV(s.mean, s.count, s.confidence);
+        case PROBABILISTIC_TRUTH_VALUE:
+            return ProbabilisticTruthValue::createTV(s.mean, s.confidence, s.count);
+        default:
+            throw RuntimeException(TRACE_INFO,
+                "load_snapshot: Unknown truth value type %u", s.type);
+    }
+}
+
+/// The atoms to be saved, each after its outgoing set.
+struct SnapOrder
+{
+    std::vector<Handle> atoms;
+    std::vector<uint32_t> heights;
+    std::unordered_map<const Atom*, size_t> slot;
+
+    /// Add the atom, and its outgoing set, if they are not there yet.
+    /// Returns the height of the atom.
+    uint32_t visit(const Handle& h)
+    {
+        auto it = slot.find(h.operator->());
+        if (slot.end() != it) return heights[it->second];
+
+        uint32_t height = 0;
+        LinkPtr l(LinkCast(h));
+        if (l)
+            for (const Handle& ho : l->getOutgoingSet())
+                height = std::max(height, visit(ho) + 1);
+
+        slot.insert({h.operator->(), atoms.size()});
+        atoms.push_back(h);
+        heights.push_back(height);
+        return height;
+    }
+};
+
+class SnapWriter
+{
+    private:
+        std::string _filename;
+        FILE* _fh;
+        size_t _off;
+
+    public:
+        SnapWriter(const std::string& filename)
+            : _filename(filename), _off(0)
+        {
+            _fh = fopen(filename.c_str(), "w");
+            if (nullptr == _fh)
+                throw RuntimeException(TRACE_INFO,
+                    "save_snapshot: cannot write %s: %s",
+                    filename.c_str(), strerror(errno));
+            setvbuf(_fh, nullptr, _IOFBF, 1 << 20);
+        }
+
+        ~SnapWriter()
+        {
+            if (_fh) fclose(_fh);
+        }
+
+        void write(const void* buf, size_t len)
+        {
+            if (0 < len and 1 != fwrite(buf, len, 1, _fh))
+                throw RuntimeException(TRACE_INFO,
+                    "save_snapshot: cannot write %s: %s",
+                    _filename.c_str(), strerror(errno));
+            _off += len;
+        }
+
+        void pad(void)
+        {
+            static const char zeros[8] = {0};
+            write(zeros, align8(_off) - _off);
+        }
+
+        size_t offset(void) const { return _off; }
+
+        void close(void)
+        {
+            bool ok = 0 == fflush(_fh) and 0 == fsync(fileno(_fh));
+            ok = (0 == fclose(_fh)) and ok;
+            _fh = nullptr;
+            if (not ok)
+                throw RuntimeException(TRACE_INFO,
+                    "save_snapshot: cannot write %s: %s",
+                    _filename.c_str(), strerror(errno));
+        }
+};
+
+/// A read-only mapping of the whole file.
+struct SnapMapping
+{
+    const char* base;
+    size_t len;
+
+    SnapMapping(const std::string& filename) : base(nullptr), len(0)
+    {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw RuntimeException(TRACE_INFO,
+                "load_snapshot: cannot open %s: %s",
+                filename.c_str(), strerror(errno));
+
+        struct stat st;
+        fstat(fd, &st);
+        len = st.st_size;
+        if (0 < len)
+            base = (const char*) mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+
+        if (0 == len or MAP_FAILED == base)
+        {
+            base = nullptr;
+            throw RuntimeException(TRACE_INFO,
+                "load_snapshot: cannot map %s: %s",
+                filename.c_str(), len ? strerror(errno) : "empty file");
+        }
+
+        // The atoms are read in order, but the names are all over.
+        madvise((void*) base, len, MADV_WILLNEED);
+    }
+
+    ~SnapMapping()
+    {
+        if (base) munmap((void*) base, len);
+    }
+};
+
+} // anonymous namespace
+
+// ====================================================================
+
+void AtomSpace::save_snapshot(const std::string& path)
+{
+    // Atoms added asynchronously are not in the type index until then.
+    atomTable.barrier();
+
+    HandleSeq all;
+    atomTable.getHandlesByType(back_inserter(all), ATOM, true, false);
+
+    // Atoms of the parent atomspaces get in only as members of the
+    // outgoing sets of atoms in this one.
+    SnapOrder order;
+    order.slot.reserve(all.size());
+    order.atoms.reserve(all.size());
+    order.heights.reserve(all.size());
+    for (const Handle& h : all)
+        order.visit(h);
+    all.clear();
+    all.shrink_to_fit();
+
+    size_t n_atoms = order.atoms.size();
+    uint32_t max_height = 0;
+    for (uint32_t ht : order.heights)
+        max_height = std::max(max_height, ht);
+
+    // Sort by height; pos[i] is where the i'th atom goes in the file.
+    std::vector<uint64_t> heights(n_atoms ? max_height + 1 : 0, 0);
+    for (uint32_t ht : order.heights)
+        heights[ht]++;
+    std::vector<uint64_t> next(heights.size(), 0);
+    for (size_t ht = 1; ht < heights.size(); ht++)
+    {
+        next[ht] = heights[ht-1];
+        heights[ht] += heights[ht-1];
+    }
+    std::vector<uint64_t> pos(n_atoms);
+    std::vector<size_t> in_order(n_atoms);
+    for (size_t i = 0; i < n_atoms; i++)
+    {
+        pos[i] = next[order.heights[i]]++;
+        in_order[pos[i]] = i;
+    }
+    order.heights.clear();
+    order.heights.shrink_to_fit();
+
+    // The type names, the node names, and the truth values.
+    std::vector<SnapString> types;
+    std::vector<SnapString> names;
+    std::string strings;
+    std::unordered_map<Type, uint16_t> type_codes;
+    std::unordered_map<const NameTable::Name*, uint64_t> name_codes;
+    std::vector<SnapTV> tvs;
+    std::vector<SnapAtom> recs(n_atoms);
+    uint64_t n_outgoing = 0;
+    UUID min_uuid = Handle::INVALID_UUID;
+    UUID max_uuid = 0;
+
+    for (size_t p = 0; p < n_atoms; p++)
+    {
+        const Handle& h = order.atoms[in_order[p]];
+        SnapAtom& r = recs[p];
+        memset(&r, 0, sizeof(r));
+        r.uuid = h.value();
+        min_uuid = std::min(min_uuid, r.uuid);
+        max_uuid = std::max(max_uuid, r.uuid);
+
+        Type t = h->getType();
+        auto tit = type_codes.find(t);
+        if (type_codes.end() == tit)
+        {
+            const std::string& tname = classserver().getTypeName(t);
+            types.push_back({strings.size(), tname.size()});
+            strings.append(tname);
+            tit = type_codes.insert({t, types.size() - 1}).first;
+        }
+        r.type = tit->second;
+
+        NodePtr n(NodeCast(h));
+        if (n)
+        {
+            const NameTable::Name* nm = n->getInternedName();
+            auto nit = name_codes.find(nm);
+            if (name_codes.end() == nit)
+            {
+                names.push_back({strings.size(), nm->_str.size()});
+                strings.append(nm->_str);
+                nit = name_codes.insert({nm, names.size() - 1}).first;
+            }
+            r.body = nit->second;
+            r.flags = NODE_ATOM;
+        }
+        else
+        {
+            r.body = n_outgoing;
+            r.size = LinkCast(h)->getArity();
+            n_outgoing += r.size;
+        }
+
+        SnapTV stv;
+        r.tv = NO_TV;
+        if (tv_to_snap(h->getTruthValue(), stv))
+        {
+            r.tv = tvs.size();
+            tvs.push_back(stv);
+        }
+    }
+    type_codes.clear();
+    name_codes.clear();
+
+    SnapHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    hdr.n_types = types.size();
+    hdr.n_names = names.size();
+    hdr.n_heights = heights.size();
+    hdr.n_atoms = n_atoms;
+    hdr.n_outgoing = n_outgoing;
+    hdr.n_tvs = tvs.size();
+    hdr.types_off = align8(sizeof(hdr));
+    hdr.names_off = hdr.types_off + types.size() * sizeof(SnapString);
+    hdr.strings_off = hdr.names_off + names.size() * sizeof(SnapString);
+    hdr.heights_off = align8(hdr.strings_off + strings.size());
+    hdr.atoms_off = hdr.heights_off + heights.size() * sizeof(uint64_t);
+    hdr.outgoing_off = hdr.atoms_off + n_atoms * sizeof(SnapAtom);
+    hdr.tvs_off = hdr.outgoing_off + n_outgoing * sizeof(uint64_t);
+    hdr.size = hdr.tvs_off + tvs.size() * sizeof(SnapTV);
+    hdr.min_uuid = n_atoms ? min_uuid : 0;
+    hdr.max_uuid = max_uuid;
+
+    // Write it aside, and then move it into place.
+    std::string tmpname = path + ".tmp";
+    try
+    {
+        SnapWriter w(tmpname);
+        w.write(&hdr, sizeof(hdr));
+        w.pad();
+        w.write(types.data(), types.size() * sizeof(SnapString));
+        w.write(names.data(), names.size() * sizeof(SnapString));
+        w.write(strings.data(), strings.size());
+        w.pad();
+        w.write(heights.data(), heights.size() * sizeof(uint64_t));
+        w.write(recs.data(), recs.size() * sizeof(SnapAtom));
+
+        std::vector<uint64_t> out;
+        for (size_t p = 0; p < n_atoms; p++)
+        {
+            LinkPtr l(LinkCast(order.atoms[in_order[p]]));
+            if (nullptr == l) continue;
+            out.clear();
+            for (const Handle& ho : l->getOutgoingSet())
+                out.push_back(pos[order.slot[ho.operator->()]]);
+            w.write(out.data(), out.size() * sizeof(uint64_t));
+        }
+
+        w.write(tvs.data(), tvs.size() * sizeof(SnapTV));
+        OC_ASSERT(w.offset() == hdr.size, "save_snapshot: bad size");
+        w.close();
+    }
+    catch (...)
+    {
+        unlink(tmpname.c_str());
+        throw;
+    }
+
+    if (rename(tmpname.c_str(), path.c_str()))
+    {
+        unlink(tmpname.c_str());
+        throw RuntimeException(TRACE_INFO,
+            "save_snapshot: cannot write %s: %s",
+            path.c_str(), strerror(errno));
+    }
+
+    logger().info("save_snapshot: wrote %lu atoms of %lu heights to %s",
+                  n_atoms, heights.size(), path.c_str());
+}
+
+// ====================================================================
+
+size_t AtomSpace::load_snapshot(const std::string& path)
+{
+    SnapMapping map(path);
+    const char* base = map.base;
+
+    const SnapHeader& hdr = *(const SnapHeader*) base;
+    auto in_file = [&](uint64_t off, uint64_t n, size_t sz) {
+        return off <= map.len and n <= (map.len - off) / sz;
+    };
+    if (map.len < sizeof(hdr) or
+        memcmp(hdr.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) or
+        hdr.size != map.len or
+        not in_file(hdr.types_off, hdr.n_types, sizeof(SnapString)) or
+        not in_file(hdr.names_off, hdr.n_names, sizeof(SnapString)) or
+        not in_file(hdr.heights_off, hdr.n_heights, sizeof(uint64_t)) or
+        not in_file(hdr.atoms_off, hdr.n_atoms, sizeof(SnapAtom)) or
+        not in_file(hdr.outgoing_off, hdr.n_outgoing, sizeof(uint64_t)) or
+        not in_file(hdr.tvs_off, hdr.n_tvs, sizeof(SnapTV)))
+        throw RuntimeException(TRACE_INFO,
+            "load_snapshot: %s is not a snapshot", path.c_str());
+
+    const SnapString* types = (const SnapString*) (base + hdr.types_off);
+    const SnapString* names = (const SnapString*) (base + hdr.names_off);
+    const char* strings = base + hdr.strings_off;
+    const uint64_t* heights = (const uint64_t*) (base + hdr.heights_off);
+    const SnapAtom* recs = (const SnapAtom*) (base + hdr.atoms_off);
+    const uint64_t* outgoing = (const uint64_t*) (base + hdr.outgoing_off);
+    const SnapTV* tvs = (const SnapTV*) (base + hdr.tvs_off);
+    size_t n_strings = hdr.heights_off - hdr.strings_off;
+
+    // The last height ends with the last atom; and the UUID's kept
+    // are a proper range.
+    if ((0 < hdr.n_heights ? heights[hdr.n_heights - 1] != hdr.n_atoms
+                           : 0 != hdr.n_atoms) or
+        (0 < hdr.n_atoms and (hdr.max_uuid < hdr.min_uuid or
+                              Handle::INVALID_UUID == hdr.max_uuid)))
+        throw RuntimeException(TRACE_INFO,
+            "load_snapshot: %s is damaged", path.c_str());
+
+    auto string_at = [&](const SnapString& s) {
+        if (n_strings < s.off or n_strings - s.off < s.len)
+            throw RuntimeException(TRACE_INFO,
+                "load_snapshot: %s is damaged", path.c_str());
+        return std::string(strings + s.off, s.len);
+    };
+
+    // Types are numbered differently in different versions of OpenCog.
+    std::vector<Type> typemap(hdr.n_types);
+    for (size_t i = 0; i < hdr.n_types; i++)
+    {
+        std::string tname(string_at(types[i]));
+        typemap[i] = classserver().getType(tname);
+        if (NOTYPE == typemap[i])
+            throw RuntimeException(TRACE_INFO,
+                "load_snapshot: OpenCog does not have a type called %s",
+                tname.c_str());
+    }
+
+    // The atoms keep their UUID's, unless some might be taken already.
+    bool keep_uuids = 0 == hdr.n_atoms or
+        TLB::reserve_unused(hdr.min_uuid, hdr.max_uuid);
+    if (not keep_uuids)
+        logger().warn("load_snapshot: UUID's of %s are in use; "
+                      "the atoms get new ones", path.c_str());
+
+    HandleSeq handles(hdr.n_atoms);
+
+    // Make and add the atoms from first to last, of the height that
+    // starts at floor.  Those below floor are already in the table,
+    // and their handles in handles.
+    auto make_range = [&](uint64_t floor, uint64_t first, uint64_t last) {
+        HandleSeq batch;
+        batch.reserve(last - first);
+        for (uint64_t i = first; i < last; i++)
+        {
+            const SnapAtom& r = recs[i];
+            bool bad = hdr.n_types <= r.type;
+            if (r.flags & NODE_ATOM)
+                bad = bad or hdr.n_names <= r.body;
+            else
+                bad = bad or hdr.n_outgoing < r.body or
+                      hdr.n_outgoing - r.body < r.size;
+            if (not bad and NO_TV != r.tv)
+                bad = hdr.n_tvs <= r.tv;
+            if (keep_uuids)
+                bad = bad or r.uuid < hdr.min_uuid or hdr.max_uuid < r.uuid;
+            if (bad)
+                throw RuntimeException(TRACE_INFO,
+                    "load_snapshot: %s is damaged", path.c_str());
+
+            TruthValuePtr tv(NO_TV == r.tv ?
+                TruthValue::DEFAULT_TV() : snap_to_tv(tvs[r.tv]));
+
+            AtomPtr atom;
+            if (r.flags & NODE_ATOM)
+                atom = createNode(typemap[r.type], string_at(names[r.body]), tv);
+            else
+            {
+                HandleSeq oset(r.size);
+                const uint64_t* out = outgoing + r.body;
+                for (uint32_t j = 0; j < r.size; j++)
+                {
+                    if (floor <= out[j])
+                        throw RuntimeException(TRACE_INFO,
+                            "load_snapshot: %s is damaged", path.c_str());
+                    oset[j] = handles[out[j]];
+                }
+                atom = createLink(typemap[r.type], oset, tv);
+            }
+            if (keep_uuids) atom->_uuid = r.uuid;
+            batch.emplace_back(atom);
+        }
+
+        HandleSeq added(atomTable.add_atoms(batch, false));
+        std::copy(added.begin(), added.end(), handles.begin() + first);
+    };
+
+    // The atoms of one height do not refer to one another; so they
+    // are made and added by several threads, a chunk at a time.
+    static const uint64_t CHUNK = 8192;
+    size_t nthreads = std::max(1U, std::min(8U, std::thread::hardware_concurrency()));
+
+    uint64_t lo = 0;
+    for (size_t ht = 0; ht < hdr.n_heights; ht++)
+    {
+        uint64_t hi = heights[ht];
+        if (hi < lo or hdr.n_atoms < hi)
+            throw RuntimeException(TRACE_INFO,
+                "load_snapshot: %s is damaged", path.c_str());
+
+        if (hi - lo <= CHUNK or 1 == nthreads)
+        {
+            for (uint64_t a = lo; a < hi; a += CHUNK)
+                make_range(lo, a, std::min(hi, a + CHUNK));
+        }
+        else
+        {
+            std::atomic<uint64_t> next(lo);
+            std::exception_ptr err;
+            std::mutex err_mtx;
+            auto worker = [&]() {
+                try
+                {
+                    while (true)
+                    {
+                        uint64_t a = next.fetch_add(CHUNK);
+                        if (hi <= a) break;
+                        make_range(lo, a, std::min(hi, a + CHUNK));
+                    }
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lck(err_mtx);
+                    if (not err) err = std::current_exception();
+                    next = hi;
+                }
+            };
+            std::vector<std::thread> workers;
+            for (size_t i = 0; i < nthreads; i++)
+                workers.push_back(std::thread(worker));
+            for (std::thread& w : workers) w.join();
+            if (err) std::rethrow_exception(err);
+        }
+        lo = hi;
+    }
+    atomTable.barrier();
+
+    logger().info("load_snapshot: loaded %lu atoms of %lu heights from %s",
+                  hdr.n_atoms, hdr.n_heights, path.c_str());
+    return hdr.n_atoms;
+}
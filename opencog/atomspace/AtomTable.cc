@@ -27,7 +27,10 @@
 
 #include "AtomTable.h"
 
+#include <algorithm>
+#include <condition_variable>
 #include <iterator>
+#include <mutex>
 #include <set>
 
 #include <stdlib.h>
@@ -62,10 +65,16 @@
 
 using namespace opencog;
 
-std::recursive_mutex AtomTable::_mtx;
+// Signalled whenever some atom has been extracted, and is gone from
+// the incoming sets of its outgoing set.  An extract() that finds its
+// atom still held by links that other threads are extracting waits on
+// this.  It is shared by all tables, because the links may be in a
+// child atomspace.
+static std::mutex extract_mtx;
+static std::condition_variable extract_cv;
 
 AtomTable::AtomTable(AtomTable* parent, AtomSpace* holder)
-    : _index_queue(this, &AtomTable::put_atom_into_index)
+    : _index_queue(this, &AtomTable::index_batch)
 {
     _as = holder;
     _environ = parent;
@@ -85,26 +94,32 @@ AtomTable::AtomTable(AtomTable* parent, AtomSpace* holder)
 
 AtomTable::~AtomTable()
 {
+    // Let the writer threads finish whatever they are working on.
+    // Atoms still on the pending list will never be indexed.
+    _index_queue.flush_queue();
+
     // Disconnect signals. Only then clear the resolver.
-    std::lock_guard<std::recursive_mutex> lck(_mtx);
     addedTypeConnection.disconnect();
     Handle::clear_resolver(this);
 
     // No one who shall look at these atoms shall ever again
     // find a reference to this atomtable.
     UUID undef = Handle::INVALID_UUID;
-    for (auto pr : _atom_set) {
-        pr.second->_atomTable = NULL;
-        pr.second->_uuid = undef;
-        // Aiee ... We added this link to every incoming set;
-        // thus, it is our responsibility to remove it as well.
-        // This is a stinky design, but I see no other way,
-        // because it seems that we can't do this in the Atom
-        // destructor (which is where this should be happening).
-        LinkPtr lll(LinkCast(pr.second));
-        if (lll) {
-            for (AtomPtr a : lll->_outgoing) {
-                a->remove_atom(lll);
+    for (AtomSetShard& sh : _atom_set) {
+        std::lock_guard<std::mutex> lck(sh.mtx);
+        for (auto pr : sh.atoms) {
+            pr.second->_atomTable = NULL;
+            pr.second->_uuid = undef;
+            // Aiee ... We added this link to every incoming set;
+            // thus, it is our responsibility to remove it as well.
+            // This is a stinky design, but I see no other way,
+            // because it seems that we can't do this in the Atom
+            // destructor (which is where this should be happening).
+            LinkPtr lll(LinkCast(pr.second));
+            if (lll) {
+                for (AtomPtr a : lll->_outgoing) {
+                    a->remove_atom(lll);
+                }
             }
         }
     }
@@ -121,7 +136,6 @@ bool AtomTable::isCleared(void) const
         return false;
     }
 
-    std::lock_guard<std::recursive_mutex> lck(_mtx);
     // if (nameIndex.size() != 0) return false;
     if (typeIndex.size() != 0) return false;
     if (importanceIndex.size() != 0) return false;
@@ -135,7 +149,7 @@ AtomTable& AtomTable::operator=(const AtomTable& other)
 }
 
 AtomTable::AtomTable(const AtomTable& other)
-    :_index_queue(this, &AtomTable::put_atom_into_index)
+    :_index_queue(this, &AtomTable::index_batch)
 {
     throw opencog::RuntimeException(TRACE_INFO,
             "AtomTable - Cannot copy an object of this class");
@@ -153,31 +167,23 @@ Handle AtomTable::getHandle(Type t, std::string name) const
     }
     catch (...) { return Handle::UNDEFINED; }
 
-    std::lock_guard<std::recursive_mutex> lck(_mtx);
-    Atom* atom = nodeIndex.getAtom(t, name);
-    if (atom) return atom->getHandle();
-    if (_environ and NULL == atom)
+    Handle h(nodeIndex.getHandle(t, name));
+    if (_environ and nullptr == h)
         return _environ->getHandle(t, name);
-    return Handle::UNDEFINED;
+    return h;
 }
 
 Handle AtomTable::getHandle(Type t, const HandleSeq &seq) const
 {
     // Make sure all the atoms in the outgoing set are resolved :-)
+    // Unordered links need not be sorted; the link index takes care
+    // of that.
     HandleSeq resolved_seq;
-    for (Handle ho : seq) {
+    resolved_seq.reserve(seq.size());
+    for (const Handle& ho : seq) {
         resolved_seq.emplace_back(getHandle(ho));
     }
 
-    // Aiieee! unordered link!
-    if (classserver().isA(t, UNORDERED_LINK)) {
-        // Caution: this comparison function MUST BE EXACTLY THE SAME
-        // as the one in Link.cc, used for sorting unordered links.
-        // Changing this without changing the other one will break things!
-        std::sort(resolved_seq.begin(), resolved_seq.end(), handle_less());
-    }
-
-    std::lock_guard<std::recursive_mutex> lck(_mtx);
     Handle h(linkIndex.getHandle(t, resolved_seq));
     if (_environ and nullptr == h)
         return _environ->getHandle(t, resolved_seq);
@@ -206,15 +212,25 @@ Handle AtomTable::getHandle(const AtomPtr& a) const
 // If we have a uuid but no atom pointer, find the atom pointer.
 Handle AtomTable::getHandle(UUID uuid) const
 {
-    // Read-lock for the _atom_set.
-    std::lock_guard<std::recursive_mutex> lck(_mtx);
+    const AtomSetShard& sh(atom_set_shard(uuid));
+    std::lock_guard<std::mutex> lck(sh.mtx);
 
-    auto hit = _atom_set.find(uuid);
-    if (hit != _atom_set.end())
+    auto hit = sh.atoms.find(uuid);
+    if (hit != sh.atoms.end())
         return hit->second;
     return Handle::UNDEFINED;
 }
 
+/// Pick the insertion/removal lock for an atom.  Atoms that are
+/// equivalent (same type and name, or same type and outgoing set)
+/// always get the same lock.  The structural hash does not depend on
+/// the order of the outgoing set of unordered links, so they get the
+/// same lock no matter how their outgoing set happens to be sorted.
+size_t AtomTable::atom_stripe(const AtomPtr& atom) const
+{
+    return atom->getHash() % NUM_ATOM_LOCKS;
+}
+
 /// Return true if the atom is in this atomtable, or in the
 /// environment for this atomtable.
 bool AtomTable::in_environ(const AtomPtr& atom) const
@@ -435,20 +451,17 @@ static void prt_diag(AtomPtr atom, size_t i, size_t arity, const HandleSeq& ogs)
     logger().setBackTraceLevel(save);
 }
 
-Handle AtomTable::add(AtomPtr atom, bool async)
+/// The first, unlocked half of add(). Returns the private copy of the
+/// atom that should be inserted into this table, after having added
+/// its outgoing set.  Returns null if there is nothing to insert;
+/// in that case, hexist is set to the already-existing atom, if any.
+AtomPtr AtomTable::prepare_add(AtomPtr atom, bool async, Handle& hexist)
 {
     // Is the atom already in this table, or one of its environments?
-    if (in_environ(atom))
-        return atom->getHandle();
-
-    // Lock before checking to see if this kind of atom can already
-    // be found in the atomspace.  We need to lock here, to avoid two
-    // different threads from trying to add exactly the same atom.
-    std::unique_lock<std::recursive_mutex> lck(_mtx);
-
-    // Check again, under the lock this time.
-    if (in_environ(atom))
-        return atom->getHandle();
+    if (in_environ(atom)) {
+        hexist = atom->getHandle();
+        return AtomPtr();
+    }
 
     // We expect to be given a valid atom...
     if (nullptr == atom)
@@ -461,14 +474,15 @@ Handle AtomTable::add(AtomPtr atom, bool async)
     atom = factory(atom_type, atom);
 
     // Certain DeleteLinks can never be added!
-    if (nullptr == atom) return Handle();
+    if (nullptr == atom) return atom;
 
     // Is the equivalent of this atom already in the table?
     // If so, then return the existing atom.  (Note that this 'existing'
     // atom might be in another atomspace, or might not be in any
-    // atomspace yet.)
-    Handle hexist(getHandle(atom));
-    if (hexist) return hexist;
+    // atomspace yet.)  This is checked again, below, under the lock;
+    // this first check is just a fast path for the common case.
+    hexist = getHandle(atom);
+    if (hexist) return AtomPtr();
 
     // If this atom is in some other atomspace or not in any atomspace,
     // then we need to clone it. We cannot insert it into this atomtable
@@ -479,10 +493,15 @@ Handle AtomTable::add(AtomPtr atom, bool async)
         // Well, if the link was in some other atomspace, then
         // the outgoing set will probably be too. (It might not
         // be if the other atomspace is a child of this one).
-        // So we recursively clone that too.
+        // So we recursively clone that too.  This is done before
+        // taking the lock, so that the insertion locks never nest.
         HandleSeq closet;
         for (const Handle& h : lll->getOutgoingSet()) {
             closet.emplace_back(add(h, async));
+            if (not closet.back()) {
+                hexist = Handle::UNDEFINED;
+                return AtomPtr();
+            }
         }
         // Preserve the UUID! This is needed for assigning the UUID
         // correctly when fetching from backing store. But do this
@@ -505,13 +524,44 @@ Handle AtomTable::add(AtomPtr atom, bool async)
     // Sometimes one inserts an atom that was previously deleted.
     // In this case, the removal flag might still be set. Clear it.
     atom->unsetRemovalFlag();
+    return atom;
+}
+
+/// Look for an atom that is equal to the given one, among the
+/// asynchronously added atoms that are not yet indexed.  Must be
+/// called with the lock for the stripe held.
+Handle AtomTable::find_pending(const AtomPtr& atom, size_t stripe) const
+{
+    const PendingStripe& pend(_pending[stripe]);
+    if (pend.by_hash.empty()) return Handle::UNDEFINED;
+    auto range = pend.by_hash.equal_range(atom->getHash());
+    for (auto it = range.first; it != range.second; ++it)
+        if (*it->second == *atom) return it->second->getHandle();
+    return Handle::UNDEFINED;
+}
+
+/// The second half of add(). Must be called with the atom's lock held.
+/// Returns true if the atom was inserted; the caller must then emit
+/// the atom-added signal, unless the insertion was async.  Otherwise,
+/// h is set to the already-existing atom; or, if some member of the
+/// outgoing set was extracted by another thread in the meanwhile, h
+/// is left undefined, and nothing is inserted.
+bool AtomTable::insert_locked(AtomPtr& atom, Handle& h, bool async)
+{
+    // Check again, under the lock this time. Atoms that were added
+    // asynchronously are in the pending list until they are indexed.
+    size_t stripe = atom_stripe(atom);
+    h = getHandle(atom);
+    if (h) return false;
+    h = find_pending(atom, stripe);
+    if (h) return false;
 
     // Check for bad outgoing set members; fix them up if needed.
     // "bad" here means outgoing set members that have UUID's but
     // no pointers to actual atoms.  We want to have the actual atoms,
     // because later steps need the pointers to do stuff, in particular,
     // to make sure the child atoms are in an atomtable, too.
-    lll = LinkCast(atom);
+    LinkPtr lll(LinkCast(atom));
     if (lll) {
         const HandleSeq& ogs(lll->getOutgoingSet());
         size_t arity = ogs.size();
@@ -519,7 +569,6 @@ Handle AtomTable::add(AtomPtr atom, bool async)
         // First, make sure that every member of the outgoing set has
         // a valid atom pointer. We need this, cause we need to call
         // methods on those atoms.
-        bool need_copy = false;
         for (size_t i = 0; i < arity; i++) {
             if (NULL == ogs[i]._ptr.get()) {
                 prt_diag(atom, i, arity, ogs);
@@ -529,36 +578,26 @@ Handle AtomTable::add(AtomPtr atom, bool async)
             }
 
             // The outgoing set must consist entirely of atoms
-            // either in this atomtable, or its environment.
-            if (not in_environ(ogs[i])) need_copy = true;
-        }
-
-        if (need_copy) {
-            atom = clone_factory(atom_type, atom);
-        }
-
-        // llc not lll, in case a copy was made.
-        LinkPtr llc(LinkCast(atom));
-        for (size_t i = 0; i < arity; i++) {
-
-            // Make sure all children have correct incoming sets
-            Handle ho(llc->_outgoing[i]);
-            if (not in_environ(ho)) {
-                ho->remove_atom(llc);
-                llc->_outgoing[i] = add(ho, async);
-            }
-            // Build the incoming set of outgoing atom h.
-            llc->_outgoing[i]->insert_atom(llc);
+            // either in this atomtable, or its environment.  They
+            // all were, when the atom was prepared; but another
+            // thread may have extracted some of them since.
+            if (not in_environ(ogs[i])) return false;
         }
 
         // OK, so if the above fixed up the outgoing set, and
         // this is an unordered link, then we have to fix it up
         // and put it back into the default sort order. That's
         // because the default sort order uses UUID's, which have
-        // now changed.
-        if (classserver().isA(llc->getType(), UNORDERED_LINK)) {
-            llc->resort();
+        // now changed.  This must be done before the link goes
+        // into any incoming sets, as it remembers its slot in
+        // them by position.
+        if (classserver().isA(lll->getType(), UNORDERED_LINK)) {
+            lll->resort();
         }
+
+        // Build the incoming set of outgoing atom h.
+        for (size_t i = 0; i < arity; i++)
+            lll->_outgoing[i]->insert_atom(lll);
     }
 
     // Its possible that the atom already has a UUID assigned,
@@ -571,48 +610,148 @@ Handle AtomTable::add(AtomPtr atom, bool async)
     } else {
        TLB::reserve_upto(atom->_uuid);
     }
-    Handle h(atom->getHandle());
+    h = atom->getHandle();
     size++;
-    _atom_set.insert({atom->_uuid, h});
+    {
+        AtomSetShard& sh(atom_set_shard(atom->_uuid));
+        std::lock_guard<std::mutex> slck(sh.mtx);
+        sh.atoms.insert({atom->_uuid, h});
+    }
 
     atom->keep_incoming_set();
     atom->setAtomTable(this);
 
-    if (not async)
-        put_atom_into_index(atom);
+    // Update the indexes while still holding the lock, so that no
+    // other thread can slip in a duplicate of this atom.  Async adds
+    // are put on the pending list instead, and indexed in batches.
+    if (not async) {
+        index_atom(atom);
+    } else {
+        PendingStripe& pend(_pending[stripe]);
+        pend.atoms.push_back(atom);
+        pend.by_hash.insert({atom->getHash(), atom.operator->()});
+        if (pend.atoms.size() == INDEX_BATCH_SIZE)
+            _index_queue.enqueue(stripe);
+    }
+
+    DPRINTF("Atom added: %ld => %s\n", atom->_uuid, atom->toString().c_str());
+    return true;
+}
 
-    // We can now unlock, since we are done.
+Handle AtomTable::add(AtomPtr atom, bool async)
+{
+    Handle h;
+    atom = prepare_add(atom, async, h);
+    if (nullptr == atom) return h;
+
+    // Lock before checking to see if this kind of atom can already
+    // be found in the atomspace.  We need to lock here, to avoid two
+    // different threads from trying to add exactly the same atom.
+    size_t stripe = atom_stripe(atom);
+    std::unique_lock<std::recursive_mutex> lck(_atom_mtx[stripe]);
+    bool added = insert_locked(atom, h, async);
+    bool backlog = _pending[stripe].atoms.size() >= MAX_PENDING;
+
+    // We can now unlock, since we are done. In particular, the signals
+    // need to run unlocked, since they may result in more atom table
+    // additions.
     lck.unlock();
 
-    // Update the indexes asynchronously
-    if (async)
-        _index_queue.enqueue(atom);
+    // Some of the outgoing set got extracted; it is not brought back.
+    if (not h) return h;
+
+    if (added and not async and still_added(h))
+        _addAtomSignal(h);
+
+    // The writer threads are not keeping up; help them out.
+    if (backlog)
+        index_batch(stripe);
 
-    DPRINTF("Atom added: %ld => %s\n", atom->_uuid, atom->toString().c_str());
     return h;
 }
 
-void AtomTable::put_atom_into_index(AtomPtr& atom)
+HandleSeq AtomTable::add_atoms(const HandleSeq& hseq, bool async)
+{
+    size_t n = hseq.size();
+    HandleSeq result(n);
+
+    // Do the unlocked part first, and sort what is left to be
+    // inserted by lock stripe.
+    std::vector<AtomPtr> atoms(n);
+    std::vector<std::vector<size_t>> stripes(NUM_ATOM_LOCKS);
+    for (size_t i = 0; i < n; i++) {
+        atoms[i] = prepare_add(hseq[i], async, result[i]);
+        if (atoms[i])
+            stripes[atom_stripe(atoms[i])].push_back(i);
+    }
+
+    // Insert each stripe under a single lock.
+    HandleSeq added;
+    for (size_t s = 0; s < NUM_ATOM_LOCKS; s++) {
+        if (stripes[s].empty()) continue;
+
+        std::unique_lock<std::recursive_mutex> lck(_atom_mtx[s]);
+        for (size_t i : stripes[s]) {
+            if (insert_locked(atoms[i], result[i], async) and not async)
+                added.push_back(result[i]);
+        }
+        bool backlog = _pending[s].atoms.size() >= MAX_PENDING;
+        lck.unlock();
+
+        if (backlog) index_batch(s);
+    }
+
+    for (const Handle& h : added)
+        if (still_added(h))
+            _addAtomSignal(h);
+
+    return result;
+}
+
+void AtomTable::index_atom(const AtomPtr& atom)
 {
-    std::unique_lock<std::recursive_mutex> lck(_mtx);
     Atom* pat = atom.operator->();
-    nodeIndex.insertAtom(pat);
+    nodeIndex.insertAtom(atom);
     linkIndex.insertAtom(atom);
     typeIndex.insertAtom(pat);
     importanceIndex.insertAtom(pat);
+}
 
-    // We can now unlock, since we are done. In particular, the signals
-    // need to run unlocked, since they may result in more atom table
-    // additions.
-    lck.unlock();
+/// Index all of the pending atoms in one stripe.  This is the
+/// callback for the writer threads.
+void AtomTable::index_batch(size_t& stripe)
+{
+    std::vector<AtomPtr> batch;
+    {
+        std::lock_guard<std::recursive_mutex> lck(_atom_mtx[stripe]);
+        batch.swap(_pending[stripe].atoms);
+        _pending[stripe].by_hash.clear();
+        for (const AtomPtr& atom : batch)
+            index_atom(atom);
+    }
 
     // Now that we are completely done, emit the added signal.
     // Don't emit signal until after the indexes are updated!
-    _addAtomSignal(atom->getHandle());
+    for (const AtomPtr& atom : batch)
+        if (still_added(atom))
+            _addAtomSignal(atom->getHandle());
+}
+
+/// True unless the atom was extracted (or is being extracted) since it
+/// was inserted.  The atom-added signal is sent with no lock held; an
+/// atom extracted in the meanwhile has had its removal signal, and
+/// must not get an added signal after it.
+bool AtomTable::still_added(const AtomPtr& atom) const
+{
+    return atom->getAtomTable() == this and not atom->isMarkedForRemoval();
 }
 
 void AtomTable::barrier()
 {
+    // Index the partially-filled batches, then wait for the writer
+    // threads to finish the full ones.
+    for (size_t s = 0; s < NUM_ATOM_LOCKS; s++)
+        index_batch(s);
     _index_queue.flush_queue();
 }
 
@@ -623,19 +762,16 @@ size_t AtomTable::getSize() const
 
 size_t AtomTable::getNumNodes() const
 {
-    std::lock_guard<std::recursive_mutex> lck(_mtx);
     return nodeIndex.size();
 }
 
 size_t AtomTable::getNumLinks() const
 {
-    std::lock_guard<std::recursive_mutex> lck(_mtx);
     return linkIndex.size();
 }
 
 size_t AtomTable::getNumAtomsOfType(Type type, bool subclass) const
 {
-    std::lock_guard<std::recursive_mutex> lck(_mtx);
     size_t result = typeIndex.getNumAtomsOfType(type, subclass);
 
     if (_environ)
@@ -644,6 +780,36 @@ size_t AtomTable::getNumAtomsOfType(Type type, bool subclass) const
     return result;
 }
 
+void AtomTable::setSTI(const HandleSeq& hs,
+                       const std::vector<AttentionValue::sti_t>& stis)
+{
+    if (hs.size() != stis.size())
+        throw RuntimeException(TRACE_INFO,
+            "AtomTable - %zu atoms, but %zu STI values!",
+            hs.size(), stis.size());
+
+    HandleSeq changed;
+    std::vector<AttentionValue::sti_t> old_stis;
+    std::vector<AttentionValue::sti_t> new_stis;
+    for (size_t i = 0; i < hs.size(); i++)
+    {
+        Atom* a = hs[i].operator->();
+        if (NULL == a) continue;
+        if (a->_atomTable != this) {
+            a->setSTI(stis[i]);
+            continue;
+        }
+        AttentionValue::sti_t old = a->exchangeSTI(stis[i]);
+        if (old == stis[i]) continue;
+        changed.push_back(hs[i]);
+        old_stis.push_back(old);
+        new_stis.push_back(stis[i]);
+    }
+
+    if (not changed.empty())
+        _STIChangedSignal(changed, old_stis, new_stis);
+}
+
 Handle AtomTable::getRandom(RandGen *rng) const
 {
     size_t x = rng->randint(getSize());
@@ -684,14 +850,15 @@ AtomPtrSet AtomTable::extract(Handle& handle, bool recursive)
         return other->extract(handle, recursive);
     }
 
-    // Lock before fetching the incoming set. Since getting the
-    // incoming set also grabs a lock, we need this mutex to be
-    // recursive. We need to lock here to avoid confusion if multiple
-    // threads are trying to delete the same atom.
-    std::unique_lock<std::recursive_mutex> lck(_mtx);
+    // Lock before marking the atom. We need to lock here to avoid
+    // confusion if multiple threads are trying to delete the same
+    // atom.  The lock is dropped while the incoming set is extracted,
+    // since those atoms have locks of their own.
+    std::unique_lock<std::recursive_mutex> lck(atom_mutex(atom));
 
     if (atom->isMarkedForRemoval()) return result;
     atom->markForRemoval();
+    lck.unlock();
 
     // If recursive-flag is set, also extract all the links in the atom's
     // incoming set
@@ -732,83 +899,108 @@ AtomPtrSet AtomTable::extract(Handle& handle, bool recursive)
     // return a non-zero value if the incoming set has weak pointers to
     // deleted atoms. Thus, a second check is made for strong pointers,
     // since getIncomingSet() converts weak to strong.
-    if (0 < handle->getIncomingSetSize())
+    while (0 < handle->getIncomingSetSize())
     {
         IncomingSet iset(handle->getIncomingSet());
-        if (0 < iset.size())
+        if (0 == iset.size()) break;
+
+        if (not recursive)
         {
-            if (not recursive)
-            {
-                // User asked for a non-recursive remove, and the
-                // atom is still referenced. So, do nothing.
-                handle->unsetRemovalFlag();
-                return result;
-            }
+            // User asked for a non-recursive remove, and the
+            // atom is still referenced. So, do nothing.
+            handle->unsetRemovalFlag();
+            return result;
+        }
 
-            // Check for an invalid condition that should not occur. See:
-            // https://github.com/opencog/opencog/commit/a08534afb4ef7f7e188e677cb322b72956afbd8f#commitcomment-5842682
-            size_t ilen = iset.size();
-            for (size_t i=0; i<ilen; i++)
+        // Check for an invalid condition that should not occur. See:
+        // https://github.com/opencog/opencog/commit/a08534afb4ef7f7e188e677cb322b72956afbd8f#commitcomment-5842682
+        bool pending = false;
+        size_t ilen = iset.size();
+        for (size_t i=0; i<ilen; i++)
+        {
+            // Its OK if the atom being extracted is in a link
+            // that is not currently in any atom space, or if that
+            // link is in a child subspace, in which case, we
+            // extract from the child.
+            //
+            // A bit of a race can happen: another thread can be
+            // deleting a different atom with an overlapping incoming
+            // set.  Since the incoming set hasn't yet been updated,
+            // it will look like the incoming set has not yet been
+            // fully cleared.  Well, it hasn't been, but as long as
+            // we are marked for removal, things should end up OK.
+            //
+            // XXX this might not be exactly thread-safe, if
+            // other atomspaces are involved...
+            if (iset[i]->getAtomTable() == NULL) continue;
+            if (not iset[i]->getAtomTable()->in_environ(handle) or
+                not iset[i]->isMarkedForRemoval())
             {
-                // Its OK if the atom being extracted is in a link
-                // that is not currently in any atom space, or if that
-                // link is in a child subspace, in which case, we
-                // extract from the child.
-                //
-                // A bit of a race can happen: when the unlock is
-                // done below, to send the removed signal, another
-                // thread can sneak in and get to here, if it is
-                // deleting a different atom with an overlapping incoming
-                // set.  Since the incoming set hasn't yet been updated
-                // (that happens after re-acquiring the lock),
-                // it will look like the incoming set has not yet been
-                // fully cleared.  Well, it hasn't been, but as long as
-                // we are marked for removal, things should end up OK.
-                //
-                // XXX this might not be exactly thread-safe, if
-                // other atomspaces are involved...
-                if (iset[i]->getAtomTable() != NULL and
-                    (not iset[i]->getAtomTable()->in_environ(handle) or
-                     not iset[i]->isMarkedForRemoval()))
-                {
-                    Logger::Level lev = logger().getBackTraceLevel();
-                    logger().setBackTraceLevel(Logger::ERROR);
-                    logger().warn() << "AtomTable::extract() internal error";
-                    logger().warn() << "Non-empty incoming set of size "
-                                    << ilen << " First trouble at " << i;
-                    logger().warn() << "This atomtable=" << ((void*) this)
-                                    << " other atomtale=" << ((void*) iset[i]->getAtomTable())
-                                    << " in_environ=" << iset[i]->getAtomTable()->in_environ(handle);
-                    logger().warn() << "This atom: " << handle->toString();
-                    for (size_t j=0; j<ilen; j++) {
-                        logger().warn() << "Atom j=" << j << " " << iset[j]->toString();
-                        logger().warn() << "Marked: " << iset[j]->isMarkedForRemoval()
-                                        << " Table: " << ((void*) iset[j]->getAtomTable());
-                    }
-                    logger().setBackTraceLevel(lev);
-                    atom->unsetRemovalFlag();
-                    throw RuntimeException(TRACE_INFO,
-                        "Internal Error: Cannot extract an atom with "
-                        "a non-empty incoming set!");
+                Logger::Level lev = logger().getBackTraceLevel();
+                logger().setBackTraceLevel(Logger::ERROR);
+                logger().warn() << "AtomTable::extract() internal error";
+                logger().warn() << "Non-empty incoming set of size "
+                                << ilen << " First trouble at " << i;
+                logger().warn() << "This atomtable=" << ((void*) this)
+                                << " other atomtale=" << ((void*) iset[i]->getAtomTable())
+                                << " in_environ=" << iset[i]->getAtomTable()->in_environ(handle);
+                logger().warn() << "This atom: " << handle->toString();
+                for (size_t j=0; j<ilen; j++) {
+                    logger().warn() << "Atom j=" << j << " " << iset[j]->toString();
+                    logger().warn() << "Marked: " << iset[j]->isMarkedForRemoval()
+                                    << " Table: " << ((void*) iset[j]->getAtomTable());
                 }
+                logger().setBackTraceLevel(lev);
+                atom->unsetRemovalFlag();
+                throw RuntimeException(TRACE_INFO,
+                    "Internal Error: Cannot extract an atom with "
+                    "a non-empty incoming set!");
             }
+            pending = true;
         }
+
+        // The links in the incoming set are being extracted by other
+        // threads. Wait for them to finish: they are indexed by our
+        // UUID, which gets reclaimed when we are removed, below.  The
+        // incoming set is looked at again under extract_mtx, so that
+        // a removal that lands before the wait is not missed.
+        if (not pending) break;
+        std::unique_lock<std::mutex> elck(extract_mtx);
+        extract_cv.wait(elck, [&]() {
+            return handle->getIncomingSet() != iset; });
     }
 
     // Issue the atom removal signal *BEFORE* the atom is actually
     // removed.  This is needed so that certain subsystems, e.g. the
     // Agent system activity table, can correctly manage the atom;
     // it needs info that gets blanked out during removal.
-    lck.unlock();
     _removeAtomSignal(atom);
     lck.lock();
 
+    // If the atom was added asynchronously, it might not have been
+    // indexed yet. Make sure that it never will be.
+    PendingStripe& pend(_pending[atom_stripe(atom)]);
+    auto pit = std::find(pend.atoms.begin(), pend.atoms.end(), atom);
+    if (pit != pend.atoms.end()) {
+        pend.atoms.erase(pit);
+        auto range = pend.by_hash.equal_range(atom->getHash());
+        for (auto it = range.first; it != range.second; ++it)
+            if (it->second == atom.operator->()) {
+                pend.by_hash.erase(it);
+                break;
+            }
+    }
+
     // Decrements the size of the table
     size--;
-    _atom_set.erase(atom->_uuid);
+    {
+        AtomSetShard& sh(atom_set_shard(atom->_uuid));
+        std::lock_guard<std::mutex> slck(sh.mtx);
+        sh.atoms.erase(atom->_uuid);
+    }
 
     Atom* pat = atom.operator->();
-    nodeIndex.removeAtom(pat);
+    nodeIndex.removeAtom(atom);
     linkIndex.removeAtom(atom);
     typeIndex.removeAtom(pat);
     LinkPtr lll(LinkCast(atom));
@@ -816,6 +1008,9 @@ AtomPtrSet AtomTable::extract(Handle& handle, bool recursive)
         for (AtomPtr a : lll->_outgoing) {
             a->remove_atom(lll);
         }
+        // Wake up whoever is extracting the outgoing set.
+        { std::lock_guard<std::mutex> elck(extract_mtx); }
+        extract_cv.notify_all();
     }
     importanceIndex.removeAtom(pat);
 
@@ -832,10 +1027,8 @@ AtomPtrSet AtomTable::extract(Handle& handle, bool recursive)
 // This is the resize callback, when a new type is dynamically added.
 void AtomTable::typeAdded(Type t)
 {
-    std::lock_guard<std::recursive_mutex> lck(_mtx);
-    //resize all Type-based indexes
-    nodeIndex.resize();
-    linkIndex.resize();
+    // Resize all Type-based indexes. The node and link indexes grow
+    // on demand, and do not need to be told.
     typeIndex.resize();
 }
 
@@ -25,8 +25,11 @@
 #ifndef _OPENCOG_ATOMTABLE_H
 #define _OPENCOG_ATOMTABLE_H
 
+#include <atomic>
 #include <iostream>
+#include <mutex>
 #include <set>
+#include <unordered_map>
 #include <vector>
 
 #include <boost/signals2.hpp>
@@ -64,6 +67,9 @@ typedef boost::signals2::signal<void (const Handle&,
 typedef boost::signals2::signal<void (const Handle&,
                                       const TruthValuePtr&,
                                       const TruthValuePtr&)> TVCHSigl;
+typedef boost::signals2::signal<void (const HandleSeq&,
+                                      const std::vector<AttentionValue::sti_t>&,
+                                      const std::vector<AttentionValue::sti_t>&)> STICHSigl;
 
 class AtomSpace;
 
@@ -79,13 +85,40 @@ class AtomTable
 
 private:
 
-    // Single, global mutex for locking the indexes.
-    // Its recursive because we need to lock twice during atom insertion
-    // and removal: we need to keep the indexes stable while we search
-    // them during add/remove.
-    static std::recursive_mutex _mtx;
+    // Striped mutexes serializing atom insertion and removal.  The
+    // stripe is chosen by hashing the atom contents (type and name, or
+    // type and outgoing set), so that two threads trying to add exactly
+    // the same atom will serialize, while threads adding different
+    // atoms will usually not.  The indexes have their own, independent
+    // locks. Recursive, because the signals emitted during insertion
+    // might end up adding more atoms.
+    static const size_t NUM_ATOM_LOCKS = 64;
+    mutable std::recursive_mutex _atom_mtx[NUM_ATOM_LOCKS];
+    size_t atom_stripe(const AtomPtr&) const;
+    std::recursive_mutex& atom_mutex(const AtomPtr& atom) const
+    {
+        return _atom_mtx[atom_stripe(atom)];
+    }
+
+    // Atoms that were added asynchronously, but are not yet in the
+    // indexes.  Each stripe is guarded by the atom lock of the same
+    // stripe, and is handed to the _index_queue writer threads as one
+    // batch, once it holds INDEX_BATCH_SIZE atoms.  If the writers
+    // fall behind by more than MAX_PENDING atoms, the adding thread
+    // indexes the stripe itself.  The atoms are kept in the order
+    // they were added, and also by structural hash, so that every add
+    // can look for a duplicate without scanning the whole stripe.
+    static const size_t INDEX_BATCH_SIZE = 64;
+    static const size_t MAX_PENDING = 16 * INDEX_BATCH_SIZE;
+    struct PendingStripe
+    {
+        std::vector<AtomPtr> atoms;
+        std::unordered_multimap<size_t, Atom*> by_hash;
+    };
+    PendingStripe _pending[NUM_ATOM_LOCKS];
+    Handle find_pending(const AtomPtr&, size_t) const;
 
-    size_t size;
+    std::atomic<size_t> size;
 
     // Holds all atoms in the table.  Provides lookup between numeric
     // handle uuid and the actual atom pointer. To some degree, this info
@@ -97,7 +130,23 @@ private:
     // increments the atom use count in a guaranteed fashion.  This is
     // the one true guaranteee that the atom will not be deleted while
     // it is in the atom table.
-    std::unordered_map<UUID, Handle> _atom_set;
+    //
+    // It is sharded by UUID, each shard having its own lock.
+    static const size_t NUM_ATOM_SET_SHARDS = 16;
+    struct AtomSetShard
+    {
+        mutable std::mutex mtx;
+        std::unordered_map<UUID, Handle> atoms;
+    };
+    AtomSetShard _atom_set[NUM_ATOM_SET_SHARDS];
+    AtomSetShard& atom_set_shard(UUID uuid)
+    {
+        return _atom_set[uuid % NUM_ATOM_SET_SHARDS];
+    }
+    const AtomSetShard& atom_set_shard(UUID uuid) const
+    {
+        return _atom_set[uuid % NUM_ATOM_SET_SHARDS];
+    }
 
     //!@{
     //! Index for quick retreival of certain kinds of atoms.
@@ -106,10 +155,18 @@ private:
     LinkIndex linkIndex;
     ImportanceIndex importanceIndex;
 
-    async_caller<AtomTable, AtomPtr> _index_queue;
-    void put_atom_into_index(AtomPtr&);
+    async_caller<AtomTable, size_t> _index_queue;
+    void index_atom(const AtomPtr&);
+    void index_batch(size_t&);
+    bool still_added(const AtomPtr&) const;
     //!@}
 
+    // The two halves of add(). The first half runs unlocked, and
+    // returns the private copy of the atom that is to be inserted.
+    // The second half must be called with the atom's lock held.
+    AtomPtr prepare_add(AtomPtr, bool, Handle&);
+    bool insert_locked(AtomPtr&, Handle&, bool);
+
     /**
      * signal connection used to find out about atom type additions in the
      * ClassServer
@@ -129,6 +186,9 @@ private:
     /** Signal emitted when the AV changes. */
     AVCHSigl _AVChangedSignal;
 
+    /** Signal emitted when the STI of a batch of atoms changes. */
+    STICHSigl _STIChangedSignal;
+
     // JUST FOR TESTS:
     bool isCleared() const;
 
@@ -207,29 +267,26 @@ public:
                      bool subclass = false,
                      bool parent = true) const
     {
-        std::lock_guard<std::recursive_mutex> lck(_mtx);
         if (parent && _environ)
             _environ->getHandlesByType(result, type, subclass, parent);
-        return std::copy(typeIndex.begin(type, subclass),
-                         typeIndex.end(),
-                         result);
+        return typeIndex.getHandles(result, type, subclass);
     }
 
-    /** Calls function 'func' on all atoms */
+    /**
+     * Calls function 'func' on all atoms.  The function is called on
+     * a snapshot of the index, so it is free to add or remove atoms.
+     */
     template <typename Function> void
     foreachHandleByType(Function func,
                         Type type,
                         bool subclass = false,
                         bool parent = true) const
     {
-        std::lock_guard<std::recursive_mutex> lck(_mtx);
         if (parent && _environ)
             _environ->foreachHandleByType(func, type, subclass);
-        std::for_each(typeIndex.begin(type, subclass),
-                      typeIndex.end(),
-             [&](Handle h)->void {
-                  (func)(h);
-             });
+        HandleSeq hs;
+        typeIndex.getHandles(std::back_inserter(hs), type, subclass);
+        for (const Handle& h : hs) (func)(h);
     }
 
     /**
@@ -242,7 +299,6 @@ public:
     UnorderedHandleSet getHandlesByAV(AttentionValue::sti_t lowerBound,
                               AttentionValue::sti_t upperBound = AttentionValue::MAXSTI) const
     {
-        std::lock_guard<std::recursive_mutex> lck(_mtx);
         return importanceIndex.getHandleSet(this, lowerBound, upperBound);
     }
 
@@ -252,41 +308,65 @@ public:
      *
      * @param The atom whose importance index will be updated.
      * @param The old importance bin where the atom originally was.
+     * @param The new importance bin.
      */
-    void updateImportanceIndex(AtomPtr a, int bin)
+    void updateImportanceIndex(Atom* a, int bin, int newbin)
     {
         if (a->_atomTable != this) return;
-        std::lock_guard<std::recursive_mutex> lck(_mtx);
-        importanceIndex.updateImportance(a.operator->(), bin);
+        importanceIndex.updateImportance(a, bin, newbin);
     }
 
+    /**
+     * Set the short-term importance of many atoms at once.  The
+     * importance index is updated as usual, but instead of one
+     * AV-changed signal per atom, a single STI-changed signal is
+     * emitted for the whole batch, listing only the atoms whose STI
+     * actually changed.  This is meant for attention allocation,
+     * which updates a great many STI values on each cycle.  Atoms
+     * that belong to some other table are updated one at a time, the
+     * usual way.
+     *
+     * @param The atoms to update.
+     * @param Their new STI values; one for each atom.
+     */
+    void setSTI(const HandleSeq&, const std::vector<AttentionValue::sti_t>&);
+
     /**
      * Adds an atom to the table. If the atom already is in the
      * atomtable, then the truth values and attention values of the
      * two are merged (how, exactly? Is this doe corrrectly!?)
      *
      * If the async flag is set, then the atom addition is performed
-     * asynchronously; the atom might not be fully added by the time
-     * this method returns, although it will get added eventually.
-     * Async addition can improve the multi-threaded performance of
-     * lots of parallel adds.  The barrier() method can be used to
-     * force synchronization.
+     * asynchronously: the returned handle is valid, and adding the
+     * same atom again returns the same handle, but the atom is placed
+     * into the indexes (and the atom-added signal is emitted) later,
+     * in batches, by a pool of writer threads.  Until then, it might
+     * not be found by name, type or outgoing set.  Async addition
+     * improves the performance of bulk loading.  The barrier() method
+     * must be used to force synchronization.
      *
-     * XXX The async code path doesn't really do anything yet, since
-     * it also uses the big global lock, at the moment.  This needs
-     * fixing, mostly be creating a second mutex for the atom insertion,
-     * and also giving each index its own uique mutex, to avoid
-     * collsions.  So teh API is here, but more work is stil needed.
+     * If another thread extracts a member of the outgoing set of a
+     * link while the link is being added, the link is not added, and
+     * the extracted atom is not brought back; Handle::UNDEFINED is
+     * returned instead.
      *
      * @param The new atom to be added.
-     * @return The handle of the newly added atom.
+     * @return The handle of the newly added atom, or Handle::UNDEFINED.
      */
     Handle add(AtomPtr, bool async);
 
+    /**
+     * Add a sequence of atoms to the table.  This is the same as
+     * calling add() on each of them, except that each atom lock is
+     * taken only once for the whole batch. The returned handles are
+     * in the same order as the given atoms.
+     */
+    HandleSeq add_atoms(const HandleSeq&, bool async);
+
     /**
      * Read-write synchronization barrier fence.  When called, this
      * will not return until all the atoms previously added to the
-     * atomspace have been fully inserted.
+     * atomspace have been fully inserted, and indexed.
      */
     void barrier(void);
 
@@ -347,6 +427,9 @@ public:
     /** Provide ability for others to find out about AV changes */
     AVCHSigl& AVChangedSignal() { return _AVChangedSignal; }
 
+    /** Provide ability for others to find out about batch STI changes */
+    STICHSigl& STIChangedSignal() { return _STIChangedSignal; }
+
     /** Provide ability for others to find out about TV changes */
     TVCHSigl& TVChangedSignal() { return _TVChangedSignal; }
 };
@@ -39,6 +39,11 @@ AttentionBank::AttentionBank(AtomTable& atab)
     AVChangedConnection = 
         atab.AVChangedSignal().connect(
             boost::bind(&AttentionBank::AVChanged, this, _1, _2, _3));
+
+
+    STIChangedConnection =
+        atab.STIChangedSignal().connect(
+            boost::bind(&AttentionBank::STIChanged, this, _1, _2, _3));
 }
 
 /// This must be called before the AtomTable is destroyed. Which
@@ -48,6 +53,7 @@ AttentionBank::AttentionBank(AtomTable& atab)
 void AttentionBank::shutdown(void)
 {
     AVChangedConnection.disconnect();
+    STIChangedConnection.disconnect();
 }
 
 AttentionBank::~AttentionBank() {}
@@ -80,6 +86,59 @@ void AttentionBank::AVChanged(Handle h, AttentionValuePtr old_av,
     }
 }
 
+/// A batch STI update is handled the same way as that many AV
+/// changes, except that the funds are settled just once, and that
+/// the min and max STI are widened to cover the new values.
+void AttentionBank::STIChanged(const HandleSeq& hs,
+                               const std::vector<AttentionValue::sti_t>& old_stis,
+                               const std::vector<AttentionValue::sti_t>& new_stis)
+{
+    if (hs.empty()) return;
+
+    long diff = 0;
+    AttentionValue::sti_t lo = AttentionValue::MAXSTI;
+    AttentionValue::sti_t hi = AttentionValue::MINSTI;
+    for (size_t i = 0; i < hs.size(); i++)
+    {
+        AttentionValue::sti_t old_sti = old_stis[i];
+        AttentionValue::sti_t new_sti = new_stis[i];
+        diff += old_sti - new_sti;
+        lo = std::min(lo, new_sti);
+        hi = std::max(hi, new_sti);
+
+        bool added = old_sti < attentionalFocusBoundary and
+                     new_sti >= attentionalFocusBoundary;
+        bool removed = new_sti < attentionalFocusBoundary and
+                       old_sti >= attentionalFocusBoundary;
+        if (not added and not removed) continue;
+
+        // Only the atoms that cross the boundary need a full AV.
+        AttentionValue::lti_t lti = hs[i]->getLTI();
+        AttentionValue::vlti_t vlti = hs[i]->getVLTI();
+        AttentionValuePtr old_av(createAV(old_sti, lti, vlti));
+        AttentionValuePtr new_av(createAV(new_sti, lti, vlti));
+        AFCHSigl& afch = added ? AddAFSignal() : RemoveAFSignal();
+        afch(hs[i], old_av, new_av);
+    }
+    {
+        // Not updateSTIFunds(): the sum may not fit in an sti_t.
+        std::lock_guard<std::mutex> lock(lock_funds);
+        fundsSTI += diff;
+    }
+
+    logger().fine("STIChanged: fundsSTI = %d, %zu atoms changed",
+                   fundsSTI, hs.size());
+
+    {
+        std::lock_guard<std::mutex> lock(lock_maxSTI);
+        if (maxSTI.val < hi) maxSTI.update(hi);
+    }
+    {
+        std::lock_guard<std::mutex> lock(lock_minSTI);
+        if (lo < minSTI.val) minSTI.update(lo);
+    }
+}
+
 long AttentionBank::getTotalSTI() const
 {
     std::lock_guard<std::mutex> lock(lock_funds);
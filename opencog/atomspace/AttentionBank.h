@@ -26,6 +26,7 @@
 #define _OPENCOG_ATTENTION_BANK_H
 
 #include <mutex>
+#include <vector>
 
 #include <boost/signals2.hpp>
 
@@ -50,6 +51,12 @@ class AttentionBank
     boost::signals2::connection AVChangedConnection;
     void AVChanged(Handle, AttentionValuePtr, AttentionValuePtr);
 
+    /** The connection by which we are notified of batch STI changes */
+    boost::signals2::connection STIChangedConnection;
+    void STIChanged(const HandleSeq&,
+                    const std::vector<AttentionValue::sti_t>&,
+                    const std::vector<AttentionValue::sti_t>&);
+
     /**
      * Boundary at which an atom is considered within the attentional
      * focus of opencog. Atom's with STI less than this value are
@@ -23,11 +23,53 @@
 
 using namespace opencog;
 
+void FixedIntegerIndex::resize(size_t sz)
+{
+	// Grab every lock, in order, so that no one is looking at the
+	// bins while they are being moved around.
+	for (size_t i = 0; i < NUM_LOCKS; i++) _locks[i].lock();
+	if (idx.size() < sz * _nshards)
+		idx.resize(sz * _nshards);
+	for (size_t i = 0; i < NUM_LOCKS; i++) _locks[i].unlock();
+}
+
+void FixedIntegerIndex::move(size_t i, size_t j, Atom* a)
+{
+	size_t si = shard(i, a);
+	size_t sj = shard(j, a);
+	size_t li = si % NUM_LOCKS;
+	size_t lj = sj % NUM_LOCKS;
+
+	// Always lock in ascending order, to avoid deadlocks.
+	std::unique_lock<std::mutex> lck1(_locks[std::min(li, lj)]);
+	std::unique_lock<std::mutex> lck2;
+	if (li != lj)
+		lck2 = std::unique_lock<std::mutex>(_locks[std::max(li, lj)]);
+
+	if (0 < idx.at(si).erase(a))
+		idx.at(sj).insert(a);
+}
+
+size_t FixedIntegerIndex::size(size_t i) const
+{
+	size_t cnt = 0;
+	for (size_t s = i * _nshards; s < (i+1) * _nshards; s++)
+	{
+		std::lock_guard<std::mutex> lck(lock_for(s));
+		cnt += idx.at(s).size();
+	}
+	return cnt;
+}
+
 size_t FixedIntegerIndex::size(void) const
 {
 	size_t cnt = 0;
-	for (const UnorderedAtomSet& s : idx)
-		cnt += s.size();
+	for (size_t s = 0; ; s++)
+	{
+		std::lock_guard<std::mutex> lck(lock_for(s));
+		if (idx.size() <= s) break;
+		cnt += idx[s].size();
+	}
 	return cnt;
 }
 
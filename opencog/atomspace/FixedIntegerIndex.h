@@ -22,6 +22,7 @@
 #ifndef _OPENCOG_FIXEDINTEGERINDEX_H
 #define _OPENCOG_FIXEDINTEGERINDEX_H
 
+#include <mutex>
 #include <vector>
 
 #include <opencog/atomspace/Atom.h>
@@ -38,37 +39,74 @@ typedef std::unordered_set<Atom*> UnorderedAtomSet;
 /**
  * Implements a vector of atom sets; each set can be found via an
  * integer index.
+ *
+ * This index is thread-safe.  Each integer bin is split into one or
+ * more shards (chosen by hashing the atom address), and the shards
+ * are guarded by a fixed pool of striped mutexes.  Thus, threads
+ * working on different bins, or on different shards of the same bin,
+ * do not contend with one-another.
  */
 class FixedIntegerIndex
 {
 	protected:
+		// Size of the mutex pool. Shard i is guarded by mutex
+		// i % NUM_LOCKS.
+		static const size_t NUM_LOCKS = 64;
+		mutable std::mutex _locks[NUM_LOCKS];
+
+		size_t _nshards;
 		std::vector<UnorderedAtomSet> idx;
-		void resize(size_t sz)
+
+		size_t shard(size_t i, const Atom* a) const
 		{
-			idx.resize(sz);
+			if (1 == _nshards) return i;
+			return i * _nshards +
+				(std::hash<const Atom*>()(a) >> 4) % _nshards;
 		}
+		std::mutex& lock_for(size_t s) const
+		{
+			return _locks[s % NUM_LOCKS];
+		}
+
+		FixedIntegerIndex(size_t nshards = 1) : _nshards(nshards) {}
+		void resize(size_t);
 
 	public:
 		~FixedIntegerIndex() {}
 		void insert(size_t i, Atom* a)
 		{
-			UnorderedAtomSet &s(idx.at(i));
-			s.insert(a);
+			size_t s = shard(i, a);
+			std::lock_guard<std::mutex> lck(lock_for(s));
+			idx.at(s).insert(a);
 		}
 
 		void remove(size_t i, Atom* a)
 		{
-			UnorderedAtomSet &s = idx.at(i);
-			s.erase(a);
+			size_t s = shard(i, a);
+			std::lock_guard<std::mutex> lck(lock_for(s));
+			idx.at(s).erase(a);
 		}
 
-		size_t size(size_t i) const
-		{
-			const UnorderedAtomSet &s(idx.at(i));
-			return s.size();
-		}
+		/// Move atom from bin i to bin j, atomically.  Does nothing
+		/// if the atom is not in bin i, i.e. if it was not inserted
+		/// yet, or was removed already.
+		void move(size_t i, size_t j, Atom* a);
 
+		size_t size(size_t i) const;
 		size_t size(void) const;
+
+		/// Call func on every atom in bin i.  The bin is locked while
+		/// this runs, so func must not modify this index.
+		template <typename Function>
+		void foreach(size_t i, Function func) const
+		{
+			for (size_t s = i * _nshards; s < (i+1) * _nshards; s++)
+			{
+				std::lock_guard<std::mutex> lck(lock_for(s));
+				if (idx.size() <= s) return;
+				for (Atom* a : idx[s]) func(a);
+			}
+		}
 };
 
 /** @}*/
@@ -32,12 +32,19 @@
 
 using namespace opencog;
 
-//! 4092 importance bins means each bin has STI range of 32
+//! Each importance bin has an STI range of 2048; as the STI is a
+//! short, this makes for 32 bins.
 #define IMPORTANCE_INDEX_SIZE   (1 << 11)
 
+//! Nearly all atoms have the default STI, and thus sit in the same
+//! bin; each bin is split into this many shards, so that they do not
+//! all sit behind the same lock.
+#define IMPORTANCE_INDEX_SHARDS 16
+
 ImportanceIndex::ImportanceIndex(void)
+	: FixedIntegerIndex(IMPORTANCE_INDEX_SHARDS)
 {
-	resize(IMPORTANCE_INDEX_SIZE+1);
+	resize(importanceBin(AttentionValue::MAXSTI) + 1);
 }
 
 unsigned int ImportanceIndex::importanceBin(short importance)
@@ -47,27 +54,29 @@ unsigned int ImportanceIndex::importanceBin(short importance)
 	return (importance + 32768) / IMPORTANCE_INDEX_SIZE;
 }
 
-void ImportanceIndex::updateImportance(Atom* atom, int bin)
+void ImportanceIndex::updateImportance(Atom* atom, int bin, int newbin)
 {
-	int newbin = importanceBin(atom->getAttentionValue()->getSTI());
 	if (bin == newbin) return;
 
-	remove(bin, atom);
-	insert(newbin, atom);
+	move(bin, newbin, atom);
 }
 
+// The atom lock is held from reading the STI until the atom is in
+// its bin, or out of it.  The STI is changed, and the atom moved from
+// bin to bin, under the same lock; and moving an atom that is not in
+// the index does nothing.  So an atom that gets a new STI while it is
+// being inserted or removed always ends up in the right bin, or in
+// none at all.
 void ImportanceIndex::insertAtom(Atom* atom)
 {
-	int sti = atom->getAttentionValue()->getSTI();
-	int bin = importanceBin(sti);
-	insert(bin, atom);
+	std::lock_guard<std::mutex> lck(atom->_mtx());
+	insert(importanceBin(atom->_sti), atom);
 }
 
 void ImportanceIndex::removeAtom(Atom* atom)
 {
-	int sti = atom->getAttentionValue()->getSTI();
-	int bin = importanceBin(sti);
-	remove(bin, atom);
+	std::lock_guard<std::mutex> lck(atom->_mtx());
+	remove(importanceBin(atom->_sti), atom);
 }
 
 UnorderedHandleSet ImportanceIndex::getHandleSet(
@@ -75,8 +84,6 @@ UnorderedHandleSet ImportanceIndex::getHandleSet(
         AttentionValue::sti_t lowerBound,
         AttentionValue::sti_t upperBound) const
 {
-	UnorderedAtomSet set;
-
 	// The indexes for the lower bound and upper bound lists is returned.
 	int lowerBin = importanceBin(lowerBound);
 	int upperBin = importanceBin(upperBound);
@@ -85,41 +92,40 @@ UnorderedHandleSet ImportanceIndex::getHandleSet(
 	// For the lower bound and upper bound index, the list is filtered,
 	// because there may be atoms that have the same importanceIndex
 	// and whose importance is lower than lowerBound or bigger than
-	// upperBound.
-	const UnorderedAtomSet &sl = idx[lowerBin];
-	std::copy_if(sl.begin(), sl.end(), inserter(set),
-		[&](Atom* atom)->bool {
-			AttentionValue::sti_t sti =
-				atom->getAttentionValue()->getSTI();
-			return (lowerBound <= sti and sti <= upperBound);
-		});
+	// upperBound.  The STI is checked only after the bin lock is
+	// dropped: the atom lock is held while moving an atom from bin to
+	// bin, and so must never be taken while holding a bin lock.  The
+	// atoms are held by handle from the moment they are found, as
+	// another thread may extract them, and drop the last reference to
+	// them, once the bin lock is released.
+	HandleSeq edge, middle;
+	auto collect = [&](Atom* atom)->void { edge.push_back(atom->getHandle()); };
+	foreach(lowerBin, collect);
 
 	// If both lower and upper bounds are in the same bin,
 	// Then we are done.
-	if (lowerBin == upperBin) {
-		UnorderedHandleSet ret;
-		std::transform(set.begin(), set.end(), inserter(ret),
-		               [](Atom* atom)->Handle { return atom->getHandle(); });
-		return ret;
-	}
-
-	// For every index within lowerBound and upperBound,
-	// add to the list.
-	while (++lowerBin < upperBin) {
-		const UnorderedAtomSet &ss = idx[lowerBin];
-		set.insert(ss.begin(), ss.end());
+	if (lowerBin != upperBin) {
+		// For every index within lowerBound and upperBound,
+		// add to the list.
+		while (++lowerBin < upperBin)
+			foreach(lowerBin, [&](Atom* atom)->void {
+				middle.push_back(atom->getHandle()); });
+
+		// The two lists are concatenated.
+		foreach(upperBin, collect);
 	}
 
-	// The two lists are concatenated.
-	const UnorderedAtomSet &uset = idx[upperBin];
-	std::copy_if(uset.begin(), uset.end(), inserter(set),
-		[&](Atom* atom)->bool {
-			AttentionValue::sti_t sti = atom->getAttentionValue()->getSTI();
-			return (lowerBound <= sti and sti <= upperBound);
-		});
-
+	// Atoms extracted since they were found are left out.
 	UnorderedHandleSet ret;
-	std::transform(set.begin(), set.end(), inserter(ret),
-	               [](Atom* atom)->Handle { return atom->getHandle(); });
+	for (const Handle& h : middle)
+		if (h->getAtomTable())
+			ret.insert(h);
+
+	for (const Handle& h : edge) {
+		if (nullptr == h->getAtomTable()) continue;
+		AttentionValue::sti_t sti = h->getSTI();
+		if (lowerBound <= sti and sti <= upperBound)
+			ret.insert(h);
+	}
 	return ret;
 }
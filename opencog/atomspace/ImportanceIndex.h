@@ -35,9 +35,10 @@ namespace opencog
 class AtomTable;
 
 /**
- * Implements an index with additional routines needed for managing 
- * short-term importance.  This index is not thread-safe, by itself.
- * Users of this class must gauarantee single-threaded access!
+ * Implements an index with additional routines needed for managing
+ * short-term importance.  Each importance bin is split into shards,
+ * each behind its own lock, so this index can be updated from
+ * multiple threads.
  */
 class ImportanceIndex: public FixedIntegerIndex
 {
@@ -48,12 +49,15 @@ public:
 
     /** Updates the importance index for the given atom.
      * According to the new importance of the atom, it may change importance
-     * bins.
+     * bins.  The caller holds the atom lock, so that concurrent updates
+     * of the same atom move it from bin to bin in the same order as
+     * they change its STI.
      *
      * @param The atom whose importance index will be updated.
      * @param The old importance bin where the atom originally was.
+     * @param The new importance bin.
      */
-    void updateImportance(Atom*, int);
+    void updateImportance(Atom*, int, int);
     
     UnorderedHandleSet getHandleSet(const AtomTable*,
                               AttentionValue::sti_t,
@@ -21,6 +21,7 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <algorithm>
 #include <stdio.h>
 
 #include <opencog/atomspace/AtomTable.h>
@@ -38,9 +39,6 @@ using namespace opencog;
 
 void Link::resort(void)
 {
-    // Caution: this comparison function MUST BE EXACTLY THE SAME as
-    // the one in AtomTable.cc, used for Unordered links. Changing
-    // this without changing the other one will break things!
     std::sort(_outgoing.begin(), _outgoing.end(), handle_less());
 }
 
@@ -55,9 +53,62 @@ void Link::init(const std::vector<Handle>& outgoingVector)
     _outgoing = outgoingVector;
     // If the link is unordered, it will be normalized by sorting the
     // elements in the outgoing list.
-    if (classserver().isA(_type, UNORDERED_LINK)) {
+    bool unordered = classserver().isA(_type, UNORDERED_LINK);
+    if (unordered) {
         resort();
     }
+    _hash = compute_hash(_type, _outgoing, unordered);
+
+    size_t arity = _outgoing.size();
+    _inslot.reset(new size_t[arity]);
+    std::fill(_inslot.get(), _inslot.get() + arity, NO_SLOT);
+}
+
+const size_t Link::NO_SLOT;
+
+static inline size_t mix(size_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/// The hash of the outgoing atoms is combined in order, or, for
+/// unordered links, summed up (not xor'ed, so that repeated atoms
+/// don't cancel out).  Each outgoing atom carries its own hash, so
+/// this does not recurse.
+size_t Link::compute_hash(Type t, const HandleSeq& oset, bool unordered)
+{
+    size_t h = t;
+    size_t sum = 0;
+    for (const Handle& ho : oset) {
+        // Handles that do not resolve to an atom can only be hashed
+        // by their UUID.
+        const Atom* a = ho.operator->();
+        size_t ha = a ? a->getHash() : handle_hash()(ho);
+        if (unordered)
+            sum += mix(ha);
+        else
+            h = (h ^ ha) * 0x9e3779b97f4a7c15ULL;
+    }
+    h = (h ^ sum) * 0x9e3779b97f4a7c15ULL;
+    return mix(h ^ oset.size());
+}
+
+size_t Link::compute_hash(Type t, const HandleSeq& oset)
+{
+    return compute_hash(t, oset, classserver().isA(t, UNORDERED_LINK));
+}
+
+size_t& Link::inslot(const Atom* atom)
+{
+    size_t arity = _outgoing.size();
+    for (size_t i = 0; i < arity; i++)
+        if (_outgoing[i].operator->() == atom) return _inslot[i];
+
+    throw RuntimeException(TRACE_INFO,
+        "Link - Atom is not in the outgoing set");
 }
 
 Link::~Link()
@@ -225,6 +276,7 @@ bool Link::operator==(const Atom& other) const
 {
     if (getType() != other.getType()) return false;
     const Link& olink = dynamic_cast<const Link&>(other);
+    if (_hash != olink._hash) return false;
 
     Arity arity = getArity();
     if (arity != olink.getArity()) return false;
@@ -49,12 +49,24 @@ typedef unsigned short Arity;
  */
 class Link : public Atom
 {
+    friend class Atom;
     friend class AtomTable;
 
 private:
     void init(const HandleSeq&);
     void resort(void);
 
+    // The slot that this link occupies in the incoming set of each of
+    // the atoms in its outgoing set, within the partition for the type
+    // of this link; see Atom::InSet.  An atom that
+    // occurs more than once uses the slot at its first position.  Each
+    // slot is guarded by the lock of the atom it refers to.  This is a
+    // plain array, rather than a vector, to save room; there is one
+    // slot for each element of _outgoing.
+    static const size_t NO_SLOT = (size_t) -1;
+    std::unique_ptr<size_t[]> _inslot;
+    size_t& inslot(const Atom*);
+
     Link(const Link &l) : Atom(0)
     { OC_ASSERT(false, "Link: bad use of copy ctor"); }
 
@@ -267,6 +279,14 @@ public:
      * @return true if they are different, false otherwise.
      */
     virtual bool operator!=(const Atom&) const;
+
+    /**
+     * Returns the structural hash that a link with the given type and
+     * outgoing set would have.  For unordered links, this does not
+     * depend on the order of the outgoing set.
+     */
+    static size_t compute_hash(Type, const HandleSeq&);
+    static size_t compute_hash(Type, const HandleSeq&, bool unordered);
 };
 
 static inline LinkPtr LinkCast(const Handle& h)
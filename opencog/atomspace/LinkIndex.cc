@@ -19,6 +19,8 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <algorithm>
+
 #include <opencog/atomspace/Link.h>
 #include <opencog/atomspace/LinkIndex.h>
 #include <opencog/atomspace/ClassServer.h>
@@ -29,57 +31,87 @@
 
 using namespace opencog;
 
-LinkIndex::LinkIndex(void)
+/// Same as the equivalence of handle_seq_ptr_less: handles are equal
+/// if they point at the same atom, or have the same (valid) UUID.
+static inline bool same_handle(const Handle& a, const Handle& b)
+{
+	if (a == b) return true;
+	return Handle::INVALID_UUID != a.value() and a.value() == b.value();
+}
+
+static bool same_seq(const HandleSeq& a, const HandleSeq& b)
 {
-	resize();
+	size_t sz = a.size();
+	if (sz != b.size()) return false;
+	for (size_t i = 0; i < sz; i++)
+		if (not same_handle(a[i], b[i])) return false;
+	return true;
 }
 
-void LinkIndex::resize()
+/// Compare the outgoing set of an unordered link with a sequence in
+/// any order.  This is done only after the hashes matched, so it is
+/// nearly always the link that is being looked for.
+static bool same_set(const HandleSeq& a, const HandleSeq& b)
 {
-	idx.resize(classserver().getNumberOfClasses());
+	size_t sz = a.size();
+	if (sz != b.size()) return false;
+	if (same_seq(a, b)) return true;
+
+	// Small sets are compared directly; large ones are put in the
+	// same order as the outgoing sets of unordered links are.
+	if (sz <= 8)
+		return std::is_permutation(a.begin(), a.end(), b.begin(), same_handle);
+
+	HandleSeq sa(a), sb(b);
+	std::sort(sa.begin(), sa.end(), handle_less());
+	std::sort(sb.begin(), sb.end(), handle_less());
+	return same_seq(sa, sb);
 }
 
 size_t LinkIndex::size() const
 {
 	size_t cnt = 0;
-	for (HandleSeqIndex hsi: idx) cnt += hsi.size();
+	for (const AtomHashIndex& sh : _shards)
+		cnt += sh.size();
 	return cnt;
 }
 
 void LinkIndex::insertAtom(const AtomPtr& a)
 {
-	Type t = a->getType();
-	HandleSeqIndex &hsi = idx[t];
-
 	LinkPtr l(LinkCast(a));
 	if (NULL == l) return;
 
-	hsi.insert(l->getOutgoingSet(), l.get());
+	size_t h = l->getHash();
+	_shards[h % NUM_SHARDS].insert(h, a);
 }
 
 void LinkIndex::removeAtom(const AtomPtr& a)
 {
-	Type t = a->getType();
-	HandleSeqIndex &hsi = idx.at(t);
-
 	LinkPtr l(LinkCast(a));
 	if (NULL == l) return;
 
-	hsi.remove(l->getOutgoingSet());
+	size_t h = l->getHash();
+	_shards[h % NUM_SHARDS].remove(h, a);
 }
 
+/// The outgoing set need not be sorted, for unordered links; the hash
+/// does not depend on the order.
 Handle LinkIndex::getHandle(Type t, const HandleSeq &seq) const
 {
-	const HandleSeqIndex &hsi = idx.at(t);
-	Link* l = hsi.get(seq);
-	if (l) return l->getHandle();
-	return Handle::UNDEFINED;
+	bool unordered = classserver().isA(t, UNORDERED_LINK);
+	size_t h = Link::compute_hash(t, seq, unordered);
+	return _shards[h % NUM_SHARDS].find(h,
+		[&](const Atom* a)->bool {
+			if (a->getType() != t) return false;
+			const HandleSeq& oset(static_cast<const Link*>(a)->getOutgoingSet());
+			return unordered ? same_set(oset, seq) : same_seq(oset, seq);
+		});
 }
 
 void LinkIndex::remove(bool (*filter)(const Handle&))
 {
-	for (HandleSeqIndex s : idx)
-		s.remove(filter);
+	for (AtomHashIndex& sh : _shards)
+		sh.remove_if(filter);
 }
 
 UnorderedHandleSet LinkIndex::getHandleSet(Type type,
@@ -94,10 +126,9 @@ UnorderedHandleSet LinkIndex::getHandleSet(Type type,
 			// The 'AssignableFrom' direction is unit-tested in AtomSpaceUTest.cxxtest
 			if (classserver().isA(s, type))
 			{
-				const HandleSeqIndex &hsi = idx.at(s);
-				Link* l = hsi.get(seq);
-				if (l)
-					hs.insert(l->getHandle());
+				Handle h(getHandle(s, seq));
+				if (nullptr != h)
+					hs.insert(h);
 			}
 		}
 	}
@@ -22,10 +22,7 @@
 #ifndef _OPENCOG_LINK_INDEX_H
 #define _OPENCOG_LINK_INDEX_H
 
-#include <set>
-#include <vector>
-
-#include <opencog/atomspace/HandleSeqIndex.h>
+#include <opencog/atomspace/AtomHashIndex.h>
 #include <opencog/atomspace/types.h>
 
 namespace opencog
@@ -35,21 +32,30 @@ namespace opencog
  */
 
 /**
- * Implements a (type, HandleSeq) index array of RB-trees (C++ set)
+ * Implements a (type, HandleSeq) index of links.
  * That is, given both a type, and a HandleSeq, it returns a single,
  * unique Handle associated with that pair.  In other words, it returns
  * the single, unique Link which is that pair.
+ *
+ * The index is keyed on the structural hash that each link carries
+ * (see Link::getHash()), so that inserting or removing a link does not
+ * hash anything, and finding one is a single probe; the outgoing sets
+ * are compared only if the hashes match.
+ *
+ * Lookups are lock-free; see AtomHashIndex. Inserts and removals are
+ * split into shards, keyed on the hash of the type and outgoing set,
+ * each with its own lock, so that they rarely contend either.
  */
 class LinkIndex
 {
     private:
-        std::vector<HandleSeqIndex> idx;
+        static const size_t NUM_SHARDS = 16;
+        AtomHashIndex _shards[NUM_SHARDS];
+
     public:
-        LinkIndex(void);
         void insertAtom(const AtomPtr&);
         void removeAtom(const AtomPtr&);
         void remove(bool (*)(const Handle&));
-        void resize();
         size_t size() const;
 
         Handle getHandle(Type type, const HandleSeq&) const;
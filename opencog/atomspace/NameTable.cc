@@ -0,0 +1,150 @@
+/*
+ * opencog/atomspace/NameTable.cc
+ *
+ * Copyright (C) 2015 OpenCog Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <opencog/atomspace/NameTable.h>
+
+using namespace opencog;
+
+// Initial number of slots in a shard; must be a power of two.
+#define INITIAL_SLOTS 16
+
+/// Return the slot holding the string, or else the empty slot where
+/// it would go.  Linear probing; there is always at least one empty
+/// slot.  Must be called with the shard lock held.
+size_t NameTable::probe(const Shard& sh, size_t h, const std::string& str)
+{
+	size_t mask = sh.slots.size() - 1;
+	size_t i = h & mask;
+	while (sh.slots[i] and sh.slots[i]->_str != str)
+		i = (i + 1) & mask;
+	return i;
+}
+
+/// Double the number of slots. Must be called with the shard lock held.
+void NameTable::grow(Shard& sh)
+{
+	std::vector<Name*> old;
+	old.swap(sh.slots);
+	sh.slots.resize(old.empty() ? INITIAL_SLOTS : 2 * old.size(), NULL);
+	for (Name* nm : old)
+		if (nm) sh.slots[probe(sh, nm->_hash, nm->_str)] = nm;
+}
+
+/// Empty the slot, and move back the entries after it that would no
+/// longer be found. Must be called with the shard lock held.
+void NameTable::erase(Shard& sh, size_t i)
+{
+	size_t mask = sh.slots.size() - 1;
+	size_t j = i;
+	while (true)
+	{
+		sh.slots[i] = NULL;
+		do
+		{
+			j = (j + 1) & mask;
+			if (NULL == sh.slots[j]) return;
+			// The entry at j can stay, if its home slot is in the
+			// cyclic range (i, j].
+			size_t home = sh.slots[j]->_hash & mask;
+			if (i <= j ? (i < home and home <= j) : (i < home or home <= j))
+				continue;
+			break;
+		} while (true);
+		sh.slots[i] = sh.slots[j];
+		i = j;
+	}
+}
+
+const NameTable::Name* NameTable::intern(const std::string& str)
+{
+	size_t h = hash(str);
+	Shard& sh = shard(h);
+	std::lock_guard<std::mutex> lck(sh.mtx);
+
+	// Keep the load factor at three-quarters or below.
+	if (4 * (sh.size + 1) > 3 * sh.slots.size())
+		grow(sh);
+
+	size_t i = probe(sh, h, str);
+	Name* nm = sh.slots[i];
+	if (nm)
+	{
+		nm->_refs++;
+		return nm;
+	}
+	nm = new Name(h, str);
+	sh.slots[i] = nm;
+	sh.size++;
+	return nm;
+}
+
+const NameTable::Name* NameTable::find(const std::string& str)
+{
+	size_t h = hash(str);
+	Shard& sh = shard(h);
+	std::lock_guard<std::mutex> lck(sh.mtx);
+	if (0 == sh.size) return NULL;
+
+	Name* nm = sh.slots[probe(sh, h, str)];
+	if (nm) nm->_refs++;
+	return nm;
+}
+
+void NameTable::release(const Name* cnm)
+{
+	Name* nm = const_cast<Name*>(cnm);
+
+	// If this is not the last reference, there is no need to lock;
+	// new references are taken only from those that exist, or else
+	// under the lock.
+	size_t r = nm->_refs.load();
+	while (1 < r)
+		if (nm->_refs.compare_exchange_weak(r, r - 1)) return;
+
+	Shard& sh = shard(nm->_hash);
+	std::lock_guard<std::mutex> lck(sh.mtx);
+	if (0 < --nm->_refs) return;
+
+	erase(sh, probe(sh, nm->_hash, nm->_str));
+	sh.size--;
+	delete nm;
+}
+
+size_t NameTable::size(void)
+{
+	size_t n = 0;
+	for (Shard& sh : _shards)
+	{
+		std::lock_guard<std::mutex> lck(sh.mtx);
+		n += sh.size;
+	}
+	return n;
+}
+
+NameTable& opencog::nametable(void)
+{
+	// Never deleted: nodes in static storage may still give back
+	// their names when the program exits.
+	static NameTable* instance = new NameTable();
+	return *instance;
+}
+
+// ================================================================
@@ -0,0 +1,117 @@
+/*
+ * opencog/atomspace/NameTable.h
+ *
+ * Copyright (C) 2015 OpenCog Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _OPENCOG_NAME_TABLE_H
+#define _OPENCOG_NAME_TABLE_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace opencog
+{
+/** \addtogroup grp_atomspace
+ *  @{
+ */
+
+/**
+ * Interned node names.
+ *
+ * Each distinct string that is used as the name of some node is
+ * stored exactly once, no matter how many nodes (of how many types,
+ * in how many atomspaces) carry it.  The interned copy has a stable
+ * address, which serves as the id of the name: two nodes have the
+ * same name if and only if they point at the same Name.  The name
+ * also carries its hash, so that it is computed only once.
+ *
+ * The names are reference-counted; a Name goes away when the last
+ * node that uses it does.  The table is split into shards, each a
+ * small open-addressing hash set with its own lock.
+ */
+class NameTable
+{
+	public:
+		struct Name
+		{
+			std::atomic<size_t> _refs;
+			const size_t _hash;
+			const std::string _str;
+			Name(size_t h, const std::string& s)
+				: _refs(1), _hash(h), _str(s) {}
+		};
+
+		/// The hash of a string; interned names carry theirs.
+		static size_t hash(const std::string& str)
+		{
+			return std::hash<std::string>()(str);
+		}
+
+	private:
+		static const size_t NUM_SHARDS = 64;
+		struct Shard
+		{
+			std::mutex mtx;
+			std::vector<Name*> slots;
+			size_t size;
+			Shard(void) : size(0) {}
+		};
+		Shard _shards[NUM_SHARDS];
+
+		Shard& shard(size_t h)
+		{
+			return _shards[(h >> 16) % NUM_SHARDS];
+		}
+		static size_t probe(const Shard&, size_t, const std::string&);
+		static void grow(Shard&);
+		static void erase(Shard&, size_t);
+
+	public:
+		/// Return the interned copy of the string, making it if need
+		/// be. The caller gets a reference, to be given back with
+		/// release().
+		const Name* intern(const std::string&);
+
+		/// Return the interned copy of the string, with a reference
+		/// that must be given back with release(); or NULL, if there
+		/// is no such name, that is, no node has it.
+		const Name* find(const std::string&);
+
+		/// Take one more reference on a name that is already held.
+		const Name* ref(const Name* nm)
+		{
+			const_cast<Name*>(nm)->_refs++;
+			return nm;
+		}
+
+		void release(const Name*);
+
+		/// The number of distinct names.
+		size_t size(void);
+};
+
+/// The table of names, shared by all atomspaces.
+NameTable& nametable(void);
+
+/** @}*/
+} //namespace opencog
+
+#endif // _OPENCOG_NAME_TABLE_H
@@ -40,13 +40,19 @@ void Node::init(const std::string& cname)
             "Node - Invalid node type '%d' %s.",
             _type, classserver().getTypeName(_type).c_str());
     }
-    _name = cname;
+    _name = nametable().intern(cname);
+    _hash = _name->_hash * 31 + _type;
+}
+
+Node::~Node()
+{
+    nametable().release(_name);
 }
 
 std::string Node::toShortString(const std::string& indent)
 {
-    std::string tmpname = _name;
-    if (_name == "")
+    std::string tmpname = getName();
+    if (tmpname == "")
         tmpname = "#" + std::to_string(_uuid);
 
     std::string atname;
@@ -64,8 +70,8 @@ std::string Node::toShortString(const std::string& indent)
 
 std::string Node::toString(const std::string& indent)
 {
-    std::string tmpname = _name;
-    if (_name == "")
+    std::string tmpname = getName();
+    if (tmpname == "")
         tmpname = "#" + std::to_string(_uuid);
 
     std::string answer = indent;
@@ -95,7 +101,7 @@ std::string Node::toString(const std::string& indent)
 bool Node::operator==(const Atom& other) const
 {
     return (getType() == other.getType()) and
-           (getName() == dynamic_cast<const Node&>(other).getName());
+           (_name == dynamic_cast<const Node&>(other)._name);
 }
 
 bool Node::operator!=(const Atom& other) const
@@ -28,6 +28,7 @@
 
 #include <opencog/util/oc_assert.h>
 #include <opencog/atomspace/Atom.h>
+#include <opencog/atomspace/NameTable.h>
 
 namespace opencog
 {
@@ -43,7 +44,8 @@ class Node : public Atom
 {
 protected:
     // properties
-    std::string _name;
+    // The name is interned; see NameTable.
+    const NameTable::Name* _name;
     void init(const std::string&);
 
     Node(const Node &l) : Atom(0)
@@ -78,15 +80,24 @@ public:
                ({ AttentionValuePtr av(n.getAttentionValue());
                   av->isDefaultAV() ? av : av->clone(); }))
     {
-        init(n._name);
+        _name = nametable().ref(n._name);
+        _hash = n._hash;
     }
 
+    ~Node();
+
     /**
      * Gets the name of the node.
      *
      * @return The name of the node.
      */
-    inline const std::string& getName() const { return _name; }
+    inline const std::string& getName() const { return _name->_str; }
+
+    /**
+     * Gets the interned name of the node. Nodes with equal names
+     * have the same interned name.
+     */
+    inline const NameTable::Name* getInternedName() const { return _name; }
 
     /**
      * Returns a string representation of the node.
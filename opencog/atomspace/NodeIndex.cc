@@ -19,6 +19,8 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <iterator>
+
 #include <opencog/atomspace/NodeIndex.h>
 #include <opencog/atomspace/Atom.h>
 #include <opencog/atomspace/ClassServer.h>
@@ -26,20 +28,11 @@
 
 using namespace opencog;
 
-NodeIndex::NodeIndex()
-{
-	resize();
-}
-
-void NodeIndex::resize()
-{
-	idx.resize(classserver().getNumberOfClasses());
-}
-
 size_t NodeIndex::size() const
 {
 	size_t cnt = 0;
-	for (const NameIndex& ni : idx) cnt += ni.size();
+	for (const AtomHashIndex& sh : _shards)
+		cnt += sh.size();
 	return cnt;
 }
 
@@ -47,21 +40,7 @@ UnorderedHandleSet NodeIndex::getHandleSet(Type type, const std::string& name,
 		bool subclass) const
 {
 	UnorderedHandleSet hs;
-	if (subclass) {
-
-		Type max = idx.size();
-		for (Type s = 0; s < max; s++) {
-			if (classserver().isA(s, type)) {
-				Atom* atom = getAtom(s, name);
-				if (atom)
-					hs.insert(atom->getHandle());
-			}
-		}
-	} else {
-		Atom* atom = getAtom(type, name);
-		if (atom) hs.insert(atom->getHandle());
-	}
-
+	getHandleSet(std::inserter(hs, hs.end()), type, name, subclass);
 	return hs;
 }
 
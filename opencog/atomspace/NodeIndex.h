@@ -22,10 +22,12 @@
 #ifndef _OPENCOG_NODEINDEX_H
 #define _OPENCOG_NODEINDEX_H
 
-#include <set>
-#include <vector>
+#include <string>
 
-#include <opencog/atomspace/NameIndex.h>
+#include <opencog/atomspace/AtomHashIndex.h>
+#include <opencog/atomspace/ClassServer.h>
+#include <opencog/atomspace/NameTable.h>
+#include <opencog/atomspace/Node.h>
 #include <opencog/atomspace/types.h>
 
 namespace opencog
@@ -35,35 +37,67 @@ namespace opencog
  */
 
 /**
- * Implements an (type, name) index array of RB-trees (C++ set)
+ * Implements a (type, name) index of atoms.
  * That is, given only the type and name of an atom, this will
  * return the corresponding handle of that atom.
+ *
+ * Node names are interned (see NameTable), and carry their hash, so
+ * that inserts and removals never hash strings. Lookups have to hash
+ * the string they are given, but they do not need to look up the
+ * interned name: the string is compared only to the names of nodes
+ * with a matching hash, which is nearly always just the one node
+ * that is found.
+ *
+ * Lookups are lock-free; see AtomHashIndex. Inserts and removals are
+ * split into shards, keyed on the hash of the type and name, each
+ * with its own lock, so that they rarely contend either.
  */
 class NodeIndex
 {
 	private:
-		std::vector<NameIndex> idx;
+		static const size_t NUM_SHARDS = 16;
+		AtomHashIndex _shards[NUM_SHARDS];
 
-	public:
-		NodeIndex();
+		// Same as the hash of a node; see Node::init().
+		static size_t hash(Type t, size_t name_hash)
+		{
+			return name_hash * 31 + t;
+		}
 
-		void insertAtom(Atom* a)
+	public:
+		void insertAtom(const AtomPtr& a)
 		{
-			NameIndex &ni(idx[a->getType()]);
-			ni.insertAtom(a);
+			NodePtr n(NodeCast(a));
+			if (NULL == n) return;
+			size_t h = n->getHash();
+			_shards[h % NUM_SHARDS].insert(h, a);
 		}
-		void removeAtom(Atom* a)
+		void removeAtom(const AtomPtr& a)
 		{
-			NameIndex &ni(idx.at(a->getType()));
-			ni.removeAtom(a);
+			NodePtr n(NodeCast(a));
+			if (NULL == n) return;
+			size_t h = n->getHash();
+			_shards[h % NUM_SHARDS].remove(h, a);
 		}
-		void resize();
 		size_t size() const;
 
-		Atom* getAtom(Type type, const std::string& str) const
+		/// Look up a node, given the hash of its name (as computed
+		/// by NameTable::hash()), so that it need not be re-computed
+		/// when looking for several types.
+		Handle getHandle(Type type, const std::string& str,
+		                 size_t name_hash) const
+		{
+			size_t h = hash(type, name_hash);
+			return _shards[h % NUM_SHARDS].find(h,
+				[&](const Atom* a)->bool {
+					return a->getType() == type and
+						static_cast<const Node*>(a)->getName() == str;
+				});
+		}
+
+		Handle getHandle(Type type, const std::string& str) const
 		{
-			const NameIndex &ni(idx.at(type));
-			return ni.get(str);
+			return getHandle(type, str, NameTable::hash(str));
 		}
 
 		UnorderedHandleSet getHandleSet(Type type, const std::string&, bool subclass) const;
@@ -72,18 +106,19 @@ class NodeIndex
 		getHandleSet(OutputIterator result,
 		             Type type, const std::string& name, bool subclass) const
 		{
+			size_t name_hash = NameTable::hash(name);
 			if (not subclass)
 			{
-				Atom* atom = getAtom(type, name);
-				if (atom) *result++ = atom->getHandle();
+				Handle h(getHandle(type, name, name_hash));
+				if (h) *result++ = h;
 			}
 			else
 			{
-				Type max = idx.size();
+				Type max = classserver().getNumberOfClasses();
 				for (Type s = 0; s < max; s++) {
 					if (classserver().isA(s, type)) {
-						Atom* atom = getAtom(s, name);
-						if (atom) *result++ = atom->getHandle();
+						Handle h(getHandle(s, name, name_hash));
+						if (h) *result++ = h;
 					}
 				}
 			}
@@ -61,9 +61,11 @@ class AtomTable;
 class TLB
 {
     friend class Atom;
+    friend class AtomSpace;
     friend class AtomSpaceBenchmark;
     friend class AtomStorage;
     friend class AtomTable;
+    friend class MmapStorage;
     friend class ::TLBUTest;
     friend class ::BasicSaveUTest;
 
@@ -125,6 +127,20 @@ private:
         UUID extent = hi - _brk_uuid + 1;
         _brk_uuid.fetch_add(extent, std::memory_order_relaxed);
     }
+
+    /// Reserve all UUID's up to 'hi', but only if none from 'lo' on
+    /// have been issued yet; otherwise, reserve nothing and return
+    /// false.  The check and the reservation are one atomic step, so
+    /// no other thread can be issued a UUID in [lo, hi] in between.
+    static inline bool reserve_unused(UUID lo, UUID hi)
+    {
+        UUID brk = _brk_uuid.load(std::memory_order_relaxed);
+        do {
+            if (lo < brk) return false;
+        } while (not _brk_uuid.compare_exchange_weak(brk, hi + 1,
+                                       std::memory_order_relaxed));
+        return true;
+    }
 };
 
 inline bool TLB::isInvalidHandle(const Handle& h)
@@ -25,141 +25,38 @@
 
 using namespace opencog;
 
+// Number of shards per type.
+#define TYPE_INDEX_SHARDS 8
+
 TypeIndex::TypeIndex(void)
+	: FixedIntegerIndex(TYPE_INDEX_SHARDS)
 {
+	num_types = 0;
 	resize();
 }
 
 void TypeIndex::resize(void)
 {
-	num_types = classserver().getNumberOfClasses();
-	FixedIntegerIndex::resize(num_types + 1);
+	size_t ntypes = classserver().getNumberOfClasses();
+	FixedIntegerIndex::resize(ntypes + 1);
+	num_types = ntypes;
 }
 
 size_t TypeIndex::getNumAtomsOfType(Type type, bool count_subclasses) const
 {
-    iterator it(type, count_subclasses);
-    size_t atom_count = 0;
-    it.s = idx.begin();
-    it.send = idx.end();
-
-    // Loop over all the types looking for type and optional subclasses.
-    Type current_type = 0;
-    while (it.s != it.send)
-    {
-        // If this type is a match...
-        if ((type == current_type) || 
-            (count_subclasses && (classserver().isA(type, it.type))))
-        {
-            // Add the size of the atom set for this type.
-            atom_count += idx.at(current_type).size();
-        }
-        current_type++;
-        ++it.s;
-    }
-
-    return atom_count;
-}
-
-// ================================================================
-
-TypeIndex::iterator TypeIndex::begin(Type t, bool sub) const
-{
-	iterator it(t, sub);
-	it.send = idx.end();
+	size_t atom_count = 0;
 
-	it.s = idx.begin();
-	it.currtype = 0;
-	while (it.s != it.send)
+	// Loop over all the types looking for type and optional subclasses.
+	for (Type t = 0; t < num_types; t++)
 	{
-		// Find the first type which is a subtype, and start iteration there.
-		if ((it.type == it.currtype) || 
-		    (sub && (classserver().isA(it.currtype, it.type))))
+		if ((type == t) or
+		    (count_subclasses and classserver().isA(t, type)))
 		{
-			it.se = it.s->begin();
-			if (it.se != it.s->end()) return it;
+			// Add the size of the atom set for this type.
+			atom_count += size(t);
 		}
-		it.currtype++;
-		++it.s;
 	}
-
-	return it;
-}
-
-TypeIndex::iterator TypeIndex::end(void) const
-{
-	iterator it(num_types, false);
-	it.se = idx.at(num_types).end();
-	it.s = idx.end();
-	it.send = idx.end();
-	it.currtype = num_types;
-	return it;
-}
-
-TypeIndex::iterator::iterator(Type t, bool sub)
-{
-	type = t;
-	subclass = sub;
-}
-
-TypeIndex::iterator& TypeIndex::iterator::operator=(iterator v)
-{
-	s = v.s;
-	send = v.send;
-	se = v.se;
-	currtype = v.currtype;
-	type = v.type;
-	subclass = v.subclass;
-	return *this;
-}
-
-Handle TypeIndex::iterator::operator*(void)
-{
-	if (s == send) return Handle::UNDEFINED;
-	return (*se)->getHandle();
-}
-
-bool TypeIndex::iterator::operator==(iterator v)
-{
-	if ((v.s == v.send) && (s == send)) return true;
-	return v.se == se;
-}
-
-bool TypeIndex::iterator::operator!=(iterator v)
-{
-	if ((v.s == v.send) && (s != send)) return v.se != se;
-	if ((v.s != v.send) && (s == send)) return v.se != se;
-	return false;
-}
-
-TypeIndex::iterator& TypeIndex::iterator::operator++()
-{
-	return operator++(1);
-}
-
-TypeIndex::iterator& TypeIndex::iterator::operator++(int i)
-{
-	if (s == send) return *this;
-
-	++se;
-	if (se == s->end())
-	{
-		do
-		{
-			++s;
-			currtype++;
-
-			// Find the first type which is a subtype, and start iteration there.
-			if ((type == currtype) || 
-			    (subclass && (classserver().isA(currtype, type))))
-			{
-				se = s->begin();
-				if (se != s->end()) return *this;
-			}
-		} while (s != send);
-	}
-
-	return *this;
+	return atom_count;
 }
 
 // ================================================================
@@ -26,6 +26,7 @@
 #include <vector>
 
 #include <opencog/atomspace/Atom.h>
+#include <opencog/atomspace/ClassServer.h>
 #include <opencog/atomspace/FixedIntegerIndex.h>
 #include <opencog/atomspace/Handle.h>
 #include <opencog/atomspace/types.h>
@@ -37,17 +38,16 @@ namespace opencog
  */
 
 /**
- * Implements an integer index as an RB-tree (C++ set) That is, given
- * an atom Type, this returns all of the Handles for that Type.
+ * Implements an integer index as an array of hash sets.  That is,
+ * given an atom Type, this returns all of the Handles for that Type.
  *
- * The primary interface for this is an iterator, and that is because
- * the index will typically contain millions of atoms, and this is far
- * too much to try to return in some temporary array.  Iterating is much
- * safer.
+ * Each type is split into several shards, so that threads inserting
+ * many atoms of the same type do not all contend for one lock.
  *
- * @todo The iterator is NOT thread-safe against the insertion or
- * removal of atoms!  Either inserting or removing an atom will cause
- * the iterator references to be freed, leading to mystery crashes!
+ * Atoms are handed out by copying them into an output iterator,
+ * rather than by iterating over the index in place: the index will
+ * typically contain millions of atoms, and is being modified by other
+ * threads, so it cannot be safely held open for iteration.
  */
 class TypeIndex : public FixedIntegerIndex
 {
@@ -64,31 +64,22 @@ class TypeIndex : public FixedIntegerIndex
 		{
 			remove(a->getType(), a);
 		}
-   		size_t getNumAtomsOfType(Type type, bool subclass) const;
+		size_t getNumAtomsOfType(Type type, bool subclass) const;
 
-		class iterator
-			: public std::iterator<std::forward_iterator_tag, Handle>
+		template <typename OutputIterator> OutputIterator
+		getHandles(OutputIterator result, Type type, bool subclass) const
 		{
-			friend class TypeIndex;
-			public:
-				iterator(Type, bool);
-				iterator& operator++();
-				iterator& operator++(int);
-				iterator& operator=(iterator);
-				bool operator==(iterator);
-				bool operator!=(iterator);
-				Handle operator*(void);
-			private:
-				Type type;
-				bool subclass;
-				std::vector<UnorderedAtomSet>::const_iterator s;
-				std::vector<UnorderedAtomSet>::const_iterator send;
-				Type currtype;
-				UnorderedAtomSet::const_iterator se;
-		};
-
-		iterator begin(Type, bool) const;
-		iterator end(void) const;
+			for (Type t = 0; t < num_types; t++)
+			{
+				if (t != type and
+				    (not subclass or not classserver().isA(t, type)))
+					continue;
+				foreach(t, [&](Atom* a)->void {
+					*result++ = a->getHandle();
+				});
+			}
+			return result;
+		}
 };
 
 /** @}*/
@@ -2,8 +2,13 @@
 /** AtomSpaceBenchmark.cc */
 
 #include <ctime>
+#include <functional>
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <thread>
+#include <malloc.h>
+#include <unistd.h>
 #include <sys/time.h>
 #include <sys/resource.h>
 
@@ -142,6 +147,89 @@ long AtomSpaceBenchmark::getMemUsage()
     return rss;
 }
 
+// Bytes in use on the heap, including the big blocks that malloc
+// hands out with mmap.
+static size_t heapInUse()
+{
+    struct mallinfo mi = mallinfo();
+    return (size_t) mi.uordblks + (size_t) mi.hblkhd;
+}
+
+// Heap bytes per atom, as seen by malloc, for an AtomTable holding
+// n ConceptNodes and n ListLinks.  This includes the indexes, and all
+// the rest.
+static double bytesPerAtom(size_t n)
+{
+    size_t before = heapInUse();
+    AtomTable* table = new AtomTable();
+    Handle prev;
+    for (size_t i = 0; i < n; i++) {
+        std::ostringstream oss;
+        oss << "bytes per atom " << i;
+        Handle h(table->add(createNode(CONCEPT_NODE, oss.str()), false));
+        if (prev)
+            table->add(createLink(LIST_LINK, prev, h), false);
+        prev = h;
+    }
+    size_t natoms = table->getSize();
+    size_t after = heapInUse();
+    prev = Handle::UNDEFINED;
+    delete table;
+    return ((double) after - (double) before) / natoms;
+}
+
+// The resident set size right now, in megabytes, or zero where there
+// is no /proc to ask.  Unlike getMemUsage(), this goes down again when
+// memory is given back.
+static double residentMB()
+{
+    long pages = 0, resident = 0;
+    std::ifstream statm("/proc/self/statm");
+    if (not (statm >> pages >> resident)) return 0.0;
+    return resident * (double) sysconf(_SC_PAGESIZE) / (1 << 20);
+}
+
+// The resident set growth for an AtomSpace holding n ConceptNodes and
+// n ListLinks; after purging half of the nodes, and adding as many
+// new ones back, a few times over; and after clearing it.  Memory
+// that is freed, but stuck in a fragmented heap, shows up in the last
+// two.
+static void printResidentChurn(size_t n, int rounds)
+{
+    double start = residentMB();
+    AtomSpace* as = new AtomSpace();
+    HandleSeq nodes(n);
+    for (size_t i = 0; i < n; i++) {
+        nodes[i] = as->add_node(CONCEPT_NODE, "churn " + std::to_string(i));
+        if (i) as->add_link(LIST_LINK, nodes[i-1], nodes[i]);
+    }
+    cout << "Resident MB, " << as->get_size() << " atoms = "
+         << residentMB() - start << endl;
+
+    size_t gen = n;
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = r % 2; i < n; i += 2) {
+            Handle& h = nodes[(i * 7919 + r * 104729) % n];
+            if (h) as->purge_atom(h, true);
+            h = Handle::UNDEFINED;
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (nodes[i]) continue;
+            nodes[i] = as->add_node(CONCEPT_NODE,
+                                    "churn " + std::to_string(gen++));
+            const Handle& next = nodes[(i + 1) % n];
+            as->add_link(LIST_LINK, nodes[i], next ? next : nodes[i]);
+        }
+    }
+    cout << "Resident MB after " << rounds << " rounds of churn, "
+         << as->get_size() << " atoms = " << residentMB() - start << endl;
+
+    nodes.clear();
+    as->clear();
+    cout << "Resident MB after clear() = " << residentMB() - start << endl;
+    delete as;
+}
+
 void AtomSpaceBenchmark::printTypeSizes()
 {
     // Note that these are just the type size, it doesn't include the size of
@@ -187,6 +275,14 @@ void AtomSpaceBenchmark::printTypeSizes()
     Handle el = LK(EVALUATION_LINK, np, ll);
     cout << "EvaluationLink with two ConceptNodes = "
          << estimateOfAtomSize(el) << endl;
+    cout << DIVIDER_LINE << endl;
+
+    // The actual memory use, indexes and all.  The resident set is
+    // looked at first, before the heap has grown to hold other tables.
+    const size_t n = 100000;
+    printResidentChurn(n, 3);
+    cout << "Heap bytes/atom, " << 2*n << " atoms = "
+         << bytesPerAtom(n) << endl;
 }
 
 void AtomSpaceBenchmark::showMethods()
@@ -196,6 +292,8 @@ void AtomSpaceBenchmark::showMethods()
     cout << "  getType" << endl;
     cout << "  getTruthValue" << endl;
     cout << "  setTruthValue" << endl;
+    cout << "  setSTI" << endl;
+    cout << "  setSTIBatch" << endl;
 #ifdef ZMQ_EXPERIMENT
     cout << "  getTruthValueZMQ" << endl;
 #endif
@@ -225,6 +323,18 @@ void AtomSpaceBenchmark::setMethod(std::string methodToTest)
         foundMethod = true;
     }
 
+    if (methodToTest == "all" or methodToTest == "getNode") {
+        methodsToTest.push_back( &AtomSpaceBenchmark::bm_getNode);
+        methodNames.push_back( "getNode");
+        foundMethod = true;
+    }
+
+    if (methodToTest == "all" or methodToTest == "getLink") {
+        methodsToTest.push_back( &AtomSpaceBenchmark::bm_getLink);
+        methodNames.push_back( "getLink");
+        foundMethod = true;
+    }
+
     if (methodToTest == "all" or methodToTest == "getTruthValue") {
         methodsToTest.push_back( &AtomSpaceBenchmark::bm_getTruthValue);
         methodNames.push_back( "getTruthValue");
@@ -245,6 +355,18 @@ void AtomSpaceBenchmark::setMethod(std::string methodToTest)
         foundMethod = true;
     }
 
+    if (methodToTest == "all" or methodToTest == "setSTI") {
+        methodsToTest.push_back( &AtomSpaceBenchmark::bm_setSTI);
+        methodNames.push_back( "setSTI");
+        foundMethod = true;
+    }
+
+    if (methodToTest == "all" or methodToTest == "setSTIBatch") {
+        methodsToTest.push_back( &AtomSpaceBenchmark::bm_setSTIBatch);
+        methodNames.push_back( "setSTIBatch");
+        foundMethod = true;
+    }
+
     if (methodToTest == "all" or methodToTest == "getOutgoingSet") {
         methodsToTest.push_back( &AtomSpaceBenchmark::bm_getOutgoingSet);
         methodNames.push_back( "getOutgoingSet");
@@ -433,7 +555,6 @@ void AtomSpaceBenchmark::startBenchmark(int numThreads)
     if (prg) delete prg;
     prg = new std::poisson_distribution<unsigned>(linkSize_mean);
 
-    // num threads does nothing at the moment;
     if (showTypeSizes) printTypeSizes();
 
     for (unsigned int i = 0; i < methodNames.size(); i++) {
@@ -486,10 +607,129 @@ void AtomSpaceBenchmark::startBenchmark(int numThreads)
         }
     }
 
+    if (0 < numThreads) doThreadedBenchmark(numThreads);
+
     //cout << estimateOfAtomSize(Handle(2)) << endl;
     //cout << estimateOfAtomSize(Handle(1020)) << endl;
 }
 
+/// Run fn(0) ... fn(nthreads-1) in parallel threads, and return the
+/// number of operations per second, given that nops operations were
+/// performed in total.
+static double timeThreads(int nthreads, size_t nops,
+                          std::function<void(int)> fn)
+{
+    timeval tim;
+    gettimeofday(&tim, NULL);
+    double t1 = tim.tv_sec + (tim.tv_usec/1000000.0);
+
+    std::vector<std::thread> thread_pool;
+    for (int t = 0; t < nthreads; t++)
+        thread_pool.push_back(std::thread(fn, t));
+    for (std::thread& th : thread_pool) th.join();
+
+    gettimeofday(&tim, NULL);
+    double t2 = tim.tv_sec + (tim.tv_usec/1000000.0);
+    return nops / (t2 - t1);
+}
+
+/// Measure the throughput of concurrent atom insertion and lookup,
+/// using 1, 2, ... maxThreads threads.  Each thread count gets a
+/// fresh atomspace, and the same total amount of work, split evenly
+/// between the threads. The threads work on disjoint sets of atoms.
+void AtomSpaceBenchmark::doThreadedBenchmark(int maxThreads)
+{
+    if (testKind != BENCH_AS and testKind != BENCH_TABLE) {
+        cerr << "Error: the threaded benchmark supports only the "
+             << "AtomSpace and AtomTable API" << endl;
+        return;
+    }
+
+    cout << "Benchmarking "
+         << (BENCH_TABLE == testKind ? "AtomTable's" : "AtomSpace's")
+         << " threaded add and lookup, " << baseNreps
+         << " operations per column" << endl;
+    printf("%8s %14s %14s %14s %14s\n", "threads",
+           "addNode/sec", "addLink/sec", "getNode/sec", "getLink/sec");
+
+    for (int nthreads = 1; nthreads <= maxThreads; nthreads++)
+    {
+        if (testKind == BENCH_TABLE)
+            atab = new AtomTable();
+        else
+            asp = new AtomSpace();
+        if (buildTestData) buildAtomSpace(atomCount, percentLinks, false);
+
+        size_t per_thread = baseNreps / nthreads;
+        size_t nops = per_thread * nthreads;
+
+        // Make up the names beforehand, so that string formatting
+        // does not get timed.
+        std::vector<std::vector<std::string>> names(nthreads);
+        for (int t = 0; t < nthreads; t++) {
+            for (size_t i = 0; i < per_thread; i++) {
+                std::ostringstream oss;
+                oss << "thread " << t << " node " << i;
+                names[t].push_back(oss.str());
+            }
+        }
+        std::vector<HandleSeq> nodes(nthreads, HandleSeq(per_thread));
+
+        auto add_node = [&](int t) {
+            for (size_t i = 0; i < per_thread; i++) {
+                if (testKind == BENCH_TABLE)
+                    nodes[t][i] = atab->add(
+                        createNode(defaultNodeType, names[t][i]), false);
+                else
+                    nodes[t][i] = asp->add_node(defaultNodeType, names[t][i]);
+            }
+        };
+        auto add_link = [&](int t) {
+            for (size_t i = 0; i < per_thread; i++) {
+                HandleSeq og({nodes[t][i], nodes[t][(i+1) % per_thread]});
+                if (testKind == BENCH_TABLE)
+                    atab->add(createLink(defaultLinkType, og), false);
+                else
+                    asp->add_link(defaultLinkType, og);
+            }
+        };
+        auto get_node = [&](int t) {
+            for (size_t i = 0; i < per_thread; i++) {
+                Handle h;
+                if (testKind == BENCH_TABLE)
+                    h = atab->getHandle(defaultNodeType, names[t][i]);
+                else
+                    h = asp->get_node(defaultNodeType, names[t][i]);
+                OC_ASSERT(h == nodes[t][i], "Node lookup failed");
+            }
+        };
+        auto get_link = [&](int t) {
+            for (size_t i = 0; i < per_thread; i++) {
+                HandleSeq og({nodes[t][i], nodes[t][(i+1) % per_thread]});
+                Handle h;
+                if (testKind == BENCH_TABLE)
+                    h = atab->getHandle(defaultLinkType, og);
+                else
+                    h = asp->get_link(defaultLinkType, og);
+                OC_ASSERT(nullptr != h, "Link lookup failed");
+            }
+        };
+
+        double add_node_rate = timeThreads(nthreads, nops, add_node);
+        double add_link_rate = timeThreads(nthreads, nops, add_link);
+        double get_node_rate = timeThreads(nthreads, nops, get_node);
+        double get_link_rate = timeThreads(nthreads, nops, get_link);
+        printf("%8d %14.0f %14.0f %14.0f %14.0f\n", nthreads,
+               add_node_rate, add_link_rate, get_node_rate, get_link_rate);
+
+        if (testKind == BENCH_TABLE)
+            delete atab;
+        else
+            delete asp;
+    }
+    cout << DIVIDER_LINE << endl;
+}
+
 std::string
 AtomSpaceBenchmark::memoize_or_compile(std::string exp)
 {
@@ -1033,6 +1273,110 @@ timepair_t AtomSpaceBenchmark::bm_getType()
     return timepair_t(0,0);
 }
 
+timepair_t AtomSpaceBenchmark::bm_getNode()
+{
+    // Look nodes up by type and name.
+    Type ts[Nclock];
+    std::string ns[Nclock];
+    for (unsigned int i=0; i<Nclock; i++)
+    {
+        Handle h = getRandomHandle();
+        while (not classserver().isA(h->getType(), NODE))
+            h = getRandomHandle();
+        ts[i] = h->getType();
+        ns[i] = NodeCast(h)->getName();
+    }
+
+    switch (testKind) {
+#if HAVE_CYTHON
+    case BENCH_PYTHON: {
+        OC_ASSERT(false, "Not implemented for python");
+        return timepair_t(0,0);
+    }
+#endif /* HAVE_CYTHON */
+#if HAVE_GUILE
+    case BENCH_SCM: {
+        std::string gsa[Nclock];
+        for (unsigned int i=0; i<Nclock; i++)
+        {
+            std::ostringstream ss;
+            for (unsigned int j=0; j<Nloops; j++) {
+                ss << "(cog-node '" << classserver().getTypeName(ts[i])
+                   << " \"" << ns[i] << "\")\n";
+            }
+            std::string gs = memoize_or_compile(ss.str());
+            gsa[i] = gs;
+        }
+        clock_t t_begin = clock();
+        for (unsigned int i=0; i<Nclock; i++)
+           scm->eval(gsa[i]);
+        clock_t time_taken = clock() - t_begin;
+        return timepair_t(time_taken,0);
+    }
+#endif /* HAVE_GUILE */
+    case BENCH_TABLE: {
+        clock_t t_begin = clock();
+        for (unsigned int i=0; i<Nclock; i++)
+            atab->getHandle(ts[i], ns[i]);
+        clock_t time_taken = clock() - t_begin;
+        return timepair_t(time_taken,0);
+    }
+    case BENCH_AS: {
+        clock_t t_begin = clock();
+        for (unsigned int i=0; i<Nclock; i++)
+            asp->get_handle(ts[i], ns[i]);
+        clock_t time_taken = clock() - t_begin;
+        return timepair_t(time_taken,0);
+    }
+    }
+    return timepair_t(0,0);
+}
+
+timepair_t AtomSpaceBenchmark::bm_getLink()
+{
+    // Look links up by type and outgoing set.
+    Type ts[Nclock];
+    HandleSeq os[Nclock];
+    for (unsigned int i=0; i<Nclock; i++)
+    {
+        Handle h = getRandomHandle();
+        while (not classserver().isA(h->getType(), LINK))
+            h = getRandomHandle();
+        ts[i] = h->getType();
+        os[i] = LinkCast(h)->getOutgoingSet();
+    }
+
+    switch (testKind) {
+#if HAVE_CYTHON
+    case BENCH_PYTHON: {
+        OC_ASSERT(false, "Not implemented for python");
+        return timepair_t(0,0);
+    }
+#endif /* HAVE_CYTHON */
+#if HAVE_GUILE
+    case BENCH_SCM: {
+        OC_ASSERT(false, "Not implemented for scheme");
+        return timepair_t(0,0);
+    }
+#endif /* HAVE_GUILE */
+    case BENCH_TABLE: {
+        clock_t t_begin = clock();
+        for (unsigned int i=0; i<Nclock; i++)
+            atab->getHandle(ts[i], os[i]);
+        clock_t time_taken = clock() - t_begin;
+        return timepair_t(time_taken,0);
+    }
+    case BENCH_AS: {
+        clock_t t_begin = clock();
+        for (unsigned int i=0; i<Nclock; i++)
+            asp->get_handle(ts[i], os[i]);
+        clock_t time_taken = clock() - t_begin;
+        return timepair_t(time_taken,0);
+    }
+    }
+    return timepair_t(0,0);
+}
+
 timepair_t AtomSpaceBenchmark::bm_getTruthValue()
 {
     Handle hs[Nclock];
@@ -1166,6 +1510,81 @@ timepair_t AtomSpaceBenchmark::bm_setTruthValue()
     return timepair_t(0,0);
 }
 
+timepair_t AtomSpaceBenchmark::bm_setSTI()
+{
+    Handle hs[Nclock];
+    AttentionValue::sti_t stis[Nclock];
+    for (unsigned int i=0; i<Nclock; i++)
+    {
+        hs[i] = getRandomHandle();
+        stis[i] = rng->randint(2000) - 1000;
+    }
+
+    switch (testKind) {
+#if HAVE_CYTHON
+    case BENCH_PYTHON: {
+        OC_ASSERT(false, "Not implemented for python");
+        return timepair_t(0,0);
+    }
+#endif /* HAVE_CYTHON */
+#if HAVE_GUILE
+    case BENCH_SCM: {
+        OC_ASSERT(false, "Not implemented for scheme");
+        return timepair_t(0,0);
+    }
+#endif /* HAVE_GUILE */
+    case BENCH_AS:
+    case BENCH_TABLE: {
+        clock_t t_begin = clock();
+        for (unsigned int i=0; i<Nclock; i++)
+            hs[i]->setSTI(stis[i]);
+        clock_t time_taken = clock() - t_begin;
+        return timepair_t(time_taken,0);
+    }
+    }
+    return timepair_t(0,0);
+}
+
+// As above, but all of the STI values are set with one call.
+timepair_t AtomSpaceBenchmark::bm_setSTIBatch()
+{
+    HandleSeq hs(Nclock);
+    std::vector<AttentionValue::sti_t> stis(Nclock);
+    for (unsigned int i=0; i<Nclock; i++)
+    {
+        hs[i] = getRandomHandle();
+        stis[i] = rng->randint(2000) - 1000;
+    }
+
+    switch (testKind) {
+#if HAVE_CYTHON
+    case BENCH_PYTHON: {
+        OC_ASSERT(false, "Not implemented for python");
+        return timepair_t(0,0);
+    }
+#endif /* HAVE_CYTHON */
+#if HAVE_GUILE
+    case BENCH_SCM: {
+        OC_ASSERT(false, "Not implemented for scheme");
+        return timepair_t(0,0);
+    }
+#endif /* HAVE_GUILE */
+    case BENCH_TABLE: {
+        clock_t t_begin = clock();
+        atab->setSTI(hs, stis);
+        clock_t time_taken = clock() - t_begin;
+        return timepair_t(time_taken,0);
+    }
+    case BENCH_AS: {
+        clock_t t_begin = clock();
+        asp->set_STI(hs, stis);
+        clock_t time_taken = clock() - t_begin;
+        return timepair_t(time_taken,0);
+    }
+    }
+    return timepair_t(0,0);
+}
+
 timepair_t AtomSpaceBenchmark::bm_getOutgoingSet()
 {
     Handle hs[Nclock];
@@ -124,8 +124,9 @@ public:
 
     void setMethod(std::string method);
     void showMethods();
-    void startBenchmark(int numThreads=1);
+    void startBenchmark(int numThreads=0);
     void doBenchmark(const std::string& methodName, BMFn methodToCall);
+    void doThreadedBenchmark(int maxThreads);
 
     void buildAtomSpace(long atomspaceSize=(1 << 16), float percentLinks = 0.1, 
             bool display = true);
@@ -138,6 +139,8 @@ public:
     timepair_t bm_rmAtom();
 
     timepair_t bm_getType();
+    timepair_t bm_getNode();
+    timepair_t bm_getLink();
     timepair_t bm_getHandlesByType();
     timepair_t bm_getOutgoingSet();
     timepair_t bm_getIncomingSet();
@@ -146,6 +149,8 @@ public:
     float chanceUseDefaultTV; // if set, this will use default TV for new atoms and bm_setTruthValue
     timepair_t bm_getTruthValue();
     timepair_t bm_setTruthValue();
+    timepair_t bm_setSTI();
+    timepair_t bm_setSTIBatch();
 
 #ifdef ZMQ_EXPERIMENT
     timepair_t bm_getTruthValueZmq();
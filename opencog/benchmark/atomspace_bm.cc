@@ -13,7 +13,7 @@ int main(int argc, char** argv)
 {
     const char* benchmark_desc = "Benchmark tool OpenCog AtomSpace\n"
      "Usage: atomspace_bm [-m <method>] [options]\n"
-     "-t        \tPrint information on type sizes\n"
+     "-t        \tPrint information on type sizes, and heap bytes per atom\n"
      "-A        \tBenchmark all methods\n"
      "-X        \tTest the AtomTable API\n"
      "-g        \tTest the Scheme API\n"
@@ -33,6 +33,8 @@ int main(int argc, char** argv)
      "          \t(default: time(NULL))\n"
      "-S <int>  \tHow many random atoms to add after each measurement\n"
      "          \t(default: 0)\n"
+     "-T <int>  \tMeasure add and lookup throughput with 1 to <int> threads\n"
+     "          \t(default: 0, i.e. not measured)\n"
      "-- Build test data --\n"
      "-p <float> \tSet the connection probability or coordination number\n"
      "         \t(default: 0.2)\n"
@@ -45,6 +47,7 @@ int main(int argc, char** argv)
      "-i <int> \tSet interval of data to save\n";
 
     int c;
+    int numThreads = 0;
 
     if (argc==1) {
         fprintf (stderr, "%s", benchmark_desc);
@@ -55,7 +58,7 @@ int main(int argc, char** argv)
     opterr = 0;
     benchmarker.testKind = opencog::AtomSpaceBenchmark::BENCH_AS;
 
-    while ((c = getopt (argc, argv, "tAXgMCcm:ln:r:u:h:R:S:p:s:d:kfi:")) != -1) {
+    while ((c = getopt (argc, argv, "tAXgMCcm:ln:r:u:h:R:S:T:p:s:d:kfi:")) != -1) {
        switch (c)
        {
            case 't':
@@ -118,6 +121,9 @@ int main(int argc, char** argv)
            case 'S':
              benchmarker.sizeIncrease = atoi(optarg);
              break;
+           case 'T':
+             numThreads = atoi(optarg);
+             break;
            case 'p':
              benchmarker.percentLinks = atof(optarg);
              break;
@@ -186,6 +192,6 @@ int main(int argc, char** argv)
     }
 #endif // HAVE_GUILE
 
-    benchmarker.startBenchmark();
+    benchmarker.startBenchmark(numThreads);
     return 0;
 }
@@ -0,0 +1,434 @@
+/*
+ * opencog/benchmark/patternmatch_bm.cc
+ *
+ * Copyright (C) 2015 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <opencog/atomspace/AtomSpace.h>
+#include <opencog/atoms/pattern/PatternCache.h>
+#include <opencog/atoms/pattern/PatternLink.h>
+#include <opencog/query/DefaultPatternMatchCB.h>
+#include <opencog/query/InitiateSearchCB.h>
+#include <opencog/util/mt19937ar.h>
+
+using namespace opencog;
+using namespace std;
+
+// Every heap allocation made by the process is counted, so that the
+// number of allocations made per query can be reported.
+static std::atomic<size_t> num_allocs(0);
+static std::atomic<size_t> num_bytes(0);
+
+void* operator new(size_t sz)
+{
+    num_allocs.fetch_add(1, std::memory_order_relaxed);
+    num_bytes.fetch_add(sz, std::memory_order_relaxed);
+    void* p = malloc(sz ? sz : 1);
+    if (NULL == p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+namespace {
+
+/// Count the groundings, and nothing else; thus, what gets measured
+/// is the search itself, and not the creation of result atoms.
+class CountingCB :
+    public virtual InitiateSearchCB,
+    public virtual DefaultPatternMatchCB
+{
+public:
+    size_t count;
+    CountingCB(AtomSpace* as) :
+        InitiateSearchCB(as), DefaultPatternMatchCB(as), count(0) {}
+
+    virtual void set_pattern(const Variables& vars, const Pattern& pat)
+    {
+        InitiateSearchCB::set_pattern(vars, pat);
+        DefaultPatternMatchCB::set_pattern(vars, pat);
+    }
+
+    virtual bool grounding(const std::map<Handle, Handle>&,
+                           const std::map<Handle, Handle>&)
+    {
+        count++;
+        return false;
+    }
+};
+
+class PatternMatchBenchmark
+{
+    AtomSpace* as;
+    MT19937RandGen* rng;
+
+    HandleSeq items;
+    HandleSeq classes;
+    Handle pred;
+    Handle colors[2];
+
+    std::vector<std::string> methodNames;
+
+    Handle var(const std::string& name)
+    {
+        return as->add_node(VARIABLE_NODE, name);
+    }
+    Handle pattern(const Handle& body)
+    {
+        return as->add_link(GET_LINK, body);
+    }
+
+public:
+    unsigned int nqueries;
+    unsigned int nitems;
+    unsigned int nclasses;
+    unsigned int maxarity;
+    unsigned long randomseed;
+
+    PatternMatchBenchmark() :
+        as(NULL), rng(NULL),
+        nqueries(100), nitems(1000), nclasses(10), maxarity(8),
+        randomseed(time(NULL)) {}
+
+    ~PatternMatchBenchmark()
+    {
+        delete rng;
+        delete as;
+    }
+
+    void showMethods();
+    bool setMethod(const std::string&);
+    void buildAtomSpace();
+    void startBenchmark();
+    void doBenchmark(const std::string&, const Handle&);
+
+    Handle join(const Handle&, const Handle&);
+    Handle slots(unsigned int);
+};
+
+} // anonymous namespace
+
+void PatternMatchBenchmark::showMethods()
+{
+    cout << "Methods that can be tested:" << endl;
+    cout << "  single     one clause, one variable" << endl;
+    cout << "  join       two clauses joined by a variable" << endl;
+    cout << "  unordered  an unordered link joined to an ordered one" << endl;
+    cout << "  choice     a choice between two clauses" << endl;
+    cout << "  filter     a fan-out written before two filters" << endl;
+    cout << "  reissue    the join, with a new variable name and class each time"
+         << endl;
+    cout << "  arity      unordered links of increasing arity" << endl;
+}
+
+bool PatternMatchBenchmark::setMethod(const std::string& method)
+{
+    static const char* all[] = { "single", "join", "unordered", "choice",
+                                 "filter", "reissue", "arity" };
+    bool found = false;
+    for (const char* m : all)
+    {
+        if (method != "all" and method != m) continue;
+        methodNames.push_back(m);
+        found = true;
+    }
+    return found;
+}
+
+/// Every item has a color, is in a class, and is similar to some
+/// random other item.
+void PatternMatchBenchmark::buildAtomSpace()
+{
+    items.clear();
+    classes.clear();
+    pred = as->add_node(PREDICATE_NODE, "has color");
+    colors[0] = as->add_node(CONCEPT_NODE, "red");
+    colors[1] = as->add_node(CONCEPT_NODE, "blue");
+
+    for (unsigned int i = 0; i < nclasses; i++)
+        classes.push_back(as->add_node(CONCEPT_NODE,
+                                       "class " + std::to_string(i)));
+
+    for (unsigned int i = 0; i < nitems; i++)
+    {
+        Handle item = as->add_node(CONCEPT_NODE, "item " + std::to_string(i));
+        items.push_back(item);
+        as->add_link(EVALUATION_LINK, pred,
+            as->add_link(LIST_LINK, item, colors[rng->randint(2)]));
+        as->add_link(INHERITANCE_LINK, item,
+            classes[rng->randint(nclasses)]);
+    }
+    for (unsigned int i = 0; i < nitems; i++)
+        as->add_link(SIMILARITY_LINK, items[i],
+            items[rng->randint(nitems)]);
+}
+
+void PatternMatchBenchmark::startBenchmark()
+{
+    cout << "OpenCog Pattern Matcher Benchmark\n";
+    cout << "Random seed: " << randomseed << "\n";
+    cout << "Items: " << nitems << ", classes: " << nclasses << "\n\n";
+
+    for (const std::string& name : methodNames)
+    {
+        as = new AtomSpace();
+        delete rng;
+        rng = new MT19937RandGen(randomseed);
+        buildAtomSpace();
+
+        // One run per arity, from two up.
+        if (name == "arity")
+        {
+            for (unsigned int n = 2; n <= maxarity; n++)
+                doBenchmark(name + " " + std::to_string(n), slots(n));
+            delete as;
+            as = NULL;
+            continue;
+        }
+
+        Handle x(var("$x")), y(var("$y"));
+        Handle color(as->add_link(EVALUATION_LINK, pred,
+                       as->add_link(LIST_LINK, x, colors[0])));
+        Handle isa(as->add_link(INHERITANCE_LINK, x, classes[0]));
+
+        // The reissue method makes its own patterns, as it goes.
+        Handle pat;
+        if (name == "single")
+            pat = pattern(color);
+        else if (name == "join")
+            pat = join(x, classes[0]);
+        else if (name == "unordered")
+            pat = pattern(as->add_link(AND_LINK,
+                    as->add_link(SIMILARITY_LINK, x, y), isa));
+        else if (name == "choice")
+            pat = pattern(as->add_link(CHOICE_LINK, isa,
+                    as->add_link(INHERITANCE_LINK, x, classes[1])));
+        else if (name == "filter")
+            pat = pattern(as->add_link(AND_LINK, isa,
+                    as->add_link(SIMILARITY_LINK, x, y),
+                    as->add_link(INHERITANCE_LINK, y, classes[1]),
+                    color,
+                    as->add_link(EVALUATION_LINK, pred,
+                        as->add_link(LIST_LINK, y, colors[1]))));
+
+        doBenchmark(name, pat);
+
+        delete as;
+        as = NULL;
+    }
+}
+
+Handle PatternMatchBenchmark::join(const Handle& x, const Handle& cls)
+{
+    return pattern(as->add_link(AND_LINK,
+        as->add_link(EVALUATION_LINK, pred,
+            as->add_link(LIST_LINK, x, colors[0])),
+        as->add_link(INHERITANCE_LINK, x, cls)));
+}
+
+/// An unordered link of n members, each of which has a place of its
+/// own: (SetLink (InheritanceLink $v0 slot0) (InheritanceLink $v1 slot1)
+/// ...). Ten ground links are made for it, of which every other one has
+/// a member in the wrong slot, and so does not match.
+Handle PatternMatchBenchmark::slots(unsigned int n)
+{
+    HandleSeq vars, pat;
+    for (unsigned int i = 0; i < n; i++)
+    {
+        Handle slot(as->add_node(CONCEPT_NODE, "slot " + std::to_string(i)));
+        vars.push_back(var("$v" + std::to_string(i)));
+        pat.push_back(as->add_link(INHERITANCE_LINK, vars[i], slot));
+    }
+    Handle extra(as->add_node(CONCEPT_NODE, "slot " + std::to_string(n)));
+
+    for (unsigned int j = 0; j < 10; j++)
+    {
+        HandleSeq gnd;
+        for (unsigned int i = 0; i < n; i++)
+        {
+            Handle slot(LinkCast(pat[i])->getOutgoingAtom(1));
+            if (j % 2 and i == n-1) slot = extra;
+            gnd.push_back(as->add_link(INHERITANCE_LINK,
+                items[rng->randint(nitems)], slot));
+        }
+        as->add_link(SET_LINK, gnd);
+    }
+
+    return as->add_link(GET_LINK, as->add_link(VARIABLE_LIST, vars),
+                        as->add_link(SET_LINK, pat));
+}
+
+void PatternMatchBenchmark::doBenchmark(const std::string& name,
+                                        const Handle& hpat)
+{
+    PatternLinkPtr plp(PatternLinkCast(hpat));
+
+    // One run to warm up.
+    if (plp)
+    {
+        CountingCB cb(as);
+        plp->satisfy(cb);
+    }
+
+    cout << "Benchmarking " << name << " query " << nqueries
+         << " times" << endl;
+
+    timeval tim;
+    gettimeofday(&tim, NULL);
+    double t1 = tim.tv_sec + (tim.tv_usec/1000000.0);
+    size_t allocs = num_allocs.load();
+    size_t bytes = num_bytes.load();
+    clock_t t_begin = clock();
+
+    size_t ngnd = 0;
+    for (unsigned int i = 0; i < nqueries; i++)
+    {
+        // Rule engines issue the same query over and over, with
+        // different constants, and different variable names.
+        if (nullptr == hpat)
+            plp = PatternLinkCast(join(var("$x" + std::to_string(i % 8)),
+                                  classes[rng->randint(nclasses)]));
+        CountingCB cb(as);
+        plp->satisfy(cb);
+        ngnd += cb.count;
+
+        // ... and throw them away when done.
+        if (nullptr == hpat)
+            as->remove_atom(plp->getHandle());
+    }
+
+    clock_t time_taken = clock() - t_begin;
+    allocs = num_allocs.load() - allocs;
+    bytes = num_bytes.load() - bytes;
+    gettimeofday(&tim, NULL);
+    double t2 = tim.tv_sec + (tim.tv_usec/1000000.0);
+
+    printf("%.6lf seconds elapsed (%.2f queries per second)\n",
+           t2-t1, nqueries / (t2-t1));
+    cout << "Sum clock() time for all queries: " << time_taken << " ("
+         << (float) time_taken / CLOCKS_PER_SEC << " seconds, "
+         << nqueries / ((float) time_taken / CLOCKS_PER_SEC)
+         << " queries per second)" << endl;
+    cout << "Groundings per query: " << (float) ngnd / nqueries << endl;
+    cout << "Heap allocations per query: " << allocs / nqueries
+         << " (" << bytes / nqueries << " bytes)" << endl;
+    if (ngnd)
+        cout << "Heap allocations per grounding: "
+             << (float) allocs / ngnd << endl;
+    cout << "------------------------------" << endl;
+}
+
+int main(int argc, char** argv)
+{
+    const char* benchmark_desc = "Benchmark tool OpenCog Pattern Matcher\n"
+     "Usage: patternmatch_bm [-m <method>] [options]\n"
+     "-A        \tBenchmark all methods\n"
+     "-m <methodname>\tMethod to benchmark\n"
+     "-l        \tList valid method names to benchmark\n"
+     "-n <int>  \tHow many queries to run\n"
+     "          \t(default: 100)\n"
+     "-s <int>  \tHow many items to put in the atomspace\n"
+     "          \t(default: 1000)\n"
+     "-c <int>  \tHow many classes the items fall into\n"
+     "          \t(default: 10)\n"
+     "-a <int>  \tThe largest arity, for the arity method\n"
+     "          \t(default: 8)\n"
+     "-R <int>  \tUse specific randomseed; useful for benchmark comparisons\n"
+     "          \t(default: time(NULL))\n"
+     "-P        \tDo not cache the analysis of patterns\n";
+
+    if (argc==1) {
+        fprintf (stderr, "%s", benchmark_desc);
+        return 0;
+    }
+
+    PatternMatchBenchmark benchmarker;
+    opterr = 0;
+    int c;
+    while ((c = getopt (argc, argv, "Am:ln:s:c:a:R:P")) != -1) {
+       switch (c)
+       {
+           case 'A':
+             benchmarker.setMethod("all");
+             break;
+           case 'm':
+             if (not benchmarker.setMethod(optarg))
+             {
+                 cerr << "Error: unknown method " << optarg << endl;
+                 benchmarker.showMethods();
+                 exit(1);
+             }
+             break;
+           case 'l':
+             benchmarker.showMethods();
+             exit(0);
+             break;
+           case 'n':
+             benchmarker.nqueries = (unsigned int) atoi(optarg);
+             break;
+           case 's':
+             benchmarker.nitems = (unsigned int) atoi(optarg);
+             break;
+           case 'c':
+             benchmarker.nclasses = (unsigned int) atoi(optarg);
+             break;
+           case 'a':
+             benchmarker.maxarity = (unsigned int) atoi(optarg);
+             break;
+           case 'R':
+             benchmarker.randomseed = std::strtoul(optarg, NULL, 10);
+             break;
+           case 'P':
+             pattern_cache().set_capacity(0);
+             break;
+           case '?':
+             fprintf (stderr, "%s", benchmark_desc);
+             return 0;
+           default:
+             fprintf (stderr, "Unknown option %c ", optopt);
+             abort ();
+       }
+    }
+
+    if (0 == benchmarker.nqueries or 0 == benchmarker.nitems
+        or 2 > benchmarker.nclasses)
+    {
+        cerr << "Fatal Error: need at least one query, one item "
+                "and two classes\n";
+        exit(-1);
+    }
+
+    benchmarker.startBenchmark();
+    return 0;
+}
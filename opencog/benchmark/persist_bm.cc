@@ -0,0 +1,200 @@
+/*
+ * opencog/benchmark/persist_bm.cc
+ *
+ * Copyright (C) 2015 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <opencog/atomspace/AtomTable.h>
+#include <opencog/atomspace/Link.h>
+#include <opencog/atomspace/Node.h>
+#include <opencog/persist/sql/AtomStorage.h>
+#include <opencog/truthvalue/SimpleTruthValue.h>
+#include <opencog/util/mt19937ar.h>
+
+using namespace opencog;
+using namespace std;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double seconds_since(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void report(const char* what, size_t natoms, double secs)
+{
+    printf("%s %lu atoms: %f seconds (%.1f atoms per second)\n",
+           what, (unsigned long) natoms, secs, natoms / secs);
+}
+
+/// Nodes, links between pairs of nodes, and links between a node and
+/// one of those, so that there are atoms of height 0, 1 and 2.
+size_t fill_table(AtomTable& table, unsigned int nnodes,
+                  unsigned long seed)
+{
+    MT19937RandGen rng(seed);
+    HandleSeq nodes;
+    for (unsigned int i = 0; i < nnodes; i++)
+    {
+        NodePtr n(createNode(CONCEPT_NODE, "node " + std::to_string(i),
+            SimpleTruthValue::createTV(rng.randdouble(), rng.randint(100))));
+        nodes.push_back(table.add(n, false));
+    }
+
+    HandleSeq pairs;
+    for (unsigned int i = 0; i < nnodes; i++)
+    {
+        HandleSeq oset({nodes[rng.randint(nnodes)],
+                        nodes[rng.randint(nnodes)]});
+        LinkPtr l(createLink(LIST_LINK, oset,
+            SimpleTruthValue::createTV(rng.randdouble(), rng.randint(100))));
+        pairs.push_back(table.add(l, false));
+    }
+
+    for (unsigned int i = 0; i < nnodes; i++)
+    {
+        HandleSeq oset({nodes[rng.randint(nnodes)], pairs[i]});
+        LinkPtr l(createLink(INHERITANCE_LINK, oset,
+            SimpleTruthValue::createTV(rng.randdouble(), rng.randint(100))));
+        table.add(l, false);
+    }
+    table.barrier();
+    return table.getSize();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const char* benchmark_desc = "Benchmark tool for SQL persistence\n"
+        "Usage: persist_bm [-option]\n"
+        "\n"
+        "Stores atoms to, and loads them back from, a PostgreSQL\n"
+        "database.  The contents of the database are destroyed!\n"
+        "\n"
+        "  -d <dbname> \tDatabase name; default opencog_test\n"
+        "  -u <user> \tDatabase user; default opencog_tester\n"
+        "  -p <passwd> \tDatabase password; default cheese\n"
+        "  -n <int> \tNumber of nodes; there are twice as many links\n"
+        "  -b <int> \tAtoms per batch; 0 stores them one at a time\n"
+        "  -L <float> \tSeconds after which a batch that is not full\n"
+        "           \tis written\n"
+        "  -q \t\tStore each atom by itself with storeAtom(), instead\n"
+        "           \tof storing the whole table with store()\n"
+        "  -R <int> \tRandom seed\n";
+
+    std::string dbname = "opencog_test";
+    std::string username = "opencog_tester";
+    std::string passwd = "cheese";
+    unsigned int nnodes = 10000;
+    size_t batch_size = 1000;
+    double latency = 1.0;
+    bool queued = false;
+    unsigned long seed = 42;
+
+    int c;
+    opterr = 0;
+    while ((c = getopt (argc, argv, "d:u:p:n:b:L:qR:")) != -1) {
+       switch (c)
+       {
+           case 'd':
+             dbname = optarg;
+             break;
+           case 'u':
+             username = optarg;
+             break;
+           case 'p':
+             passwd = optarg;
+             break;
+           case 'n':
+             nnodes = (unsigned int) atoi(optarg);
+             break;
+           case 'b':
+             batch_size = (size_t) atol(optarg);
+             break;
+           case 'L':
+             latency = atof(optarg);
+             break;
+           case 'q':
+             queued = true;
+             break;
+           case 'R':
+             seed = std::strtoul(optarg, NULL, 10);
+             break;
+           case '?':
+             fprintf (stderr, "%s", benchmark_desc);
+             return 0;
+           default:
+             abort();
+       }
+    }
+
+    AtomStorage* store = new AtomStorage(dbname, username, passwd);
+    if (not store->connected())
+    {
+        fprintf(stderr, "Cannot connect to database \"%s\" as \"%s\"\n",
+                dbname.c_str(), username.c_str());
+        return 1;
+    }
+    store->kill_data();
+    store->setBulkStore(batch_size, latency);
+
+    AtomTable* table = new AtomTable();
+    size_t natoms = fill_table(*table, nnodes, seed);
+    printf("Batch size %lu, %s\n", (unsigned long) batch_size,
+           queued ? "storing each atom" : "storing the whole table");
+
+    // The first time around the atoms are all new; the second time,
+    // only their truth values are updated.
+    for (const char* what : {"Inserted", "Updated"})
+    {
+        Clock::time_point start = Clock::now();
+        if (queued)
+        {
+            table->foreachHandleByType(
+                [&](Handle h)->void { store->storeAtom(h); }, ATOM, true);
+            store->flushStoreQueue();
+        }
+        else store->store(*table);
+        report(what, natoms, seconds_since(start));
+    }
+    delete store;
+    delete table;
+
+    store = new AtomStorage(dbname, username, passwd);
+    table = new AtomTable();
+    Clock::time_point start = Clock::now();
+    store->load(*table);
+    report("Loaded", table->getSize(), seconds_since(start));
+
+    store->kill_data();
+    delete store;
+    delete table;
+    return 0;
+}
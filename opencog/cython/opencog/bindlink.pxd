@@ -1,3 +1,7 @@
+from libcpp.pair cimport pair
+from libcpp.string cimport string
+from libcpp.vector cimport vector
+
 from opencog.atomspace cimport cHandle, tv_ptr, cAtomSpace
 
 cdef extern from "opencog/cython/opencog/BindlinkStub.h" namespace "opencog":
@@ -13,13 +17,74 @@ cdef extern from "opencog/query/BindLinkAPI.h" namespace "opencog":
     #   Handle bindlink(AtomSpace*, Handle);
     #   Handle single_bindlink (AtomSpace*, Handle);
     #   Handle af_bindlink(AtomSpace*, Handle);
+    #   Handle parallel_bindlink(AtomSpace*, Handle);
     #   TruthValuePtr satisfaction_link(AtomSpace*, Handle);
     #
     cdef cHandle c_bindlink "bindlink" (cAtomSpace*, cHandle)
     cdef cHandle c_single_bindlink "single_bindlink" (cAtomSpace*, cHandle)
     cdef cHandle c_af_bindlink "af_bindlink" (cAtomSpace*, cHandle)
+    cdef cHandle c_parallel_bindlink "parallel_bindlink" (cAtomSpace*, cHandle)
     cdef tv_ptr c_satisfaction_link "satisfaction_link" (cAtomSpace*, cHandle)
 
 
+cdef extern from "opencog/query/SearchBudget.h" namespace "opencog":
+    # C++:
+    #   SearchBudget(double max_time, size_t max_candidates);
+    #   void cancel();
+    #   bool truncated();
+    #
+    cdef cppclass cSearchBudget "opencog::SearchBudget":
+        cSearchBudget(double, size_t) except +
+        void cancel() nogil
+        bint is_cancelled()
+        bint truncated()
+        size_t get_candidates()
+
+
+cdef extern from "opencog/query/BindLinkAPI.h" namespace "opencog":
+    # C++:
+    #   Handle bounded_bindlink(AtomSpace*, const Handle&, SearchBudget&);
+    #   Handle bounded_satisfying_set(AtomSpace*, const Handle&, SearchBudget&);
+    #
+    cdef cHandle c_bounded_bindlink "bounded_bindlink" \
+        (cAtomSpace*, cHandle, cSearchBudget&) nogil except +
+    cdef cHandle c_bounded_satisfying_set "bounded_satisfying_set" \
+        (cAtomSpace*, cHandle, cSearchBudget&) nogil except +
+
+
+cdef extern from "opencog/query/SearchProfile.h" namespace "opencog":
+    # C++:
+    #   SearchProfile();
+    #   std::vector<std::pair<std::string, double>> report();
+    #
+    cdef cppclass cSearchProfile "opencog::SearchProfile":
+        cSearchProfile() except +
+        double get_elapsed()
+        vector[pair[string, double]] report()
+
+
+cdef extern from "opencog/query/BindLinkAPI.h" namespace "opencog":
+    # C++:
+    #   Handle profiled_bindlink(AtomSpace*, const Handle&, SearchProfile&);
+    #   Handle profiled_satisfying_set(AtomSpace*, const Handle&, SearchProfile&);
+    #
+    cdef cHandle c_profiled_bindlink "profiled_bindlink" \
+        (cAtomSpace*, cHandle, cSearchProfile&) nogil except +
+    cdef cHandle c_profiled_satisfying_set "profiled_satisfying_set" \
+        (cAtomSpace*, cHandle, cSearchProfile&) nogil except +
+
+
+cdef extern from "opencog/query/GroundingStream.h" namespace "opencog":
+    # C++:
+    #   GroundingStream(AtomSpace*, const Handle&, size_t capacity);
+    #   Handle next();
+    #   void close();
+    #
+    cdef cppclass cGroundingStream "opencog::GroundingStream":
+        cGroundingStream(cAtomSpace*, cHandle, size_t) except +
+        cHandle next() nogil except +
+        void close() nogil
+
+
 cdef extern from "opencog/atoms/execution/EvaluationLink.h" namespace "opencog":
     tv_ptr c_evaluate_atom "opencog::EvaluationLink::do_evaluate"(cAtomSpace*, cHandle)
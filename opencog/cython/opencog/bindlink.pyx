@@ -2,6 +2,9 @@ from opencog.atomspace cimport Atom, AtomSpace, Handle, TruthValue
 from opencog.atomspace cimport cHandle, cAtomSpace, cTruthValue
 from opencog.atomspace cimport tv_ptr, strength_t, count_t
 from cython.operator cimport dereference as deref
+from libcpp.pair cimport pair
+from libcpp.string cimport string
+from libcpp.vector cimport vector
 
 
 def stub_bindlink(AtomSpace atomspace, Handle handle):
@@ -27,6 +30,137 @@ def af_bindlink(AtomSpace atomspace, Handle handle):
     cdef Handle result = Handle(c_result.value())
     return result
 
+def parallel_bindlink(AtomSpace atomspace, Handle handle):
+    cdef cHandle c_result = c_parallel_bindlink(atomspace.atomspace,
+                                                deref(handle.h))
+    cdef Handle result = Handle(c_result.value())
+    return result
+
+cdef class GroundingStream:
+    """
+    The results of bindlink() or satisfying_set(), one at a time, as
+    they are found; there is no SetLink holding them.  The search runs
+    in a thread of its own, at most `capacity` results ahead; close()
+    stops it early.
+    """
+    cdef cGroundingStream *stream
+
+    def __cinit__(self, AtomSpace atomspace, Handle handle,
+                  size_t capacity=64):
+        self.stream = new cGroundingStream(atomspace.atomspace,
+                                           deref(handle.h), capacity)
+    def __dealloc__(self):
+        if self.stream != NULL:
+            with nogil:
+                self.stream.close()
+            del self.stream
+    def __iter__(self):
+        return self
+    def __next__(self):
+        cdef cHandle c_result
+        # The search may need the GIL, to run GroundedPredicateNodes.
+        with nogil:
+            c_result = self.stream.next()
+        if c_result == c_result.UNDEFINED:
+            raise StopIteration
+        return Handle(c_result.value())
+    def close(self):
+        with nogil:
+            self.stream.close()
+
+def bindlink_stream(AtomSpace atomspace, Handle handle, size_t capacity=64):
+    return GroundingStream(atomspace, handle, capacity)
+
+cdef class SearchBudget:
+    """
+    Limits on a search: at most max_time seconds, and at most
+    max_candidates atoms to start the search at; zero means no limit.
+    cancel() may be called from another thread, to stop the search.
+    After the search, truncated tells if it was cut short, in which
+    case the results are partial.
+    """
+    cdef cSearchBudget *budget
+
+    def __cinit__(self, double max_time=0.0, size_t max_candidates=0):
+        self.budget = new cSearchBudget(max_time, max_candidates)
+    def __dealloc__(self):
+        del self.budget
+    def cancel(self):
+        with nogil:
+            self.budget.cancel()
+    property cancelled:
+        def __get__(self):
+            return self.budget.is_cancelled()
+    property truncated:
+        def __get__(self):
+            return self.budget.truncated()
+    property candidates:
+        def __get__(self):
+            return self.budget.get_candidates()
+
+def bounded_bindlink(AtomSpace atomspace, Handle handle, SearchBudget budget):
+    cdef cHandle c_result
+    # Let go of the GIL, so that other threads can cancel the search.
+    with nogil:
+        c_result = c_bounded_bindlink(atomspace.atomspace, deref(handle.h),
+                                      deref(budget.budget))
+    return Handle(c_result.value())
+
+def bounded_satisfying_set(AtomSpace atomspace, Handle handle,
+                           SearchBudget budget):
+    cdef cHandle c_result
+    with nogil:
+        c_result = c_bounded_satisfying_set(atomspace.atomspace,
+                                            deref(handle.h),
+                                            deref(budget.budget))
+    return Handle(c_result.value())
+
+cdef class SearchProfile:
+    """
+    What a search did: how many candidates, comparisons, backtracks,
+    permutations, clauses accepted and rejected, evaluations and
+    groundings, and how long it took.  report is a dict of these;
+    the times are in seconds.  A profile can be reused; each search
+    starts it afresh.
+    """
+    cdef cSearchProfile *profile
+
+    def __cinit__(self):
+        self.profile = new cSearchProfile()
+    def __dealloc__(self):
+        del self.profile
+    property report:
+        def __get__(self):
+            cdef vector[pair[string, double]] entries = self.profile.report()
+            result = {}
+            for entry in entries:
+                name = entry.first.c_str()[:entry.first.size()].decode('UTF-8')
+                if name.endswith('-time'):
+                    result[name] = entry.second
+                else:
+                    result[name] = int(entry.second)
+            return result
+    property elapsed:
+        def __get__(self):
+            return self.profile.get_elapsed()
+
+def profiled_bindlink(AtomSpace atomspace, Handle handle,
+                      SearchProfile profile):
+    cdef cHandle c_result
+    with nogil:
+        c_result = c_profiled_bindlink(atomspace.atomspace, deref(handle.h),
+                                       deref(profile.profile))
+    return Handle(c_result.value())
+
+def profiled_satisfying_set(AtomSpace atomspace, Handle handle,
+                            SearchProfile profile):
+    cdef cHandle c_result
+    with nogil:
+        c_result = c_profiled_satisfying_set(atomspace.atomspace,
+                                             deref(handle.h),
+                                             deref(profile.profile))
+    return Handle(c_result.value())
+
 def satisfaction_link(AtomSpace atomspace, Handle handle):
     cdef tv_ptr result_tv_ptr = c_satisfaction_link(atomspace.atomspace,
                                                  deref(handle.h))
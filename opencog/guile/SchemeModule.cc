@@ -70,6 +70,14 @@ FunctionWrap::FunctionWrap(HandleSeq (f)(AtomSpace*, const Handle&),
                             this, modname);
 }
 
+FunctionWrap::FunctionWrap(std::string (f)(AtomSpace*, const Handle&),
+                           const char* funcname, const char* modname)
+	: _func_s_ah(f), _name(funcname)
+{
+	define_scheme_primitive(_name, &FunctionWrap::as_wrapper_s_h,
+	                        this, modname);
+}
+
 void FunctionWrap::wrapper_v_s(const std::string& s)
 {
 	return _func_v_s(s);
@@ -116,6 +124,12 @@ HandleSeq FunctionWrap::as_wrapper_q_h(Handle h){
     return _func_q_ah(as, h);
 }
 
+std::string FunctionWrap::as_wrapper_s_h(Handle h)
+{
+	AtomSpace *as = SchemeSmob::ss_get_env_as(_name);
+	return _func_s_ah(as, h);
+}
+
 // ========================================================
 
 ModuleWrap::ModuleWrap(const char* m) :
@@ -28,6 +28,7 @@ class FunctionWrap
 		                      const Handle&, const Handle&);
 		Handle (*_func_h_ahtq)(AtomSpace*, const Handle&, Type, const HandleSeq&);
 		HandleSeq (*_func_q_ah)(AtomSpace*, const Handle&);
+		std::string (*_func_s_ah)(AtomSpace*, const Handle&);
 
 		// Wrappers are used because define_scheme_primitive expect a
 		// class function member pointer as opposed to a dangling
@@ -49,6 +50,9 @@ class FunctionWrap
 		// This wrapper return HandleSeq and abstract the atomspace away.
 		HandleSeq as_wrapper_q_h(Handle);
 
+		// This wrapper returns a string and abstracts the atomspace away.
+		std::string as_wrapper_s_h(Handle);
+
 		const char *_name;  // scheme name of the c++ function.
 	public:
 		FunctionWrap(void (*)(bool),
@@ -69,6 +73,8 @@ class FunctionWrap
 		             const char*, const char*);
 		FunctionWrap(HandleSeq (*)(AtomSpace*, const Handle&),
 		             const char*, const char*);
+		FunctionWrap(std::string (*)(AtomSpace*, const Handle&),
+		             const char*, const char*);
 };
 
 class ModuleWrap
@@ -87,11 +87,13 @@ class SchemePrimitive : public PrimitiveEnviron
 
 			// Below is the list of currently supported signatures.
 			// Extend as needed.
+			bool (T::*b_i)(int);
 			bool (T::*b_hi)(Handle, int);
 			bool (T::*b_hh)(Handle, Handle);
 			double (T::*d_hht)(Handle, Handle, Type);
 			double (T::*d_hhtb)(Handle, Handle, Type, bool);
 			Handle (T::*h_h)(Handle);
+			Handle (T::*h_i)(int);
 			Handle (T::*h_hi)(Handle, int);
 			Handle (T::*h_hh)(Handle, Handle);
 			Handle (T::*h_hhh)(Handle, Handle, Handle);
@@ -100,6 +102,8 @@ class SchemePrimitive : public PrimitiveEnviron
 			Handle (T::*h_sq)(const std::string&, const HandleSeq&);
 			Handle (T::*h_sqq)(const std::string&,
 			                   const HandleSeq&, const HandleSeq&);
+			int (T::*i_h)(Handle);
+			int (T::*i_ii)(int, int);
 			HandleSeq (T::*q_h)(Handle);
 			HandleSeq (T::*q_hti)(Handle, Type, int);
 			HandleSeq (T::*q_htib)(Handle, Type, int, bool);
@@ -112,10 +116,12 @@ class SchemePrimitive : public PrimitiveEnviron
 			                               const std::string&,
 			                               const std::string&);
 			const std::string& (T::*s_v)(void);
+			std::string (T::*s_h)(Handle);
 			TruthValuePtr (T::*p_h)(Handle);
 			UUID (T::*u_ssb)(const std::string&,const std::string&,bool);
 			void (T::*v_b)(bool);
 			void (T::*v_h)(Handle);
+			void (T::*v_i)(int);
 			void (T::*v_s)(const std::string&);
 			void (T::*v_ss)(const std::string&,
 			                const std::string&);
@@ -132,11 +138,13 @@ class SchemePrimitive : public PrimitiveEnviron
 		const char *scheme_name;
 		enum
 		{
+			B_I,   // return boolean, take int
 			B_HI,  // return boolean, take handle and int
 			B_HH,  // return boolean, take handle and handle
 			D_HHT, // return double, take handle, handle, and type
 			D_HHTB,// return double, take handle, handle, and type
 			H_H,   // return handle, take handle
+			H_I,   // return handle (or '() if none), take int
 			H_HI,  // return handle, take handle and int
 			H_HH,  // return handle, take handle and handle
 			H_HS,  // return handle, take handle and string
@@ -144,6 +152,8 @@ class SchemePrimitive : public PrimitiveEnviron
 			H_HTQ, // return handle, take handle, type, and HandleSeq
 			H_SQ,  // return handle, take string and HandleSeq
 			H_SQQ, // return handle, take string, HandleSeq and HandleSeq
+			I_H,   // return int, take handle
+			I_II,  // return int, take two ints
 			Q_H,   // return HandleSeq, take handle
 			Q_HTI, // return HandleSeq, take handle, type, and int
 			Q_HTIB,// return HandleSeq, take handle, type, and bool
@@ -153,10 +163,12 @@ class SchemePrimitive : public PrimitiveEnviron
 			S_SS,  // return string, take two strings
 			S_SSS, // return string, take three strings
 			S_V,   // return string, take void
+			S_H,   // return string, take handle
 			P_H,   // return truth value, take Handle
 			U_SSB, // return UUID, take string,string,boolean
 			V_B,   // return void, take bool
 			V_H,   // return void, take Handle
+			V_I,   // return void, take int
 			V_S,   // return void, take string
 			V_SS,  // return void, take two strings
 			V_SSS, // return void, take three strings
@@ -171,6 +183,13 @@ class SchemePrimitive : public PrimitiveEnviron
 			SCM rc = SCM_EOL;
 			switch (signature)
 			{
+				case B_I:
+				{
+					int i = SchemeSmob::verify_int(scm_car(args), scheme_name);
+					bool b = (that->*method.b_i)(i);
+					if (b) { rc = SCM_BOOL_T; } else { rc = SCM_BOOL_F; }
+					break;
+				}
 				case B_HI:
 				{
 					Handle h(SchemeSmob::verify_handle(scm_car(args), scheme_name));
@@ -220,6 +239,13 @@ class SchemePrimitive : public PrimitiveEnviron
 					rc = SchemeSmob::handle_to_scm(rh);
 					break;
 				}
+				case H_I:
+				{
+					int i = SchemeSmob::verify_int(scm_car(args), scheme_name);
+					Handle rh((that->*method.h_i)(i));
+					if (rh) rc = SchemeSmob::handle_to_scm(rh);
+					break;
+				}
 				case H_HI:
 				{
 					Handle h(SchemeSmob::verify_handle(scm_car(args), scheme_name));
@@ -300,6 +326,21 @@ class SchemePrimitive : public PrimitiveEnviron
 					rc = SchemeSmob::handle_to_scm(rh);
 					break;
 				}
+				case I_H:
+				{
+					Handle h(SchemeSmob::verify_handle(scm_car(args), scheme_name));
+					int i = (that->*method.i_h)(h);
+					rc = scm_from_int(i);
+					break;
+				}
+				case I_II:
+				{
+					int i1 = SchemeSmob::verify_int(scm_car(args), scheme_name, 1);
+					int i2 = SchemeSmob::verify_int(scm_cadr(args), scheme_name, 2);
+					int i = (that->*method.i_ii)(i1, i2);
+					rc = scm_from_int(i);
+					break;
+				}
 				case Q_H:
 				{
 					// the only argument is a handle
@@ -445,6 +486,13 @@ class SchemePrimitive : public PrimitiveEnviron
 					rc = scm_from_utf8_string(rs.c_str());
 					break;
 				}
+				case S_H:
+				{
+					Handle h(SchemeSmob::verify_handle(scm_car(args), scheme_name));
+					std::string rs((that->*method.s_h)(h));
+					rc = scm_from_utf8_string(rs.c_str());
+					break;
+				}
 				case P_H:
 				{
 					Handle h = SchemeSmob::verify_handle(scm_car(args), scheme_name);
@@ -476,6 +524,12 @@ class SchemePrimitive : public PrimitiveEnviron
 					(that->*method.v_h)(h);
 					break;
 				}
+				case V_I:
+				{
+					int i = SchemeSmob::verify_int(scm_car(args), scheme_name);
+					(that->*method.v_i)(i);
+					break;
+				}
 				case V_S:
 				{
 					// First argument is a string
@@ -633,17 +687,21 @@ class SchemePrimitive : public PrimitiveEnviron
 
 		// Declare and define the constructors for this class. They all have
 		// the same basic form, except for the types.
+		DECLARE_CONSTR_1(B_I,  b_i,  bool, int)
 		DECLARE_CONSTR_2(B_HI, b_hi, bool, Handle, int)
 		DECLARE_CONSTR_2(B_HH, b_hh, bool, Handle, Handle)
 		DECLARE_CONSTR_3(D_HHT, d_hht, double, Handle, Handle, Type)
 		DECLARE_CONSTR_4(D_HHTB, d_hhtb, double, Handle, Handle, Type, bool)
 		DECLARE_CONSTR_1(H_H,  h_h,  Handle, Handle)
+		DECLARE_CONSTR_1(H_I,  h_i,  Handle, int)
 		DECLARE_CONSTR_2(H_HI, h_hi, Handle, Handle, int)
 		DECLARE_CONSTR_2(H_HH, h_hh, Handle, Handle, Handle)
 		DECLARE_CONSTR_2(H_HS, h_hs, Handle, Handle, const std::string&)
 		DECLARE_CONSTR_3(H_HTQ, h_htq, Handle, Handle, Type, const HandleSeq&)
 		DECLARE_CONSTR_2(H_SQ, h_sq, Handle, const std::string&, const HandleSeq&)
 		DECLARE_CONSTR_3(H_SQQ, h_sqq, Handle, const std::string&, const HandleSeq&, const HandleSeq&)
+		DECLARE_CONSTR_1(I_H, i_h, int, Handle)
+		DECLARE_CONSTR_2(I_II, i_ii, int, int, int)
 		DECLARE_CONSTR_1(Q_H, q_h, HandleSeq, Handle)
 		DECLARE_CONSTR_3(Q_HTI, q_hti, HandleSeq, Handle, Type, int)
 		DECLARE_CONSTR_4(Q_HTIB, q_htib, HandleSeq, Handle, Type, int, bool)
@@ -656,10 +714,12 @@ class SchemePrimitive : public PrimitiveEnviron
 		                             const std::string&, const std::string&)
 		DECLARE_CONSTR_3(H_HHH, h_hhh, Handle, Handle, Handle, Handle)
 		DECLARE_CONSTR_0(S_V,  s_v,  const std::string&)
+		DECLARE_CONSTR_1(S_H,  s_h,  std::string, Handle)
 		DECLARE_CONSTR_1(P_H,  p_h,  TruthValuePtr, Handle)
 		DECLARE_CONSTR_3(U_SSB, u_ssb, UUID,const std::string&,const std::string&, bool)
 		DECLARE_CONSTR_1(V_B,  v_b,  void, bool)
 		DECLARE_CONSTR_1(V_H,  v_h,  void, Handle)
+		DECLARE_CONSTR_1(V_I,  v_i,  void, int)
 		DECLARE_CONSTR_1(V_S,  v_s,  void, const std::string&)
 		DECLARE_CONSTR_2(V_SS, v_ss, void, const std::string&,
 		                             const std::string&)
@@ -707,20 +767,26 @@ inline void define_scheme_primitive(const char *name, RET (T::*cb)(ARG1,ARG2,ARG
 	new SchemePrimitive<T>(module, name, cb, data); \
 }
 
+DECLARE_DECLARE_1(bool, int)
 DECLARE_DECLARE_1(Handle, Handle)
+DECLARE_DECLARE_1(Handle, int)
+DECLARE_DECLARE_1(int, Handle)
 DECLARE_DECLARE_1(HandleSeq, Handle)
 DECLARE_DECLARE_1(HandleSeqSeq, Handle)
 DECLARE_DECLARE_1(const std::string&, const std::string&)
 DECLARE_DECLARE_1(const std::string&, void)
+DECLARE_DECLARE_1(std::string, Handle)
 DECLARE_DECLARE_1(TruthValuePtr, Handle)
 DECLARE_DECLARE_1(void, bool)
 DECLARE_DECLARE_1(void, Handle)
+DECLARE_DECLARE_1(void, int)
 DECLARE_DECLARE_1(void, const std::string&)
 DECLARE_DECLARE_1(void, Type)
 DECLARE_DECLARE_1(void, void)
 DECLARE_DECLARE_2(bool, Handle, int)
 DECLARE_DECLARE_2(bool, Handle, Handle)
 DECLARE_DECLARE_2(Handle, Handle, int)
+DECLARE_DECLARE_2(int, int, int)
 DECLARE_DECLARE_2(Handle, Handle, Handle)
 DECLARE_DECLARE_2(Handle, Handle, const std::string&)
 DECLARE_DECLARE_2(Handle, const std::string&, const HandleSeq&)
@@ -0,0 +1,210 @@
+/*
+ * opencog/persist/mmap/MmapPersistSCM.cc
+ *
+ * Copyright (c) 2015 by OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <opencog/atomspace/AtomSpace.h>
+#include <opencog/atomspace/BackingStore.h>
+#include <opencog/guile/SchemePrimitive.h>
+
+#include "MmapPersistSCM.h"
+#include "MmapStorage.h"
+
+using namespace opencog;
+
+namespace opencog {
+class MmapBackingStore : public BackingStore
+{
+	private:
+		MmapStorage *_store;
+	public:
+		MmapBackingStore();
+		void set_store(MmapStorage *);
+
+		virtual NodePtr getNode(Type, const char *) const;
+		virtual LinkPtr getLink(Type, const HandleSeq&) const;
+		virtual AtomPtr getAtom(UUID) const;
+		virtual HandleSeq getIncomingSet(Handle) const;
+		virtual void storeAtom(Handle);
+		virtual void loadType(AtomTable&, Type);
+		virtual void barrier();
+};
+};
+
+MmapBackingStore::MmapBackingStore()
+{
+	_store = NULL;
+}
+
+void MmapBackingStore::set_store(MmapStorage *ms)
+{
+	_store = ms;
+}
+
+NodePtr MmapBackingStore::getNode(Type t, const char *name) const
+{
+	return _store->getNode(t, name);
+}
+
+LinkPtr MmapBackingStore::getLink(Type t, const std::vector<Handle>& oset) const
+{
+	return _store->getLink(t, oset);
+}
+
+AtomPtr MmapBackingStore::getAtom(UUID uuid) const
+{
+	return _store->getAtom(uuid);
+}
+
+HandleSeq MmapBackingStore::getIncomingSet(Handle h) const
+{
+	return _store->getIncomingSet(h);
+}
+
+void MmapBackingStore::storeAtom(Handle h)
+{
+	_store->storeAtom(h);
+}
+
+void MmapBackingStore::loadType(AtomTable& at, Type t)
+{
+	_store->loadType(at, t);
+}
+
+void MmapBackingStore::barrier()
+{
+	_store->barrier();
+}
+
+// =================================================================
+
+MmapPersistSCM::MmapPersistSCM(AtomSpace *as)
+{
+	_as = as;
+	_store = NULL;
+	_backing = new MmapBackingStore();
+
+#ifdef HAVE_GUILE
+	static bool is_init = false;
+	if (is_init) return;
+	is_init = true;
+	scm_with_guile(init_in_guile, this);
+#endif
+}
+
+void* MmapPersistSCM::init_in_guile(void* self)
+{
+#ifdef HAVE_GUILE
+	scm_c_define_module("opencog persist-mmap", init_in_module, self);
+	scm_c_use_module("opencog persist-mmap");
+#endif
+	return NULL;
+}
+
+void MmapPersistSCM::init_in_module(void* data)
+{
+	MmapPersistSCM* self = (MmapPersistSCM*) data;
+	self->init();
+}
+
+void MmapPersistSCM::init(void)
+{
+#ifdef HAVE_GUILE
+	define_scheme_primitive("mmap-open", &MmapPersistSCM::do_open, this, "persist-mmap");
+	define_scheme_primitive("mmap-close", &MmapPersistSCM::do_close, this, "persist-mmap");
+	define_scheme_primitive("mmap-load", &MmapPersistSCM::do_load, this, "persist-mmap");
+	define_scheme_primitive("mmap-store", &MmapPersistSCM::do_store, this, "persist-mmap");
+#endif
+}
+
+MmapPersistSCM::~MmapPersistSCM()
+{
+	delete _backing;
+}
+
+void MmapPersistSCM::do_open(const std::string& path)
+{
+	if (_store)
+		throw RuntimeException(TRACE_INFO,
+			"mmap-open: Error: Storage already open");
+
+	// The constructor reserves the UUID range in use.
+	_store = new MmapStorage(path);
+	_backing->set_store(_store);
+	AtomSpace *as = _as;
+#ifdef HAVE_GUILE
+	if (NULL == as)
+		as = SchemeSmob::ss_get_env_as("mmap-open");
+#endif
+	as->registerBackingStore(_backing);
+}
+
+void MmapPersistSCM::do_close(void)
+{
+	if (_store == NULL)
+		throw RuntimeException(TRACE_INFO,
+			 "mmap-close: Error: Storage not open");
+
+	AtomSpace *as = _as;
+#ifdef HAVE_GUILE
+	if (NULL == as)
+		as = SchemeSmob::ss_get_env_as("mmap-close");
+#endif
+	as->unregisterBackingStore(_backing);
+
+	_backing->set_store(NULL);
+	delete _store;
+	_store = NULL;
+}
+
+void MmapPersistSCM::do_load(void)
+{
+	if (_store == NULL)
+		throw RuntimeException(TRACE_INFO,
+			"mmap-load: Error: Storage not open");
+
+	AtomSpace *as = _as;
+#ifdef HAVE_GUILE
+	if (NULL == as)
+		as = SchemeSmob::ss_get_env_as("mmap-load");
+#endif
+	_store->load(const_cast<AtomTable&>(as->get_atomtable()));
+}
+
+
+void MmapPersistSCM::do_store(void)
+{
+	if (_store == NULL)
+		throw RuntimeException(TRACE_INFO,
+			"mmap-store: Error: Storage not open");
+
+	AtomSpace *as = _as;
+#ifdef HAVE_GUILE
+	if (NULL == as)
+		as = SchemeSmob::ss_get_env_as("mmap-store");
+#endif
+	_store->store(const_cast<AtomTable&>(as->get_atomtable()));
+	_store->barrier();
+}
+
+void opencog_persist_mmap_init(void)
+{
+	static MmapPersistSCM patty(NULL);
+}
@@ -0,0 +1,969 @@
+/*
+ * FUNCTION:
+ * Persistent Atom storage, in local memory-mapped files.
+ *
+ * HISTORY:
+ * Copyright (c) 2015 OpenCog Foundation
+ *
+ * LICENSE:
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <opencog/atomspace/ClassServer.h>
+#include <opencog/atomspace/TLB.h>
+#include <opencog/truthvalue/CountTruthValue.h>
+#include <opencog/truthvalue/IndefiniteTruthValue.h>
+#include <opencog/truthvalue/ProbabilisticTruthValue.h>
+#include <opencog/truthvalue/SimpleTruthValue.h>
+#include <opencog/util/exceptions.h>
+#include <opencog/util/Logger.h>
+
+#include "MmapStorage.h"
+
+using namespace opencog;
+
+// The number of records appended since the index was written, beyond
+// which barrier() writes it again.  It is also written on close.
+#define INDEX_TAIL 200000
+
+#define NO_RECORD ((uint64_t) -1)
+#define NO_TV ((uint64_t) -1)
+
+#define FIRST_RECORD 0x1    // The atom was first stored by this record.
+#define NODE_RECORD  0x2    // The body is a name, not an outgoing set.
+
+/* ================================================================ */
+/*
+ * File layout.  Each segment file starts with a header, telling how
+ * much of what follows was there at the last barrier(); anything after
+ * that is overwritten.  The atom segment is made durable last, so a
+ * record never points at names, outgoing sets or truth values that
+ * were lost.
+ */
+
+struct SegmentHeader
+{
+	char magic[8];
+	uint64_t used;      // Bytes of data, after the header.
+	char pad[48];
+};
+
+struct MmapStorage::AtomRecord
+{
+	uint64_t uuid;
+	uint64_t body;      // Offset of the name, or of the outgoing set.
+	uint64_t tv;        // Number of the truth value record, or NO_TV.
+	uint32_t size;      // Length of the name, or arity.
+	uint16_t type;      // Number of the type name.
+	uint16_t flags;
+};
+
+struct MmapStorage::TVRecord
+{
+	uint32_t type;
+	uint32_t pad;
+	double mean;
+	double confidence;
+	double count;
+};
+
+struct MmapStorage::IndexEntry
+{
+	uint64_t key;
+	uint64_t value;
+};
+
+// The index file: a header, then the entries by UUID (the latest
+// record of each atom), by content hash (the first record of each
+// atom), and by outgoing atom (the UUID of the link), each sorted.
+struct IndexHeader
+{
+	char magic[8];
+	uint64_t indexed;   // Number of atom records covered.
+	uint64_t n_uuid;
+	uint64_t n_content;
+	uint64_t n_target;
+	char pad[24];
+};
+
+static const char SEGMENT_MAGIC[8] = "OCMSEG1";
+static const char INDEX_MAGIC[8] = "OCMIDX1";
+
+static bool entry_less(const MmapStorage::IndexEntry& a,
+                       const MmapStorage::IndexEntry& b)
+{
+	if (a.key != b.key) return a.key < b.key;
+	return a.value < b.value;
+}
+
+/* ================================================================ */
+/**
+ * An append-only file, mapped into memory.  The mapping grows, by
+ * doubling, as the file does; it may move when it does, so the data
+ * is referred to by its offset, and pointers into it are good only
+ * until the next append.
+ */
+class MmapStorage::Segment
+{
+	private:
+		std::string _filename;
+		int _fd;
+		char* _base;
+		size_t _cap;      // Bytes mapped, header included.
+		size_t _used;     // Bytes of data, durable or not.
+		size_t _synced;   // Bytes of data already made durable.
+
+		SegmentHeader* header(void) { return (SegmentHeader*) _base; }
+		void map(size_t);
+
+	public:
+		Segment(const std::string&);
+		~Segment();
+
+		size_t size(void) const { return _used; }
+		const char* data(size_t off) const
+		{
+			return _base + sizeof(SegmentHeader) + off;
+		}
+		size_t append(const void*, size_t);
+		void sync(void);
+};
+
+#define SEGMENT_INITIAL (1024*1024)
+
+MmapStorage::Segment::Segment(const std::string& filename)
+	: _filename(filename), _fd(-1), _base(NULL), _cap(0)
+{
+	_fd = open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+	if (_fd < 0)
+		throw RuntimeException(TRACE_INFO,
+			"MmapStorage: cannot open %s: %s",
+			filename.c_str(), strerror(errno));
+
+	struct stat st;
+	fstat(_fd, &st);
+	if (0 == st.st_size)
+	{
+		if (ftruncate(_fd, SEGMENT_INITIAL))
+			throw RuntimeException(TRACE_INFO,
+				"MmapStorage: cannot grow %s: %s",
+				filename.c_str(), strerror(errno));
+		map(SEGMENT_INITIAL);
+		memcpy(header()->magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+		header()->used = 0;
+	}
+	else
+	{
+		map(st.st_size);
+		if (_cap < sizeof(SegmentHeader) or
+		    memcmp(header()->magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) or
+		    _cap < sizeof(SegmentHeader) + header()->used)
+			throw RuntimeException(TRACE_INFO,
+				"MmapStorage: %s is not a storage segment",
+				filename.c_str());
+	}
+	_used = header()->used;
+	_synced = _used;
+}
+
+MmapStorage::Segment::~Segment()
+{
+	if (_base) munmap(_base, _cap);
+	if (0 <= _fd) close(_fd);
+}
+
+void MmapStorage::Segment::map(size_t cap)
+{
+	if (_base) munmap(_base, _cap);
+	_base = (char*) mmap(NULL, cap, PROT_READ | PROT_WRITE,
+	                     MAP_SHARED, _fd, 0);
+	if (MAP_FAILED == _base)
+	{
+		_base = NULL;
+		throw RuntimeException(TRACE_INFO,
+			"MmapStorage: cannot map %s: %s",
+			_filename.c_str(), strerror(errno));
+	}
+	_cap = cap;
+}
+
+size_t MmapStorage::Segment::append(const void* buf, size_t len)
+{
+	size_t need = sizeof(SegmentHeader) + _used + len;
+	if (_cap < need)
+	{
+		size_t cap = std::max(2 * _cap, need);
+		size_t pg = sysconf(_SC_PAGESIZE);
+		cap = (cap + pg - 1) / pg * pg;
+		if (ftruncate(_fd, cap))
+			throw RuntimeException(TRACE_INFO,
+				"MmapStorage: cannot grow %s: %s",
+				_filename.c_str(), strerror(errno));
+		map(cap);
+	}
+
+	size_t off = _used;
+	memcpy(_base + sizeof(SegmentHeader) + off, buf, len);
+	_used += len;
+	return off;
+}
+
+/// Make the data durable, and then the header that says it is there.
+void MmapStorage::Segment::sync(void)
+{
+	if (_synced == _used) return;
+
+	size_t pg = sysconf(_SC_PAGESIZE);
+	size_t start = (sizeof(SegmentHeader) + _synced) / pg * pg;
+	size_t end = sizeof(SegmentHeader) + _used;
+	if (msync(_base + start, end - start, MS_SYNC))
+		throw RuntimeException(TRACE_INFO,
+			"MmapStorage: cannot sync %s: %s",
+			_filename.c_str(), strerror(errno));
+
+	header()->used = _used;
+	if (msync(_base, pg, MS_SYNC))
+		throw RuntimeException(TRACE_INFO,
+			"MmapStorage: cannot sync %s: %s",
+			_filename.c_str(), strerror(errno));
+	_synced = _used;
+}
+
+/* ================================================================ */
+
+MmapStorage::MmapStorage(const std::string& path)
+	: _path(path), _lock_fd(-1),
+	  _index_fd(-1), _index_base(NULL), _index_len(0), _indexed(0),
+	  _by_uuid(NULL), _by_content(NULL), _by_target(NULL),
+	  _n_uuid(0), _n_content(0), _n_target(0),
+	  _natoms(0), _max_uuid(0)
+{
+	if (mkdir(path.c_str(), 0755) and EEXIST != errno)
+		throw RuntimeException(TRACE_INFO,
+			"MmapStorage: cannot create %s: %s",
+			path.c_str(), strerror(errno));
+
+	// Two writers would append over one another; the lock goes away
+	// with the process that holds it, should it crash.
+	std::string lockname = path + "/lock";
+	_lock_fd = open(lockname.c_str(), O_RDWR | O_CREAT, 0644);
+	if (_lock_fd < 0)
+		throw RuntimeException(TRACE_INFO,
+			"MmapStorage: cannot open %s: %s",
+			lockname.c_str(), strerror(errno));
+	if (flock(_lock_fd, LOCK_EX | LOCK_NB))
+	{
+		int err = errno;
+		close(_lock_fd);
+		throw RuntimeException(TRACE_INFO,
+			"MmapStorage: %s is in use: %s",
+			path.c_str(), strerror(err));
+	}
+
+	// The segments that were opened are closed by their members.
+	try
+	{
+		_atoms.reset(new Segment(path + "/atoms"));
+		_names.reset(new Segment(path + "/names"));
+		_outgoing.reset(new Segment(path + "/outgoing"));
+		_tvs.reset(new Segment(path + "/truthvalues"));
+		_types.reset(new Segment(path + "/types"));
+
+		load_typemap();
+		open_index();
+
+		// Whatever was stored after the index was written.
+		uint64_t nrec = _atoms->size() / sizeof(AtomRecord);
+		for (uint64_t rec = _indexed; rec < nrec; rec++)
+			note_record(rec);
+
+		reserve();
+	}
+	catch (...)
+	{
+		close_index();
+		close(_lock_fd);
+		throw;
+	}
+}
+
+MmapStorage::~MmapStorage()
+{
+	try
+	{
+		sync();
+		if (not _tail_uuid.empty()) write_index();
+	}
+	catch (const std::exception& ex)
+	{
+		logger().error("MmapStorage: failed to close %s: %s",
+		               _path.c_str(), ex.what());
+	}
+
+	// Unmap everything before the lock is let go.
+	close_index();
+	_atoms.reset();
+	_names.reset();
+	_outgoing.reset();
+	_tvs.reset();
+	_types.reset();
+	close(_lock_fd);
+}
+
+/* ================================================================ */
+/*
+ * The type names.  Types are numbered differently in different
+ * versions of OpenCog, and may be added or removed; so they are
+ * stored by name, as in the SQL backend.
+ */
+
+void MmapStorage::load_typemap(void)
+{
+	size_t off = 0;
+	while (off < _types->size())
+	{
+		std::string name(_types->data(off));
+		off += name.size() + 1;
+
+		Type t = classserver().getType(name);
+		if (NOTYPE != t) _storing_typemap[t] = _loading_typemap.size();
+		_loading_typemap.push_back(t);
+		_typenames.push_back(name);
+	}
+}
+
+uint16_t MmapStorage::type_code(Type t)
+{
+	auto it = _storing_typemap.find(t);
+	if (_storing_typemap.end() != it) return it->second;
+
+	const std::string& name = classserver().getTypeName(t);
+	_types->append(name.c_str(), name.size() + 1);
+
+	uint16_t code = _loading_typemap.size();
+	_storing_typemap[t] = code;
+	_loading_typemap.push_back(t);
+	_typenames.push_back(name);
+	return code;
+}
+
+/* ================================================================ */
+/* The index */
+
+void MmapStorage::open_index(void)
+{
+	std::string filename = _path + "/index";
+	_index_fd = open(filename.c_str(), O_RDONLY);
+	if (_index_fd < 0) return;
+
+	struct stat st;
+	fstat(_index_fd, &st);
+	_index_len = st.st_size;
+	if (_index_len < sizeof(IndexHeader))
+	{
+		close_index();
+		return;
+	}
+
+	_index_base = (const char*) mmap(NULL, _index_len, PROT_READ,
+	                                 MAP_SHARED, _index_fd, 0);
+	if (MAP_FAILED == _index_base)
+	{
+		_index_base = NULL;
+		close_index();
+		return;
+	}
+
+	// An index that does not fit the atoms is ignored, and the atoms
+	// are read instead; it is written anew on close.
+	const IndexHeader* hdr = (const IndexHeader*) _index_base;
+	uint64_t nrec = _atoms->size() / sizeof(AtomRecord);
+	if (memcmp(hdr->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) or
+	    nrec < hdr->indexed or
+	    _index_len != sizeof(IndexHeader) + sizeof(IndexEntry) *
+	                  (hdr->n_uuid + hdr->n_content + hdr->n_target))
+	{
+		logger().warn("MmapStorage: ignoring bad index in %s",
+		              _path.c_str());
+		close_index();
+		return;
+	}
+
+	_indexed = hdr->indexed;
+	_n_uuid = hdr->n_uuid;
+	_n_content = hdr->n_content;
+	_n_target = hdr->n_target;
+	_by_uuid = (const IndexEntry*) (_index_base + sizeof(IndexHeader));
+	_by_content = _by_uuid + _n_uuid;
+	_by_target = _by_content + _n_content;
+
+	_natoms = _n_uuid;
+	if (0 < _n_uuid) _max_uuid = _by_uuid[_n_uuid-1].key;
+}
+
+void MmapStorage::close_index(void)
+{
+	if (_index_base) munmap((void*) _index_base, _index_len);
+	if (0 <= _index_fd) close(_index_fd);
+	_index_fd = -1;
+	_index_base = NULL;
+	_index_len = 0;
+	_indexed = 0;
+	_by_uuid = _by_content = _by_target = NULL;
+	_n_uuid = _n_content = _n_target = 0;
+}
+
+/// Merge what was appended since into the index, and write it out.
+/// The segments must be durable first.
+void MmapStorage::write_index(void)
+{
+	std::vector<IndexEntry> by_uuid(_by_uuid, _by_uuid + _n_uuid);
+	for (const auto& pr : _tail_uuid)
+		by_uuid.push_back({pr.first, pr.second});
+
+	// The latest record of each atom is the one with the highest
+	// number.
+	std::sort(by_uuid.begin(), by_uuid.end(), entry_less);
+	std::vector<IndexEntry> latest;
+	latest.reserve(by_uuid.size());
+	for (const IndexEntry& e : by_uuid)
+	{
+		if (not latest.empty() and latest.back().key == e.key)
+			latest.back() = e;
+		else
+			latest.push_back(e);
+	}
+	by_uuid.clear();
+	by_uuid.shrink_to_fit();
+
+	std::vector<IndexEntry> by_content(_by_content, _by_content + _n_content);
+	for (const auto& pr : _tail_content)
+		by_content.push_back({pr.first, pr.second});
+	std::sort(by_content.begin(), by_content.end(), entry_less);
+
+	std::vector<IndexEntry> by_target(_by_target, _by_target + _n_target);
+	for (const auto& pr : _tail_target)
+		by_target.push_back({pr.first, pr.second});
+	std::sort(by_target.begin(), by_target.end(), entry_less);
+
+	IndexHeader hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+	hdr.indexed = _atoms->size() / sizeof(AtomRecord);
+	hdr.n_uuid = latest.size();
+	hdr.n_content = by_content.size();
+	hdr.n_target = by_target.size();
+
+	// Write it aside, and then move it into place, so that there is
+	// always one good index, or none.
+	std::string filename = _path + "/index";
+	std::string tmpname = filename + ".tmp";
+	FILE* fh = fopen(tmpname.c_str(), "w");
+	if (NULL == fh)
+		throw RuntimeException(TRACE_INFO,
+			"MmapStorage: cannot write %s: %s",
+			tmpname.c_str(), strerror(errno));
+
+	bool ok = 1 == fwrite(&hdr, sizeof(hdr), 1, fh);
+	for (const std::vector<IndexEntry>* v : {&latest, &by_content, &by_target})
+		if (not v->empty())
+			ok = ok and v->size() ==
+				fwrite(v->data(), sizeof(IndexEntry), v->size(), fh);
+	ok = ok and 0 == fflush(fh) and 0 == fsync(fileno(fh));
+	ok = (0 == fclose(fh)) and ok;
+	if (not ok or rename(tmpname.c_str(), filename.c_str()))
+	{
+		unlink(tmpname.c_str());
+		throw RuntimeException(TRACE_INFO,
+			"MmapStorage: cannot write %s: %s",
+			filename.c_str(), strerror(errno));
+	}
+
+	close_index();
+	_tail_uuid.clear();
+	_tail_content.clear();
+	_tail_target.clear();
+	open_index();
+}
+
+/// Add an atom record, past the end of the index, to the hash tables.
+void MmapStorage::note_record(uint64_t rec)
+{
+	const AtomRecord& r = record(rec);
+	_tail_uuid[r.uuid] = rec;
+	if (_max_uuid < r.uuid) _max_uuid = r.uuid;
+	if (not (r.flags & FIRST_RECORD)) return;
+
+	_natoms++;
+	if (r.flags & NODE_RECORD)
+	{
+		_tail_content.insert({content_hash(r.type, true,
+			_names->data(r.body), r.size), rec});
+		return;
+	}
+
+	const UUID* out = (const UUID*) _outgoing->data(r.body);
+	_tail_content.insert({content_hash(r.type, false,
+		out, r.size * sizeof(UUID)), rec});
+	for (uint32_t i = 0; i < r.size; i++)
+		_tail_target.insert({out[i], r.uuid});
+}
+
+/* ================================================================ */
+/* Lookups */
+
+const MmapStorage::AtomRecord& MmapStorage::record(uint64_t rec) const
+{
+	return ((const AtomRecord*) _atoms->data(0))[rec];
+}
+
+/// The latest record of the atom, or NO_RECORD.
+uint64_t MmapStorage::find_uuid(UUID uuid) const
+{
+	auto it = _tail_uuid.find(uuid);
+	if (_tail_uuid.end() != it) return it->second;
+
+	IndexEntry key = {uuid, 0};
+	const IndexEntry* end = _by_uuid + _n_uuid;
+	const IndexEntry* e = std::lower_bound(_by_uuid, end, key, entry_less);
+	if (end != e and e->key == uuid) return e->value;
+	return NO_RECORD;
+}
+
+/// FNV-1a, over the type, the kind of atom, and the name or the
+/// outgoing UUID's.  It is kept in the index, so it must not change.
+uint64_t MmapStorage::content_hash(uint16_t type, bool node,
+                                   const void* buf, size_t len) const
+{
+	uint64_t h = 14695981039346656037ULL;
+	auto mix = [&h](uint8_t c) { h ^= c; h *= 1099511628211ULL; };
+
+	mix(type & 0xff);
+	mix(type >> 8);
+	mix(node ? 'n' : 'l');
+
+	const uint8_t* p = (const uint8_t*) buf;
+	for (size_t i = 0; i < len; i++) mix(p[i]);
+	return h;
+}
+
+/// The first records of the atoms whose content has this hash.
+std::vector<uint64_t> MmapStorage::find_content(uint64_t hash) const
+{
+	std::vector<uint64_t> recs;
+	auto range = _tail_content.equal_range(hash);
+	for (auto it = range.first; it != range.second; it++)
+		recs.push_back(it->second);
+
+	IndexEntry key = {hash, 0};
+	const IndexEntry* end = _by_content + _n_content;
+	for (const IndexEntry* e = std::lower_bound(_by_content, end, key, entry_less);
+	     end != e and e->key == hash; e++)
+		recs.push_back(e->value);
+	return recs;
+}
+
+TruthValuePtr MmapStorage::get_tv(uint64_t tvrec) const
+{
+	if (NO_TV == tvrec) return NULL;
+
+	const TVRecord& r = ((const TVRecord*) _tvs->data(0))[tvrec];
+	switch (r.type)
+	{
+		case SIMPLE_TRUTH_VALUE:
+			return SimpleTruthValue::createTV(r.mean, r.count);
+		case COUNT_TRUTH_VALUE:
+			return CountTruthValue::createTV(r.mean, r.confidence, r.count);
+		case INDEFINITE_TRUTH_VALUE:
+			return IndefiniteTruthValue::createTV(r.mean, r.count, r.confidence);
+		case PROBABILISTIC_TRUTH_VALUE:
+			return ProbabilisticTruthValue::createTV(r.mean, r.confidence, r.count);
+		default:
+			throw RuntimeException(TRACE_INFO,
+				"MmapStorage: Unknown truth value type %u", r.type);
+	}
+}
+
+/// The truth value as a record, the same as the SQL backend stores it.
+/// Returns false if there is none to store.
+static bool tv_record(const TruthValuePtr& tv, MmapStorage::TVRecord& r)
+{
+	memset(&r, 0, sizeof(r));
+	r.type = NULL_TRUTH_VALUE;
+	if (tv) r.type = tv->getType();
+
+	switch (r.type)
+	{
+		case NULL_TRUTH_VALUE:
+			return false;
+		case SIMPLE_TRUTH_VALUE:
+		case COUNT_TRUTH_VALUE:
+		case PROBABILISTIC_TRUTH_VALUE:
+			r.mean = tv->getMean();
+			r.confidence = tv->getConfidence();
+			r.count = tv->getCount();
+			return true;
+		case INDEFINITE_TRUTH_VALUE:
+		{
+			IndefiniteTruthValuePtr itv = std::static_pointer_cast<IndefiniteTruthValue>(tv);
+			r.mean = itv->getL();
+			r.count = itv->getU();
+			r.confidence = itv->getConfidenceLevel();
+			return true;
+		}
+		default:
+			throw RuntimeException(TRACE_INFO,
+				"Error: store: Unknown truth value type\n");
+	}
+}
+
+bool MmapStorage::same_tv(uint64_t tvrec, const TruthValuePtr& tv) const
+{
+	TVRecord r;
+	if (not tv_record(tv, r)) return NO_TV == tvrec;
+	if (NO_TV == tvrec) return false;
+
+	const TVRecord& old = ((const TVRecord*) _tvs->data(0))[tvrec];
+	return old.type == r.type and old.mean == r.mean and
+	       old.confidence == r.confidence and old.count == r.count;
+}
+
+/// Build the atom from its latest record.  The outgoing set is taken
+/// from the table, if given, and made from storage otherwise.
+AtomPtr MmapStorage::make_atom(AtomTable* table, uint64_t rec) const
+{
+	// A copy; the records are not moved by this, but it is cheap.
+	AtomRecord r = record(rec);
+
+	if (_loading_typemap.size() <= r.type or
+	    NOTYPE == _loading_typemap[r.type])
+		throw RuntimeException(TRACE_INFO,
+			"MmapStorage: OpenCog does not have a type called %s",
+			r.type < _typenames.size() ? _typenames[r.type].c_str() : "?");
+	Type t = _loading_typemap[r.type];
+
+	TruthValuePtr tv(get_tv(r.tv));
+
+	if (r.flags & NODE_RECORD)
+	{
+		NodePtr n(createNode(t, std::string(_names->data(r.body), r.size), tv));
+		n->_uuid = r.uuid;
+		return n;
+	}
+
+	const UUID* out = (const UUID*) _outgoing->data(r.body);
+	HandleSeq oset;
+	oset.reserve(r.size);
+	for (uint32_t i = 0; i < r.size; i++)
+	{
+		Handle h;
+		if (table) h = table->getHandle(out[i]);
+		if (NULL == h)
+		{
+			uint64_t orec = find_uuid(out[i]);
+			if (NO_RECORD == orec)
+				throw RuntimeException(TRACE_INFO,
+					"MmapStorage: atom %lu has a missing outgoing atom %lu",
+					r.uuid, out[i]);
+			h = make_atom(table, orec)->getHandle();
+		}
+		oset.emplace_back(h);
+	}
+
+	LinkPtr l(createLink(t, oset, tv));
+	l->_uuid = r.uuid;
+	return l;
+}
+
+AtomPtr MmapStorage::getAtom(UUID uuid)
+{
+	std::lock_guard<std::mutex> lck(_mtx);
+	uint64_t rec = find_uuid(uuid);
+	if (NO_RECORD == rec) return NULL;
+	return make_atom(NULL, rec);
+}
+
+NodePtr MmapStorage::getNode(Type t, const char * name)
+{
+	std::lock_guard<std::mutex> lck(_mtx);
+	auto it = _storing_typemap.find(t);
+	if (_storing_typemap.end() == it) return NULL;
+	uint16_t code = it->second;
+
+	size_t len = strlen(name);
+	for (uint64_t rec : find_content(content_hash(code, true, name, len)))
+	{
+		const AtomRecord& r = record(rec);
+		if (r.type != code or not (r.flags & NODE_RECORD) or
+		    r.size != len or memcmp(_names->data(r.body), name, len))
+			continue;
+
+		TruthValuePtr tv(get_tv(record(find_uuid(r.uuid)).tv));
+		NodePtr n(createNode(t, name, tv));
+		n->_uuid = r.uuid;
+		return n;
+	}
+	return NULL;
+}
+
+LinkPtr MmapStorage::getLink(Type t, const HandleSeq& oset)
+{
+	std::lock_guard<std::mutex> lck(_mtx);
+	auto it = _storing_typemap.find(t);
+	if (_storing_typemap.end() == it) return NULL;
+	uint16_t code = it->second;
+
+	std::vector<UUID> out;
+	out.reserve(oset.size());
+	for (const Handle& h : oset)
+	{
+		// An atom that was never stored has no UUID here, and then
+		// neither can the link.
+		if (TLB::isInvalidHandle(h)) return NULL;
+		out.push_back(h.value());
+	}
+
+	size_t len = out.size() * sizeof(UUID);
+	for (uint64_t rec : find_content(content_hash(code, false, out.data(), len)))
+	{
+		const AtomRecord& r = record(rec);
+		if (r.type != code or (r.flags & NODE_RECORD) or
+		    r.size != out.size() or
+		    (0 < len and memcmp(_outgoing->data(r.body), out.data(), len)))
+			continue;
+
+		TruthValuePtr tv(get_tv(record(find_uuid(r.uuid)).tv));
+		LinkPtr l(createLink(t, oset, tv));
+		l->_uuid = r.uuid;
+		return l;
+	}
+	return NULL;
+}
+
+HandleSeq MmapStorage::getIncomingSet(const Handle& h)
+{
+	std::lock_guard<std::mutex> lck(_mtx);
+	UUID uuid = h.value();
+
+	std::vector<UUID> sources;
+	auto range = _tail_target.equal_range(uuid);
+	for (auto it = range.first; it != range.second; it++)
+		sources.push_back(it->second);
+
+	IndexEntry key = {uuid, 0};
+	const IndexEntry* end = _by_target + _n_target;
+	for (const IndexEntry* e = std::lower_bound(_by_target, end, key, entry_less);
+	     end != e and e->key == uuid; e++)
+		sources.push_back(e->value);
+
+	// A link holding the same atom twice is listed twice.
+	std::sort(sources.begin(), sources.end());
+	sources.erase(std::unique(sources.begin(), sources.end()), sources.end());
+
+	HandleSeq iset;
+	iset.reserve(sources.size());
+	for (UUID src : sources)
+		iset.emplace_back(make_atom(NULL, find_uuid(src))->getHandle());
+	return iset;
+}
+
+/* ================================================================ */
+/* Storing */
+
+/// The number of the truth value record, or NO_TV.
+uint64_t MmapStorage::append_tv(const TruthValuePtr& tv)
+{
+	TVRecord r;
+	if (not tv_record(tv, r)) return NO_TV;
+	return _tvs->append(&r, sizeof(r)) / sizeof(TVRecord);
+}
+
+/// Store the atom, after its outgoing set.  If recursive, the outgoing
+/// set is stored too; otherwise only the atoms in it that are not
+/// stored yet.
+void MmapStorage::do_store_atom(const AtomPtr& atom, bool recursive)
+{
+	if (TLB::isInvalidHandle(atom->getHandle()))
+		throw RuntimeException(TRACE_INFO,
+			"Trying to save atom with an invalid handle!");
+
+	LinkPtr l(LinkCast(atom));
+	if (l)
+	{
+		for (const Handle& h : l->getOutgoingSet())
+			if (recursive or NO_RECORD == find_uuid(h.value()))
+				do_store_atom(h, recursive);
+	}
+
+	UUID uuid = atom->getUUID();
+	TruthValuePtr tv(atom->getTruthValue());
+	uint64_t old = find_uuid(uuid);
+
+	AtomRecord r;
+	if (NO_RECORD != old)
+	{
+		// Once stored, an atom cannot change; only its truth value can.
+		if (same_tv(record(old).tv, tv)) return;
+		r = record(old);
+		r.flags &= ~FIRST_RECORD;
+	}
+	else
+	{
+		memset(&r, 0, sizeof(r));
+		r.uuid = uuid;
+		r.type = type_code(atom->getType());
+		r.flags = FIRST_RECORD;
+
+		NodePtr n(NodeCast(atom));
+		if (n)
+		{
+			const std::string& name = n->getName();
+			r.body = _names->append(name.data(), name.size());
+			r.size = name.size();
+			r.flags |= NODE_RECORD;
+		}
+		else
+		{
+			std::vector<UUID> out;
+			out.reserve(l->getArity());
+			for (const Handle& h : l->getOutgoingSet())
+				out.push_back(h.value());
+			r.body = _outgoing->append(out.data(), out.size() * sizeof(UUID));
+			r.size = out.size();
+		}
+	}
+	r.tv = append_tv(tv);
+
+	uint64_t rec = _atoms->append(&r, sizeof(r)) / sizeof(AtomRecord);
+	note_record(rec);
+}
+
+void MmapStorage::storeAtom(const Handle& h)
+{
+	std::lock_guard<std::mutex> lck(_mtx);
+	do_store_atom(h, true);
+}
+
+void MmapStorage::store(const AtomTable& table)
+{
+	std::lock_guard<std::mutex> lck(_mtx);
+	size_t before = _natoms;
+
+	HandleSeq all;
+	table.getHandlesByType(back_inserter(all), ATOM, true);
+	for (const Handle& h : all)
+		do_store_atom(h, false);
+
+	logger().info("MmapStorage: stored %lu atoms, %lu of them new",
+	              all.size(), _natoms - before);
+}
+
+/// The atoms segment goes last: a record is never durable before what
+/// it points at.
+void MmapStorage::sync(void)
+{
+	_names->sync();
+	_outgoing->sync();
+	_tvs->sync();
+	_types->sync();
+	_atoms->sync();
+}
+
+void MmapStorage::barrier(void)
+{
+	std::lock_guard<std::mutex> lck(_mtx);
+	sync();
+
+	// Keep the hash tables, and the work of opening, small.
+	if (std::max<uint64_t>(INDEX_TAIL, _indexed / 8) < _tail_uuid.size())
+		write_index();
+}
+
+/* ================================================================ */
+/* Loading */
+
+void MmapStorage::reserve(void)
+{
+	TLB::reserve_upto(_max_uuid);
+}
+
+size_t MmapStorage::size(void)
+{
+	std::lock_guard<std::mutex> lck(_mtx);
+	return _natoms;
+}
+
+/// The records are in the order the atoms were first stored, each
+/// after its outgoing set; so the outgoing set of each link is already
+/// in the table, when it comes to be added.
+void MmapStorage::load(AtomTable& table)
+{
+	std::lock_guard<std::mutex> lck(_mtx);
+	reserve();
+
+	size_t count = 0;
+	uint64_t nrec = _atoms->size() / sizeof(AtomRecord);
+	for (uint64_t rec = 0; rec < nrec; rec++)
+	{
+		const AtomRecord& r = record(rec);
+		if (not (r.flags & FIRST_RECORD)) continue;
+
+		table.add(make_atom(&table, find_uuid(r.uuid)), true);
+		count++;
+	}
+	table.barrier();
+
+	logger().info("MmapStorage: loaded %lu atoms from %s",
+	              count, _path.c_str());
+}
+
+void MmapStorage::loadType(AtomTable& table, Type t)
+{
+	std::lock_guard<std::mutex> lck(_mtx);
+	auto it = _storing_typemap.find(t);
+	if (_storing_typemap.end() == it) return;
+	uint16_t code = it->second;
+	reserve();
+
+	size_t count = 0;
+	uint64_t nrec = _atoms->size() / sizeof(AtomRecord);
+	for (uint64_t rec = 0; rec < nrec; rec++)
+	{
+		const AtomRecord& r = record(rec);
+		if (r.type != code or not (r.flags & FIRST_RECORD)) continue;
+		if (table.getHandle(r.uuid)) continue;
+
+		table.add(make_atom(&table, find_uuid(r.uuid)), true);
+		count++;
+	}
+	table.barrier();
+
+	logger().debug("MmapStorage: loaded %lu atoms of type %s",
+	               count, classserver().getTypeName(t).c_str());
+}
+
+/* ============================= END OF FILE ================= */
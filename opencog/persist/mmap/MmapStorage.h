@@ -0,0 +1,171 @@
+/*
+ * FUNCTION:
+ * Persistent Atom storage, in local memory-mapped files.
+ *
+ * HISTORY:
+ * Copyright (c) 2015 OpenCog Foundation
+ *
+ * LICENSE:
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _OPENCOG_PERSISTENT_MMAP_STORAGE_H
+#define _OPENCOG_PERSISTENT_MMAP_STORAGE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <opencog/atomspace/Atom.h>
+#include <opencog/atomspace/AtomTable.h>
+#include <opencog/atomspace/Link.h>
+#include <opencog/atomspace/Node.h>
+#include <opencog/atomspace/types.h>
+
+namespace opencog
+{
+/** \addtogroup grp_persist
+ *  @{
+ */
+
+/**
+ * Atoms are saved to, and restored from, a directory of memory-mapped
+ * files, with no server process.  As in the SQL backend, atoms are
+ * identified by their UUID's, which must be kept consistent with the
+ * TLB; opening the storage reserves the UUID's found in it.
+ *
+ * The files are append-only segments: one of fixed-size atom records,
+ * and one each for the node names, the outgoing sets, the truth values
+ * and the type names.  Storing an atom that is already stored appends
+ * only a new truth value, and a record pointing at it; the latest
+ * record of an atom is the one that counts.  The atom records are in
+ * the order in which they were first stored, and an atom is always
+ * stored after its outgoing set, so the whole can be loaded in one
+ * pass, in the order of the file.
+ *
+ * Lookups by UUID, by name or outgoing set, and of incoming sets, go
+ * through an index: sorted arrays in a file of their own, written when
+ * the storage is closed, and searched in place, plus hash tables for
+ * the records appended since.  Those are found again by reading the
+ * records past the end of the index, when the storage is opened.
+ *
+ * Writes are done in the calling thread, and are made durable by
+ * barrier().  Whatever was appended after the last barrier may be lost
+ * in a crash, but what was there before will not be damaged.  The
+ * files are in the byte order of the machine that wrote them.  Only
+ * one MmapStorage, in any process, can have the directory open at a
+ * time; opening it again throws.
+ */
+class MmapStorage
+{
+	public:
+		// The records in the files; see MmapStorage.cc
+		struct AtomRecord;
+		struct TVRecord;
+		struct IndexEntry;
+
+	private:
+		class Segment;
+
+		std::string _path;
+		std::mutex _mtx;
+
+		// Held open, and locked, for as long as the storage is open.
+		int _lock_fd;
+
+		std::unique_ptr<Segment> _atoms;
+		std::unique_ptr<Segment> _names;
+		std::unique_ptr<Segment> _outgoing;
+		std::unique_ptr<Segment> _tvs;
+		std::unique_ptr<Segment> _types;
+
+		// The type names are stored once each; a type is stored as
+		// the number of its name, in the order of the types segment.
+		std::vector<Type> _loading_typemap;
+		std::vector<std::string> _typenames;
+		std::unordered_map<Type, uint16_t> _storing_typemap;
+		void load_typemap(void);
+		uint16_t type_code(Type);
+
+		// The index file, mapped read-only, and what was appended
+		// since it was written.
+		int _index_fd;
+		const char* _index_base;
+		size_t _index_len;
+		uint64_t _indexed;        // Number of atom records it covers.
+		const IndexEntry* _by_uuid;
+		const IndexEntry* _by_content;
+		const IndexEntry* _by_target;
+		uint64_t _n_uuid, _n_content, _n_target;
+
+		std::unordered_map<UUID, uint64_t> _tail_uuid;
+		std::unordered_multimap<uint64_t, uint64_t> _tail_content;
+		std::unordered_multimap<UUID, UUID> _tail_target;
+		uint64_t _natoms;
+		UUID _max_uuid;
+
+		void open_index(void);
+		void close_index(void);
+		void write_index(void);
+		void note_record(uint64_t);
+
+		const AtomRecord& record(uint64_t) const;
+		uint64_t find_uuid(UUID) const;
+		uint64_t content_hash(uint16_t, bool, const void*, size_t) const;
+		std::vector<uint64_t> find_content(uint64_t) const;
+		TruthValuePtr get_tv(uint64_t) const;
+
+		uint64_t append_tv(const TruthValuePtr&);
+		bool same_tv(uint64_t, const TruthValuePtr&) const;
+		void do_store_atom(const AtomPtr&, bool);
+		void sync(void);
+
+		AtomPtr make_atom(AtomTable*, uint64_t) const;
+
+	public:
+		/// Open the storage in the directory, creating it if need be.
+		MmapStorage(const std::string& path);
+		MmapStorage(const MmapStorage&) = delete;
+		MmapStorage& operator=(const MmapStorage&) = delete;
+		~MmapStorage();
+
+		// Store atoms; barrier() makes them durable.
+		void storeAtom(const Handle&);
+		void store(const AtomTable&);
+		void barrier(void);
+
+		// Fetch atoms
+		AtomPtr getAtom(UUID);
+		NodePtr getNode(Type, const char *);
+		LinkPtr getLink(Type, const HandleSeq&);
+		HandleSeq getIncomingSet(const Handle&);
+
+		// Large-scale loads
+		void loadType(AtomTable&, Type); // Load *all* atoms of type
+		void load(AtomTable&);  // Load entire contents of storage
+		void reserve(void);     // reserve range of UUID's
+
+		/// The number of atoms in storage.
+		size_t size(void);
+};
+
+/** @}*/
+} // namespace opencog
+
+#endif // _OPENCOG_PERSISTENT_MMAP_STORAGE_H
@@ -28,11 +28,16 @@
  */
 #ifdef HAVE_SQL_STORAGE
 
+#include <stdarg.h>
 #include <stdlib.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <chrono>
+#include <condition_variable>
+#include <exception>
 #include <memory>
+#include <mutex>
 #include <thread>
 
 #include <opencog/util/oc_assert.h>
@@ -54,6 +59,11 @@ using namespace opencog;
 
 #define USE_INLINE_EDGES
 
+// The columns that the atom fetches ask for, in the order that
+// Response::get_atom_columns() expects them.
+#define ATOM_COLUMNS "uuid, type, tv_type, stv_mean, stv_confidence, " \
+                     "stv_count, name, outgoing"
+
 /* ================================================================ */
 
 /**
@@ -88,61 +98,40 @@ class AtomStorage::Response
 			intval = 0;
 		}
 
-		bool create_atom_column_cb(const char *colname, const char * colvalue)
+		// The columns of ATOM_COLUMNS, as fetched by the prepared
+		// statements; these come back as numbers, not text, except
+		// for the name and the outgoing set.
+		void get_atom_columns(void)
 		{
-			// printf ("%s = %s\n", colname, colvalue);
-			if (!strcmp(colname, "type"))
-			{
-				itype = atoi(colvalue);
-			}
-			else if (!strcmp(colname, "name"))
-			{
-				name = colvalue;
-			}
-			else if (!strcmp(colname, "outgoing"))
-			{
-				outlist = colvalue;
-			}
-			if (!strcmp(colname, "tv_type"))
-			{
-				tv_type = atoi(colvalue);
-			}
-			else if (!strcmp(colname, "stv_mean"))
-			{
-				mean = atof(colvalue);
-			}
-			else if (!strcmp(colname, "stv_confidence"))
-			{
-				confidence = atof(colvalue);
-			}
-			else if (!strcmp(colname, "stv_count"))
-			{
-				count = atof(colvalue);
-			}
-			else if (!strcmp(colname, "uuid"))
-			{
-				uuid = strtoul(colvalue, NULL, 10);
-			}
-			return false;
+			uuid = rs->get_int(0);
+			itype = rs->get_int(1);
+			tv_type = rs->get_int(2);
+			mean = rs->get_double(3);
+			confidence = rs->get_double(4);
+			count = rs->get_double(5);
+			name = rs->get_string(6);
+			outlist = rs->get_string(7);
 		}
 		bool create_atom_cb(void)
 		{
 			// printf ("---- New atom found ----\n");
-			rs->foreach_column(&Response::create_atom_column_cb, this);
+			get_atom_columns();
 
 			return false;
 		}
 
 		AtomTable *table;
 		AtomStorage *store;
+
+		// The bulk loads only decode the atoms here; they are added
+		// to the table later, in order. See the Loader below.
+		std::vector<PseudoPtr> *pvec;
 		bool load_all_atoms_cb(void)
 		{
 			// printf ("---- New atom found ----\n");
-			rs->foreach_column(&Response::create_atom_column_cb, this);
+			get_atom_columns();
 
-			PseudoPtr p(store->makeAtom(*this, uuid));
-			AtomPtr atom(get_recursive_if_not_exists(p));
-			table->add(atom, true);
+			pvec->emplace_back(store->makeAtom(*this, uuid));
 			return false;
 		}
 
@@ -154,15 +143,11 @@ class AtomStorage::Response
 		bool load_if_not_exists_cb(void)
 		{
 			// printf ("---- New atom found ----\n");
-			rs->foreach_column(&Response::create_atom_column_cb, this);
+			get_atom_columns();
 
 			Handle h(uuid);
 			if (nullptr == table->getHandle(h))
-			{
-				PseudoPtr p(store->makeAtom(*this, uuid));
-				AtomPtr atom(get_recursive_if_not_exists(p));
-				table->add(atom, true);
-			}
+				pvec->emplace_back(store->makeAtom(*this, uuid));
 			return false;
 		}
 
@@ -170,7 +155,7 @@ class AtomStorage::Response
 		bool fetch_incoming_set_cb(void)
 		{
 			// printf ("---- New atom found ----\n");
-			rs->foreach_column(&Response::create_atom_column_cb, this);
+			get_atom_columns();
 
 			// Note, unlike the above 'load' routines, this merely fetches
 			// the atoms, and returns a vector of them.  They are loaded
@@ -362,6 +347,12 @@ bool AtomStorage::idExists(const char * buff)
 /* ================================================================ */
 #define BUFSZ 250
 
+// Number of uuids fetched by one query, when loading in bulk; and the
+// number of threads fetching them. Each thread takes one connection
+// from the pool at a time.
+#define LOAD_STEP 12003
+#define NUM_LOAD_THREADS 4
+
 #ifndef USE_INLINE_EDGES
 /**
  * Callback class, whose method is invoked on each outgoing edge.
@@ -430,6 +421,10 @@ void AtomStorage::init(const char * dbname,
 	type_map_was_loaded = false;
 	max_height = 0;
 
+	bulk_size = 0;
+	bulk_latency = std::chrono::milliseconds(1000);
+	bulk_stop = false;
+
 	for (int i=0; i< TYPEMAP_SZ; i++)
 	{
 		db_typename[i] = NULL;
@@ -460,6 +455,18 @@ AtomStorage::AtomStorage(const std::string& dbname,
 
 AtomStorage::~AtomStorage()
 {
+	// Write out whatever is left, and stop the flusher thread.
+	// Throwing from here would terminate, so just complain.
+	try
+	{
+		setBulkStore(0);
+	}
+	catch (const std::exception& ex)
+	{
+		logger().error("AtomStorage: %zu atoms were not stored: %s",
+		               bulk_pending.size(), ex.what());
+	}
+
 	if (connected())
 		setMaxHeight(getMaxObservedHeight());
 
@@ -693,14 +700,14 @@ std::string AtomStorage::oset_to_string(const std::vector<Handle>& out,
                                         int arity)
 {
 	std::string str;
-	str += "\'{";
+	str += "{";
 	for (int i=0; i<arity; i++)
 	{
 		Handle h = out[i];
 		if (i != 0) str += ", ";
 		str += std::to_string(h->_uuid);
 	}
-	str += "}\'";
+	str += "}";
 	return str;
 }
 
@@ -714,6 +721,9 @@ std::string AtomStorage::oset_to_string(const std::vector<Handle>& out,
 void AtomStorage::flushStoreQueue()
 {
 	_write_queue.flush_queue();
+
+	std::unique_lock<std::mutex> lck(bulk_mutex);
+	bulk_flush(lck);
 }
 
 /* ================================================================ */
@@ -745,12 +755,13 @@ void AtomStorage::storeAtom(AtomPtr atom, bool synchronous)
  * in the calling thread.
  * Returns the height of the atom.
  */
-int AtomStorage::do_store_atom(AtomPtr atom)
+int AtomStorage::do_store_atom(AtomPtr atom, bool bulk)
 {
 	LinkPtr l(LinkCast(atom));
 	if (NULL == l)
 	{
-		do_store_single_atom(atom, 0);
+		if (bulk) bulk_add(atom, 0);
+		else do_store_single_atom(atom, 0);
 		return 0;
 	}
 
@@ -760,20 +771,21 @@ int AtomStorage::do_store_atom(AtomPtr atom)
 	for (int i=0; i<arity; i++)
 	{
 		// Recurse.
-		int heig = do_store_atom(out[i]);
+		int heig = do_store_atom(out[i], bulk);
 		if (lheight < heig) lheight = heig;
 	}
 
 	// Height of this link is, by definition, one more than tallest
 	// atom in outgoing set.
 	lheight ++;
-	do_store_single_atom(atom, lheight);
+	if (bulk) bulk_add(atom, lheight);
+	else do_store_single_atom(atom, lheight);
 	return lheight;
 }
 
 void AtomStorage::vdo_store_atom(AtomPtr& atom)
 {
-	do_store_atom(atom);
+	do_store_atom(atom, 0 < bulk_size);
 }
 
 /* ================================================================ */
@@ -793,159 +805,492 @@ void AtomStorage::do_store_single_atom(AtomPtr atom, int aheight)
 {
 	setup_typemap();
 
-	int notfirst = 0;
-	std::string cols;
-	std::string vals;
-	std::string coda;
-
 	// Use the TLB Handle as the UUID.
 	Handle h(atom->getHandle());
 	if (TLB::isInvalidHandle(h))
 		throw RuntimeException(TRACE_INFO, "Trying to save atom with an invalid handle!");
 
 	UUID uuid = h->_uuid;
-	std::string uuidbuff = std::to_string(uuid);
+
+	TruthValueType tvt;
+	double mean, confidence, count;
+	bool has_stv = tv_columns(atom->getTruthValue(),
+	                          tvt, mean, confidence, count);
 
 	std::unique_lock<std::mutex> lck = maybe_create_id(uuid);
 	bool update = not lck.owns_lock();
+
+	ODBCConnection* db_conn = get_conn();
+	ODBCRecordSet* stmt;
+	int tvparm;
 	if (update)
 	{
-		cols = "UPDATE Atoms SET ";
-		vals = "";
-		coda = " WHERE uuid = ";
-		coda += uuidbuff;
-		coda += ";";
+		// Once an atom is in an atom table, its name and type cannot
+		// be changed. Only its truth value can change.
+		stmt = db_conn->prepare("UPDATE Atoms SET tv_type = ?, "
+			"stv_mean = ?, stv_confidence = ?, stv_count = ? "
+			"WHERE uuid = ?;");
+		tvparm = 1;
+		if (stmt) stmt->bind_int(5, uuid);
 	}
 	else
 	{
-		cols = "INSERT INTO Atoms (";
-		vals = ") VALUES (";
-		coda = ");";
+		stmt = db_conn->prepare("INSERT INTO Atoms (uuid, space, type, "
+			"height, name, outgoing, tv_type, stv_mean, stv_confidence, "
+			"stv_count) VALUES (?, ?, ?, ?, ?, CAST(? AS BIGINT[]), "
+			"?, ?, ?, ?);");
+		tvparm = 7;
+		if (stmt)
+		{
+			stmt->bind_int(1, uuid);
 
-		STMT("uuid", uuidbuff);
-	}
+			// Store the atomspace UUID
+			// We allow storage of atoms that don't belong to an atomspace.
+			AtomTable * at = atom->getAtomTable();
+			stmt->bind_int(2, at ? at->get_uuid() : 0);
 
-	// Store the atom type and node name only if storing for the
-	// first time ever. Once an atom is in an atom table, it's
-	// name can type cannot be changed. Only its truth value can
-	// change.
-	if (false == update)
-	{
-		// Store the atomspace UUID
-		AtomTable * at = atom->getAtomTable();
-		// We allow storage of atoms that don't belong to an atomspace.
-		if (at) uuidbuff = std::to_string(at->get_uuid());
-		else uuidbuff = "0";
-		STMT("space", uuidbuff);
-
-		// Store the atom UUID
-		Type t = atom->getType();
-		int dbtype = storing_typemap[t];
-		STMTI("type", dbtype);
-
-		// Store the node name, if its a node
-		NodePtr n(NodeCast(atom));
-		if (n)
-		{
-#if 0
-			std::string qname = n->getName();
-			escape_single_quotes(qname);
-			qname.insert(0U,1U,'\'');
-			qname += "'";
-#else
-			// Use postgres $-quoting to make unicode strings
-			// easier to deal with.
-			std::string qname = " $ocp$";
-			qname += n->getName();
-			qname += "$ocp$ ";
-#endif
-			STMT("name", qname);
+			stmt->bind_int(3, storing_typemap[atom->getType()]);
 
-			// Nodes have a height of zero by definition.
-			STMTI("height", 0);
-		}
-		else
-		{
-			if (max_height < aheight) max_height = aheight;
-			STMTI("height", aheight);
+			// Store the node name, if its a node. Being a parameter,
+			// it needs no quoting.
+			NodePtr n(NodeCast(atom));
+			if (n)
+			{
+				// Nodes have a height of zero by definition.
+				stmt->bind_int(4, 0);
+				stmt->bind_string(5, n->getName());
+				stmt->bind_null(6);
+			}
+			else
+			{
+				if (max_height < aheight) max_height = aheight;
+				stmt->bind_int(4, aheight);
+				stmt->bind_null(5);
+				stmt->bind_null(6);
 
 #ifdef USE_INLINE_EDGES
-			LinkPtr l(LinkCast(atom));
-			if (l)
-			{
+				LinkPtr l(LinkCast(atom));
 				int arity = l->getArity();
 				if (arity)
-				{
-					cols += ", outgoing";
-					vals += ", ";
-					vals += oset_to_string(l->getOutgoingSet(), arity);
-				}
-			}
+					stmt->bind_string(6,
+						oset_to_string(l->getOutgoingSet(), arity));
 #endif /* USE_INLINE_EDGES */
+			}
 		}
 	}
 
+	if (NULL == stmt)
+	{
+		put_conn(db_conn);
+		throw RuntimeException(TRACE_INFO,
+			"Error: store_single: cannot prepare statement\n");
+	}
+
 	// Store the truth value
-	TruthValuePtr tv(atom->getTruthValue());
-	TruthValueType tvt = NULL_TRUTH_VALUE;
+	stmt->bind_int(tvparm, tvt);
+	if (has_stv)
+	{
+		stmt->bind_double(tvparm+1, mean);
+		stmt->bind_double(tvparm+2, confidence);
+		stmt->bind_double(tvparm+3, count);
+	}
+	else
+	{
+		stmt->bind_null(tvparm+1);
+		stmt->bind_null(tvparm+2);
+		stmt->bind_null(tvparm+3);
+	}
+
+	// We may have to store the atom table UUID and try again...
+	// We waste CPU cycles to store the atomtable, only if it failed.
+	ODBCRecordSet* rs = stmt->execute();
+	if (NULL == rs)
+	{
+		AtomTable *at = atom->getAtomTable();
+		if (at) store_atomtable_id(*at);
+		rs = stmt->execute();
+	}
+	if (rs) rs->release();
+	put_conn(db_conn);
+
+#ifndef USE_INLINE_EDGES
+	// Store the outgoing handles only if we are storing for the first
+	// time, otherwise do nothing. The semantics is that, once the
+	// outgoing set has been determined, it cannot be changed.
+	if (false == update)
+	{
+		storeOutgoing(atom);
+	}
+#endif /* USE_INLINE_EDGES */
+
+	// Make note of the fact that this atom has been stored.
+	add_id_to_cache(uuid);
+}
+
+/* ================================================================ */
+/*
+ * Bulk store.
+ *
+ * Storing atoms one at a time costs one round-trip to the database
+ * per atom; that is what limits the speed of storing, and not the
+ * database itself.  In bulk mode, the atoms are gathered up instead,
+ * and each batch is written with a few multi-row INSERTs, for the
+ * atoms that are new to the database, and one UPDATE ... FROM
+ * (VALUES ...), for the truth values of the rest.  The INSERTs are
+ * prepared statements, so that the node names are passed as
+ * parameters, and not pasted into the SQL.  Within a batch, the atoms
+ * are written lowest first, so that an atom is never written before
+ * the atoms in its outgoing set.  An atom queued more than once before
+ * its batch is written is written once, with its latest truth value.
+ *
+ * A batch that the flusher thread fails to write is kept, and tried
+ * again with the next one; flushStoreQueue() and setBulkStore() write
+ * out whatever is pending, and throw if that fails.
+ */
+
+#define BULK_INSERT_ROWS 64  // Most atoms in one INSERT; a power of two.
+#define BULK_INSERT_COLS 10  // Parameters per atom.
+
+void AtomStorage::setBulkStore(size_t batch_size, double flush_latency)
+{
+	// Stop the flusher, and write out what was gathered so far;
+	// the flusher is started again below, if need be.
+	{
+		std::lock_guard<std::mutex> lck(bulk_mutex);
+		bulk_stop = true;
+		bulk_cv.notify_all();
+	}
+	if (bulk_flusher.joinable()) bulk_flusher.join();
+
+	std::unique_lock<std::mutex> lck(bulk_mutex);
+	bulk_size = batch_size;
+	bulk_latency = std::chrono::milliseconds((long) (1000.0 * flush_latency));
+	bulk_stop = false;
+	if (0 < bulk_size)
+		bulk_flusher = std::thread(&AtomStorage::bulk_flush_loop, this);
+	bulk_flush(lck);
+}
+
+void AtomStorage::bulk_add(AtomPtr atom, int height)
+{
+	Handle h(atom->getHandle());
+	if (TLB::isInvalidHandle(h))
+		throw RuntimeException(TRACE_INFO, "Trying to save atom with an invalid handle!");
+
+	std::unique_lock<std::mutex> lck(bulk_mutex);
+	if (bulk_pending.empty())
+	{
+		bulk_since = std::chrono::steady_clock::now();
+		bulk_cv.notify_all();
+	}
+	bulk_pending[h->_uuid] = {atom, height};
+	if (bulk_pending.size() < bulk_size) return;
+	bulk_flush(lck);
+}
+
+/// Write out the atoms gathered so far, and wait for any batch that
+/// is being written to be done.  Must be called with the bulk_mutex
+/// held; it is let go of before writing.
+void AtomStorage::bulk_flush(std::unique_lock<std::mutex>& lck)
+{
+	std::vector<BulkRow> rows;
+	rows.reserve(bulk_pending.size());
+	for (auto& pr : bulk_pending)
+		rows.emplace_back(std::move(pr.second));
+	bulk_pending.clear();
+
+	// Take the write lock before letting go of the pending atoms, so
+	// that the batches are written in the order they were gathered.
+	std::lock_guard<std::mutex> wlck(bulk_write_mutex);
+	lck.unlock();
+	if (rows.empty()) return;
+	try
+	{
+		bulk_write(rows);
+	}
+	catch (...)
+	{
+		// Keep the atoms, to be written with the next batch; those
+		// queued again meanwhile have a newer truth value.  The
+		// flusher waits a while, before trying again.
+		lck.lock();
+		bulk_since = std::chrono::steady_clock::now();
+		for (BulkRow& row : rows)
+			bulk_pending.emplace(row.atom->getHandle()->_uuid,
+			                     std::move(row));
+		lck.unlock();
+		throw;
+	}
+}
+
+/// Write out each batch that is not full, once it is old enough.
+void AtomStorage::bulk_flush_loop(void)
+{
+	std::unique_lock<std::mutex> lck(bulk_mutex);
+	while (not bulk_stop)
+	{
+		if (bulk_pending.empty())
+		{
+			bulk_cv.wait_for(lck, bulk_latency);
+			continue;
+		}
+		if (std::chrono::steady_clock::now() < bulk_since + bulk_latency)
+		{
+			bulk_cv.wait_until(lck, bulk_since + bulk_latency);
+			continue;
+		}
+
+		try
+		{
+			bulk_flush(lck);
+		}
+		catch (const std::exception& ex)
+		{
+			logger().error("AtomStorage: bulk store failed, "
+			               "will try again: %s", ex.what());
+		}
+		lck.lock();
+	}
+}
+
+/// The values of the tv_type, stv_mean, stv_confidence and stv_count
+/// columns for the truth value.  Returns false if only the tv_type is
+/// stored; the other three are then NULL.
+bool AtomStorage::tv_columns(const TruthValuePtr& tv, TruthValueType& tvt,
+                             double& mean, double& confidence, double& count)
+{
+	tvt = NULL_TRUTH_VALUE;
 	if (tv) tvt = tv->getType();
-	STMTI("tv_type", tvt);
 
 	switch (tvt)
 	{
 		case NULL_TRUTH_VALUE:
-			break;
+			return false;
 		case SIMPLE_TRUTH_VALUE:
 		case COUNT_TRUTH_VALUE:
 		case PROBABILISTIC_TRUTH_VALUE:
-			STMTF("stv_mean", tv->getMean());
-			STMTF("stv_confidence", tv->getConfidence());
-			STMTF("stv_count", tv->getCount());
-			break;
+			mean = tv->getMean();
+			confidence = tv->getConfidence();
+			count = tv->getCount();
+			return true;
 		case INDEFINITE_TRUTH_VALUE:
 		{
 			IndefiniteTruthValuePtr itv = std::static_pointer_cast<IndefiniteTruthValue>(tv);
-			STMTF("stv_mean", itv->getL());
-			STMTF("stv_count", itv->getU());
-			STMTF("stv_confidence", itv->getConfidenceLevel());
-			break;
+			mean = itv->getL();
+			count = itv->getU();
+			confidence = itv->getConfidenceLevel();
+			return true;
 		}
 		default:
 			throw RuntimeException(TRACE_INFO,
-				"Error: store_single: Unknown truth value type\n");
+				"Error: store: Unknown truth value type\n");
+	}
+}
+
+/// The truth value, as the values of the tv_type, stv_mean,
+/// stv_confidence and stv_count columns, in that order.  The same as
+/// do_store_single_atom() stores.
+std::string AtomStorage::tv_to_values(const TruthValuePtr& tv)
+{
+	TruthValueType tvt;
+	double mean, confidence, count;
+	if (not tv_columns(tv, tvt, mean, confidence, count))
+		return std::to_string(tvt) + ", NULL, NULL, NULL";
+
+	char buff[BUFSZ];
+	snprintf(buff, BUFSZ, "%u, %12.8g, %12.8g, %12.8g",
+	         tvt, mean, confidence, count);
+	return buff;
+}
+
+void AtomStorage::bulk_write(std::vector<BulkRow>& rows)
+{
+	setup_typemap();
+
+	std::stable_sort(rows.begin(), rows.end(),
+		[](const BulkRow& a, const BulkRow& b)
+		{ return a.height < b.height; });
+
+	// While the creation lock is held, no other writer is part-way
+	// through inserting an atom; so the cache tells exactly which of
+	// these are new.  See maybe_create_id() above.
+	std::unique_lock<std::mutex> create_lock(id_create_mutex);
+
+	std::vector<const BulkRow*> ins;
+	std::string upd;
+	{
+		std::unique_lock<std::mutex> cache_lock(id_cache_mutex);
+		for (const BulkRow& row : rows)
+		{
+			UUID uuid = row.atom->getHandle()->_uuid;
+			if (0 == local_id_cache.count(uuid))
+			{
+				ins.push_back(&row);
+				continue;
+			}
+			upd += upd.empty() ? "(" : ", (";
+			upd += std::to_string(uuid) + ", "
+			    + tv_to_values(row.atom->getTruthValue()) + ")";
+		}
 	}
 
-	// We may have to store the atom table UUID and try again...
-	// We waste CPU cycles to store the atomtable, only if it failed.
-	bool try_again = false;
-	std::string qry = cols + vals + coda;
 	ODBCConnection* db_conn = get_conn();
-	Response rp;
-	rp.rs = db_conn->exec(qry.c_str());
-	if (NULL == rp.rs) try_again = true;
-	rp.rs->release();
+	try
+	{
+		// Pieces of a power of two in size, so that only a few
+		// statements ever get prepared.
+		for (size_t done = 0; done < ins.size(); )
+		{
+			size_t n = BULK_INSERT_ROWS;
+			while (ins.size() - done < n) n /= 2;
+			bulk_insert(db_conn, &ins[done], n);
+			done += n;
+		}
 
-	if (try_again)
+		if (not upd.empty())
+		{
+			// A column of nothing but NULL's would be taken to be text;
+			// hence the casts.  Only numbers go into it, and so it need
+			// not be prepared.
+			std::string qry = "UPDATE Atoms SET tv_type = v.tv_type, "
+				"stv_mean = CAST(v.stv_mean AS FLOAT), "
+				"stv_confidence = CAST(v.stv_confidence AS FLOAT), "
+				"stv_count = CAST(v.stv_count AS DOUBLE PRECISION) "
+				"FROM (VALUES " + upd + ") AS v (uuid, tv_type, "
+				"stv_mean, stv_confidence, stv_count) "
+				"WHERE Atoms.uuid = v.uuid;";
+			// NULL here may just mean that no rows changed.
+			ODBCRecordSet* rs = db_conn->exec(qry.c_str());
+			if (rs) rs->release();
+		}
+	}
+	catch (...)
 	{
-		AtomTable *at = atom->getAtomTable();
-		if (at) store_atomtable_id(*at);
-		rp.rs = db_conn->exec(qry.c_str());
-		rp.rs->release();
+		put_conn(db_conn);
+		throw;
 	}
 	put_conn(db_conn);
+}
 
+/// Insert n atoms, that are not in the database yet, with one prepared
+/// statement, and make note of them having been stored.  The columns
+/// are those of do_store_single_atom(), in the same order; being
+/// parameters, the node names need no quoting.
+void AtomStorage::bulk_insert(ODBCConnection* db_conn,
+                              const BulkRow* const* rows, size_t n)
+{
+	std::string qry = "INSERT INTO Atoms (uuid, space, type, "
+		"height, name, outgoing, tv_type, stv_mean, stv_confidence, "
+		"stv_count) VALUES ";
+	for (size_t r = 0; r < n; r++)
+	{
+		if (0 < r) qry += ", ";
+		qry += "(?, ?, ?, ?, ?, CAST(? AS BIGINT[]), ?, ?, ?, ?)";
+	}
+	qry += ";";
+
+	ODBCRecordSet* stmt = db_conn->prepare(qry.c_str());
+	if (NULL == stmt)
+		throw RuntimeException(TRACE_INFO,
+			"Error: bulk store: cannot prepare statement\n");
+
+	std::set<AtomTable*> tables;
 #ifndef USE_INLINE_EDGES
-	// Store the outgoing handles only if we are storing for the first
-	// time, otherwise do nothing. The semantics is that, once the
-	// outgoing set has been determined, it cannot be changed.
-	if (false == update)
+	std::string edges;
+#endif
+	for (size_t r = 0; r < n; r++)
 	{
-		storeOutgoing(atom);
+		const AtomPtr& atom = rows[r]->atom;
+		UUID uuid = atom->getHandle()->_uuid;
+		int p = 1 + r * BULK_INSERT_COLS;
+
+		stmt->bind_int(p, uuid);
+		AtomTable * at = atom->getAtomTable();
+		if (at) tables.insert(at);
+		stmt->bind_int(p+1, at ? at->get_uuid() : 0);
+		stmt->bind_int(p+2, storing_typemap[atom->getType()]);
+
+		NodePtr nd(NodeCast(atom));
+		if (nd)
+		{
+			stmt->bind_int(p+3, 0);
+			stmt->bind_string(p+4, nd->getName());
+			stmt->bind_null(p+5);
+		}
+		else
+		{
+			int height = rows[r]->height;
+			if (max_height < height) max_height = height;
+			stmt->bind_int(p+3, height);
+			stmt->bind_null(p+4);
+			stmt->bind_null(p+5);
+
+			LinkPtr l(LinkCast(atom));
+			int arity = l->getArity();
+#ifdef USE_INLINE_EDGES
+			if (arity)
+				stmt->bind_string(p+5,
+					oset_to_string(l->getOutgoingSet(), arity));
+#else
+			const HandleSeq& out = l->getOutgoingSet();
+			for (int i=0; i<arity; i++)
+			{
+				edges += edges.empty() ? "(" : ", (";
+				edges += std::to_string(uuid) + ", "
+				      + std::to_string(out[i]->_uuid)
+				      + ", " + std::to_string(i) + ")";
+			}
+#endif /* USE_INLINE_EDGES */
+		}
+
+		TruthValueType tvt;
+		double mean, confidence, count;
+		if (tv_columns(atom->getTruthValue(), tvt, mean, confidence, count))
+		{
+			stmt->bind_double(p+7, mean);
+			stmt->bind_double(p+8, confidence);
+			stmt->bind_double(p+9, count);
+		}
+		else
+		{
+			stmt->bind_null(p+7);
+			stmt->bind_null(p+8);
+			stmt->bind_null(p+9);
+		}
+		stmt->bind_int(p+6, tvt);
+	}
+
+	// We may have to store the atom table UUID's and try again.
+	ODBCRecordSet* rs = stmt->execute();
+	if (NULL == rs)
+	{
+		for (AtomTable* at : tables) store_atomtable_id(*at);
+		rs = stmt->execute();
+	}
+	if (NULL == rs)
+		throw RuntimeException(TRACE_INFO,
+			"Error: bulk store: cannot insert atoms\n");
+	rs->release();
+
+#ifndef USE_INLINE_EDGES
+	if (not edges.empty())
+	{
+		qry = "INSERT INTO Edges (src_uuid, dst_uuid, pos) "
+			"VALUES " + edges + ";";
+		rs = db_conn->exec(qry.c_str());
+		if (NULL == rs)
+			throw RuntimeException(TRACE_INFO,
+				"Error: bulk store: cannot insert edges\n");
+		rs->release();
 	}
 #endif /* USE_INLINE_EDGES */
 
-	// Make note of the fact that this atom has been stored.
-	add_id_to_cache(uuid);
+	// Make note of the fact that these atoms have been stored; if a
+	// later piece of the batch fails, these are updated, when the
+	// batch is written again, and not inserted twice.
+	std::unique_lock<std::mutex> cache_lock(id_cache_mutex);
+	for (size_t r = 0; r < n; r++)
+		local_id_cache.insert(rows[r]->atom->getHandle()->_uuid);
 }
 
 /* ================================================================ */
@@ -1199,20 +1544,23 @@ void AtomStorage::getOutgoing(std::vector<Handle> &outv, Handle h)
 
 /* ================================================================ */
 
-/* One-size-fits-all atom fetcher */
-AtomStorage::PseudoPtr AtomStorage::getAtom(const char * query, int height)
+/* One-size-fits-all atom fetcher.  The statement is one prepared
+ * on the connection, selecting ATOM_COLUMNS, with its parameters
+ * bound; it may be NULL, if it could not be prepared. */
+AtomStorage::PseudoPtr AtomStorage::getAtom(ODBCConnection* db_conn,
+                                            ODBCRecordSet* stmt,
+                                            int height)
 {
-	ODBCConnection* db_conn = get_conn();
 	Response rp;
 	rp.uuid = Handle::INVALID_UUID;
-	rp.rs = db_conn->exec(query);
-	rp.rs->foreach_row(&Response::create_atom_cb, &rp);
+	rp.rs = stmt ? stmt->execute() : NULL;
+	if (rp.rs) rp.rs->foreach_row(&Response::create_atom_cb, &rp);
 
 	// Did we actually find anything?
 	// DO NOT USE TLB::IsInvalidHandle() HERE! It won't work, duhh!
 	if (rp.uuid == Handle::INVALID_UUID)
 	{
-		rp.rs->release();
+		if (rp.rs) rp.rs->release();
 		put_conn(db_conn);
 		return NULL;
 	}
@@ -1227,10 +1575,12 @@ AtomStorage::PseudoPtr AtomStorage::getAtom(const char * query, int height)
 AtomStorage::PseudoPtr AtomStorage::petAtom(UUID uuid)
 {
 	setup_typemap();
-	char buff[BUFSZ];
-	snprintf(buff, BUFSZ, "SELECT * FROM Atoms WHERE uuid = %lu;", uuid);
+	ODBCConnection* db_conn = get_conn();
+	ODBCRecordSet* stmt = db_conn->prepare(
+		"SELECT " ATOM_COLUMNS " FROM Atoms WHERE uuid = ?;");
+	if (stmt) stmt->bind_int(1, uuid);
 
-	return getAtom(buff, -1);
+	return getAtom(db_conn, stmt, -1);
 }
 
 /**
@@ -1270,10 +1620,6 @@ std::vector<Handle> AtomStorage::getIncomingSet(Handle h)
 	std::vector<Handle> iset;
 
 	setup_typemap();
-	char buff[BUFSZ];
-	snprintf(buff, BUFSZ,
-		"SELECT * FROM Atoms WHERE outgoing @> ARRAY[CAST(%lu AS BIGINT)];",
-		h->_uuid);
 
 	// Note: "select * from atoms where outgoing@>array[556];" will return
 	// all links with atom 556 in the outgoing set -- i.e. the incoming set of 556.
@@ -1282,13 +1628,23 @@ std::vector<Handle> AtomStorage::getIncomingSet(Handle h)
 	// ERROR:  operator does not exist: bigint[] @> integer[]
 
 	ODBCConnection* db_conn = get_conn();
+	ODBCRecordSet* stmt = db_conn->prepare("SELECT " ATOM_COLUMNS
+		" FROM Atoms WHERE outgoing @> ARRAY[CAST(? AS BIGINT)];");
 	Response rp;
 	rp.store = this;
 	rp.height = -1;
 	rp.hvec = &iset;
-	rp.rs = db_conn->exec(buff);
-	rp.rs->foreach_row(&Response::fetch_incoming_set_cb, &rp);
-	rp.rs->release();
+	rp.rs = NULL;
+	if (stmt)
+	{
+		stmt->bind_int(1, h->_uuid);
+		rp.rs = stmt->execute();
+	}
+	if (rp.rs)
+	{
+		rp.rs->foreach_row(&Response::fetch_incoming_set_cb, &rp);
+		rp.rs->release();
+	}
 	put_conn(db_conn);
 
 	return iset;
@@ -1305,21 +1661,19 @@ std::vector<Handle> AtomStorage::getIncomingSet(Handle h)
 NodePtr AtomStorage::getNode(Type t, const char * str)
 {
 	setup_typemap();
-	char buff[40*BUFSZ];
-
-	// Use postgres $-quoting to make unicode strings easier to deal with.
-	int nc = snprintf(buff, 4*BUFSZ, "SELECT * FROM Atoms WHERE "
-	    "type = %hu AND name = $ocp$%s$ocp$ ;", storing_typemap[t], str);
 
-	if (40*BUFSZ-1 <= nc)
+	// The name is a parameter, and so needs no quoting, and can be
+	// of any length.
+	ODBCConnection* db_conn = get_conn();
+	ODBCRecordSet* stmt = db_conn->prepare("SELECT " ATOM_COLUMNS
+		" FROM Atoms WHERE type = ? AND name = ?;");
+	if (stmt)
 	{
-		fprintf(stderr, "Error: AtomStorage::getNode: buffer overflow!\n");
-		buff[40*BUFSZ-1] = 0x0;
-		fprintf(stderr, "\tnc=%d buffer=>>%s<<\n", nc, buff);
-		return NULL;
+		stmt->bind_int(1, storing_typemap[t]);
+		stmt->bind_string(2, str);
 	}
 
-	PseudoPtr p(getAtom(buff, 0));
+	PseudoPtr p(getAtom(db_conn, stmt, 0));
 	if (NULL == p) return NULL;
 
 	NodePtr node = createNode(t, str, p->tv);
@@ -1339,16 +1693,16 @@ LinkPtr AtomStorage::getLink(Type t, const HandleSeq& oset)
 {
 	setup_typemap();
 
-	char buff[BUFSZ];
-	snprintf(buff, BUFSZ,
-	    "SELECT * FROM Atoms WHERE type = %hu AND outgoing = ",
-	    storing_typemap[t]);
-
-	std::string ostr = buff;
-	ostr += oset_to_string(oset, oset.size());
-	ostr += ";";
+	ODBCConnection* db_conn = get_conn();
+	ODBCRecordSet* stmt = db_conn->prepare("SELECT " ATOM_COLUMNS
+		" FROM Atoms WHERE type = ? AND outgoing = CAST(? AS BIGINT[]);");
+	if (stmt)
+	{
+		stmt->bind_int(1, storing_typemap[t]);
+		stmt->bind_string(2, oset_to_string(oset, oset.size()));
+	}
 
-	PseudoPtr p = getAtom(ostr.c_str(), 1);
+	PseudoPtr p = getAtom(db_conn, stmt, 1);
 	if (NULL == p) return NULL;
 
 	LinkPtr link = createLink(t, oset, p->tv);
@@ -1446,6 +1800,238 @@ AtomStorage::PseudoPtr AtomStorage::makeAtom(Response &rp, UUID uuid)
 
 /* ================================================================ */
 
+/**
+ * Bulk loader.
+ *
+ * The atoms are loaded one height at a time, lowest first, as a link
+ * cannot be created before its outgoing set is in the table.  Each
+ * height is split into uuid ranges; these are fetched and decoded by
+ * several threads at once, each with a database connection of its own.
+ * The ranges are added to the table by the calling thread, in order,
+ * as they become ready; thus, fetching the next height can go on while
+ * the last one is being added, and only the making of links waits for
+ * the height below them to be in the table.  The fetching threads stay
+ * a bounded number of ranges ahead of the adding, so as to bound the
+ * memory used.
+ */
+class AtomStorage::Loader
+{
+	private:
+		AtomStorage *_store;
+		AtomTable *_table;
+		int _db_type;      // Load only atoms of this type, if not -1.
+		bool _if_not_exists;
+		bool _verbose;     // Report to stderr, else to the log.
+
+		struct Task
+		{
+			int height;
+			unsigned long rec;
+		};
+		std::vector<Task> _tasks;
+		std::vector<HandleSeq> _results;
+		std::vector<bool> _ready;
+		size_t _window;
+		size_t _next_task;    // Next range to fetch.
+		size_t _next_insert;  // Next range to add to the table.
+		int _done_height;     // All lower heights are in the table.
+		bool _stop;
+		std::exception_ptr _failure;
+
+		std::mutex _mtx;
+		std::condition_variable _cv;  // Signalled on every change above.
+
+		void fetch(const Task&, Response&);
+		void worker(void);
+		void report(const char *, ...);
+
+	public:
+		Loader(AtomStorage *store, AtomTable *table, int db_type,
+		       bool if_not_exists, bool verbose)
+			: _store(store), _table(table), _db_type(db_type),
+			  _if_not_exists(if_not_exists), _verbose(verbose),
+			  _window(0), _next_task(0), _next_insert(0),
+			  _done_height(-1), _stop(false) {}
+
+		void run(int max_height, unsigned long max_nrec, int nthreads);
+};
+
+void AtomStorage::Loader::report(const char *fmt, ...)
+{
+	char buff[BUFSZ];
+	va_list args;
+	va_start(args, fmt);
+	vsnprintf(buff, BUFSZ, fmt, args);
+	va_end(args);
+	if (_verbose) fprintf(stderr, "%s\n", buff);
+	else logger().debug("%s", buff);
+}
+
+void AtomStorage::Loader::fetch(const Task& task, Response& rp)
+{
+	ODBCConnection* db_conn = _store->get_conn();
+
+	// It appears that, when the select statement returns more than
+	// about a 100K to a million atoms or so, some sort of heap
+	// corruption occurs in the iodbc code, causing future mallocs
+	// to fail. So limit the number of records processed in one go.
+	// It also appears that asking for lots of records increases
+	// the memory fragmentation (and/or there's a memory leak in iodbc??)
+	// XXX Not clear is UnixODBC suffers from this same problem.
+	// Whatever, seems to be a better strategy overall, anyway.
+	ODBCRecordSet* stmt;
+	int parm = 1;
+	if (_db_type < 0)
+		stmt = db_conn->prepare("SELECT " ATOM_COLUMNS " FROM Atoms "
+			"WHERE height = ? AND uuid > ? AND uuid <= ?;");
+	else
+	{
+		stmt = db_conn->prepare("SELECT " ATOM_COLUMNS " FROM Atoms "
+			"WHERE type = ? AND height = ? AND uuid > ? AND uuid <= ?;");
+		if (stmt) stmt->bind_int(parm++, _db_type);
+	}
+	if (NULL == stmt)
+	{
+		_store->put_conn(db_conn);
+		throw RuntimeException(TRACE_INFO,
+			"Error: load: cannot prepare statement\n");
+	}
+	stmt->bind_int(parm++, task.height);
+	stmt->bind_int(parm++, task.rec);
+	stmt->bind_int(parm++, task.rec+LOAD_STEP);
+
+	rp.height = task.height;
+	rp.rs = stmt->execute();
+	if (rp.rs)
+	{
+		if (_if_not_exists)
+			rp.rs->foreach_row(&Response::load_if_not_exists_cb, &rp);
+		else
+			rp.rs->foreach_row(&Response::load_all_atoms_cb, &rp);
+		rp.rs->release();
+	}
+	_store->put_conn(db_conn);
+}
+
+void AtomStorage::Loader::worker(void)
+{
+	Response rp;
+	rp.table = _table;
+	rp.store = _store;
+	std::vector<PseudoPtr> pseudos;
+	rp.pvec = &pseudos;
+
+	while (true)
+	{
+		size_t t;
+		{
+			std::unique_lock<std::mutex> lck(_mtx);
+			_cv.wait(lck, [&]{ return _stop or _tasks.size() <= _next_task
+				or _next_task < _next_insert + _window; });
+			if (_stop or _tasks.size() <= _next_task) return;
+			t = _next_task++;
+		}
+
+		try
+		{
+			const Task& task = _tasks[t];
+			pseudos.clear();
+			fetch(task, rp);
+
+			// The outgoing sets have to be in the table first.
+			if (0 < task.height)
+			{
+				std::unique_lock<std::mutex> lck(_mtx);
+				_cv.wait(lck, [&]{ return _stop or
+					task.height <= _done_height + 1; });
+				if (_stop) return;
+			}
+
+			HandleSeq atoms;
+			atoms.reserve(pseudos.size());
+			for (const PseudoPtr& p : pseudos)
+				atoms.emplace_back(rp.get_recursive_if_not_exists(p)->getHandle());
+
+			std::lock_guard<std::mutex> lck(_mtx);
+			_results[t].swap(atoms);
+			_ready[t] = true;
+			_cv.notify_all();
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lck(_mtx);
+			if (not _failure) _failure = std::current_exception();
+			_stop = true;
+			_cv.notify_all();
+			return;
+		}
+	}
+}
+
+void AtomStorage::Loader::run(int max_height, unsigned long max_nrec,
+                              int nthreads)
+{
+	for (int hei=0; hei<=max_height; hei++)
+		for (unsigned long rec = 0; rec <= max_nrec; rec += LOAD_STEP)
+			_tasks.push_back({hei, rec});
+	_results.resize(_tasks.size());
+	_ready.resize(_tasks.size(), false);
+	_window = 4 * nthreads;
+
+	std::vector<std::thread> workers;
+	for (int i=0; i<nthreads; i++)
+		workers.push_back(std::thread(&Loader::worker, this));
+
+	auto start = std::chrono::steady_clock::now();
+	unsigned long count = 0;
+	unsigned long height_count = 0;
+	try
+	{
+		for (size_t t = 0; t < _tasks.size(); t++)
+		{
+			HandleSeq atoms;
+			{
+				std::unique_lock<std::mutex> lck(_mtx);
+				_cv.wait(lck, [&]{ return _stop or _ready[t]; });
+				if (_stop) break;
+				atoms.swap(_results[t]);
+			}
+			if (not atoms.empty()) _table->add_atoms(atoms, true);
+			height_count += atoms.size();
+
+			int hei = _tasks[t].height;
+			bool height_done = (t+1 == _tasks.size() or
+			                    _tasks[t+1].height != hei);
+			if (height_done)
+			{
+				_table->barrier();
+				count += height_count;
+				double secs = std::chrono::duration<double>(
+					std::chrono::steady_clock::now() - start).count();
+				report("Loaded %lu atoms at height %d (%lu in total, "
+				       "%.0f atoms per second)",
+				       height_count, hei, count, count / secs);
+				height_count = 0;
+			}
+
+			std::lock_guard<std::mutex> lck(_mtx);
+			_next_insert = t+1;
+			if (height_done) _done_height = hei;
+			_cv.notify_all();
+		}
+	}
+	catch (...)
+	{
+		std::lock_guard<std::mutex> lck(_mtx);
+		if (not _failure) _failure = std::current_exception();
+		_stop = true;
+		_cv.notify_all();
+	}
+
+	for (std::thread& w : workers) w.join();
+	if (_failure) std::rethrow_exception(_failure);
+}
+
 void AtomStorage::load(AtomTable &table)
 {
 	unsigned long max_nrec = getMaxObservedUUID();
@@ -1457,48 +2043,9 @@ void AtomStorage::load(AtomTable &table)
 
 	setup_typemap();
 
-	ODBCConnection* db_conn = get_conn();
-	Response rp;
-	rp.table = &table;
-	rp.store = this;
-
-	for (int hei=0; hei<=max_height; hei++)
-	{
-		unsigned long cur = load_count;
+	Loader loader(this, &table, -1, false, true);
+	loader.run(max_height, max_nrec, NUM_LOAD_THREADS);
 
-#if GET_ONE_BIG_BLOB
-		char buff[BUFSZ];
-		snprintf(buff, BUFSZ, "SELECT * FROM Atoms WHERE height = %d;", hei);
-		rp.height = hei;
-		rp.rs = db_conn->exec(buff);
-		rp.rs->foreach_row(&Response::load_all_atoms_cb, &rp);
-		rp.rs->release();
-#else
-		// It appears that, when the select statement returns more than
-		// about a 100K to a million atoms or so, some sort of heap
-		// corruption occurs in the iodbc code, causing future mallocs
-		// to fail. So limit the number of records processed in one go.
-		// It also appears that asking for lots of records increases
-		// the memory fragmentation (and/or there's a memory leak in iodbc??)
-		// XXX Not clear is UnixODBC suffers from this same problem.
-		// Whatever, seems to be a better strategy overall, anyway.
-#define STEP 12003
-		unsigned long rec;
-		for (rec = 0; rec <= max_nrec; rec += STEP)
-		{
-			char buff[BUFSZ];
-			snprintf(buff, BUFSZ, "SELECT * FROM Atoms WHERE "
-			        "height = %d AND uuid > %lu AND uuid <= %lu;",
-			         hei, rec, rec+STEP);
-			rp.height = hei;
-			rp.rs = db_conn->exec(buff);
-			rp.rs->foreach_row(&Response::load_all_atoms_cb, &rp);
-			rp.rs->release();
-		}
-#endif
-		fprintf(stderr, "Loaded %lu atoms at height %d\n", load_count - cur, hei);
-	}
-	put_conn(db_conn);
 	fprintf(stderr, "Finished loading %lu atoms in total\n",
 		(unsigned long) load_count);
 
@@ -1524,50 +2071,9 @@ void AtomStorage::loadType(AtomTable &table, Type atom_type)
 	setup_typemap();
 	int db_atom_type = storing_typemap[atom_type];
 
-	ODBCConnection* db_conn = get_conn();
-	Response rp;
-	rp.table = &table;
-	rp.store = this;
-
-	for (int hei=0; hei<=max_height; hei++)
-	{
-		unsigned long cur = load_count;
+	Loader loader(this, &table, db_atom_type, true, false);
+	loader.run(max_height, max_nrec, NUM_LOAD_THREADS);
 
-#if GET_ONE_BIG_BLOB
-		char buff[BUFSZ];
-		snprintf(buff, BUFSZ,
-			"SELECT * FROM Atoms WHERE height = %d AND type = %d;",
-			 hei, db_atom_type);
-		rp.height = hei;
-		rp.rs = db_conn->exec(buff);
-		rp.rs->foreach_row(&Response::load_if_not_exists_cb, &rp);
-		rp.rs->release();
-#else
-		// It appears that, when the select statment returns more than
-		// about a 100K to a million atoms or so, some sort of heap
-		// corruption occurs in the iodbc code, causing future mallocs
-		// to fail. So limit the number of records processed in one go.
-		// It also appears that asking for lots of records increases
-		// the memory fragmentation (and/or there's a memory leak in iodbc??)
-		// XXX Not clear is UnixODBC suffers from this same problem.
-#define STEP 12003
-		unsigned long rec;
-		for (rec = 0; rec <= max_nrec; rec += STEP)
-		{
-			char buff[BUFSZ];
-			snprintf(buff, BUFSZ, "SELECT * FROM Atoms WHERE type = %d "
-			        "AND height = %d AND uuid > %lu AND uuid <= %lu;",
-			         db_atom_type, hei, rec, rec+STEP);
-			rp.height = hei;
-			rp.rs = db_conn->exec(buff);
-			rp.rs->foreach_row(&Response::load_if_not_exists_cb, &rp);
-			rp.rs->release();
-		}
-#endif
-		logger().debug("AtomStorage::loadType: Loaded %lu atoms of type %d at height %d\n",
-			load_count - cur, db_atom_type, hei);
-	}
-	put_conn(db_conn);
 	logger().debug("AtomStorage::loadType: Finished loading %lu atoms in total\n",
 		(unsigned long) load_count);
 
@@ -1614,8 +2120,41 @@ void AtomStorage::store(const AtomTable &table)
 	rp.rs->release();
 #endif
 
-	table.foreachHandleByType(
-	    [&](Handle h)->void { store_cb(h); }, ATOM, true);
+	if (0 < bulk_size)
+	{
+		// Lowest first, so that the outgoing set of each link is in
+		// the database before the link is.
+		std::vector<BulkRow> rows;
+		table.foreachHandleByType(
+		    [&](Handle h)->void { rows.push_back({h, get_height(h)}); },
+		    ATOM, true);
+		std::stable_sort(rows.begin(), rows.end(),
+			[](const BulkRow& a, const BulkRow& b)
+			{ return a.height < b.height; });
+
+		for (size_t i = 0; i < rows.size(); i += bulk_size)
+		{
+			std::vector<BulkRow> batch(rows.begin() + i,
+				rows.begin() + std::min(i + bulk_size, rows.size()));
+			try
+			{
+				std::lock_guard<std::mutex> wlck(bulk_write_mutex);
+				bulk_write(batch);
+			}
+			catch (...)
+			{
+				// The connection goes back to the pool, even so.
+				put_conn(db_conn);
+				throw;
+			}
+			store_count += batch.size();
+			fprintf(stderr, "\tStored %lu atoms.\n",
+			        (unsigned long) store_count);
+		}
+	}
+	else
+		table.foreachHandleByType(
+		    [&](Handle h)->void { store_cb(h); }, ATOM, true);
 
 #ifndef USE_INLINE_EDGES
 	// Create indexes
@@ -26,9 +26,12 @@
 #define _OPENCOG_PERSITENT_ATOM_STORAGE_H
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
 #include <set>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include <opencog/util/async_method_caller.h>
@@ -56,6 +59,7 @@ class AtomStorage
 		// Utility for handling responses on stack.
 		class Response;
 		class Outgoing;
+		class Loader;
 
 		void init(const char *, const char *, const char *);
 
@@ -80,7 +84,7 @@ class AtomStorage
 		typedef std::shared_ptr<PseudoAtom> PseudoPtr;
 		#define createPseudo std::make_shared<PseudoAtom>
 		PseudoPtr makeAtom(Response &, UUID);
-		PseudoPtr getAtom(const char *, int);
+		PseudoPtr getAtom(ODBCConnection*, ODBCRecordSet*, int);
 		PseudoPtr petAtom(UUID);
 
 		int get_height(AtomPtr);
@@ -88,10 +92,36 @@ class AtomStorage
 		void setMaxHeight(int);
 		int getMaxHeight(void);
 
-		int do_store_atom(AtomPtr);
+		int do_store_atom(AtomPtr, bool bulk = false);
 		void vdo_store_atom(AtomPtr&);
 		void do_store_single_atom(AtomPtr, int);
 
+		// Bulk store: the atoms are gathered up, and written with
+		// a few INSERT statements and one UPDATE per batch.
+		struct BulkRow
+		{
+			AtomPtr atom;
+			int height;
+		};
+		size_t bulk_size;  // zero if atoms are stored one at a time
+		std::chrono::milliseconds bulk_latency;
+		std::mutex bulk_mutex;
+		std::condition_variable bulk_cv;
+		std::unordered_map<UUID, BulkRow> bulk_pending;
+		std::chrono::steady_clock::time_point bulk_since;
+		std::mutex bulk_write_mutex;  // One batch is written at a time.
+		std::thread bulk_flusher;
+		bool bulk_stop;
+
+		void bulk_add(AtomPtr, int);
+		void bulk_flush(std::unique_lock<std::mutex>&);
+		void bulk_flush_loop(void);
+		void bulk_write(std::vector<BulkRow>&);
+		void bulk_insert(ODBCConnection*, const BulkRow* const*, size_t);
+		bool tv_columns(const TruthValuePtr&, TruthValueType&,
+		                double&, double&, double&);
+		std::string tv_to_values(const TruthValuePtr&);
+
 		std::string oset_to_string(const HandleSeq&, int);
 		void storeOutgoing(AtomPtr, Handle);
 		void getOutgoing(HandleSeq&, Handle);
@@ -164,6 +194,15 @@ class AtomStorage
 		void storeAtom(AtomPtr, bool synchronous = false);
 		void flushStoreQueue();
 
+		// Gather up the atoms queued by storeAtom(), and those saved
+		// by store(), and write them batch_size at a time; a batch
+		// that is not full is written once it is flush_latency seconds
+		// old, and by flushStoreQueue(). A batch_size of zero stores
+		// each atom by itself, which is the default. Both throw if
+		// what was pending could not be written; it is kept, to be
+		// written later.
+		void setBulkStore(size_t batch_size, double flush_latency = 1.0);
+
 		// Fetch atoms from DB
 		bool atomExists(Handle);
 		AtomPtr getAtom(UUID);
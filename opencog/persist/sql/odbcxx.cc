@@ -47,6 +47,7 @@
 #include <sql.h>
 #include <sqlext.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include <opencog/util/platform.h>
 
@@ -146,6 +147,15 @@ ODBCConnection::ODBCConnection(const char * _dbname,
 
 ODBCConnection::~ODBCConnection()
 {
+	// The prepared statements go back to the pool, to be freed with
+	// the rest; they must be gone before the disconnect.
+	for (auto& pr : prepared)
+	{
+		pr.second->is_prepared = false;
+		pr.second->release();
+	}
+	prepared.clear();
+
 	if (sql_hdbc)
 	{
 		SQLDisconnect(sql_hdbc);
@@ -255,6 +265,224 @@ ODBCConnection::exec(const char * buff)
 
 /* =========================================================== */
 
+ODBCRecordSet *
+ODBCConnection::prepare(const char * buff)
+{
+	if (!is_connected) return NULL;
+
+	auto it = prepared.find(buff);
+	if (prepared.end() != it) return it->second;
+
+	ODBCRecordSet *rs = get_record_set();
+	if (!rs) return NULL;
+
+	SQLRETURN rc = SQLPrepare(rs->sql_hstmt, (SQLCHAR *)buff, SQL_NTS);
+	if ((SQL_SUCCESS != rc) and (SQL_SUCCESS_WITH_INFO != rc))
+	{
+		PERR ("Can't prepare query rc=%d ", rc);
+		PRINT_SQLERR (SQL_HANDLE_STMT, rs->sql_hstmt);
+		rs->release();
+		PERR ("\tQuery was: %s\n", buff);
+		return NULL;
+	}
+
+	// None of our statements have a '?' anywhere but in place of
+	// a parameter.
+	size_t nparams = 0;
+	for (const char *p = buff; *p; p++)
+		if ('?' == *p) nparams++;
+
+	rs->param_ints.resize(nparams);
+	rs->param_doubles.resize(nparams);
+	rs->param_strings.resize(nparams);
+	rs->param_lens.resize(nparams);
+	rs->is_prepared = true;
+
+	prepared[buff] = rs;
+	return rs;
+}
+
+/* =========================================================== */
+
+bool
+ODBCRecordSet::bind_param(int i, SQLSMALLINT ctype, SQLSMALLINT sqltype,
+                          SQLPOINTER val, SQLULEN size, SQLLEN len)
+{
+	if ((i < 1) or ((int) param_lens.size() < i))
+	{
+		PERR ("No such parameter %d", i);
+		return false;
+	}
+
+	param_lens[i-1] = len;
+	SQLRETURN rc = SQLBindParameter(sql_hstmt, i, SQL_PARAM_INPUT,
+		ctype, sqltype, size, 0, val, len, &param_lens[i-1]);
+	if ((SQL_SUCCESS != rc) and (SQL_SUCCESS_WITH_INFO != rc))
+	{
+		PERR ("Can't bind parameter %d rc=%d", i, rc);
+		PRINT_SQLERR (SQL_HANDLE_STMT, sql_hstmt);
+		return false;
+	}
+	return true;
+}
+
+void
+ODBCRecordSet::bind_int(int i, SQLBIGINT val)
+{
+	if ((i < 1) or ((int) param_ints.size() < i)) return;
+	param_ints[i-1] = val;
+	bind_param(i, SQL_C_SBIGINT, SQL_BIGINT, &param_ints[i-1], 0, 0);
+}
+
+void
+ODBCRecordSet::bind_double(int i, double val)
+{
+	if ((i < 1) or ((int) param_doubles.size() < i)) return;
+	param_doubles[i-1] = val;
+	bind_param(i, SQL_C_DOUBLE, SQL_DOUBLE, &param_doubles[i-1], 0, 0);
+}
+
+void
+ODBCRecordSet::bind_string(int i, const std::string& val)
+{
+	if ((i < 1) or ((int) param_strings.size() < i)) return;
+	param_strings[i-1] = val;
+	const std::string& str = param_strings[i-1];
+	bind_param(i, SQL_C_CHAR, SQL_VARCHAR, (SQLPOINTER) str.c_str(),
+	           str.size() + 1, str.size());
+}
+
+void
+ODBCRecordSet::bind_null(int i)
+{
+	bind_param(i, SQL_C_CHAR, SQL_VARCHAR, NULL, 1, SQL_NULL_DATA);
+}
+
+/* =========================================================== */
+
+ODBCRecordSet *
+ODBCRecordSet::execute(void)
+{
+	SQLRETURN rc = SQLExecute(sql_hstmt);
+
+	/* Just as for exec(), no data is not an error. */
+	if (SQL_NO_DATA == rc)
+	{
+		release();
+		return NULL;
+	}
+
+	if ((SQL_SUCCESS != rc) and (SQL_SUCCESS_WITH_INFO != rc))
+	{
+		PERR ("Can't execute prepared query rc=%d ", rc);
+		PRINT_SQLERR (SQL_HANDLE_STMT, sql_hstmt);
+		release();
+		return NULL;
+	}
+
+	/* The result columns are the same every time; bind them once. */
+	if (0 > ncols) bind_typed_cols();
+	return this;
+}
+
+/* =========================================================== */
+
+/**
+ * Bind the result columns of a prepared statement to buffers of
+ * their own type, so that numbers come back as numbers, and need not
+ * be printed by the driver, and parsed again by us.  Each column gets
+ * its own length, so that NULLs can be told apart.
+ */
+void
+ODBCRecordSet::bind_typed_cols(void)
+{
+	get_column_labels();
+	if (0 > ncols) return;
+
+	SQLFreeStmt(sql_hstmt, SQL_UNBIND);
+	column_ctype.resize(ncols);
+	int_values.resize(ncols);
+	double_values.resize(ncols);
+	value_lens.resize(ncols);
+
+	for (int i=0; i<ncols; i++)
+	{
+		SQLPOINTER buf;
+		SQLLEN bufsz;
+		switch (column_datatype[i])
+		{
+			case SQL_TINYINT:
+			case SQL_SMALLINT:
+			case SQL_INTEGER:
+			case SQL_BIGINT:
+				column_ctype[i] = SQL_C_SBIGINT;
+				buf = &int_values[i];
+				bufsz = sizeof(SQLBIGINT);
+				break;
+			case SQL_REAL:
+			case SQL_FLOAT:
+			case SQL_DOUBLE:
+			case SQL_NUMERIC:
+			case SQL_DECIMAL:
+				column_ctype[i] = SQL_C_DOUBLE;
+				buf = &double_values[i];
+				bufsz = sizeof(double);
+				break;
+			default:
+				column_ctype[i] = SQL_C_CHAR;
+				buf = values[i];
+				bufsz = vsizes[i];
+				break;
+		}
+
+		SQLRETURN rc = SQLBindCol(sql_hstmt, i+1, column_ctype[i],
+			buf, bufsz, &value_lens[i]);
+		if ((SQL_SUCCESS != rc) and (SQL_SUCCESS_WITH_INFO != rc))
+		{
+			PERR ("Can't bind col=%d rc=%d", i, rc);
+			PRINT_SQLERR (SQL_HANDLE_STMT, sql_hstmt);
+			return;
+		}
+	}
+}
+
+/* =========================================================== */
+
+bool
+ODBCRecordSet::is_null(int i)
+{
+	if ((i < 0) or (ncols <= i)) return true;
+	return SQL_NULL_DATA == value_lens[i];
+}
+
+SQLBIGINT
+ODBCRecordSet::get_int(int i)
+{
+	if (is_null(i)) return 0;
+	if (SQL_C_SBIGINT == column_ctype[i]) return int_values[i];
+	if (SQL_C_DOUBLE == column_ctype[i]) return (SQLBIGINT) double_values[i];
+	return strtoll(values[i], NULL, 10);
+}
+
+double
+ODBCRecordSet::get_double(int i)
+{
+	if (is_null(i)) return 0.0;
+	if (SQL_C_DOUBLE == column_ctype[i]) return double_values[i];
+	if (SQL_C_SBIGINT == column_ctype[i]) return (double) int_values[i];
+	return strtod(values[i], NULL);
+}
+
+const char *
+ODBCRecordSet::get_string(int i)
+{
+	if (is_null(i)) return "";
+	if (SQL_C_CHAR != column_ctype[i]) return "";
+	return values[i];
+}
+
+/* =========================================================== */
+
 #define DEFAULT_COLUMN_NAME_SIZE 121
 #define DEFAULT_VARCHAR_SIZE 4040
 
@@ -366,6 +594,7 @@ ODBCRecordSet::ODBCRecordSet(ODBCConnection *_conn)
 	values = NULL;
 	vsizes = NULL;
 	sql_hstmt = NULL;
+	is_prepared = false;
 }
 
 /* =========================================================== */
@@ -381,6 +610,14 @@ ODBCRecordSet::release(void)
 	// Avoid accidental double-release
 	if (NULL == sql_hstmt) return;
 
+	// Prepared statements are kept by the connection; just close the
+	// cursor, so that it can be run again.
+	if (is_prepared)
+	{
+		SQLFreeStmt(sql_hstmt, SQL_CLOSE);
+		return;
+	}
+
 	// SQLFreeStmt(sql_hstmt, SQL_UNBIND);
 	// SQLFreeStmt(sql_hstmt, SQL_CLOSE);
 	SQLFreeHandle(SQL_HANDLE_STMT, sql_hstmt);
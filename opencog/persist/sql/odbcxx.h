@@ -28,8 +28,10 @@
 #ifndef _OPENCOG_PERSISTENT_ODBC_DRIVER_H
 #define _OPENCOG_PERSISTENT_ODBC_DRIVER_H
 
+#include <map>
 #include <stack>
 #include <string>
+#include <vector>
 
 #include <sql.h>
 #include <sqlext.h>
@@ -51,6 +53,9 @@ class ODBCConnection
 		SQLHDBC sql_hdbc;
 		std::stack<ODBCRecordSet *> free_pool;
 
+		// Prepared statements, by their SQL text.
+		std::map<std::string, ODBCRecordSet *> prepared;
+
 		ODBCRecordSet *get_record_set(void);
 
 	public:
@@ -63,6 +68,11 @@ class ODBCConnection
 
 		ODBCRecordSet *exec(const char *);
 		void extract_error(const char *);
+
+		// Return the prepared statement for the SQL, with '?' in place
+		// of each parameter. It is prepared the first time it is asked
+		// for, and kept until the connection is closed; NULL on error.
+		ODBCRecordSet *prepare(const char *);
 };
 
 class ODBCRecordSet
@@ -79,7 +89,22 @@ class ODBCRecordSet
 		char **values;
 		int  *vsizes;
 
+		// For prepared statements: the parameters, and the columns,
+		// which are fetched in their own types, not as text.
+		bool is_prepared;
+		std::vector<SQLBIGINT> param_ints;
+		std::vector<double> param_doubles;
+		std::vector<std::string> param_strings;
+		std::vector<SQLLEN> param_lens;
+		std::vector<SQLSMALLINT> column_ctype;
+		std::vector<SQLBIGINT> int_values;
+		std::vector<double> double_values;
+		std::vector<SQLLEN> value_lens;
+
 		void alloc_and_bind_cols(int ncols);
+		void bind_typed_cols(void);
+		bool bind_param(int, SQLSMALLINT, SQLSMALLINT,
+		                SQLPOINTER, SQLULEN, SQLLEN);
 		ODBCRecordSet(ODBCConnection *);
 		~ODBCRecordSet();
 
@@ -97,6 +122,24 @@ class ODBCRecordSet
 		// when done with this instance.
 		void release(void);
 
+		// Bind the parameters of a prepared statement, numbered from 1,
+		// and then run it.  Returns NULL on error, like exec() does.
+		// The parameters stay bound until they are bound again.
+		void bind_int(int, SQLBIGINT);
+		void bind_double(int, double);
+		void bind_string(int, const std::string&);
+		void bind_null(int);
+		ODBCRecordSet *execute(void);
+
+		// The columns of the current row of a prepared statement,
+		// numbered from 0, in the order of the SELECT. Integer and
+		// floating-point columns are fetched as such; the others as
+		// text, which get_value() and foreach_column() cannot see.
+		bool is_null(int);
+		SQLBIGINT get_int(int);
+		double get_double(int);
+		const char * get_string(int);
+
 		// Calls the callback once for each row.
 		template<class T> bool
 			foreach_row(bool (T::*cb)(void), T *data)
@@ -45,8 +45,19 @@ bool AttentionalFocusCB::link_match(const LinkPtr& lpat, const LinkPtr& lsoln)
 
 IncomingSet AttentionalFocusCB::get_incoming_set(const Handle& h)
 {
-	const IncomingSet &incoming_set = h->getIncomingSet();
+	return af_filter(h->getIncomingSet());
+}
 
+IncomingSet AttentionalFocusCB::get_incoming_set(const Handle& h, Type t)
+{
+	// Same type restriction as in the DefaultPatternMatchCB.
+	if (CHOICE_LINK == t or QUOTE_LINK == t or UNQUOTE_LINK == t)
+		return get_incoming_set(h);
+	return af_filter(h->getIncomingSetByType(t));
+}
+
+IncomingSet AttentionalFocusCB::af_filter(const IncomingSet& incoming_set)
+{
 	// Discard the part of the incoming set that is below the
 	// AF boundary.  The PM will look only at those links that
 	// this callback returns; thus we avoid searching the low-AF
@@ -45,6 +45,10 @@ public:
 
 	// Only get incoming sets that are in the attentional focus
 	IncomingSet get_incoming_set(const Handle&);
+	IncomingSet get_incoming_set(const Handle&, Type);
+
+private:
+	IncomingSet af_filter(const IncomingSet&);
 };
 
 } //namespace opencog
@@ -22,19 +22,31 @@
 #ifndef _OPENCOG_BINDLINK_API_H
 #define _OPENCOG_BINDLINK_API_H
 
+#include <string>
+
 #include <opencog/atomspace/Handle.h>
 #include <opencog/truthvalue/TruthValue.h>
 
 namespace opencog {
 
 class AtomSpace;
+class SearchBudget;
+class SearchProfile;
 
 Handle bindlink(AtomSpace*, const Handle&);
 Handle single_bindlink (AtomSpace*, const Handle&);
 Handle af_bindlink(AtomSpace*, const Handle&);
+Handle parallel_bindlink(AtomSpace*, const Handle&);
+HandleSeq bindlink_batch(AtomSpace*, const HandleSeq&);
+Handle bounded_bindlink(AtomSpace*, const Handle&, SearchBudget&);
+Handle profiled_bindlink(AtomSpace*, const Handle&, SearchProfile&);
 TruthValuePtr satisfaction_link(AtomSpace*, const Handle&);
 Handle satisfying_set(AtomSpace*, const Handle&);
+Handle parallel_satisfying_set(AtomSpace*, const Handle&);
+Handle bounded_satisfying_set(AtomSpace*, const Handle&, SearchBudget&);
+Handle profiled_satisfying_set(AtomSpace*, const Handle&, SearchProfile&);
 Handle recognize(AtomSpace*, const Handle&);
+std::string explain_bindlink(AtomSpace*, const Handle&);
 
 } // namespace opencog
 
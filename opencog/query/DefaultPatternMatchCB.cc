@@ -241,8 +241,10 @@ bool DefaultPatternMatchCB::clause_match(const Handle& ptrn,
 		// which seems reasonable, except that everything else in the
 		// default callback ignores the TV on EvaluationLinks. So this
 		// is kind-of schizophrenic here.  Not sure what else to do.
+		std::unique_lock<std::mutex> lck(_temp_mtx);
 		_temp_aspace.clear();
 		TruthValuePtr tvp(EvaluationLink::do_eval_scratch(_as, grnd, &_temp_aspace));
+		lck.unlock();
 
 		LAZY_LOG_FINE << "Clause_match evaluation yeilded tv"
 		              << std::endl << tvp->toString() << std::endl;
@@ -277,6 +279,17 @@ IncomingSet DefaultPatternMatchCB::get_incoming_set(const Handle& h)
 	return h->getIncomingSet(_as);
 }
 
+/// link_match() above rejects any link whose type differs from that
+/// of the pattern, so only the links of that type need be looked at.
+/// The exceptions are the ChoiceLink, which matches anything, and the
+/// quoting links, which do not themselves appear in the groundings.
+IncomingSet DefaultPatternMatchCB::get_incoming_set(const Handle& h, Type t)
+{
+	if (CHOICE_LINK == t or QUOTE_LINK == t or UNQUOTE_LINK == t)
+		return get_incoming_set(h);
+	return h->getIncomingSetByType(t, false, _as);
+}
+
 /* ======================================================== */
 
 bool DefaultPatternMatchCB::eval_term(const Handle& virt,
@@ -289,6 +302,7 @@ bool DefaultPatternMatchCB::eval_term(const Handle& virt,
 	// grounding might be insane.  So we put it here. This is probably
 	// not very efficient, but will do for now...
 
+	std::unique_lock<std::mutex> lck(_temp_mtx);
 	Handle gvirt(_instor.instantiate(virt, gnds));
 
 	LAZY_LOG_FINE << "Enter eval_term CB with virt=" << std::endl
@@ -357,6 +371,7 @@ bool DefaultPatternMatchCB::eval_term(const Handle& virt,
 			return false;
 		}
 	}
+	lck.unlock();
 
 	// Avoid null-pointer dereference if user specified a bogus evaluation.
 	// i.e. an evaluation that failed to return a TV.
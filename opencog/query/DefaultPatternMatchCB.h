@@ -25,6 +25,9 @@
 #ifndef _OPENCOG_DEFAULT_PATTERN_MATCH_H
 #define _OPENCOG_DEFAULT_PATTERN_MATCH_H
 
+#include <atomic>
+#include <mutex>
+
 #include <opencog/atomspace/types.h>
 #include <opencog/atomspace/AtomSpace.h>
 #include <opencog/atoms/execution/Instantiator.h>
@@ -70,6 +73,7 @@ class DefaultPatternMatchCB : public virtual PatternMatchCallback
 		                                   const Handle& grnd);
 
 		virtual IncomingSet get_incoming_set(const Handle&);
+		virtual IncomingSet get_incoming_set(const Handle&, Type);
 
 		/**
 		 * Called when a virtual link is encountered. Returns false
@@ -98,8 +102,11 @@ class DefaultPatternMatchCB : public virtual PatternMatchCallback
 		Handle _pattern_body;
 
 		// Temp atomspace used for test-groundings of virtual links.
+		// The lock guards both of these, so that the evaluatable
+		// terms can be checked during a parallel search.
 		AtomSpace _temp_aspace;
 		Instantiator _instor;
+		std::mutex _temp_mtx;
 
 		// Crisp-logic evaluation of evaluatable terms
 		std::set<Type> _connectives;
@@ -108,7 +115,7 @@ class DefaultPatternMatchCB : public virtual PatternMatchCallback
 		bool eval_sentence(const Handle& pat,
 		             const std::map<Handle,Handle>& gnds);
 
-		bool _optionals_present = false;
+		std::atomic<bool> _optionals_present{false};
 		AtomSpace* _as;
 };
 
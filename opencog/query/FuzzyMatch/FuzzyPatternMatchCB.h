@@ -48,6 +48,12 @@ namespace opencog
 
             virtual bool link_match(const LinkPtr&, const LinkPtr&);
 
+            // Links of all types are accepted, so the whole incoming
+            // set has to be explored.
+            using DefaultPatternMatchCB::get_incoming_set;
+            virtual IncomingSet get_incoming_set(const Handle& h, Type)
+            { return DefaultPatternMatchCB::get_incoming_set(h); }
+
             virtual bool fuzzy_match(const Handle&, const Handle&)
             { return true; }
 
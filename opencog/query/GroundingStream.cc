@@ -0,0 +1,225 @@
+/*
+ * GroundingStream.cc
+ *
+ * Copyright (C) 2015 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <opencog/atomspace/AtomSpace.h>
+#include <opencog/atoms/pattern/BindLink.h>
+
+#include "DefaultImplicator.h"
+#include "GroundingStream.h"
+#include "Satisfier.h"
+
+namespace opencog {
+
+/// Hands each grounded implicand over to the stream, instead of
+/// collecting them.
+class StreamImplicator : public DefaultImplicator
+{
+	GroundingStream* _stream;
+public:
+	bool found;
+	StreamImplicator(AtomSpace* as, GroundingStream* s) :
+		Implicator(as), InitiateSearchCB(as), DefaultPatternMatchCB(as),
+		DefaultImplicator(as), _stream(s), found(false) {}
+
+	virtual bool grounding(const std::map<Handle, Handle> &var_soln,
+	                       const std::map<Handle, Handle> &term_soln)
+	{
+		if (_stream->is_closed()) return true;
+		Implicator::grounding(var_soln, term_soln);
+		return _stream->is_closed();
+	}
+
+	virtual void insert_result(const Handle& h)
+	{
+		if (nullptr == h) return;
+		found = true;
+		_stream->push(h);
+	}
+};
+
+/// Hands each grounding of the variables over to the stream.
+class StreamSatisfier : public SatisfyingSet
+{
+	GroundingStream* _stream;
+public:
+	StreamSatisfier(AtomSpace* as, GroundingStream* s) :
+		InitiateSearchCB(as), DefaultPatternMatchCB(as),
+		SatisfyingSet(as), _stream(s) {}
+
+	virtual bool grounding(const std::map<Handle, Handle> &var_soln,
+	                       const std::map<Handle, Handle> &term_soln)
+	{
+		if (1 == _varseq.size())
+			return not _stream->push(var_soln.at(_varseq[0]));
+
+		// Same as in SatisfyingSet, except that the ListLink goes into
+		// the atomspace right away, as there is no SetLink to hold it.
+		HandleSeq vargnds;
+		for (const Handle& hv : _varseq)
+			vargnds.push_back(var_soln.at(hv));
+		return not _stream->push(_stream->_as->add_link(LIST_LINK, vargnds));
+	}
+};
+
+}
+
+using namespace opencog;
+
+GroundingStream::GroundingStream(AtomSpace* as, const Handle& hlink,
+                                 size_t capacity, bool unique)
+	: _as(as), _is_bind(false), _capacity(std::max((size_t) 1, capacity)),
+	  _unique(unique), _started(false), _finished(false), _closed(false)
+{
+	// The pattern is analysed here, and not in the search thread, so
+	// that a bad pattern throws right away.
+	if (classserver().isA(hlink->getType(), BIND_LINK))
+	{
+		BindLinkPtr bl(BindLinkCast(hlink));
+		if (NULL == bl)
+			bl = createBindLink(*LinkCast(hlink));
+		_pattern = bl;
+		_is_bind = true;
+		return;
+	}
+
+	_pattern = PatternLinkCast(hlink);
+	if (NULL == _pattern)
+	{
+		if (classserver().isA(hlink->getType(), GET_LINK))
+			_pattern = createPatternLink(*LinkCast(hlink));
+		else
+			_pattern = createPatternLink(hlink);
+	}
+}
+
+GroundingStream::~GroundingStream()
+{
+	close();
+}
+
+void GroundingStream::run(void)
+{
+	try
+	{
+		if (_is_bind)
+		{
+			BindLinkPtr bl(BindLinkCast(_pattern));
+			StreamImplicator impl(_as, this);
+			impl.set_budget(&_budget);
+			impl.implicand = bl->get_implicand();
+			bl->imply(impl, false);
+
+			// The search for absent clauses; see result_set() in
+			// Implicator.cc.
+			const Pattern& pat = bl->get_pattern();
+			if (not impl.found and 0 == pat.mandatory.size()
+			    and 0 < pat.optionals.size()
+			    and not impl.optionals_present()
+			    and not _budget.truncated())
+			{
+				std::map<Handle, Handle> empty_map;
+				impl.insert_result(
+					impl.inst.instantiate(impl.implicand, empty_map));
+			}
+		}
+		else
+		{
+			StreamSatisfier sater(_as, this);
+			sater.set_budget(&_budget);
+			_pattern->satisfy(sater);
+		}
+	}
+	catch (...)
+	{
+		std::lock_guard<std::mutex> lck(_mtx);
+		_failure = std::current_exception();
+	}
+
+	std::lock_guard<std::mutex> lck(_mtx);
+	_finished = true;
+	_cv.notify_all();
+}
+
+bool GroundingStream::push(const Handle& h)
+{
+	std::unique_lock<std::mutex> lck(_mtx);
+	if (_closed) return false;
+	if (_unique and not _seen.insert(h).second) return true;
+
+	_cv.wait(lck, [&]{ return _queue.size() < _capacity or _closed; });
+	if (_closed) return false;
+
+	_queue.push_back(h);
+	_cv.notify_all();
+	return true;
+}
+
+bool GroundingStream::is_closed(void)
+{
+	std::lock_guard<std::mutex> lck(_mtx);
+	return _closed;
+}
+
+Handle GroundingStream::next(void)
+{
+	std::unique_lock<std::mutex> lck(_mtx);
+	if (_closed) return Handle::UNDEFINED;
+	if (not _started)
+	{
+		_started = true;
+		_search = std::thread(&GroundingStream::run, this);
+	}
+
+	_cv.wait(lck, [&]{ return not _queue.empty() or _finished; });
+	if (_queue.empty())
+	{
+		if (_failure)
+		{
+			std::exception_ptr failure = _failure;
+			_failure = nullptr;
+			std::rethrow_exception(failure);
+		}
+		return Handle::UNDEFINED;
+	}
+
+	Handle h(_queue.front());
+	_queue.pop_front();
+	_cv.notify_all();
+	return h;
+}
+
+void GroundingStream::close(void)
+{
+	// Cancel first, so that the search winds down, instead of going
+	// on to the next grounding; then wake it up, if it is waiting for
+	// room in the queue.
+	_budget.cancel();
+	{
+		std::lock_guard<std::mutex> lck(_mtx);
+		_closed = true;
+		_queue.clear();
+		_cv.notify_all();
+	}
+	if (_search.joinable()) _search.join();
+}
+
+/* ===================== END OF FILE ===================== */
@@ -0,0 +1,148 @@
+/*
+ * GroundingStream.h
+ *
+ * Copyright (C) 2015 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _OPENCOG_GROUNDING_STREAM_H
+#define _OPENCOG_GROUNDING_STREAM_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <thread>
+
+#include <opencog/atomspace/Handle.h>
+#include <opencog/atoms/pattern/PatternLink.h>
+#include <opencog/query/SearchBudget.h>
+
+namespace opencog {
+
+class AtomSpace;
+
+/**
+ * Pull-based stream of the results of a pattern search.
+ *
+ * For a BindLink, the results are the grounded implicands, exactly as
+ * returned by bindlink(); for a GetLink or SatisfactionLink, they are
+ * the groundings of the variables, exactly as returned by
+ * satisfying_set(), where groundings of more than one variable come
+ * in a ListLink.  Unlike those two, the stream does not gather up all
+ * of the results first, and it does not create a SetLink to hold them:
+ * each result is handed over as soon as it is found.
+ *
+ * The search runs in a thread of its own, started by the first call to
+ * next(); it runs at most `capacity` results ahead of the reader, and
+ * then waits for the reader to catch up.  Closing the stream (or
+ * destroying it) cancels the search, as SearchBudget::cancel() does,
+ * so that it stops soon, even when it is finding nothing.
+ *
+ * The same result is reported again each time that the search finds
+ * it; bindlink() and satisfying_set() merge these, in their SetLink.
+ * If `unique` is set, each result is reported only once; to do so,
+ * the stream holds on to every result handed out so far, until it is
+ * destroyed.  That is as much memory as the SetLink would have taken;
+ * leave it unset for searches with very many results.
+ *
+ * If the search throws, the exception is rethrown by next(), after
+ * the results found before it are read.
+ *
+ * The atomspace may be changed while the stream is being read; the
+ * search may or may not see the changes.
+ *
+ * Example:
+ *
+ *    GroundingStream results(as, bindlink_handle);
+ *    for (const Handle& h : results)
+ *       if (found_what_i_wanted(h)) break;
+ */
+class GroundingStream
+{
+	friend class StreamImplicator;
+	friend class StreamSatisfier;
+
+	AtomSpace* _as;
+	PatternLinkPtr _pattern;
+	bool _is_bind;
+	size_t _capacity;
+	bool _unique;
+	SearchBudget _budget;
+
+	std::thread _search;
+	std::mutex _mtx;
+	std::condition_variable _cv;  // Signalled on every change below.
+	std::deque<Handle> _queue;
+	UnorderedHandleSet _seen;     // Only if _unique.
+	bool _started;
+	bool _finished;
+	bool _closed;
+	std::exception_ptr _failure;
+
+	void run(void);
+
+	// Called by the search; return false if the stream was closed.
+	bool push(const Handle&);
+	bool is_closed(void);
+
+public:
+	GroundingStream(AtomSpace*, const Handle&, size_t capacity = 64,
+	                bool unique = false);
+	GroundingStream(const GroundingStream&) = delete;
+	GroundingStream& operator=(const GroundingStream&) = delete;
+	~GroundingStream();
+
+	/// Return the next result, waiting for it if need be; return the
+	/// undefined handle once there are no more.
+	Handle next(void);
+
+	/// Stop the search; no more results will be returned.
+	void close(void);
+
+	/// Single-pass iteration over the results.
+	class iterator
+		: public std::iterator<std::input_iterator_tag, Handle>
+	{
+		GroundingStream* _stream;
+		Handle _h;
+	public:
+		iterator(GroundingStream* s = nullptr) : _stream(s)
+			{ if (_stream) ++(*this); }
+		const Handle& operator*() const { return _h; }
+		const Handle* operator->() const { return &_h; }
+		iterator& operator++()
+		{
+			_h = _stream->next();
+			if (nullptr == _h) _stream = nullptr;
+			return *this;
+		}
+		bool operator==(const iterator& other) const
+			{ return _stream == other._stream; }
+		bool operator!=(const iterator& other) const
+			{ return _stream != other._stream; }
+	};
+
+	iterator begin(void) { return iterator(this); }
+	iterator end(void) { return iterator(); }
+};
+
+} // namespace opencog
+
+#endif // _OPENCOG_GROUNDING_STREAM_H
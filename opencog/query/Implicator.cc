@@ -21,6 +21,9 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <map>
+#include <memory>
+
 #include <opencog/atomspace/AtomSpace.h>
 #include <opencog/truthvalue/SimpleTruthValue.h>
 #include <opencog/atoms/pattern/BindLink.h>
@@ -45,8 +48,22 @@ bool Implicator::grounding(const std::map<Handle, Handle> &var_soln,
                            const std::map<Handle, Handle> &term_soln)
 {
 	// PatternMatchEngine::print_solution(term_soln,var_soln);
-	Handle h = inst.instantiate(implicand, var_soln);
-	insert_result(h);
+
+	// This may be running in several threads at once (see
+	// InitiateSearchCB::parallel_search()).  The instantiator keeps
+	// some state, so each call uses a copy of its own; the results
+	// are guarded by the lock.  If some other thread has already
+	// found enough, there is no need to instantiate anything.
+	{
+		std::lock_guard<std::mutex> lck(_result_mtx);
+		if (max_results <= _result_set.size()) return true;
+	}
+	Instantiator instor(inst);
+	Handle h = instor.instantiate(implicand, var_soln);
+
+	std::lock_guard<std::mutex> lck(_result_mtx);
+	if (_result_set.size() < max_results)
+		insert_result(h);
 
 	// If we found as many as we want, then stop looking for more.
 	if (_result_set.size() < max_results)
@@ -66,30 +83,10 @@ void Implicator::insert_result(const Handle& h)
 namespace opencog
 {
 
-/**
- * Simplified utility
- *
- * The `do_conn_check` flag stands for "do connectivity check"; if the
- * flag is set, and the pattern is disconnected, then an error will be
- * thrown. The URE explicitly allows disconnected graphs.
- *
- * Set the default to always allow disconnected graphs. This will
- * get naive users into trouble, but there are legit uses, not just
- * in the URE, for doing disconnected searches.
- */
-static Handle do_imply(AtomSpace* as,
-                       const Handle& hbindlink,
-                       Implicator& impl,
-                       bool do_conn_check=false)
+/// Put the results into a SetLink, and return that.
+static Handle result_set(AtomSpace* as, const BindLinkPtr& bl,
+                         Implicator& impl)
 {
-	BindLinkPtr bl(BindLinkCast(hbindlink));
-	if (NULL == bl)
-		bl = createBindLink(*LinkCast(hbindlink));
-
-	impl.implicand = bl->get_implicand();
-
-	bl->imply(impl, do_conn_check);
-
 	if (0 < impl.get_result_list().size())
 	{
 		// The result_list contains a list of the grounded expressions.
@@ -109,12 +106,15 @@ static Handle do_imply(AtomSpace* as,
 	//
 	// Theoretical background: the atomspace can be thought of as a
 	// Kripke frame: it holds everything we know "right now". The
-	// AbsentLink is a check for what we don't know, right now.
+	// AbsentLink is a check for what we don't know, right now. If the
+	// search was cut short, we don't know that either.
 	const Pattern& pat = bl->get_pattern();
 	DefaultPatternMatchCB* intu =
 		dynamic_cast<DefaultPatternMatchCB*>(&impl);
+	SearchBudget* budget = impl.get_budget();
 	if (0 == pat.mandatory.size() and 0 < pat.optionals.size()
-	    and not intu->optionals_present())
+	    and not intu->optionals_present()
+	    and not (budget and budget->truncated()))
 	{
 		std::map<Handle, Handle> empty_map;
 		Handle h = impl.inst.instantiate(impl.implicand, empty_map);
@@ -124,6 +124,33 @@ static Handle do_imply(AtomSpace* as,
 	return as->add_link(SET_LINK, impl.get_result_list());
 }
 
+/**
+ * Simplified utility
+ *
+ * The `do_conn_check` flag stands for "do connectivity check"; if the
+ * flag is set, and the pattern is disconnected, then an error will be
+ * thrown. The URE explicitly allows disconnected graphs.
+ *
+ * Set the default to always allow disconnected graphs. This will
+ * get naive users into trouble, but there are legit uses, not just
+ * in the URE, for doing disconnected searches.
+ */
+static Handle do_imply(AtomSpace* as,
+                       const Handle& hbindlink,
+                       Implicator& impl,
+                       bool do_conn_check=false)
+{
+	BindLinkPtr bl(BindLinkCast(hbindlink));
+	if (NULL == bl)
+		bl = createBindLink(*LinkCast(hbindlink));
+
+	impl.implicand = bl->get_implicand();
+
+	bl->imply(impl, do_conn_check);
+
+	return result_set(as, bl, impl);
+}
+
 /**
  * Evaluate a pattern and rewrite rule embedded in a BindLink
  *
@@ -141,6 +168,35 @@ Handle bindlink(AtomSpace* as, const Handle& hbindlink)
 	return do_imply(as, hbindlink, impl);
 }
 
+/**
+ * Same as bindlink() above, but the search stops once the budget is
+ * used up, or cancelled; see SearchBudget.h.  The results found until
+ * then are returned; budget.truncated() tells if there might be more.
+ */
+Handle bounded_bindlink(AtomSpace* as, const Handle& hbindlink,
+                        SearchBudget& budget)
+{
+	DefaultImplicator impl(as);
+	impl.set_budget(&budget);
+	budget.start();
+	return do_imply(as, hbindlink, impl);
+}
+
+/**
+ * Same as bindlink() above, but count what the search does, and how
+ * long it takes; see SearchProfile.h.
+ */
+Handle profiled_bindlink(AtomSpace* as, const Handle& hbindlink,
+                         SearchProfile& profile)
+{
+	DefaultImplicator impl(as);
+	impl.set_profile(&profile);
+	profile.start();
+	Handle result(do_imply(as, hbindlink, impl));
+	profile.stop();
+	return result;
+}
+
 /**
  * Evaluate an pattern and rewrite rule embedded in a BindLink
  *
@@ -167,6 +223,116 @@ Handle af_bindlink(AtomSpace* as, const Handle& hbindlink)
 	return do_imply(as, hbindlink, impl, false);
 }
 
+/**
+ * Evaluate a pattern and rewrite rule embedded in a BindLink
+ *
+ * Identical to bindlink() above, except that the candidate groundings
+ * are explored with one thread per CPU core.  This pays off for
+ * patterns whose search starts at an atom with a very large incoming
+ * set; small searches are run in a single thread anyway.
+ */
+Handle parallel_bindlink(AtomSpace* as, const Handle& hbindlink)
+{
+	// Now perform the search.
+	DefaultImplicator impl(as);
+	impl.set_num_threads(0);
+	return do_imply(as, hbindlink, impl);
+}
+
+/**
+ * Evaluate many BindLinks together, sharing the scans of the incoming
+ * sets that their searches start at.
+ *
+ * The results are the same as those of calling bindlink() on each in
+ * turn, one SetLink per BindLink, in the same order. But where two or
+ * more searches start at the same atom (which is common for rules
+ * specialized to the same source, or for queries about a hub atom),
+ * its incoming set is fetched and walked only once, and each candidate
+ * is handed to all of the searches that want it.  Searches that do
+ * not start at an atom (e.g. those whose clauses are all variables, or
+ * with several components) are run one by one, as usual.
+ */
+HandleSeq bindlink_batch(AtomSpace* as, const HandleSeq& hbindlinks)
+{
+	struct Query
+	{
+		BindLinkPtr bl;
+		std::unique_ptr<DefaultImplicator> impl;
+		std::unique_ptr<PatternMatchEngine> pme;
+	};
+	struct Member
+	{
+		size_t query;
+		Handle clause;
+		Handle term;
+	};
+
+	HandleSeq results(hbindlinks.size());
+	std::vector<Query> queries(hbindlinks.size());
+	std::map<std::pair<Handle, Type>, std::vector<Member>> scans;
+
+	for (size_t i = 0; i < hbindlinks.size(); i++)
+	{
+		Query& q = queries[i];
+		q.bl = BindLinkCast(hbindlinks[i]);
+		if (NULL == q.bl)
+			q.bl = createBindLink(*LinkCast(hbindlinks[i]));
+
+		std::vector<InitiateSearchCB::Start> starts;
+		if (q.bl->get_component_patterns().empty())
+		{
+			q.impl.reset(new DefaultImplicator(as));
+			q.impl->implicand = q.bl->get_implicand();
+			q.pme.reset(new PatternMatchEngine(*q.impl));
+			q.pme->set_pattern(q.bl->get_variables(), q.bl->get_pattern());
+			q.impl->set_pattern(q.bl->get_variables(), q.bl->get_pattern());
+			q.impl->get_starts(q.pme.get(), starts);
+		}
+
+		if (starts.empty())
+		{
+			q.pme.reset();
+			results[i] = bindlink(as, hbindlinks[i]);
+			continue;
+		}
+
+		for (const InitiateSearchCB::Start& st : starts)
+			scans[{st.atom, st.link_type}].push_back({i, st.clause, st.term});
+	}
+
+	std::vector<bool> done(queries.size(), false);
+	for (const auto& scan : scans)
+	{
+		const std::vector<Member>& members = scan.second;
+		const Handle& start = scan.first.first;
+		Type t = scan.first.second;
+
+		DefaultImplicator& impl = *queries[members[0].query].impl;
+		IncomingSet iset = (NOTYPE == t) ?
+			impl.get_incoming_set(start) : impl.get_incoming_set(start, t);
+
+		for (const LinkPtr& lp : iset)
+		{
+			Handle h(lp);
+			for (const Member& m : members)
+			{
+				if (done[m.query]) continue;
+				if (queries[m.query].pme->explore_neighborhood(m.clause, m.term, h))
+					done[m.query] = true;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < queries.size(); i++)
+	{
+		Query& q = queries[i];
+		if (nullptr == q.pme) continue;
+		q.impl->search_finished(done[i]);
+		results[i] = result_set(as, q.bl, *q.impl);
+	}
+	return results;
+}
+
 }
 
 /* ===================== END OF FILE ===================== */
@@ -24,6 +24,7 @@
 #ifndef _OPENCOG_IMPLICATOR_H
 #define _OPENCOG_IMPLICATOR_H
 
+#include <mutex>
 #include <vector>
 
 #include <opencog/atomspace/AtomSpace.h>
@@ -58,6 +59,10 @@ class Implicator :
 		UnorderedHandleSet _result_set;
 		HandleSeq _result_list;
 
+		// Guards the results; a parallel search reports groundings
+		// from several threads at once.
+		std::mutex _result_mtx;
+
 	public:
 		Implicator(AtomSpace* as) : inst(as), max_results(SIZE_MAX) {}
 		Instantiator inst;
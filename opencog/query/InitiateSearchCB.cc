@@ -21,6 +21,15 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
 #include <opencog/atomspace/AtomSpace.h>
 
 #include <opencog/atoms/core/DefineLink.h>
@@ -35,6 +44,10 @@
 
 using namespace opencog;
 
+// Searches with fewer candidates than this are not worth splitting
+// up among threads; each thread gets at least this many.
+static const size_t PARALLEL_MIN_CANDIDATES = 64;
+
 /* ======================================================== */
 
 InitiateSearchCB::InitiateSearchCB(AtomSpace* as) :
@@ -43,10 +56,19 @@ InitiateSearchCB::InitiateSearchCB(AtomSpace* as) :
 	_pattern(NULL),
 	_type_restrictions(NULL),
 	_dynamic(NULL),
+	_num_threads(1),
+	_budget(nullptr),
+	_profile(nullptr),
 	_as(as)
 {
 }
 
+void InitiateSearchCB::set_num_threads(size_t n)
+{
+	if (0 == n) n = std::thread::hardware_concurrency();
+	_num_threads = std::max((size_t) 1, n);
+}
+
 void InitiateSearchCB::set_pattern(const Variables& vars,
                                    const Pattern& pat)
 {
@@ -171,6 +193,13 @@ InitiateSearchCB::find_starter_recursive(const Handle& h, size_t& depth,
 
 		Handle s(find_starter_recursive(hunt, brdepth, sbr, brwid));
 
+		// A constant node will be searched from only through links of
+		// the same type as this one; count just those.  This is cheap,
+		// as the incoming set is kept partitioned by type.
+		if (s == hunt and CHOICE_LINK != t and QUOTE_LINK != t
+		    and UNQUOTE_LINK != t)
+			brwid = hunt->getIncomingSetSizeByType(t);
+
 		if (s)
 		{
 			// Each ChoiceLink is potentially disconnected from the rest
@@ -204,6 +233,13 @@ InitiateSearchCB::find_starter_recursive(const Handle& h, size_t& depth,
  * Iterate over all the clauses, to find the "thinnest" one.
  * Skip any/all evaluatable clauses, as these typically do not
  * exist in the atomspace, anyway.
+ *
+ * Each clause that could be started with is then weighed by the
+ * estimated cost of grounding all of the clauses, starting there
+ * (see QueryPlanner); the cheapest wins. The thinnest start is not
+ * always the cheapest: a thin start that joins up with a clause that
+ * fans out can cost far more than a somewhat thicker one that joins
+ * up with a filter.  The plan for the winner is kept in _plan.
  */
 Handle InitiateSearchCB::find_thinnest(const HandleSeq& clauses,
                                        const std::set<Handle>& evl,
@@ -212,10 +248,23 @@ Handle InitiateSearchCB::find_thinnest(const HandleSeq& clauses,
 {
 	size_t thinnest = SIZE_MAX;
 	size_t deepest = 0;
+	double cheapest = DBL_MAX;
 	bestclause = 0;
 	Handle best_start(Handle::UNDEFINED);
 	starter_term = Handle::UNDEFINED;
 	_choices.clear();
+	_plan.clear();
+
+	// The evaluatables are grounded last, no matter what; only the
+	// other clauses get planned.
+	HandleSeq fixed;
+	for (const Handle& h : clauses)
+		if (0 == evl.count(h)) fixed.push_back(h);
+
+	// Without an atomspace, there are no statistics to plan with.
+	std::unique_ptr<QueryPlanner> planner;
+	if (_as) planner.reset(new QueryPlanner(_as, *_variables));
+	QueryPlanner::Plan plan;
 
 	size_t nc = clauses.size();
 	for (size_t i=0; i < nc; i++)
@@ -229,21 +278,43 @@ Handle InitiateSearchCB::find_thinnest(const HandleSeq& clauses,
 		size_t width = SIZE_MAX;
 		Handle term(Handle::UNDEFINED);
 		Handle start(find_starter(h, depth, term, width));
-		if (start != nullptr
-		    and (width < thinnest
-		         or (width == thinnest and depth > deepest)))
+		if (nullptr == start) continue;
+
+		double cost = 0.0;
+		if (planner) cost = planner->plan(fixed, h, width, plan);
+		if (cost < cheapest
+		    or (cost == cheapest
+		        and (width < thinnest
+		             or (width == thinnest and depth > deepest))))
 		{
+			cheapest = cost;
 			thinnest = width;
 			deepest = depth;
 			bestclause = i;
 			best_start = start;
 			starter_term = term;
+			_plan.swap(plan);
 		}
 	}
 
 	return best_start;
 }
 
+/// The clauses that the search may start with. Sometimes, the number
+/// of mandatory clauses can be zero... or they might all be
+/// evaluatable.  In this case, its OK to start searching with an
+/// optional clause. But if there ARE mandatories, we must NOT start
+/// search on an optional, since, after all, it might be absent!
+const HandleSeq& InitiateSearchCB::start_clauses(void)
+{
+	for (const Handle& m : _pattern->mandatory)
+	{
+		if (0 == _pattern->evaluatable_holders.count(m))
+			return _pattern->mandatory;
+	}
+	return _pattern->cnf_clauses;
+}
+
 /* ======================================================== */
 /**
  * Given a set of clauses, find a neighborhood to search, and perform
@@ -266,23 +337,69 @@ Handle InitiateSearchCB::find_thinnest(const HandleSeq& clauses,
  */
 bool InitiateSearchCB::neighbor_search(PatternMatchEngine *pme)
 {
-	// Sometimes, the number of mandatory clauses can be zero...
-	// or they might all be evaluatable.  In this case, its OK to
-	// start searching with an optional clause. But if there ARE
-	// mandatories, we must NOT start serch on an optional, since,
-	// after all, it might be absent!
-	bool try_all = true;
-	for (const Handle& m : _pattern->mandatory)
+	if (not choose_starts(pme))
 	{
-		if (0 == _pattern->evaluatable_holders.count(m))
+		_search_fail = true;
+		return false;
+	}
+
+	const HandleSeq& clauses = start_clauses();
+	for (const Choice& ch : _choices)
+	{
+		Handle best_start = ch.best_start;
+		_starter_term = ch.start_term;
+
+		_root = clauses[ch.clause];
+		LAZY_LOG_FINE << "Search start node: " << best_start->toShortString();
+		LAZY_LOG_FINE << "Start term is: "
+		              << (_starter_term == nullptr ?
+		                  "UNDEFINED" : _starter_term->toShortString());
+		LAZY_LOG_FINE << "Root clause is: " <<  _root->toShortString();
+
+		// This should be calling the over-loaded virtual method
+		// get_incoming_set(), so that, e.g. it gets sorted by attentional
+		// focus in the AttentionalFocusCB class...  If the start term
+		// is a link above the start node, then only links of its type
+		// can be candidates.
+		IncomingSet iset;
+		if (_starter_term and _starter_term != best_start)
+			iset = get_incoming_set(best_start, _starter_term->getType());
+		else
+			iset = get_incoming_set(best_start);
+		size_t sz = iset.size();
+		if (1 < _num_threads and PARALLEL_MIN_CANDIDATES <= sz)
 		{
-			try_all = false;
-			break;
+			HandleSeq cands(iset.begin(), iset.end());
+			if (parallel_search(pme, cands)) return true;
+			continue;
+		}
+		for (size_t i = 0; i < sz; i++)
+		{
+			Handle h(iset[i]);
+			LAZY_LOG_FINE << "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx\n"
+			              << "Loop candidate (" << i+1 << "/" << sz << "):\n"
+			              << h->toShortString();
+			bool found = pme->explore_neighborhood(_root, _starter_term, h);
+
+			// Terminate search if satisfied.
+			if (found) return true;
+			if (out_of_budget()) return false;
 		}
 	}
 
-	const HandleSeq& clauses =
-		try_all ?  _pattern->cnf_clauses :  _pattern->mandatory;
+	// If we are here, we have searched the entire neighborhood, and
+	// no satisfiable groundings were found.
+	return false;
+}
+
+/**
+ * Pick the atoms that the neighbor search starts at, and the clause
+ * order, for neighbor_search() above. Return false if there is no
+ * atom to start at.
+ */
+bool InitiateSearchCB::choose_starts(PatternMatchEngine *pme)
+{
+	const HandleSeq& clauses = start_clauses();
 
 	// In principle, we could start our search at some node, any node,
 	// that is not a variable. In practice, the search begins by
@@ -306,12 +423,9 @@ bool InitiateSearchCB::neighbor_search(PatternMatchEngine *pme)
 	// Somewhat unusual, but it can happen.  For this, we need
 	// some other, alternative search strategy.
 	if (nullptr == best_start and 0 == _choices.size())
-	{
-		_search_fail = true;
 		return false;
-	}
 
-	// If only a single choice, fake it for the loop below.
+	// If only a single choice, fake it for the loop in the caller.
 	if (0 == _choices.size())
 	{
 		Choice ch;
@@ -325,40 +439,77 @@ bool InitiateSearchCB::neighbor_search(PatternMatchEngine *pme)
 		// TODO -- weed out duplicates!
 	}
 
+	// Ground the other clauses in the order planned for; the plan is
+	// for the best start, but the order holds up for the other
+	// choices, too.
+	_clause_rank.clear();
+	for (size_t i = 0; i < _plan.size(); i++)
+		_clause_rank[_plan[i].clause] = i;
+	pme->set_clause_order(_clause_rank);
+	return true;
+}
+
+bool InitiateSearchCB::get_starts(PatternMatchEngine *pme,
+                                  std::vector<Start>& starts)
+{
+	jit_analyze(pme);
+	if (not choose_starts(pme)) return false;
+
+	const HandleSeq& clauses = start_clauses();
 	for (const Choice& ch : _choices)
 	{
-		bestclause = ch.clause;
-		best_start = ch.best_start;
-		_starter_term = ch.start_term;
-
-		_root = clauses[bestclause];
-		LAZY_LOG_FINE << "Search start node: " << best_start->toShortString();
-		LAZY_LOG_FINE << "Start term is: "
-		              << (_starter_term == nullptr ?
-		                  "UNDEFINED" : _starter_term->toShortString());
-		LAZY_LOG_FINE << "Root clause is: " <<  _root->toShortString();
+		Start st;
+		st.clause = clauses[ch.clause];
+		st.term = ch.start_term;
+		st.atom = ch.best_start;
+		st.link_type = NOTYPE;
+		if (ch.start_term and ch.start_term != ch.best_start)
+			st.link_type = ch.start_term->getType();
+		starts.push_back(st);
+	}
+	return true;
+}
 
-		// This should be calling the over-loaded virtual method
-		// get_incoming_set(), so that, e.g. it gets sorted by attentional
-		// focus in the AttentionalFocusCB class...
-		IncomingSet iset = get_incoming_set(best_start);
-		size_t sz = iset.size();
-		for (size_t i = 0; i < sz; i++)
-		{
-			Handle h(iset[i]);
-			LAZY_LOG_FINE << "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx\n"
-			              << "Loop candidate (" << i+1 << "/" << sz << "):\n"
-			              << h->toShortString();
-			bool found = pme->explore_neighborhood(_root, _starter_term, h);
+/* ======================================================== */
+/**
+ * Describe the search that neighbor_search() would make, without
+ * making it. This is meant for people, not for programs; the format
+ * of the text may change at any time.
+ */
+std::string InitiateSearchCB::explain(void)
+{
+	std::stringstream ss;
+	if (0 < _pattern->defined_terms.size())
+		ss << "The pattern holds definitions; this is the plan for the "
+		      "pattern before they are expanded.\n";
 
-			// Terminate search if satisfied.
-			if (found) return true;
-		}
+	const HandleSeq& clauses = start_clauses();
+	size_t bestclause;
+	Handle starter_term;
+	Handle best_start = find_thinnest(clauses, _pattern->evaluatable_holders,
+	                                  starter_term, bestclause);
+	if (nullptr == best_start and 0 == _choices.size())
+	{
+		ss << "No constant to start from; the search will loop over "
+		      "all atoms of some type.\n";
+		return ss.str();
 	}
 
-	// If we are here, we have searched the entire neighborhood, and
-	// no satisfiable groundings were found.
-	return false;
+	if (0 < _choices.size())
+		ss << "Start at each of " << _choices.size()
+		   << " alternatives of a ChoiceLink.\n";
+	else
+		ss << "Start at " << best_start->toShortString()
+		   << "in clause " << bestclause+1 << " of " << clauses.size()
+		   << ".\n";
+	ss << QueryPlanner::to_string(_plan);
+
+	size_t nevl = _pattern->evaluatable_holders.size();
+	size_t nopt = _pattern->optionals.size();
+	if (0 < nevl or 0 < nopt)
+		ss << "Then the " << nevl << " evaluatable and the " << nopt
+		   << " optional clauses.\n";
+	return ss.str();
 }
 
 /* ======================================================== */
@@ -454,6 +605,10 @@ bool InitiateSearchCB::initiate_search(PatternMatchEngine *pme)
 {
 	jit_analyze(pme);
 
+	// Only the neighbor search has a plan.
+	_clause_rank.clear();
+	pme->set_clause_order(_clause_rank);
+
 	logger().fine("Attempt to use node-neighbor search");
 	_search_fail = false;
 	bool found = neighbor_search(pme);
@@ -587,6 +742,8 @@ bool InitiateSearchCB::link_type_search(PatternMatchEngine *pme)
 	_as->get_handles_by_type(handle_set, ptype);
 
 	size_t i = 0, hsz = handle_set.size();
+	if (1 < _num_threads and PARALLEL_MIN_CANDIDATES <= hsz)
+		return parallel_search(pme, handle_set);
 	for (const Handle& h : handle_set)
 	{
 		LAZY_LOG_FINE << "yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy\n"
@@ -594,6 +751,7 @@ bool InitiateSearchCB::link_type_search(PatternMatchEngine *pme)
 		              << h->toShortString();
 		bool found = pme->explore_neighborhood(_root, _starter_term, h);
 		if (found) return true;
+		if (out_of_budget()) return false;
 	}
 	return false;
 }
@@ -695,6 +853,8 @@ bool InitiateSearchCB::variable_search(PatternMatchEngine *pme)
 	LAZY_LOG_FINE << "Atomspace reported " << handle_set.size() << " atoms";
 
 	size_t i = 0, hsz = handle_set.size();
+	if (1 < _num_threads and PARALLEL_MIN_CANDIDATES <= hsz)
+		return parallel_search(pme, handle_set);
 	for (const Handle& h : handle_set)
 	{
 		LAZY_LOG_FINE << "zzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzz\n"
@@ -702,11 +862,83 @@ bool InitiateSearchCB::variable_search(PatternMatchEngine *pme)
 		              << h->toShortString();
 		bool found = pme->explore_neighborhood(_root, _starter_term, h);
 		if (found) return true;
+		if (out_of_budget()) return false;
 	}
 
 	return false;
 }
 
+/* ======================================================== */
+/**
+ * Explore the neighborhood of each of the candidate groundings of the
+ * starter term, using several threads.  The candidates are handed out
+ * in small chunks from a shared counter; a thread that is done with
+ * its chunk grabs the next one, so that a few expensive candidates do
+ * not leave the other threads idle.  The calling thread works along,
+ * with the engine it was given; each of the others gets an engine of
+ * its own, as the engine holds the state of the search.
+ *
+ * As with the serial loops, the search stops as soon as some thread
+ * is told to stop by the grounding() callback, e.g. because it has
+ * found max_results groundings.  The other threads stop after the
+ * candidate they are currently on.
+ */
+bool InitiateSearchCB::parallel_search(PatternMatchEngine *pme,
+                                       const HandleSeq& cands)
+{
+	size_t nthreads = std::min(_num_threads,
+	                           cands.size() / PARALLEL_MIN_CANDIDATES);
+	size_t chunk = std::max((size_t) 1, cands.size() / (16 * nthreads));
+
+	LAZY_LOG_FINE << "Parallel search over " << cands.size()
+	              << " candidates with " << nthreads << " threads";
+
+	std::atomic<size_t> next(0);
+	std::atomic<bool> found(false);
+	std::exception_ptr failure;
+	std::mutex failure_mtx;
+
+	auto worker = [&](PatternMatchEngine* eng)
+	{
+		try
+		{
+			while (not found and not out_of_budget())
+			{
+				size_t i = next.fetch_add(chunk);
+				if (cands.size() <= i) break;
+				size_t end = std::min(i + chunk, cands.size());
+				for (; i < end and not found; i++)
+				{
+					if (eng->explore_neighborhood(_root, _starter_term,
+					                              cands[i]))
+						found = true;
+				}
+			}
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lck(failure_mtx);
+			if (not failure) failure = std::current_exception();
+			found = true;
+		}
+	};
+
+	std::vector<std::unique_ptr<PatternMatchEngine>> engines;
+	std::vector<std::thread> threads;
+	for (size_t t = 1; t < nthreads; t++)
+	{
+		engines.emplace_back(new PatternMatchEngine(*this));
+		engines.back()->set_pattern(*_variables, *_pattern);
+		engines.back()->set_clause_order(_clause_rank);
+		threads.push_back(std::thread(worker, engines.back().get()));
+	}
+	worker(pme);
+	for (std::thread& t : threads) t.join();
+
+	if (failure) std::rethrow_exception(failure);
+	return found;
+}
+
 /* ======================================================== */
 /**
  * No search -- no variables, one evaluatable clause.
@@ -29,6 +29,7 @@
 #include <opencog/atoms/pattern/PatternLink.h>
 #include <opencog/query/PatternMatchCallback.h>
 #include <opencog/query/PatternMatchEngine.h>
+#include <opencog/query/QueryPlanner.h>
 
 namespace opencog {
 
@@ -54,6 +55,58 @@ public:
 	virtual void set_pattern(const Variables&, const Pattern&);
 	virtual bool initiate_search(PatternMatchEngine *);
 
+	/**
+	 * Search with the given number of threads; zero means one per
+	 * CPU core. The default is to use a single thread. With more than
+	 * one, the candidate groundings of the starting term are explored
+	 * in parallel, each thread with a PatternMatchEngine of its own,
+	 * while all of them share this callback object. Thus, the
+	 * callbacks must be thread-safe; the grounding() callbacks of the
+	 * Implicator and the SatisfyingSet are.
+	 */
+	void set_num_threads(size_t);
+
+	/**
+	 * Limit the search; see SearchBudget.h. The budget is not owned
+	 * by the callback, and must outlive the search.
+	 */
+	void set_budget(SearchBudget* b) { _budget = b; }
+	virtual SearchBudget* get_budget(void) { return _budget; }
+
+	/**
+	 * Count what the search does; see SearchProfile.h. The profile is
+	 * not owned by the callback, and must outlive the search.
+	 */
+	void set_profile(SearchProfile* p) { _profile = p; }
+	virtual SearchProfile* get_profile(void) { return _profile; }
+
+	/**
+	 * Describe how the search would proceed: where it would start,
+	 * and the order in which the clauses would be grounded, with the
+	 * estimated costs. Nothing is searched. The pattern must have
+	 * been set.
+	 */
+	std::string explain(void);
+
+	/**
+	 * Where the neighbor search would start: the clause, the term in
+	 * it, and the atom that the term is grounded by; the candidates
+	 * are the links in the incoming set of that atom, of the given
+	 * type, else of any type. This is for running several searches
+	 * together, so that each incoming set is fetched only once; see
+	 * bindlink_batch(). The candidates are then handed to
+	 * PatternMatchEngine::explore_neighborhood(). Return false if the
+	 * search cannot start at an atom, and has to be run by itself.
+	 */
+	struct Start
+	{
+		Handle clause;
+		Handle term;
+		Handle atom;
+		Type link_type;
+	};
+	bool get_starts(PatternMatchEngine *, std::vector<Start>&);
+
 protected:
 
 	ClassServer& _classserver;
@@ -78,6 +131,11 @@ protected:
 	size_t _curr_clause;
 	std::vector<Choice> _choices;
 
+	// The plan for the chosen start, and the rank of each clause in it.
+	QueryPlanner::Plan _plan;
+	std::map<Handle, size_t> _clause_rank;
+	const HandleSeq& start_clauses(void);
+
 	virtual Handle find_starter(const Handle&, size_t&, Handle&, size_t&);
 	virtual Handle find_starter_recursive(const Handle&, size_t&, Handle&,
 	                                      size_t&);
@@ -88,11 +146,19 @@ protected:
 	                         int quotation_level = 0);
 
 	bool _search_fail;
+	bool choose_starts(PatternMatchEngine *);
 	virtual bool neighbor_search(PatternMatchEngine *);
 	virtual bool link_type_search(PatternMatchEngine *);
 	virtual bool variable_search(PatternMatchEngine *);
 	virtual bool no_search(PatternMatchEngine *);
 
+	size_t _num_threads;
+	SearchBudget* _budget;
+	SearchProfile* _profile;
+	bool out_of_budget(void) const
+		{ return _budget and _budget->is_stopped(); }
+	bool parallel_search(PatternMatchEngine *, const HandleSeq&);
+
 	AtomSpace *_as;
 };
 
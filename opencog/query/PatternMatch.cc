@@ -78,6 +78,9 @@ class PMCGroundings : public PatternMatchCallback
 		IncomingSet get_incoming_set(const Handle& h) {
 			return _cb.get_incoming_set(h);
 		}
+		IncomingSet get_incoming_set(const Handle& h, Type t) {
+			return _cb.get_incoming_set(h, t);
+		}
 		void push(void) { _cb.push(); }
 		void pop(void) { _cb.pop(); }
 		void set_pattern(const Variables& vars,
@@ -96,6 +99,16 @@ class PMCGroundings : public PatternMatchCallback
 			return _cb.search_finished(done);
 		}
 
+		SearchBudget* get_budget(void)
+		{
+			return _cb.get_budget();
+		}
+
+		SearchProfile* get_profile(void)
+		{
+			return _cb.get_profile();
+		}
+
 		// This one we don't pass through. Instead, we collect the
 		// groundings.
 		bool grounding(const std::map<Handle, Handle> &var_soln,
@@ -176,13 +189,19 @@ bool PatternMatch::recursive_virtual(PatternMatchCallback& cb,
 			// in the Arg atoms. So, we ground the args, and pass that
 			// to the callback.
 
-			bool match = cb.evaluate_sentence(virt, var_gnds);
+			bool match;
+			{
+				SearchProfile::Timer t(cb.get_profile(),
+				                       SearchProfile::EVALUATIONS);
+				match = cb.evaluate_sentence(virt, var_gnds);
+			}
 
 			if (not match) return false;
 		}
 
 		// Yay! We found one! We now have a fully and completely grounded
 		// pattern! See what the callback thinks of it.
+		SearchProfile::Timer t(cb.get_profile(), SearchProfile::GROUNDINGS);
 		return cb.grounding(var_gnds, term_gnds);
 	}
 	LAZY_LOG_FINE << "Component recursion: num comp=" << comp_var_gnds.size();
@@ -201,9 +220,12 @@ bool PatternMatch::recursive_virtual(PatternMatchCallback& cb,
 	std::vector<std::map<Handle, Handle>> pg = comp_term_gnds.back();
 	comp_term_gnds.pop_back();
 
+	SearchBudget* budget = cb.get_budget();
 	size_t ngnds = vg.size();
 	for (size_t i=0; i<ngnds; i++)
 	{
+		if (budget and budget->check()) return false;
+
 		// Given a set of groundings, tack on those for this component,
 		// and recurse, with one less component. We need to make a copy,
 		// of course.
@@ -389,11 +411,14 @@ bool PatternLink::satisfy(PatternMatchCallback& pmcb) const
 		clp->satisfy(gcb);
 
 		// Special handling for disconnected pure optionals -- Returns false to
-		// end the search if this disconnected pure optional is found
+		// end the search if this disconnected pure optional is found,
+		// or if the search for it was cut short.
 		if (is_pure_optional)
 		{
 			DefaultPatternMatchCB* dpmcb = dynamic_cast<DefaultPatternMatchCB*>(&pmcb);
 			if (dpmcb->optionals_present()) return false;
+			if (pmcb.get_budget() and pmcb.get_budget()->is_stopped())
+				return false;
 		}
 		else
 		{
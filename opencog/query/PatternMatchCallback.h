@@ -33,6 +33,8 @@
 
 namespace opencog {
 class PatternMatchEngine;
+class SearchBudget;
+class SearchProfile;
 
 /**
  * Callback interface, used to implement specifics of hypergraph
@@ -251,6 +253,20 @@ class PatternMatchCallback
 			return h->getIncomingSet();
 		}
 
+		/**
+		 * Same as above, except that the caller is only interested in
+		 * those links in the incoming set that might match a pattern
+		 * term of type t. Callbacks whose link_match() rejects links of
+		 * any other type can return just the links of type t, which,
+		 * for atoms with large, mixed incoming sets, is a great deal
+		 * cheaper. The default returns the whole incoming set, as
+		 * given by the method above.
+		 */
+		virtual IncomingSet get_incoming_set(const Handle& h, Type t)
+		{
+			return get_incoming_set(h);
+		}
+
 		/**
 		 * Called after a top-level clause (tree) has been fully
 		 * grounded. This gives the callee the opportunity to save
@@ -284,6 +300,18 @@ class PatternMatchCallback
 		 */
 		virtual bool initiate_search(PatternMatchEngine *) = 0;
 
+		/**
+		 * The limits on the search, if any; see SearchBudget.h. The
+		 * engine gives up on the search once they are used up.
+		 */
+		virtual SearchBudget* get_budget(void) { return nullptr; }
+
+		/**
+		 * Where to count what the search does, if anywhere; see
+		 * SearchProfile.h.
+		 */
+		virtual SearchProfile* get_profile(void) { return nullptr; }
+
 		/**
 		 * Called when the search has completed. In principle, this is not
 		 * really needed, since the above callback "knows" when the search
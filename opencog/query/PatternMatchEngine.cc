@@ -21,6 +21,9 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <algorithm>
+#include <cstdint>
+
 #include <opencog/util/oc_assert.h>
 #include <opencog/util/Logger.h>
 #include <opencog/atomutils/FindUtils.h>
@@ -43,12 +46,6 @@ using namespace opencog;
  */
 /* ======================================================== */
 
-// The macro POPSTK has an OC_ASSERT when DEBUG is defined, so we keep
-// that #define around, although it's not clear why that OC_ASSERT
-// wouldn't be kept no matter what (it's not like it's gonna take up a
-// lot of resources).
-// #define DEBUG
-
 static inline bool log(const Handle& h)
 {
 	LAZY_LOG_FINE << h->toShortString();
@@ -71,23 +68,6 @@ static inline void logmsg(const char * msg, const Handle& h)
 // Undefine this to experiment. See also the unit tests.
 #define NO_SELF_GROUNDING 1
 
-/* Reset the current variable grounding to the last grounding pushed
- * onto the stack. */
-#ifdef DEBUG
-   #define POPSTK(stack,soln) {         \
-      OC_ASSERT(not stack.empty(),      \
-           "Unbalanced stack " #stack); \
-      soln = stack.top();               \
-      stack.pop();                      \
-   }
-#else
-   #define POPSTK(stack,soln) {         \
-      soln = stack.top();               \
-      stack.pop();                      \
-   }
-#endif
-
-/* ======================================================== */
 
 /// Compare a VariableNode in the pattern to the proposed grounding.
 ///
@@ -152,7 +132,7 @@ bool PatternMatchEngine::variable_compare(const Handle& hp,
 	LAZY_LOG_FINE << "Found grounding of variable:";
 	logmsg("$$ variable:", hp);
 	logmsg("$$ ground term:", hg);
-	if (hp != hg and hp->getType() != GLOB_NODE) var_grounding[hp] = hg;
+	if (hp != hg and hp->getType() != GLOB_NODE) var_trail.set(hp, hg);
 	return true;
 }
 
@@ -189,7 +169,7 @@ bool PatternMatchEngine::node_compare(const Handle& hp,
 		LAZY_LOG_FINE << "Found matching nodes";
 		logmsg("# pattern:", hp);
 		logmsg("# match:", hg);
-		if (hp != hg) var_grounding[hp] = hg;
+		if (hp != hg) var_trail.set(hp, hg);
 	}
 	return match;
 }
@@ -203,11 +183,10 @@ bool PatternMatchEngine::ordered_compare(const PatternTermPtr& ptm,
                                          const LinkPtr& lp,
                                          const LinkPtr& lg)
 {
-	PatternTermSeq osp = ptm->getOutgoingSet();
 	const HandleSeq &osg = lg->getOutgoingSet();
 
 	size_t osg_size = osg.size();
-	size_t osp_size = osp.size();
+	size_t osp_size = ptm->getArity();
 	size_t max_size = std::max(osg_size, osp_size);
 
 	// The recursion step: traverse down the tree.
@@ -241,7 +220,7 @@ bool PatternMatchEngine::ordered_compare(const PatternTermPtr& ptm,
 		{
 			for (size_t i=0; i<max_size; i++)
 			{
-				if (not tree_compare(osp[i], osg[i], CALL_ORDER))
+				if (not tree_compare(ptm->getOutgoingTerm(i), osg[i], CALL_ORDER))
 				{
 					match = false;
 					break;
@@ -257,7 +236,8 @@ bool PatternMatchEngine::ordered_compare(const PatternTermPtr& ptm,
 		for (size_t ip=0, jg=0; ip<osp_size and jg<osg_size; ip++, jg++)
 		{
 			bool tc = false;
-			const Handle& ohp(osp[ip]->getHandle());
+			PatternTermPtr optm(ptm->getOutgoingTerm(ip));
+			const Handle& ohp(optm->getHandle());
 			Type ptype = ohp->getType();
 			if (GLOB_NODE == ptype)
 			{
@@ -265,7 +245,7 @@ bool PatternMatchEngine::ordered_compare(const PatternTermPtr& ptm,
 				if (ohp == osg[jg]) return false;
 #endif
 				HandleSeq glob_seq;
-				PatternTermPtr glob(osp[ip]);
+				const PatternTermPtr& glob(optm);
 				// Globs at the end are handled differently than globs
 				// which are followed by other stuff. So, is there
 				// anything after the glob?
@@ -274,7 +254,7 @@ bool PatternMatchEngine::ordered_compare(const PatternTermPtr& ptm,
 				if (ip+1 < osp_size)
 				{
 					have_post = true;
-					post_glob = (osp[ip+1]);
+					post_glob = ptm->getOutgoingTerm(ip+1);
 				}
 
 				// Match at least one.
@@ -309,12 +289,12 @@ bool PatternMatchEngine::ordered_compare(const PatternTermPtr& ptm,
 
 				// If we are here, we've got a match; record the glob.
 				LinkPtr glp(createLink(LIST_LINK, glob_seq));
-				var_grounding[glob->getHandle()] = glp->getHandle();
+				var_trail.set(glob->getHandle(), glp->getHandle());
 			}
 			else
 			{
 				// If we are here, we are not comparing to a glob.
-				tc = tree_compare(osp[ip], osg[jg], CALL_ORDER);
+				tc = tree_compare(optm, osg[jg], CALL_ORDER);
 				if (not tc)
 				{
 					match = false;
@@ -336,7 +316,7 @@ bool PatternMatchEngine::ordered_compare(const PatternTermPtr& ptm,
 
 	// If we've found a grounding, record it.
 	const Handle &hp = ptm->getHandle();
-	if (hp != hg) var_grounding[hp] = hg;
+	if (hp != hg) var_trail.set(hp, hg);
 
 	return true;
 }
@@ -356,10 +336,9 @@ bool PatternMatchEngine::choice_compare(const PatternTermPtr& ptm,
                                         const LinkPtr& lg)
 {
 	const Handle& hp = ptm->getHandle();
-	PatternTermSeq osp = ptm->getOutgoingSet();
 
 	// _choice_state lets use resume where we last left off.
-	size_t iend = osp.size();
+	size_t iend = ptm->getArity();
 	bool fresh = false;
 	size_t icurr = curr_choice(ptm, hg, fresh);
 	if (fresh) choose_next = false; // took a step, clear the flag
@@ -380,7 +359,7 @@ bool PatternMatchEngine::choice_compare(const PatternTermPtr& ptm,
 	while (icurr<iend)
 	{
 		solution_push();
-		const PatternTermPtr& hop = osp[icurr];
+		PatternTermPtr hop(ptm->getOutgoingTerm(icurr));
 
 		LAZY_LOG_FINE << "tree_comp or_link choice " << icurr
 		              << " of " << iend;
@@ -397,19 +376,20 @@ bool PatternMatchEngine::choice_compare(const PatternTermPtr& ptm,
 				solution_drop();
 
 				// If the grounding is accepted, record it.
-				if (hp != hg) var_grounding[hp] = hg;
+				if (hp != hg) var_trail.set(hp, hg);
 
-				_choice_state[GndChoice(ptm, hg)] = icurr;
+				choice_trail.set(GndChoice(ptm, hg), icurr);
 				return true;
 			}
 		}
+		count_backtrack();
 		solution_pop();
 		choose_next = false; // we are taking a step, so clear the flag.
 		icurr++;
 	}
 
 	// If we are here, we've explored all the possibilities already
-	_choice_state.erase(GndChoice(ptm, hg));
+	choice_trail.erase(GndChoice(ptm, hg));
 	return false;
 }
 
@@ -581,6 +561,20 @@ Notice that these rules never pushed of popped the have-more stack.
 The have-more stack is only pushed/popped by other branchpoints, before
 they call compare_tree.
 
+Trying every permutation takes time factorial in the arity. So, for
+links with four or more members, the permutations that cannot match
+are skipped, as if they had been tried and had failed. Which member
+might go where is worked out at the fresh start, by perm_filter(), and
+kept with the permutation until it runs out; since the groundings only
+grow in the meantime, it stays good. A member that is known to go in
+only one place (a constant, say) thus prunes all of
+the permutations that put it anywhere else, and a member that fits
+nowhere prunes them all. When a comparison fails part-way through a
+permutation, all of the permutations that begin the same way are
+skipped as well, as they would fail the same way. Only the rigid
+members (see is_rigid()) are treated like this; it makes no difference
+to the flags above.
+
 ******************************************************************/
 
 bool PatternMatchEngine::unorder_compare(const PatternTermPtr& ptm,
@@ -590,8 +584,7 @@ bool PatternMatchEngine::unorder_compare(const PatternTermPtr& ptm,
 {
 	const Handle& hp = ptm->getHandle();
 	const HandleSeq& osg = lg->getOutgoingSet();
-	PatternTermSeq osp = ptm->getOutgoingSet();
-	size_t arity = osp.size();
+	size_t arity = ptm->getArity();
 
 	// They've got to be the same size, at the least!
 	// We con't currently support globs, here.
@@ -604,12 +597,32 @@ bool PatternMatchEngine::unorder_compare(const PatternTermPtr& ptm,
 
 	// _perm_state lets use resume where we last left off.
 	bool fresh = false;
-	Permutation mutation = curr_perm(ptm, hg, fresh);
+	PermPlace place = curr_perm(ptm, hg, fresh);
+	Permutation& mutation = place.perm;
 	if (fresh) take_step = false; // took a step, clear the flag.
 
+	// Skip over the permutations that cannot possibly match; see
+	// perm_filter(). The filter is worked out at the fresh start, and
+	// kept with the permutation. A fresh start counts as a step,
+	// whether or not the first permutation gets skipped.
+	if (fresh) place.filter = perm_filter(ptm, osg);
+	const PermFilter* pf = place.filter.get();
+	if (pf and fresh)
+	{
+		size_t dead = dead_prefix(*pf, mutation, 0);
+		if (dead < arity and not next_perm(pf, mutation, dead))
+		{
+			LAZY_LOG_FINE << "No permutation can match term="
+			              << ptm->toString();
+			have_more = false;
+			return false;
+		}
+	}
+
 	// Cases C and D fall through.
 	// If we are here, we've got possibilities to explore.
 	int num_perms = 0;
+	size_t fail_at = arity; // Where the last permutation failed, if it did.
 	// if (logger().isFineEnabled())
 	// {
 	// 	num_perms = facto(mutation.size());
@@ -623,17 +636,34 @@ bool PatternMatchEngine::unorder_compare(const PatternTermPtr& ptm,
 		LAZY_LOG_FINE << "tree_comp explore unordered perm "
 		              << perm_count[Unorder(ptm, hg)] << " of " << num_perms
 		              << " of term=" << ptm->toString();
+		count(SearchProfile::PERMUTATIONS);
 		solution_push();
 		bool match = true;
+		fail_at = arity;
 		for (size_t i=0; i<arity; i++)
 		{
 			if (not tree_compare(mutation[i], osg[i], CALL_UNORDER))
 			{
 				match = false;
+				fail_at = i;
 				break;
 			}
 		}
 
+		// If the members up to the mismatch are rigid, then every other
+		// permutation that begins the same way fails the same way.
+		for (size_t i=0; pf and fail_at<arity and i<=fail_at; i++)
+			if (not pf->rigid[pf->index(mutation[i])])
+				fail_at = arity;
+
+		// Out of budget: give up on the remaining permutations, as if
+		// there were none.
+		if (_budget and _budget->is_stopped())
+		{
+			solution_pop();
+			break;
+		}
+
 		// Check for cases 1&2 of description above.
 		// The step-next may have been taken by someone else, in the
 		// tree_compare immediate above.
@@ -667,7 +697,7 @@ bool PatternMatchEngine::unorder_compare(const PatternTermPtr& ptm,
 				solution_drop();
 
 				// If the grounding is accepted, record it.
-				if (hp != hg) var_grounding[hp] = hg;
+				if (hp != hg) var_trail.set(hp, hg);
 
 				// Handle case 5&7 of description above.
 				have_more = true;
@@ -675,7 +705,7 @@ bool PatternMatchEngine::unorder_compare(const PatternTermPtr& ptm,
 				              << perm_count[Unorder(ptm, hg)]
 				              << " for term=" << ptm->toString()
 				              << " have_more=" << have_more;
-				_perm_state[Unorder(ptm, hg)] = mutation;
+				perm_trail.set(Unorder(ptm, hg), place);
 				return true;
 			}
 		}
@@ -686,14 +716,15 @@ bool PatternMatchEngine::unorder_compare(const PatternTermPtr& ptm,
 take_next_step:
 		take_step = false; // we are taking a step, so clear the flag.
 		have_more = false; // start with a clean slate...
+		count_backtrack();
 		solution_pop();
 		// if (logger().isFineEnabled())
 		// 	perm_count[Unorder(ptm, hg)] ++;
-	} while (std::next_permutation(mutation.begin(), mutation.end()));
+	} while (next_perm(pf, mutation, fail_at));
 
 	// If we are here, we've explored all the possibilities already
 	LAZY_LOG_FINE << "Exhausted all permuations of term=" << ptm->toString();
-	_perm_state.erase(Unorder(ptm, hg));
+	perm_trail.erase(Unorder(ptm, hg));
 	have_more = false;
 	return false;
 }
@@ -712,22 +743,22 @@ bool PatternMatchEngine::clause_compare(const PatternTermPtr& ptm,
 /// Return the saved unordered-link permutation for this
 /// particular point in the tree comparison (i.e. for the
 /// particular unordered link hp in the pattern.)
-PatternMatchEngine::Permutation
+PatternMatchEngine::PermPlace
 PatternMatchEngine::curr_perm(const PatternTermPtr& ptm,
                               const Handle& hg,
                               bool& fresh)
 {
-	Permutation perm;
-	try { perm = _perm_state.at(Unorder(ptm, hg)); }
+	PermPlace place;
+	try { place = _perm_state.at(Unorder(ptm, hg)); }
 	catch(...)
 	{
 		LAZY_LOG_FINE << "tree_comp fresh start unordered link term="
 		              << ptm->toString();
-		perm = ptm->getOutgoingSet();
-		sort(perm.begin(), perm.end());
+		place.perm = ptm->getOutgoingSet();
+		sort(place.perm.begin(), place.perm.end());
 		fresh = true;
 	}
-	return perm;
+	return place;
 }
 
 /// Return true if there are more permutations to explore.
@@ -740,18 +771,207 @@ bool PatternMatchEngine::have_perm(const PatternTermPtr& ptm,
 	return true;
 }
 
+/* ======================================================== */
+
+/// Return true if comparing the term to an atom depends on nothing but
+/// the groundings made so far, and changes nothing but the groundings;
+/// thus, a failed comparison fails again, if tried again with the same
+/// (or more) groundings. The unordered links and the ChoiceLinks, which
+/// keep state of their own, are not rigid; neither are the globs, nor
+/// anything that is evaluated.
+bool PatternMatchEngine::is_rigid(const PatternTermPtr& ptm)
+{
+	const Handle& h = ptm->getHandle();
+	Type t = h->getType();
+	if (GLOB_NODE == t or CHOICE_LINK == t or DEFINED_SCHEMA_NODE == t)
+		return false;
+	if (is_evaluatable(h) or is_executable(h)
+	    or 0 < _pat->evaluatable_terms.count(h)
+	    or 0 < _pat->globby_terms.count(h))
+		return false;
+	if (1 < ptm->getArity() and not _classserver.isA(t, ORDERED_LINK))
+		return false;
+
+	for (Arity i = 0; i < ptm->getArity(); i++)
+		if (not is_rigid(ptm->getOutgoingTerm(i))) return false;
+	return true;
+}
+
+size_t PatternMatchEngine::PermFilter::index(const PatternTermPtr& ptm) const
+{
+	return std::lower_bound(members.begin(), members.end(), ptm)
+		- members.begin();
+}
+
+/// Work out where each member of the unordered link ptm might go in
+/// the ground link, by comparing each rigid member to each ground
+/// member, in turn. As the groundings only ever grow while the
+/// permutations are explored, a member that fails to match some ground
+/// member now will never match it. The remaining members are assumed
+/// to fit anywhere. Also note the rigid members that occur more than
+/// once: their permutations among themselves are all the same.
+///
+/// Return null if there is nothing to be gained: if the link is so
+/// small that it is faster to just try all of its permutations, or if
+/// none of its members are rigid.
+PatternMatchEngine::PermFilterPtr
+PatternMatchEngine::perm_filter(const PatternTermPtr& ptm,
+                                const HandleSeq& osg)
+{
+	size_t arity = osg.size();
+	if (arity < 4 or 64 < arity) return nullptr;
+
+	std::shared_ptr<PermFilter> pfp(std::make_shared<PermFilter>());
+	PermFilter& pf = *pfp;
+
+	pf.members = ptm->getOutgoingSet();
+	sort(pf.members.begin(), pf.members.end());
+
+	uint64_t all = (64 == arity) ? ~((uint64_t) 0)
+	                             : (((uint64_t) 1) << arity) - 1;
+	pf.rigid.assign(arity, false);
+	pf.fits.assign(arity, all);
+	pf.twins.assign(arity, 0);
+	pf.restricted = false;
+
+	// These trials are not part of the search proper; they are
+	// counted apart from it.
+	bool was_filtering = _filtering;
+	_filtering = true;
+	bool any_rigid = false;
+	for (size_t i=0; i<arity; i++)
+	{
+		const PatternTermPtr& mem = pf.members[i];
+		if (not is_rigid(mem)) continue;
+		pf.rigid[i] = any_rigid = true;
+
+		uint64_t fits = 0;
+		for (size_t j=0; j<arity; j++)
+		{
+			solution_push();
+			if (tree_compare(mem, osg[j], CALL_UNORDER))
+				fits |= ((uint64_t) 1) << j;
+			solution_pop();
+		}
+		pf.fits[i] = fits;
+		if (all != fits) pf.restricted = true;
+
+		for (size_t k=0; k<i; k++)
+			if (pf.rigid[k] and pf.members[k]->getHandle() == mem->getHandle())
+				pf.twins[i] |= ((uint64_t) 1) << k;
+	}
+	_filtering = was_filtering;
+	if (not any_rigid) return nullptr;
+	return pfp;
+}
+
+/// Try to find a place, among the free ground positions, for member i,
+/// moving the members already placed about, if need be. This is the
+/// augmenting-path step of bipartite matching.
+static bool place_member(const std::vector<uint64_t>& fits, size_t i,
+                         uint64_t free_pos, uint64_t& seen,
+                         std::vector<size_t>& owner)
+{
+	uint64_t cand = fits[i] & free_pos & ~seen;
+	for (size_t j=0; cand; j++)
+	{
+		uint64_t bit = ((uint64_t) 1) << j;
+		if (0 == (cand & bit)) continue;
+		cand &= ~bit;
+		seen |= bit;
+		if (SIZE_MAX == owner[j] or
+		    place_member(fits, owner[j], free_pos, seen, owner))
+		{
+			owner[j] = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+/// Return the first position in the permutation at which it is known
+/// that no permutation beginning the same way can match: because the
+/// member there does not fit there, or because it is a twin placed
+/// before the one that sorts first, or because the members that are
+/// left over cannot all be fitted into the positions that are left
+/// over. Positions before `from` are taken to be fine. Return the
+/// arity, if the permutation might match.
+size_t PatternMatchEngine::dead_prefix(const PermFilter& pf,
+                                       const Permutation& perm,
+                                       size_t from)
+{
+	size_t arity = perm.size();
+	uint64_t placed = 0;
+	for (size_t p=0; p<from; p++)
+		placed |= ((uint64_t) 1) << pf.index(perm[p]);
+
+	std::vector<size_t> owner;
+	for (size_t p=from; p<arity; p++)
+	{
+		size_t i = pf.index(perm[p]);
+		if (0 == (pf.fits[i] & (((uint64_t) 1) << p))) return p;
+		if (pf.twins[i] & ~placed) return p;
+		placed |= ((uint64_t) 1) << i;
+
+		if (not pf.restricted) continue;
+		uint64_t free_pos = 0;
+		for (size_t j=p+1; j<arity; j++)
+			free_pos |= ((uint64_t) 1) << j;
+		owner.assign(arity, SIZE_MAX);
+		for (size_t k=0; k<arity; k++)
+		{
+			if (placed & (((uint64_t) 1) << k)) continue;
+			uint64_t seen = 0;
+			if (not place_member(pf.fits, k, free_pos, seen, owner))
+				return p;
+		}
+	}
+	return arity;
+}
+
+/// Step to the next permutation that might match. If a prefix of the
+/// current one is known to be hopeless, i.e. if dead is less than the
+/// arity, then skip all of the permutations that begin with the first
+/// dead+1 members of it. Without a filter, this is just
+/// std::next_permutation(). Return false when there are no more.
+bool PatternMatchEngine::next_perm(const PermFilter* pf,
+                                   Permutation& perm,
+                                   size_t dead)
+{
+	if (nullptr == pf)
+		return std::next_permutation(perm.begin(), perm.end());
+
+	size_t arity = perm.size();
+	while (true)
+	{
+		// The last of the permutations that begin the same way is the
+		// one with the rest in reverse order.
+		if (dead < arity)
+		{
+			sort(perm.begin() + dead + 1, perm.end());
+			std::reverse(perm.begin() + dead + 1, perm.end());
+		}
+
+		// std::next_permutation leaves everything before the pivot as
+		// it was.
+		size_t pivot = arity - 1;
+		while (0 < pivot and not (perm[pivot-1] < perm[pivot])) pivot--;
+		if (0 == pivot) return false;
+		std::next_permutation(perm.begin(), perm.end());
+
+		dead = dead_prefix(*pf, perm, pivot - 1);
+		if (arity == dead) return true;
+	}
+}
+
 void PatternMatchEngine::perm_push(void)
 {
-	perm_stack.push(_perm_state);
-	// if (logger().isFineEnabled())
-	// 	perm_count_stack.push(perm_count);
+	perm_trail.push();
 }
 
 void PatternMatchEngine::perm_pop(void)
 {
-	POPSTK(perm_stack, _perm_state);
-	// if (logger().isFineEnabled())
-	// 	POPSTK(perm_count_stack, perm_count);
+	perm_trail.pop();
 }
 
 /* ======================================================== */
@@ -811,6 +1031,14 @@ bool PatternMatchEngine::tree_compare(const PatternTermPtr& ptm,
 	if (is_executable(hp))
 		throw RuntimeException(TRACE_INFO, "Not implemented!!");
 
+	count(_filtering ? SearchProfile::FILTER_COMPARES
+	                 : SearchProfile::TREE_COMPARES);
+
+	// Once the budget is used up, nothing matches any more, and the
+	// search unwinds.
+	if (_budget and out_of_budget())
+		return false;
+
 	// If the pattern is a DefinedSchemaNode, we need to substitute
 	// its definition. XXX TODO.
 	if (DEFINED_SCHEMA_NODE == tp)
@@ -961,8 +1189,10 @@ bool PatternMatchEngine::explore_up_branches(const PatternTermPtr& ptm,
                                              const Handle& hg,
                                              const Handle& clause_root)
 {
-	// Move up the solution graph, looking for a match.
-	IncomingSet iset = _pmc.get_incoming_set(hg);
+	// Move up the solution graph, looking for a match. Only links
+	// of the same type as the term can possibly match it, so let the
+	// callback skip the others, if it can.
+	IncomingSet iset = _pmc.get_incoming_set(hg, ptm->getHandle()->getType());
 	size_t sz = iset.size();
 	LAZY_LOG_FINE << "Looking upward for term=" << ptm->toString()
 	              << " have " << sz << " branches";
@@ -972,7 +1202,7 @@ bool PatternMatchEngine::explore_up_branches(const PatternTermPtr& ptm,
 		              << " for term=" << ptm->toString()
 		              << " propose=" << Handle(iset[i]).value();
 		found = explore_link_branches(ptm, Handle(iset[i]), clause_root);
-		if (found) break;
+		if (found or (_budget and _budget->is_stopped())) break;
 	}
 
 	LAZY_LOG_FINE << "Found upward soln = " << found;
@@ -1033,6 +1263,11 @@ bool PatternMatchEngine::explore_link_branches(const PatternTermPtr& ptm,
 		// On the next go-around, take a step.
 		take_step = true;
 		have_more = false;
+
+		// Out of budget, tree_compare() fails before it gets to the
+		// permutations, leaving them as they were; so don't wait for
+		// them to run out.
+		if (_budget and _budget->is_stopped()) break;
 	} while (have_perm(ptm, hg));
 
 	logger().fine("No more unordered permutations");
@@ -1058,9 +1293,10 @@ bool PatternMatchEngine::explore_choice_branches(const PatternTermPtr& ptm,
 		// should resemble the perm_push() used for unordered links.
 		// However, currently, no test case trips this up. so .. OK.
 		// Whatever. This still probably needs fixing.
-		if (_need_choice_push) choice_stack.push(_choice_state);
+		bool pushed = _need_choice_push;
+		if (pushed) choice_trail.push();
 		bool match = explore_single_branch(ptm, hg, clause_root);
-		if (_need_choice_push) POPSTK(choice_stack, _choice_state);
+		if (pushed) choice_trail.pop();
 		_need_choice_push = false;
 
 		// If the pattern was satisfied, then we are done for good.
@@ -1109,6 +1345,7 @@ bool PatternMatchEngine::explore_single_branch(const PatternTermPtr& ptm,
 	{
 		LAZY_LOG_FINE << "Pattern term=" << ptm->toString()
 		              << " NOT solved by " << hg.value();
+		count_backtrack();
 		solution_pop();
 		return false;
 	}
@@ -1122,6 +1359,8 @@ bool PatternMatchEngine::explore_single_branch(const PatternTermPtr& ptm,
 	bool found = do_term_up(ptm, hg, clause_root);
 	perm_pop();
 
+	// Once found, the search is over, and this is just unwinding.
+	if (not found) count_backtrack();
 	solution_pop();
 	return found;
 }
@@ -1237,11 +1476,16 @@ bool PatternMatchEngine::do_term_up(const PatternTermPtr& ptm,
 			// the evaluation for the callback.
 // XXX TODO count the number of ungrounded vars !!! (make sure its zero)
 
-			bool found = _pmc.evaluate_sentence(clause_root, var_grounding);
+			bool found;
+			{
+				SearchProfile::Timer t(_profile, SearchProfile::EVALUATIONS);
+				found = _pmc.evaluate_sentence(clause_root, var_grounding);
+			}
 			logger().fine("After evaluating clause, found = %d", found);
 			if (found)
 				return clause_accept(clause_root, hg);
 
+			count(SearchProfile::CLAUSES_REJECTED);
 			return false;
 		}
 	}
@@ -1308,9 +1552,14 @@ bool PatternMatchEngine::clause_accept(const Handle& clause_root,
 		match = _pmc.clause_match(clause_root, hg);
 		logger().fine("clause match callback match=%d", match);
 	}
-	if (not match) return false;
+	if (not match)
+	{
+		count(SearchProfile::CLAUSES_REJECTED);
+		return false;
+	}
+	count(SearchProfile::CLAUSES_ACCEPTED);
 
-	clause_grounding[clause_root] = hg;
+	term_trail.set(clause_root, hg);
 	logmsg("---------------------\nclause:", clause_root);
 	logmsg("ground:", hg);
 
@@ -1334,6 +1583,7 @@ bool PatternMatchEngine::do_next_clause(void)
 	{
 		logger().fine("==================== FINITO!");
 		log_solution(var_grounding, clause_grounding);
+		SearchProfile::Timer t(_profile, SearchProfile::GROUNDINGS);
 		found = _pmc.grounding(var_grounding, clause_grounding);
 	}
 	else
@@ -1345,7 +1595,7 @@ bool PatternMatchEngine::do_next_clause(void)
 		              << (is_evaluatable(curr_root)?
 		                  "dynamically evaluatable" : "non-dynamic");
 		logmsg("Joining variable is", joiner);
-		logmsg("Joining grounding is", var_grounding[joiner]);
+		logmsg("Joining grounding is", grounding_of(joiner));
 
 		// Else, start solving the next unsolved clause. Note: this is
 		// a recursive call, and not a loop. Recursion is halted when
@@ -1357,7 +1607,7 @@ bool PatternMatchEngine::do_next_clause(void)
 		// else the join is a 'real' atom.
 
 		clause_accepted = false;
-		Handle hgnd = var_grounding[joiner];
+		Handle hgnd = grounding_of(joiner);
 		OC_ASSERT(hgnd != nullptr,
 			"Error: joining handle has not been grounded yet!");
 		found = explore_clause(joiner, hgnd, curr_root);
@@ -1373,9 +1623,13 @@ bool PatternMatchEngine::do_next_clause(void)
 		// depend on recursion to find additional unmatched optional
 		// clauses; thus we have to explicitly loop over all optional
 		// clauses that don't have matches.
+		//
+		// If the search was cut short, then it is not known whether
+		// the optional clause has a grounding, so give up on it.
 		while ((false == found) and
 		       (false == clause_accepted) and
-		       (is_optional(curr_root)))
+		       (is_optional(curr_root)) and
+		       not (_budget and _budget->is_stopped()))
 		{
 			Handle undef(Handle::UNDEFINED);
 			bool match = _pmc.optional_clause_match(joiner, undef);
@@ -1386,7 +1640,7 @@ bool PatternMatchEngine::do_next_clause(void)
 			}
 
 			// XXX Maybe should push n pop here? No, maybe not ...
-			clause_grounding[curr_root] = Handle::UNDEFINED;
+			term_trail.set(curr_root, Handle::UNDEFINED);
 			get_next_untried_clause();
 			joiner = next_joint;
 			curr_root = next_clause;
@@ -1396,6 +1650,7 @@ bool PatternMatchEngine::do_next_clause(void)
 			{
 				logger().fine("==================== FINITO BANDITO!");
 				log_solution(var_grounding, clause_grounding);
+				SearchProfile::Timer t(_profile, SearchProfile::GROUNDINGS);
 				found = _pmc.grounding(var_grounding, clause_grounding);
 			}
 			else
@@ -1404,7 +1659,7 @@ bool PatternMatchEngine::do_next_clause(void)
 				// or not. If it does, we'll recurse. If it does not,
 				// we'll loop around back to here again.
 				clause_accepted = false;
-				Handle hgnd = var_grounding[joiner];
+				Handle hgnd = grounding_of(joiner);
 				found = explore_term_branches(joiner, hgnd, curr_root);
 			}
 		}
@@ -1544,6 +1799,7 @@ bool PatternMatchEngine::get_next_thinnest_clause(bool search_virtual,
 	Handle unsolved_clause(Handle::UNDEFINED);
 	unsigned int thinnest_joint = UINT_MAX;
 	unsigned int thinnest_clause = UINT_MAX;
+	size_t best_rank = SIZE_MAX;
 	bool unsolved = false;
 
 	// Make a list of the as-yet ungrounded variables.
@@ -1572,13 +1828,15 @@ bool PatternMatchEngine::get_next_thinnest_clause(bool search_virtual,
 	// joins will become our next untried clause. We choose joining atom
 	// with smallest size of its incoming set. If there are many such
 	// atoms we choose one from clauses with minimal number of ungrounded
-	// yet variables.
+	// yet variables.  If the clauses were put in order by a planner,
+	// then that order comes first.
 	for (auto tckvar : thick_vars)
 	{
 		std::size_t pursue_thickness = tckvar.first;
 		const Handle& pursue = tckvar.second;
 
-		if (pursue_thickness > thinnest_joint) break;
+		if (pursue_thickness > thinnest_joint and _clause_rank.empty())
+			break;
 
 		try { _pat->connectivity_map.at(pursue); }
 		catch(...) { continue; }
@@ -1591,9 +1849,16 @@ bool PatternMatchEngine::get_next_thinnest_clause(bool search_virtual,
 			        and (search_black or not is_black(root))
 			        and (search_optionals or not is_optional(root)))
 			{
+				auto rit = _clause_rank.find(root);
+				size_t rank = _clause_rank.end() == rit ? SIZE_MAX : rit->second;
+				if (best_rank < rank) continue;
+
 				unsigned int root_thickness = thickness(root, ungrounded_vars);
-				if (root_thickness < thinnest_clause)
+				if (rank < best_rank
+				    or (pursue_thickness <= thinnest_joint
+				        and root_thickness < thinnest_clause))
 				{
+					best_rank = rank;
 					thinnest_clause = root_thickness;
 					thinnest_joint = pursue_thickness;
 					unsolved_clause = root;
@@ -1615,7 +1880,7 @@ bool PatternMatchEngine::get_next_thinnest_clause(bool search_virtual,
 
 		if (unsolved_clause)
 		{
-			issued.insert(unsolved_clause);
+			issued_trail.insert(unsolved_clause);
 			return true;
 		}
 	}
@@ -1644,11 +1909,11 @@ void PatternMatchEngine::clause_stacks_push(void)
 	logger().fine("--- That's it, now push to stack depth=%d",
 	              _clause_stack_depth);
 
-	var_solutn_stack.push(var_grounding);
-	term_solutn_stack.push(clause_grounding);
+	var_trail.push();
+	term_trail.push();
 
-	issued_stack.push(issued);
-	choice_stack.push(_choice_state);
+	issued_trail.push();
+	choice_trail.push();
 
 	perm_push();
 
@@ -1666,11 +1931,11 @@ void PatternMatchEngine::clause_stacks_pop(void)
 	_pmc.pop();
 
 	// The grounding stacks are handled differently.
-	POPSTK(term_solutn_stack, clause_grounding);
-	POPSTK(var_solutn_stack, var_grounding);
-	POPSTK(issued_stack, issued);
+	term_trail.pop();
+	var_trail.pop();
+	issued_trail.pop();
 
-	POPSTK(choice_stack, _choice_state);
+	choice_trail.pop();
 
 	perm_pop();
 
@@ -1689,37 +1954,29 @@ void PatternMatchEngine::clause_stacks_pop(void)
 void PatternMatchEngine::clause_stacks_clear(void)
 {
 	_clause_stack_depth = 0;
-#if 0
-	OC_ASSERT(0 == term_solutn_stack.size());
-	OC_ASSERT(0 == var_solutn_stack.size());
-	OC_ASSERT(0 == issued_stack.size());
-	OC_ASSERT(0 == choice_stack.size());
-	OC_ASSERT(0 == perm_stack.size());
-#else
-	while (!term_solutn_stack.empty()) term_solutn_stack.pop();
-	while (!var_solutn_stack.empty()) var_solutn_stack.pop();
-	while (!issued_stack.empty()) issued_stack.pop();
-	while (!choice_stack.empty()) choice_stack.pop();
-	while (!perm_stack.empty()) perm_stack.pop();
-#endif
+	var_trail.clear();
+	term_trail.clear();
+	issued_trail.clear();
+	choice_trail.clear();
+	perm_trail.clear();
 }
 
 void PatternMatchEngine::solution_push(void)
 {
-	var_solutn_stack.push(var_grounding);
-	term_solutn_stack.push(clause_grounding);
+	var_trail.push();
+	term_trail.push();
 }
 
 void PatternMatchEngine::solution_pop(void)
 {
-	POPSTK(var_solutn_stack, var_grounding);
-	POPSTK(term_solutn_stack, clause_grounding);
+	var_trail.pop();
+	term_trail.pop();
 }
 
 void PatternMatchEngine::solution_drop(void)
 {
-	var_solutn_stack.pop();
-	term_solutn_stack.pop();
+	var_trail.drop();
+	term_trail.drop();
 }
 
 /* ======================================================== */
@@ -1748,11 +2005,19 @@ void PatternMatchEngine::solution_drop(void)
  * This routine is meant to be invoked on every candidate atom taken
  * from the atom space. That atom is assumed to anchor some part of
  * a graph that hopefully will match the pattern.
+ *
+ * Each call counts as one candidate against the search budget, if
+ * there is one; once the budget is used up, this returns false right
+ * away.
  */
 bool PatternMatchEngine::explore_neighborhood(const Handle& do_clause,
                                               const Handle& term,
                                               const Handle& grnd)
 {
+	if (_budget and _budget->next_candidate())
+		return false;
+	count(SearchProfile::CANDIDATES);
+
 	clause_stacks_clear();
 	return explore_redex(term, grnd, do_clause);
 }
@@ -1772,7 +2037,7 @@ bool PatternMatchEngine::explore_redex(const Handle& term,
 	clear_current_state();
 
 	// Match the required clauses.
-	issued.insert(first_clause);
+	issued_trail.insert(first_clause);
 	return explore_clause(term, grnd, first_clause);
 }
 
@@ -1806,11 +2071,16 @@ bool PatternMatchEngine::explore_clause(const Handle& term,
 
 	// If we are here, we have an evaluatable clause on our hands.
 	logger().fine("Clause is evaluatable; start evaluating it");
-	bool found = _pmc.evaluate_sentence(clause, var_grounding);
+	bool found;
+	{
+		SearchProfile::Timer t(_profile, SearchProfile::EVALUATIONS);
+		found = _pmc.evaluate_sentence(clause, var_grounding);
+	}
 	logger().fine("Post evaluating clause, found = %d", found);
 	if (found)
 		return clause_accept(clause, grnd);
 
+	count(SearchProfile::CLAUSES_REJECTED);
 	return false;
 }
 
@@ -1821,29 +2091,38 @@ bool PatternMatchEngine::explore_clause(const Handle& term,
 void PatternMatchEngine::clear_current_state(void)
 {
 	// Clear all state.
-	var_grounding.clear();
-	clause_grounding.clear();
+	var_trail.clear();
+	term_trail.clear();
 
 	depth = 0;
 
 	// choice link state
-	_choice_state.clear();
+	choice_trail.clear();
 	_need_choice_push = false;
 	choose_next = true;
 
 	// unordered link state
 	have_more = false;
 	take_step = true;
-	_perm_state.clear();
+	perm_trail.clear();
 
-	issued.clear();
+	issued_trail.clear();
 }
 
 PatternMatchEngine::PatternMatchEngine(PatternMatchCallback& pmcb)
 	: _pmc(pmcb),
 	_classserver(classserver()),
+	_budget(nullptr),
+	_budget_ticks(0),
+	_profile(nullptr),
+	_filtering(false),
 	_varlist(NULL),
-	_pat(NULL)
+	_pat(NULL),
+	var_trail(var_grounding),
+	term_trail(clause_grounding),
+	choice_trail(_choice_state),
+	perm_trail(_perm_state),
+	issued_trail(issued)
 {
 	// current state
 	depth = 0;
@@ -1865,6 +2144,13 @@ void PatternMatchEngine::set_pattern(const Variables& v,
 {
 	_varlist = &v;
 	_pat = &p;
+	_budget = _pmc.get_budget();
+	_profile = _pmc.get_profile();
+}
+
+void PatternMatchEngine::set_clause_order(const std::map<Handle, size_t>& r)
+{
+	_clause_rank = r;
 }
 
 /* ======================================================== */
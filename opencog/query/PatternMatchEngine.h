@@ -24,7 +24,9 @@
 #ifndef _OPENCOG_PATTERN_MATCH_ENGINE_H
 #define _OPENCOG_PATTERN_MATCH_ENGINE_H
 
+#include <cstdint>
 #include <map>
+#include <memory>
 #include <set>
 #include <stack>
 #include <unordered_map>
@@ -32,6 +34,9 @@
 
 #include <opencog/query/Pattern.h>
 #include <opencog/query/PatternMatchCallback.h>
+#include <opencog/query/SearchBudget.h>
+#include <opencog/query/SearchProfile.h>
+#include <opencog/query/Trail.h>
 #include <opencog/atomspace/ClassServer.h>
 
 namespace opencog {
@@ -43,6 +48,26 @@ class PatternMatchEngine
 	PatternMatchCallback &_pmc;
 	ClassServer& _classserver;
 
+	// Limits on the search, from the callback; may be null. The clock
+	// is looked at only every so many comparisons.
+	SearchBudget* _budget;
+	unsigned int _budget_ticks;
+	bool out_of_budget(void) {
+		if (_budget->is_stopped()) return true;
+		return 0 == (++_budget_ticks % 64) and _budget->check(); }
+
+	// Where to count what the search does, from the callback; may be
+	// null.
+	SearchProfile* _profile;
+	void count(SearchProfile::Counter c) {
+		if (_profile) _profile->count(c); }
+	bool _filtering;  // In perm_filter(), trying members against the ground.
+
+	// Not when the search is just unwinding, out of budget.
+	void count_backtrack(void) {
+		if (_profile and not (_budget and _budget->is_stopped()))
+			_profile->count(SearchProfile::BACKTRACKS); }
+
 	// Private, locally scoped typedefs, not used outside of this class.
 
 private:
@@ -93,6 +118,17 @@ private:
 	// Map of clauses to their current groundings
 	std::map<Handle, Handle> clause_grounding;
 
+	// All changes to the two maps above go through these, so that
+	// they can be undone when backtracking.
+	typedef std::map<Handle, Handle> SolnMap;
+	MapTrail<SolnMap> var_trail;
+	MapTrail<SolnMap> term_trail;
+
+	// Look up a grounding, without inserting an empty one.
+	Handle grounding_of(const Handle& h) const {
+		auto it = var_grounding.find(h);
+		return var_grounding.end() == it ? Handle::UNDEFINED : it->second; }
+
 	void clear_current_state(void);  // clear the stuff above
 
 	// -------------------------------------------
@@ -101,6 +137,7 @@ private:
 	typedef std::map<GndChoice, size_t> ChoiceState;
 
 	ChoiceState _choice_state;
+	MapTrail<ChoiceState> choice_trail;
 	bool _need_choice_push;
 
 	size_t curr_choice(const PatternTermPtr&, const Handle&, bool&);
@@ -114,18 +151,48 @@ private:
 	// Unordered Link suppoprt
 	typedef std::pair<PatternTermPtr, Handle> Unorder; // Choice
 	typedef PatternTermSeq Permutation;
-	typedef std::map<Unorder, Permutation> PermState; // ChoiceState
+
+	// Which members of an unordered pattern link can go where in the
+	// ground link, so that the permutations that cannot match are
+	// skipped. Members are numbered in sorted order; one bit per
+	// ground position, or per member.
+	struct PermFilter
+	{
+		PatternTermSeq members;
+		std::vector<bool> rigid;
+		std::vector<uint64_t> fits;  // Ground positions it might match.
+		std::vector<uint64_t> twins; // Identical members that sort first.
+		bool restricted;             // Some member does not fit everywhere.
+		size_t index(const PatternTermPtr&) const;
+	};
+	typedef std::shared_ptr<const PermFilter> PermFilterPtr;
+
+	// The permutation reached, and the filter worked out at the fresh
+	// start; it stays good for as long as the permutations are walked.
+	struct PermPlace
+	{
+		Permutation perm;
+		PermFilterPtr filter;  // Null if there is nothing to skip.
+		bool operator==(const PermPlace& other) const
+			{ return perm == other.perm and filter == other.filter; }
+	};
+	typedef std::map<Unorder, PermPlace> PermState; // ChoiceState
 
 	PermState _perm_state;
-	Permutation curr_perm(const PatternTermPtr&, const Handle&, bool&);
+	MapTrail<PermState> perm_trail;
+	PermPlace curr_perm(const PatternTermPtr&, const Handle&, bool&);
 	bool have_perm(const PatternTermPtr&, const Handle&);
 
+	bool is_rigid(const PatternTermPtr&);
+	PermFilterPtr perm_filter(const PatternTermPtr&, const HandleSeq&);
+	size_t dead_prefix(const PermFilter&, const Permutation&, size_t);
+	bool next_perm(const PermFilter*, Permutation&, size_t);
+
 	// Iteration control for unordered links. Branchpoint advances
 	// whenever take_step is set to true.
 	bool take_step;
 	bool have_more;
 	std::map<Unorder, int> perm_count;
-	std::stack<std::map<Unorder, int>> perm_count_stack;
 
 	// --------------------------------------------
 	// Methods and state that select the next clause to be grounded.
@@ -134,32 +201,28 @@ private:
 	bool clause_accepted;
 	void get_next_untried_clause(void);
 	bool get_next_thinnest_clause(bool, bool, bool);
+
+	// The order in which to ground the clauses, if one was planned.
+	std::map<Handle, size_t> _clause_rank;
 	unsigned int thickness(const Handle&, const std::set<Handle>&);
 	Handle next_clause;
 	Handle next_joint;
 	// Set of clauses for which a grounding is currently being attempted.
 	typedef std::set<Handle> IssuedSet;
-	IssuedSet issued;     // stacked on issued_stack
+	IssuedSet issued;     // changes logged on issued_trail
+	SetTrail<IssuedSet> issued_trail;
 
 	// -------------------------------------------
-	// Stack used to store current traversal state for a single
-	// clause. These are pushed when a clause is fully grounded,
-	// and a new clause is about to be started. These are popped
-	// in order to get back to the original clause, and resume
-	// traversal of that clause, where it was last left off.
+	// Current traversal state for a single clause is saved by
+	// pushing a mark onto the trails above. These are pushed when a
+	// clause is fully grounded, and a new clause is about to be
+	// started. These are popped in order to get back to the original
+	// clause, and resume traversal of that clause, where it was last
+	// left off. Popping undoes only what changed since the push.
 	void solution_push(void);
 	void solution_pop(void);
 	void solution_drop(void);
 
-	// Stacks containing partial groundings.
-	typedef std::map<Handle, Handle> SolnMap;
-	std::stack<SolnMap> var_solutn_stack;
-	std::stack<SolnMap> term_solutn_stack;
-
-	std::stack<IssuedSet> issued_stack;
-	std::stack<ChoiceState> choice_stack;
-
-	std::stack<PermState> perm_stack;
 	void perm_push(void);
 	void perm_pop(void);
 
@@ -217,8 +280,13 @@ private:
 
 public:
 	PatternMatchEngine(PatternMatchCallback&);
+	PatternMatchEngine(const PatternMatchEngine&) = delete;
 	void set_pattern(const Variables&, const Pattern&);
 
+	// Ground the clauses in order of their rank, where the choice is
+	// open. Clauses without a rank come after those with one.
+	void set_clause_order(const std::map<Handle, size_t>&);
+
 	// Examine the locally connected neighborhood for possible
 	// matches.
 	bool explore_neighborhood(const Handle&, const Handle&, const Handle&);
@@ -5,12 +5,19 @@
  * Copyright (c) 2008, 2014, 2015 Linas Vepstas <linas@linas.org>
  */
 
+#include <sstream>
+
 #include <opencog/atomspace/AtomSpace.h>
 #include <opencog/guile/SchemeModule.h>
+#include <opencog/guile/SchemePrimitive.h>
+#include <opencog/guile/SchemeSmob.h>
 
 #include "BindLinkAPI.h"
+#include "GroundingStream.h"
 #include "PatternMatch.h"
 #include "PatternSCM.h"
+#include "SearchBudget.h"
+#include "SearchProfile.h"
 #include "FuzzyMatch/FuzzyPatternMatch.h"
 
 
@@ -18,6 +25,193 @@ using namespace opencog;
 
 // ========================================================
 
+namespace opencog {
+
+/// The open result streams, by number; scheme cannot hold on to a
+/// C++ object, so it holds on to the number instead.  Streams that
+/// are never closed live on until the end; cog-bind-stream closes
+/// them once they run dry, or once its procedure is garbage-collected
+/// (see query.scm).  That is done with a guardian, and not by a smob
+/// free function, as closing a stream waits for its search to stop,
+/// which must not happen in the middle of a garbage collection.
+class StreamSCM
+{
+	std::mutex _mtx;
+	std::map<int, std::shared_ptr<GroundingStream>> _streams;
+	int _next_id;
+
+	std::shared_ptr<GroundingStream> get(int id)
+	{
+		std::lock_guard<std::mutex> lck(_mtx);
+		auto it = _streams.find(id);
+		if (_streams.end() == it)
+			throw InvalidParamException(TRACE_INFO,
+				"No such result stream: %d", id);
+		return it->second;
+	}
+
+public:
+	StreamSCM(void) : _next_id(0) {}
+
+	int open(Handle h)
+	{
+		AtomSpace* as = SchemeSmob::ss_get_env_as("cog-stream-open");
+		std::shared_ptr<GroundingStream> gs(
+			std::make_shared<GroundingStream>(as, h));
+
+		std::lock_guard<std::mutex> lck(_mtx);
+		_streams.insert({++_next_id, gs});
+		return _next_id;
+	}
+
+	Handle next(int id)
+	{
+		return get(id)->next();
+	}
+
+	void close(int id)
+	{
+		std::shared_ptr<GroundingStream> gs(get(id));
+		{
+			std::lock_guard<std::mutex> lck(_mtx);
+			_streams.erase(id);
+		}
+		gs->close();
+	}
+};
+
+/// The search budgets, by number, the same way as the streams above.
+/// A search can be cancelled from another thread, given the number of
+/// its budget.
+class BudgetSCM
+{
+	std::mutex _mtx;
+	std::map<int, std::shared_ptr<SearchBudget>> _budgets;
+	int _next_id;
+
+	std::shared_ptr<SearchBudget> get(int id)
+	{
+		std::lock_guard<std::mutex> lck(_mtx);
+		auto it = _budgets.find(id);
+		if (_budgets.end() == it)
+			throw InvalidParamException(TRACE_INFO,
+				"No such search budget: %d", id);
+		return it->second;
+	}
+
+public:
+	BudgetSCM(void) : _next_id(0) {}
+
+	int make(int msecs, int max_candidates)
+	{
+		if (msecs < 0 or max_candidates < 0)
+			throw InvalidParamException(TRACE_INFO,
+				"Expecting limits that are not negative, got %d and %d",
+				msecs, max_candidates);
+		std::shared_ptr<SearchBudget> sb(
+			std::make_shared<SearchBudget>(msecs / 1000.0, max_candidates));
+
+		std::lock_guard<std::mutex> lck(_mtx);
+		_budgets.insert({++_next_id, sb});
+		return _next_id;
+	}
+
+	Handle bind(Handle h, int id)
+	{
+		AtomSpace* as = SchemeSmob::ss_get_env_as("cog-bind-bounded");
+		return bounded_bindlink(as, h, *get(id));
+	}
+
+	Handle satisfying_set(Handle h, int id)
+	{
+		AtomSpace* as = SchemeSmob::ss_get_env_as("cog-satisfying-set-bounded");
+		return bounded_satisfying_set(as, h, *get(id));
+	}
+
+	void cancel(int id)
+	{
+		get(id)->cancel();
+	}
+
+	bool truncated(int id)
+	{
+		return get(id)->truncated();
+	}
+
+	void forget(int id)
+	{
+		std::lock_guard<std::mutex> lck(_mtx);
+		_budgets.erase(id);
+	}
+};
+
+/// The profile of the last profiled search for each query, kept until
+/// it is asked for; see cog-bind-profile in query.scm.
+class ProfileSCM
+{
+	std::mutex _mtx;
+	std::map<Handle, std::shared_ptr<SearchProfile>> _profiles;
+
+	void keep(const Handle& h, const std::shared_ptr<SearchProfile>& prof)
+	{
+		std::lock_guard<std::mutex> lck(_mtx);
+		_profiles[h] = prof;
+	}
+
+public:
+	Handle bind(Handle h)
+	{
+		AtomSpace* as = SchemeSmob::ss_get_env_as("cog-bind-profiled");
+		std::shared_ptr<SearchProfile> prof(std::make_shared<SearchProfile>());
+		Handle res(profiled_bindlink(as, h, *prof));
+		keep(h, prof);
+		return res;
+	}
+
+	Handle satisfying_set(Handle h)
+	{
+		AtomSpace* as = SchemeSmob::ss_get_env_as("cog-satisfying-set-profiled");
+		std::shared_ptr<SearchProfile> prof(std::make_shared<SearchProfile>());
+		Handle res(profiled_satisfying_set(as, h, *prof));
+		keep(h, prof);
+		return res;
+	}
+
+	/// The report, as the text of an association list, and forget it.
+	std::string report(Handle h)
+	{
+		std::shared_ptr<SearchProfile> prof;
+		{
+			std::lock_guard<std::mutex> lck(_mtx);
+			auto it = _profiles.find(h);
+			if (_profiles.end() == it)
+				throw InvalidParamException(TRACE_INFO,
+					"No profile for %s", h->toShortString().c_str());
+			prof = it->second;
+			_profiles.erase(it);
+		}
+
+		SearchProfile::Report rep(prof->report());
+		std::ostringstream oss;
+		oss << "(";
+		for (size_t i = 0; i < rep.size(); i++)
+		{
+			oss << "(" << rep[i].first << " . ";
+			if (i < SearchProfile::NUM_COUNTERS)
+				oss << (size_t) rep[i].second;
+			else
+				oss << rep[i].second;
+			oss << ")";
+		}
+		oss << ")";
+		return oss.str();
+	}
+};
+
+}
+
+// ========================================================
+
 // XXX HACK ALERT This needs to be static, in order for python to
 // work correctly.  The problem is that python keeps creating and
 // destroying this class, but it expects things to stick around.
@@ -42,6 +236,11 @@ void PatternSCM::init(void)
 	_binders.push_back(new FunctionWrap(single_bindlink,
 	                   "cog-bind-single", "query"));
 
+	// Identical to do_bindlink above, except that the search is
+	// spread over several threads.
+	_binders.push_back(new FunctionWrap(parallel_bindlink,
+	                   "cog-bind-parallel", "query"));
+
 	// Attentional Focus function
 	_binders.push_back(new FunctionWrap(af_bindlink,
 	                   "cog-bind-af", "query"));
@@ -57,6 +256,48 @@ void PatternSCM::init(void)
 	_binders.push_back(new FunctionWrap(satisfying_set,
 	                   "cog-satisfying-set", "query"));
 
+	_binders.push_back(new FunctionWrap(parallel_satisfying_set,
+	                   "cog-satisfying-set-parallel", "query"));
+
+	// Describe the search plan, without searching.
+	_binders.push_back(new FunctionWrap(explain_bindlink,
+	                   "cog-bind-explain", "query"));
+
+	// Results, one at a time; see cog-bind-stream in query.scm
+	// XXX Never deleted, for the same reason as the binders.
+	static StreamSCM* streams = new StreamSCM();
+	define_scheme_primitive("cog-stream-open",
+		&StreamSCM::open, streams, "query");
+	define_scheme_primitive("cog-stream-next",
+		&StreamSCM::next, streams, "query");
+	define_scheme_primitive("cog-stream-close",
+		&StreamSCM::close, streams, "query");
+
+	// Searches with limits on their time and size; see
+	// cog-bind-with-budget in query.scm
+	static BudgetSCM* budgets = new BudgetSCM();
+	define_scheme_primitive("cog-budget-new",
+		&BudgetSCM::make, budgets, "query");
+	define_scheme_primitive("cog-bind-bounded",
+		&BudgetSCM::bind, budgets, "query");
+	define_scheme_primitive("cog-satisfying-set-bounded",
+		&BudgetSCM::satisfying_set, budgets, "query");
+	define_scheme_primitive("cog-budget-cancel",
+		&BudgetSCM::cancel, budgets, "query");
+	define_scheme_primitive("cog-budget-truncated?",
+		&BudgetSCM::truncated, budgets, "query");
+	define_scheme_primitive("cog-budget-delete",
+		&BudgetSCM::forget, budgets, "query");
+
+	// Counts of what a search did; see cog-bind-profile in query.scm
+	static ProfileSCM* profiles = new ProfileSCM();
+	define_scheme_primitive("cog-bind-profiled",
+		&ProfileSCM::bind, profiles, "query");
+	define_scheme_primitive("cog-satisfying-set-profiled",
+		&ProfileSCM::satisfying_set, profiles, "query");
+	define_scheme_primitive("cog-profile-report",
+		&ProfileSCM::report, profiles, "query");
+
 	// Rule recognition.
 	_binders.push_back(new FunctionWrap(recognize,
 	                   "cog-recognize", "query"));
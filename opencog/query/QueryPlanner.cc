@@ -0,0 +1,266 @@
+/*
+ * QueryPlanner.cc
+ *
+ * Copyright (C) 2015 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+#include <cfloat>
+#include <sstream>
+
+#include <opencog/atomspace/AtomSpace.h>
+#include <opencog/atoms/pattern/PatternLink.h>
+
+#include "BindLinkAPI.h"
+#include "QueryPlanner.h"
+#include "Satisfier.h"
+
+using namespace opencog;
+
+QueryPlanner::QueryPlanner(AtomSpace* as, const Variables& vars)
+	: _as(as), _vars(vars)
+{
+	_size = std::max(1.0, (double) _as->get_size());
+}
+
+/* ======================================================== */
+
+double QueryPlanner::count(Type t)
+{
+	auto it = _type_count.find(t);
+	if (_type_count.end() != it) return it->second;
+
+	double n = std::max(1.0, (double) _as->get_num_atoms_of_type(t));
+	_type_count.insert({t, n});
+	return n;
+}
+
+/// The number of atoms that the variable might be grounded by: those
+/// of the types it is restricted to, else all of them.
+double QueryPlanner::domain(const Handle& var)
+{
+	auto it = _domain.find(var);
+	if (_domain.end() != it) return it->second;
+
+	double n = _size;
+	auto tit = _vars.typemap.find(var);
+	if (_vars.typemap.end() != tit)
+	{
+		n = 0.0;
+		for (Type t : tit->second)
+			n += _as->get_num_atoms_of_type(t);
+		n = std::max(1.0, n);
+	}
+
+	_domain.insert({var, n});
+	return n;
+}
+
+/// Collect the variables of the clause, and the selectivity of its
+/// constants. A constant held by a link of type T narrows the links
+/// of that type down to the ones in its incoming set.
+void QueryPlanner::scan(const Handle& h, Clause& cl, int quotation_level)
+{
+	if (0 == quotation_level and _vars.varset.count(h))
+	{
+		cl.vars.insert(h);
+		return;
+	}
+
+	LinkPtr lp(LinkCast(h));
+	if (nullptr == lp) return;
+
+	Type t = h->getType();
+	if (QUOTE_LINK == t) quotation_level++;
+	else if (UNQUOTE_LINK == t) quotation_level--;
+
+	// Any one of the alternatives may match; none of them narrows
+	// the search down.
+	bool choice = (0 == quotation_level and CHOICE_LINK == t);
+	double sel = cl.sel;
+	for (const Handle& ho : lp->getOutgoingSet())
+	{
+		scan(ho, cl, quotation_level);
+		if (QUOTE_LINK == t or UNQUOTE_LINK == t or choice) continue;
+		if (nullptr != LinkCast(ho)) continue;
+		if (0 == quotation_level and _vars.varset.count(ho)) continue;
+
+		cl.sel *= ho->getIncomingSetSizeByType(t) / count(t);
+	}
+	if (choice) cl.sel = sel;
+}
+
+const QueryPlanner::Clause& QueryPlanner::clause(const Handle& h)
+{
+	auto it = _clauses.find(h);
+	if (_clauses.end() != it) return it->second;
+
+	Clause cl;
+	cl.sel = 1.0;
+	if (_vars.varset.count(h))
+	{
+		cl.vars.insert(h);
+		cl.card = _size;
+	}
+	else
+	{
+		cl.card = count(h->getType());
+		scan(h, cl, 0);
+	}
+	return _clauses.insert({h, cl}).first->second;
+}
+
+/// The expected number of groundings of the clause, for any one
+/// grounding of the bound variables. The other variables narrow it
+/// down by their type restrictions, if any.
+double QueryPlanner::estimate(const Clause& cl, const std::set<Handle>& bound)
+{
+	double est = cl.card * cl.sel;
+	for (const Handle& v : cl.vars)
+	{
+		if (bound.count(v)) est /= domain(v);
+		else est *= domain(v) / _size;
+	}
+	return est;
+}
+
+/// The expected number of candidates examined, for any one grounding
+/// of the bound variables.  The search climbs up from the grounding
+/// of one of the bound variables, through the links of the type of
+/// the clause; that is, on average, card / domain of them.
+double QueryPlanner::probe(const Clause& cl, const std::set<Handle>& bound)
+{
+	double best = cl.card * cl.sel;
+	for (const Handle& v : cl.vars)
+		if (bound.count(v)) best = std::min(best, cl.card / domain(v));
+	return std::max(1.0, best);
+}
+
+/* ======================================================== */
+
+double QueryPlanner::plan(const HandleSeq& clauses, const Handle& start,
+                          size_t width, Plan& plan)
+{
+	plan.clear();
+
+	std::set<Handle> bound;
+	const Clause& first = clause(start);
+	double rows = std::min((double) width, estimate(first, bound));
+	double total = width;
+	plan.push_back({start, rows, (double) width});
+	bound.insert(first.vars.begin(), first.vars.end());
+
+	HandleSeq rest;
+	for (const Handle& h : clauses)
+		if (h != start) rest.push_back(h);
+
+	while (not rest.empty())
+	{
+		// Prefer the clauses that are joined to the ones grounded so
+		// far; of those, the one that leaves the fewest groundings,
+		// and then, the one that is quickest to look up.
+		size_t best = 0;
+		bool best_joined = false;
+		double best_rows = DBL_MAX;
+		double best_probe = DBL_MAX;
+		for (size_t i = 0; i < rest.size(); i++)
+		{
+			const Clause& cl = clause(rest[i]);
+			bool joined = cl.vars.empty();
+			for (const Handle& v : cl.vars)
+				if (bound.count(v)) { joined = true; break; }
+			if (best_joined and not joined) continue;
+
+			double r = rows * estimate(cl, bound);
+			double p = probe(cl, bound);
+			if ((joined and not best_joined) or r < best_rows
+			    or (r == best_rows and p < best_probe))
+			{
+				best = i;
+				best_joined = joined;
+				best_rows = r;
+				best_probe = p;
+			}
+		}
+
+		double cost = rows * best_probe;
+		rows = best_rows;
+		total += cost;
+		plan.push_back({rest[best], rows, cost});
+
+		const Clause& cl = clause(rest[best]);
+		bound.insert(cl.vars.begin(), cl.vars.end());
+		rest.erase(rest.begin() + best);
+	}
+
+	return total;
+}
+
+std::string QueryPlanner::to_string(const Plan& plan)
+{
+	std::stringstream ss;
+	double total = 0.0;
+	for (size_t i = 0; i < plan.size(); i++)
+	{
+		total += plan[i].cost;
+		ss << "Step " << i+1 << ": examine " << plan[i].cost
+		   << ", keep " << plan[i].rows << "\n"
+		   << plan[i].clause->toShortString();
+	}
+	ss << "Estimated cost: " << total << "\n";
+	return ss.str();
+}
+
+/* ======================================================== */
+
+std::string opencog::explain_bindlink(AtomSpace* as, const Handle& hlink)
+{
+	PatternLinkPtr bl(PatternLinkCast(hlink));
+	if (NULL == bl)
+	{
+		if (classserver().isA(hlink->getType(), GET_LINK))
+			bl = createPatternLink(*LinkCast(hlink));
+		else
+			bl = createPatternLink(hlink);
+	}
+
+	const HandleSeq& comps = bl->get_component_patterns();
+	if (comps.empty())
+	{
+		SatisfyingSet sater(as);
+		sater.set_pattern(bl->get_variables(), bl->get_pattern());
+		return sater.explain();
+	}
+
+	// Each component is searched for by itself; the virtual clauses
+	// are then evaluated on every combination of their groundings.
+	std::stringstream ss;
+	ss << comps.size() << " components, joined by "
+	   << bl->get_virtual().size() << " virtual clauses\n";
+	for (size_t i = 0; i < comps.size(); i++)
+	{
+		PatternLinkPtr clp(PatternLinkCast(comps[i]));
+		SatisfyingSet sater(as);
+		sater.set_pattern(clp->get_variables(), clp->get_pattern());
+		ss << "Component " << i+1 << ":\n" << sater.explain();
+	}
+	return ss.str();
+}
+
+/* ===================== END OF FILE ===================== */
@@ -0,0 +1,103 @@
+/*
+ * QueryPlanner.h
+ *
+ * Copyright (C) 2015 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _OPENCOG_QUERY_PLANNER_H
+#define _OPENCOG_QUERY_PLANNER_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <opencog/atomspace/Handle.h>
+#include <opencog/atoms/core/Variables.h>
+
+namespace opencog {
+
+class AtomSpace;
+
+/**
+ * Cost-based ordering of the clauses of a pattern.
+ *
+ * Given a clause to start with, and the number of candidate groundings
+ * for it, the planner orders the remaining clauses greedily: at each
+ * step, it picks the clause, joined to those already grounded, that is
+ * expected to leave the fewest partial groundings.  The estimates are
+ * made from the number of atoms of each type in the atomspace, from
+ * the incoming sets of the constants in the clause (split by link
+ * type), and from the type restrictions on the variables; all values
+ * are assumed to be independent, and uniformly spread.  This is crude,
+ * but cheap, and it is enough to avoid the worst orderings: those that
+ * join in a clause that fans out, before one that filters.
+ *
+ * The cost of a plan is the expected number of candidates examined,
+ * summed over all of its steps; comparing the costs of the plans that
+ * start at different clauses picks the start.
+ */
+class QueryPlanner
+{
+public:
+	struct Step
+	{
+		Handle clause;
+		double rows;  // Expected partial groundings, after this step.
+		double cost;  // Expected candidates examined, in this step.
+	};
+	typedef std::vector<Step> Plan;
+
+	QueryPlanner(AtomSpace*, const Variables&);
+
+	/// Order the clauses, starting with the clause start, which has
+	/// width candidate groundings. Return the estimated total cost.
+	double plan(const HandleSeq& clauses, const Handle& start,
+	            size_t width, Plan&);
+
+	/// Print the plan, step by step.
+	static std::string to_string(const Plan&);
+
+private:
+	AtomSpace* _as;
+	const Variables& _vars;
+
+	struct Clause
+	{
+		std::set<Handle> vars;  // The variables in it.
+		double card;            // Size of the table it is matched in.
+		double sel;             // Fraction of it that has the constants.
+	};
+	std::map<Handle, Clause> _clauses;
+	std::map<Type, double> _type_count;
+	std::map<Handle, double> _domain;
+	double _size;
+
+	double count(Type);
+	double domain(const Handle&);
+	const Clause& clause(const Handle&);
+	void scan(const Handle&, Clause&, int quotation_level);
+
+	double estimate(const Clause&, const std::set<Handle>&);
+	double probe(const Clause&, const std::set<Handle>&);
+};
+
+} // namespace opencog
+
+#endif // _OPENCOG_QUERY_PLANNER_H
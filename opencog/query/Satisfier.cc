@@ -92,6 +92,7 @@ bool SatisfyingSet::grounding(const std::map<Handle, Handle> &var_soln,
 
 	if (1 == _varseq.size())
 	{
+		std::lock_guard<std::mutex> lck(_satisfying_mtx);
 		_satisfying_set.emplace(var_soln.at(_varseq[0]));
 		return false;
 	}
@@ -103,7 +104,9 @@ bool SatisfyingSet::grounding(const std::map<Handle, Handle> &var_soln,
 	{
 		vargnds.push_back(var_soln.at(hv));
 	}
-	_satisfying_set.emplace(Handle(createLink(LIST_LINK, vargnds)));
+	Handle gnd(createLink(LIST_LINK, vargnds));
+	std::lock_guard<std::mutex> lck(_satisfying_mtx);
+	_satisfying_set.emplace(gnd);
 
 	// Look for more groundings.
 	return false;
@@ -128,7 +131,10 @@ TruthValuePtr opencog::satisfaction_link(AtomSpace* as, const Handle& hlink)
 	return sater._result;
 }
 
-Handle opencog::satisfying_set(AtomSpace* as, const Handle& hlink)
+static Handle do_satisfying_set(AtomSpace* as, const Handle& hlink,
+                                size_t nthreads,
+                                SearchBudget* budget = nullptr,
+                                SearchProfile* profile = nullptr)
 {
 	PatternLinkPtr bl(PatternLinkCast(hlink));
 	if (NULL == bl)
@@ -142,7 +148,13 @@ Handle opencog::satisfying_set(AtomSpace* as, const Handle& hlink)
 	}
 
 	SatisfyingSet sater(as);
+	sater.set_num_threads(nthreads);
+	sater.set_budget(budget);
+	if (budget) budget->start();
+	sater.set_profile(profile);
+	if (profile) profile->start();
 	bl->satisfy(sater);
+	if (profile) profile->stop();
 
 	// Ugh. We used an std::set to avoid duplicates. But now, we need a
 	// vector.  Which means copying. Got a better idea?
@@ -153,4 +165,32 @@ Handle opencog::satisfying_set(AtomSpace* as, const Handle& hlink)
 	return as->add_link(SET_LINK, satvec);
 }
 
+Handle opencog::satisfying_set(AtomSpace* as, const Handle& hlink)
+{
+	return do_satisfying_set(as, hlink, 1);
+}
+
+/// Same as above, but explore the candidate groundings with one
+/// thread per CPU core.
+Handle opencog::parallel_satisfying_set(AtomSpace* as, const Handle& hlink)
+{
+	return do_satisfying_set(as, hlink, 0);
+}
+
+/// Same as above, but only search within the budget; the groundings
+/// found until it is used up are returned.  See SearchBudget.h.
+Handle opencog::bounded_satisfying_set(AtomSpace* as, const Handle& hlink,
+                                       SearchBudget& budget)
+{
+	return do_satisfying_set(as, hlink, 1, &budget);
+}
+
+/// Same as above, but count what the search does, and how long it
+/// takes.  See SearchProfile.h.
+Handle opencog::profiled_satisfying_set(AtomSpace* as, const Handle& hlink,
+                                        SearchProfile& profile)
+{
+	return do_satisfying_set(as, hlink, 1, nullptr, &profile);
+}
+
 /* ===================== END OF FILE ===================== */
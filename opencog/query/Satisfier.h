@@ -24,6 +24,7 @@
 #ifndef _OPENCOG_SATISFIER_H
 #define _OPENCOG_SATISFIER_H
 
+#include <mutex>
 #include <vector>
 
 #include <opencog/atomspace/AtomSpace.h>
@@ -97,6 +98,9 @@ class SatisfyingSet :
 		HandleSeq _varseq;
 		std::set<Handle> _satisfying_set;
 
+		// Guards the satisfying set, for parallel searches.
+		std::mutex _satisfying_mtx;
+
 		virtual void set_pattern(const Variables& vars,
 		                         const Pattern& pat)
 		{
@@ -0,0 +1,82 @@
+/*
+ * SearchBudget.cc
+ *
+ * Copyright (C) 2015 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <opencog/util/exceptions.h>
+
+#include "SearchBudget.h"
+
+using namespace opencog;
+
+SearchBudget::SearchBudget(double max_time, size_t max_candidates)
+	: _cancelled(false), _stopped(false), _candidates(0),
+	  _max_time(max_time), _max_candidates(max_candidates)
+{
+	if (max_time < 0.0)
+		throw InvalidParamException(TRACE_INFO,
+			"Negative time limit: %g", max_time);
+	start();
+}
+
+void SearchBudget::start(void)
+{
+	_candidates = 0;
+
+	// A cancel() that comes along meanwhile must not be lost: clear
+	// the latch first, and then look, as cancel() sets them the other
+	// way round.
+	_stopped = false;
+	if (_cancelled) _stopped = true;
+	_deadline = Clock::now() +
+		std::chrono::duration_cast<Clock::duration>(
+			std::chrono::duration<double>(_max_time));
+}
+
+void SearchBudget::cancel(void)
+{
+	_cancelled = true;
+	_stopped = true;
+}
+
+bool SearchBudget::next_candidate(void)
+{
+	if (is_stopped()) return true;
+	size_t n = ++_candidates;
+	if (0 < _max_candidates and _max_candidates < n)
+	{
+		_stopped = true;
+		return true;
+	}
+	return check();
+}
+
+bool SearchBudget::check(void)
+{
+	if (is_stopped()) return true;
+	if (0.0 < _max_time and _deadline <= Clock::now())
+	{
+		_stopped = true;
+		return true;
+	}
+	return false;
+}
+
+/* ===================== END OF FILE ===================== */
@@ -0,0 +1,96 @@
+/*
+ * SearchBudget.h
+ *
+ * Copyright (C) 2015 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _OPENCOG_SEARCH_BUDGET_H
+#define _OPENCOG_SEARCH_BUDGET_H
+
+#include <atomic>
+#include <chrono>
+
+namespace opencog {
+
+/**
+ * Limits on a pattern search: a maximum wall-clock time, a maximum
+ * number of candidate atoms to start the search at, and a flag that
+ * any thread may set, to cancel the search.
+ *
+ * The PatternMatchEngine checks the budget as it compares the pattern
+ * to the candidates; once it is used up, every comparison fails, and
+ * the search winds down, keeping the groundings found so far. These
+ * are partial results: some groundings may be missing, but none of
+ * those found are wrong.  (In particular, an optional or absent clause
+ * is never taken as ungrounded because the search for it was cut
+ * short.) Afterwards, truncated() tells if the search was complete.
+ *
+ * The limits are counted from the last call to start(); the search
+ * functions (e.g. bounded_bindlink()) call it when they begin.  A
+ * budget may be shared by several threads searching together, but
+ * it should not be used for two searches at the same time.
+ */
+class SearchBudget
+{
+	typedef std::chrono::steady_clock Clock;
+
+	std::atomic<bool> _cancelled;
+	std::atomic<bool> _stopped;     // Latched when any limit is hit.
+	std::atomic<size_t> _candidates;
+
+	double _max_time;               // In seconds; no limit if zero.
+	size_t _max_candidates;         // No limit if zero.
+	Clock::time_point _deadline;
+
+public:
+	SearchBudget(double max_time = 0.0, size_t max_candidates = 0);
+
+	/// Restart the clock and the count of candidates. A budget that
+	/// was cancelled stays cancelled.
+	void start(void);
+
+	/// Stop the search at the next check; may be called from any
+	/// thread, before or during the search.
+	void cancel(void);
+
+	bool is_cancelled(void) const { return _cancelled; }
+
+	/// True if the search was stopped before it was done.
+	bool truncated(void) const { return _stopped; }
+
+	size_t get_candidates(void) const { return _candidates; }
+
+	// -------------------------------------------------------
+	// Called by the engine.
+
+	/// Cheap enough to be called for every comparison.
+	bool is_stopped(void) const
+		{ return _stopped.load(std::memory_order_relaxed); }
+
+	/// Count one more candidate; return true if it is one too many,
+	/// or if the search is to stop for some other reason.
+	bool next_candidate(void);
+
+	/// Look at the clock; return true if the search is to stop.
+	bool check(void);
+};
+
+} // namespace opencog
+
+#endif // _OPENCOG_SEARCH_BUDGET_H
@@ -0,0 +1,92 @@
+/*
+ * SearchProfile.cc
+ *
+ *
+ * Copyright (C) 2015 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <sstream>
+
+#include "SearchProfile.h"
+
+using namespace opencog;
+
+static const char* counter_names[SearchProfile::NUM_COUNTERS] =
+{
+	"candidates",
+	"tree-compares",
+	"filter-compares",
+	"backtracks",
+	"permutations",
+	"clauses-accepted",
+	"clauses-rejected",
+	"evaluations",
+	"groundings",
+};
+
+SearchProfile::SearchProfile(void)
+{
+	start();
+}
+
+void SearchProfile::start(void)
+{
+	for (auto& c : _counts) c = 0;
+	_evaluation_time = 0;
+	_grounding_time = 0;
+	_elapsed = 0.0;
+	_start = Clock::now();
+}
+
+void SearchProfile::stop(void)
+{
+	_elapsed = std::chrono::duration<double>(Clock::now() - _start).count();
+}
+
+SearchProfile::Report SearchProfile::report(void) const
+{
+	Report rep;
+	for (int c = 0; c < NUM_COUNTERS; c++)
+		rep.push_back({counter_names[c], (double) _counts[c]});
+	rep.push_back({"evaluation-time", get_evaluation_time()});
+	rep.push_back({"grounding-time", get_grounding_time()});
+	rep.push_back({"elapsed-time", get_elapsed()});
+	return rep;
+}
+
+std::string SearchProfile::to_string(void) const
+{
+	std::ostringstream oss;
+	for (const auto& entry : report())
+		oss << entry.first << ": " << entry.second << std::endl;
+	return oss.str();
+}
+
+SearchProfile::Timer::~Timer()
+{
+	if (nullptr == _profile) return;
+	long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		Clock::now() - _start).count();
+	std::atomic<long long>& total = (EVALUATIONS == _counter) ?
+		_profile->_evaluation_time : _profile->_grounding_time;
+	total.fetch_add(ns, std::memory_order_relaxed);
+	_profile->count(_counter);
+}
+
+/* ===================== END OF FILE ===================== */
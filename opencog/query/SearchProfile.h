@@ -0,0 +1,140 @@
+/*
+ * SearchProfile.h
+ *
+ *
+ * Copyright (C) 2015 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _OPENCOG_SEARCH_PROFILE_H
+#define _OPENCOG_SEARCH_PROFILE_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace opencog {
+
+/**
+ * Counts of what a pattern search did, and of the time it spent in the
+ * callbacks; for finding out why a query is slow.
+ *
+ * The PatternMatchEngine counts, as it goes:
+ *  - the candidate atoms that the search was started at;
+ *  - the calls to tree_compare(), i.e. every (sub-)term of the pattern
+ *    compared to an atom;
+ *  - apart from these, the calls made to work out where the members
+ *    of a large unordered link can go, before its permutations are
+ *    tried;
+ *  - the backtracks: (partial) groundings undone, so as to try
+ *    something else; not those undone as the search unwinds, once it
+ *    is over or out of budget;
+ *  - the permutations tried, of the unordered links;
+ *  - the clauses accepted, and those rejected by the callback (or that
+ *    evaluated to false);
+ *  - the evaluations of evaluatable clauses, and the groundings
+ *    reported, with the time spent in each of these two callbacks.
+ *    For a pattern made of several components, the groundings of
+ *    each component are counted, as well as those of the whole.
+ *
+ * The search functions (e.g. profiled_bindlink()) call start() when
+ * they begin, and stop() when they are done, so that the total time is
+ * known.  Nothing is counted unless a profile is given to the search;
+ * without one, the cost is a test of a null pointer, here and there.
+ * A profile may be shared by several threads searching together.
+ */
+class SearchProfile
+{
+public:
+	enum Counter
+	{
+		CANDIDATES,
+		TREE_COMPARES,
+		FILTER_COMPARES,
+		BACKTRACKS,
+		PERMUTATIONS,
+		CLAUSES_ACCEPTED,
+		CLAUSES_REJECTED,
+		EVALUATIONS,
+		GROUNDINGS,
+		NUM_COUNTERS
+	};
+
+	typedef std::vector<std::pair<std::string, double>> Report;
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	std::atomic<size_t> _counts[NUM_COUNTERS];
+
+	// Nanoseconds in the evaluate_sentence() and grounding() callbacks.
+	std::atomic<long long> _evaluation_time;
+	std::atomic<long long> _grounding_time;
+
+	Clock::time_point _start;
+	double _elapsed;
+
+public:
+	SearchProfile(void);
+
+	/// Zero the counts, and start the clock.
+	void start(void);
+
+	/// Stop the clock.
+	void stop(void);
+
+	size_t get(Counter c) const { return _counts[c]; }
+
+	/// Seconds spent in the search, in all, and in the callbacks.
+	double get_elapsed(void) const { return _elapsed; }
+	double get_evaluation_time(void) const { return _evaluation_time * 1e-9; }
+	double get_grounding_time(void) const { return _grounding_time * 1e-9; }
+
+	/// All of the above, by name, e.g. ("tree-compares", 1234); the
+	/// times are in seconds.
+	Report report(void) const;
+
+	/// The report, one line per entry.
+	std::string to_string(void) const;
+
+	// -------------------------------------------------------
+	// Called by the engine.
+
+	void count(Counter c)
+		{ _counts[c].fetch_add(1, std::memory_order_relaxed); }
+
+	/// Counts a call to evaluate_sentence() or to grounding(), and
+	/// the time spent in it, from construction to destruction. Does
+	/// nothing, if there is no profile.
+	class Timer
+	{
+		SearchProfile* _profile;
+		Counter _counter;
+		Clock::time_point _start;
+	public:
+		Timer(SearchProfile* p, Counter c) : _profile(p), _counter(c)
+			{ if (_profile) _start = Clock::now(); }
+		~Timer();
+	};
+};
+
+} // namespace opencog
+
+#endif // _OPENCOG_SEARCH_PROFILE_H
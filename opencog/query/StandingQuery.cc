@@ -0,0 +1,392 @@
+/*
+ * StandingQuery.cc
+ *
+ * Copyright (C) 2015 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+#include <set>
+
+#include <opencog/atomspace/AtomSpace.h>
+#include <opencog/atoms/execution/Instantiator.h>
+#include <opencog/atoms/pattern/BindLink.h>
+#include <opencog/util/Logger.h>
+
+#include "DefaultPatternMatchCB.h"
+#include "InitiateSearchCB.h"
+#include "StandingQuery.h"
+
+namespace opencog {
+
+/// Collects the groundings. If given an atom to start at, it grounds
+/// each of the seed clauses that can match it to it, in turn, and
+/// goes on from there; else, it does the usual search.
+class StandingQueryCB :
+	public virtual InitiateSearchCB,
+	public virtual DefaultPatternMatchCB
+{
+	const HandleSeq& _seeds;
+	Handle _seed;
+	std::vector<std::pair<std::map<Handle, Handle>,
+	                      std::map<Handle, Handle>>>& _found;
+
+public:
+	StandingQueryCB(AtomSpace* as, const HandleSeq& seeds,
+	                const Handle& seed,
+	                std::vector<std::pair<std::map<Handle, Handle>,
+	                                      std::map<Handle, Handle>>>& found) :
+		InitiateSearchCB(as), DefaultPatternMatchCB(as),
+		_seeds(seeds), _seed(seed), _found(found) {}
+
+	virtual void set_pattern(const Variables& vars,
+	                         const Pattern& pat)
+	{
+		InitiateSearchCB::set_pattern(vars, pat);
+		DefaultPatternMatchCB::set_pattern(vars, pat);
+	}
+
+	virtual bool initiate_search(PatternMatchEngine* pme)
+	{
+		if (nullptr == _seed)
+			return InitiateSearchCB::initiate_search(pme);
+
+		// A clause can only be grounded by an atom of the same type,
+		// unless it is quoted, or a choice.
+		Type t = _seed->getType();
+		LinkPtr lseed(LinkCast(_seed));
+		for (const Handle& cl : _seeds)
+		{
+			Type ct = cl->getType();
+			if (QUOTE_LINK != ct and CHOICE_LINK != ct)
+			{
+				if (ct != t) continue;
+				LinkPtr lcl(LinkCast(cl));
+				if (lcl and lcl->getArity() != lseed->getArity()) continue;
+			}
+			pme->explore_neighborhood(cl, cl, _seed);
+		}
+		return false;
+	}
+
+	virtual bool grounding(const std::map<Handle, Handle> &var_soln,
+	                       const std::map<Handle, Handle> &term_soln)
+	{
+		_found.push_back({var_soln, term_soln});
+		return false;
+	}
+};
+
+}
+
+using namespace opencog;
+
+StandingQuery::StandingQuery(AtomSpace* as, const Handle& hlink,
+                             Callback cb)
+	: _as(as), _callback(cb), _incremental(false),
+	  _guard(std::make_shared<Guard>()), _busy(false)
+{
+	_guard->query = this;
+
+	if (classserver().isA(hlink->getType(), BIND_LINK))
+	{
+		BindLinkPtr bl(BindLinkCast(hlink));
+		if (NULL == bl)
+			bl = createBindLink(*LinkCast(hlink));
+		_implicand = bl->get_implicand();
+		_pattern = bl;
+	}
+	else
+	{
+		_pattern = PatternLinkCast(hlink);
+		if (NULL == _pattern)
+		{
+			if (classserver().isA(hlink->getType(), GET_LINK))
+				_pattern = createPatternLink(*LinkCast(hlink));
+			else
+				_pattern = createPatternLink(hlink);
+		}
+	}
+
+	// Any mandatory clause that is grounded by a real atom can be
+	// started at; the evaluatable ones are not.
+	const Pattern& pat = _pattern->get_pattern();
+	const Variables& vars = _pattern->get_variables();
+	for (const Handle& cl : pat.mandatory)
+	{
+		if (pat.evaluatable_holders.count(cl)) continue;
+		if (vars.varset.count(cl)) continue;
+		_seeds.push_back(cl);
+	}
+
+	_incremental = not _seeds.empty()
+		and pat.optionals.empty()
+		and _pattern->get_component_patterns().empty()
+		and pat.defined_terms.empty()
+		and pat.globby_terms.empty();
+
+	// Listen first, and then search, so that nothing added in between
+	// is missed; the atoms added meanwhile wait until we are done.
+	std::lock_guard<std::recursive_mutex> lck(_guard->mtx);
+	_busy = true;
+	std::shared_ptr<Guard> guard(_guard);
+	_add_connection = _as->addAtomSignal(
+		[guard](const Handle& h)
+		{
+			std::lock_guard<std::recursive_mutex> lck(guard->mtx);
+			if (guard->query) guard->query->atom_added(h);
+		});
+	_remove_connection = _as->removeAtomSignal(
+		[guard](const AtomPtr& atom)
+		{
+			std::lock_guard<std::recursive_mutex> lck(guard->mtx);
+			if (guard->query) guard->query->atom_removed(atom);
+		});
+
+	refresh(Handle::UNDEFINED);
+	drain();
+}
+
+StandingQuery::~StandingQuery()
+{
+	_add_connection.disconnect();
+	_remove_connection.disconnect();
+
+	// Another thread may have got the signal before the disconnect;
+	// wait for it to leave, and keep any others from coming in.  They
+	// hold on to the guard, so it outlives us, if need be.
+	std::lock_guard<std::recursive_mutex> lck(_guard->mtx);
+	_guard->query = nullptr;
+}
+
+HandleSeq StandingQuery::get_results(void)
+{
+	std::lock_guard<std::recursive_mutex> lck(_guard->mtx);
+	HandleSeq results;
+	for (const auto& sup : _support)
+		results.push_back(sup.first);
+	return results;
+}
+
+/* ======================================================== */
+
+/// Search for the groundings; those that ground some clause to the
+/// seed atom, if one is given, else all of them. Return true if some
+/// of the optional clauses were grounded.
+bool StandingQuery::search(const Handle& seed, std::vector<Grounding>& found)
+{
+	StandingQueryCB sqcb(_as, _seeds, seed, found);
+	_pattern->satisfy(sqcb);
+	return sqcb.optionals_present();
+}
+
+StandingQuery::Key StandingQuery::make_key(const Grounding& g) const
+{
+	Key key;
+	for (const Handle& var : _pattern->get_variables().varseq)
+	{
+		auto it = g.first.find(var);
+		key.push_back(g.first.end() == it ? Handle::UNDEFINED : it->second);
+	}
+	for (const Handle& cl : _pattern->get_pattern().mandatory)
+	{
+		auto it = g.second.find(cl);
+		key.push_back(g.second.end() == it ? Handle::UNDEFINED : it->second);
+	}
+	return key;
+}
+
+/// True if the grounding makes use of an atom that is being removed,
+/// or is gone.  The removal signal is sent before the atom is taken
+/// out of the indexes, so a search run by another thread meanwhile may
+/// still find it; the removal handler has run already, and would never
+/// drop such a grounding.
+bool StandingQuery::is_dying(const Key& key) const
+{
+	for (const Handle& h : key)
+		if (h and (nullptr == h->getAtomTable() or h->isMarkedForRemoval()))
+			return true;
+	return false;
+}
+
+/// The result for the grounding; the same as bindlink() or
+/// satisfying_set() would have.
+Handle StandingQuery::make_result(const HandleMap& var_soln)
+{
+	if (_implicand)
+	{
+		Instantiator inst(_as);
+		return inst.instantiate(_implicand, var_soln);
+	}
+
+	const HandleSeq& varseq = _pattern->get_variables().varseq;
+	if (1 == varseq.size())
+		return var_soln.at(varseq[0]);
+
+	HandleSeq vargnds;
+	for (const Handle& var : varseq)
+		vargnds.push_back(var_soln.at(var));
+	return _as->add_link(LIST_LINK, vargnds);
+}
+
+void StandingQuery::insert(const Key& key, const Handle& result)
+{
+	if (nullptr == result) return;
+	if (not _groundings.insert({key, result}).second) return;
+
+	std::set<Handle> atoms(key.begin(), key.end());
+	for (const Handle& h : atoms)
+		if (h) _by_atom.insert({h, key});
+
+	if (1 == ++_support[result])
+		_callback(result, true);
+}
+
+void StandingQuery::erase(const Key& key)
+{
+	auto git = _groundings.find(key);
+	if (_groundings.end() == git) return;
+	Handle result(git->second);
+	_groundings.erase(git);
+
+	std::set<Handle> atoms(key.begin(), key.end());
+	for (const Handle& h : atoms)
+	{
+		auto range = _by_atom.equal_range(h);
+		for (auto it = range.first; it != range.second; )
+		{
+			if (it->second == key) it = _by_atom.erase(it);
+			else it++;
+		}
+	}
+
+	auto sit = _support.find(result);
+	if (0 < --sit->second) return;
+	_support.erase(sit);
+	_callback(result, false);
+}
+
+/// Search in full, and bring the groundings up to date, leaving out
+/// those that make use of the atom about to be removed.
+void StandingQuery::refresh(const Handle& removed)
+{
+	std::vector<Grounding> found;
+	bool optionals_present = search(Handle::UNDEFINED, found);
+
+	std::map<Key, const HandleMap*> current;
+	for (const Grounding& g : found)
+	{
+		Key key(make_key(g));
+		if (removed and std::find(key.begin(), key.end(), removed) != key.end())
+			continue;
+		if (is_dying(key)) continue;
+		current.insert({key, &g.first});
+	}
+
+	// The search for absent clauses; see do_imply() in Implicator.cc
+	HandleMap empty_map;
+	const Pattern& pat = _pattern->get_pattern();
+	if (_implicand and current.empty() and 0 == pat.mandatory.size()
+	    and 0 < pat.optionals.size() and not optionals_present)
+		current.insert({Key(), &empty_map});
+
+	std::vector<Key> gone;
+	for (const auto& gnd : _groundings)
+		if (0 == current.count(gnd.first)) gone.push_back(gnd.first);
+	for (const Key& key : gone)
+		erase(key);
+
+	for (const auto& cur : current)
+		if (0 == _groundings.count(cur.first))
+			insert(cur.first, make_result(*cur.second));
+}
+
+/* ======================================================== */
+
+/// Process the atoms that were added. Making the results may add more
+/// atoms; these are queued up, and processed in turn.
+void StandingQuery::drain(void)
+{
+	_busy = true;
+	while (not _pending.empty())
+	{
+		Handle h(_pending.front());
+		_pending.pop_front();
+
+		try
+		{
+			if (not _incremental)
+			{
+				_pending.clear();
+				refresh(Handle::UNDEFINED);
+				continue;
+			}
+
+			std::vector<Grounding> found;
+			search(h, found);
+			for (const Grounding& g : found)
+			{
+				Key key(make_key(g));
+				if (0 == _groundings.count(key) and not is_dying(key))
+					insert(key, make_result(g.first));
+			}
+		}
+		catch (const std::exception& ex)
+		{
+			// Throwing would fail the insertion of the atom, which
+			// is not at fault.
+			logger().error("StandingQuery: failed to match %s: %s",
+			               h->toShortString().c_str(), ex.what());
+		}
+	}
+	_busy = false;
+}
+
+/// The signal handlers call these with the guard locked.
+void StandingQuery::atom_added(const Handle& h)
+{
+	_pending.push_back(h);
+	if (not _busy) drain();
+}
+
+/// Called before the atom is removed.
+void StandingQuery::atom_removed(const AtomPtr& atom)
+{
+	Handle h(atom->getHandle());
+	_pending.erase(std::remove(_pending.begin(), _pending.end(), h),
+	               _pending.end());
+
+	if (not _incremental)
+	{
+		try { refresh(h); }
+		catch (const std::exception& ex)
+		{
+			logger().error("StandingQuery: failed to match: %s", ex.what());
+		}
+		return;
+	}
+
+	std::vector<Key> gone;
+	auto range = _by_atom.equal_range(h);
+	for (auto it = range.first; it != range.second; it++)
+		gone.push_back(it->second);
+	for (const Key& key : gone)
+		erase(key);
+}
+
+/* ===================== END OF FILE ===================== */
@@ -0,0 +1,146 @@
+/*
+ * StandingQuery.h
+ *
+ * Copyright (C) 2015 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _OPENCOG_STANDING_QUERY_H
+#define _OPENCOG_STANDING_QUERY_H
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include <boost/signals2.hpp>
+
+#include <opencog/atomspace/Handle.h>
+#include <opencog/atoms/pattern/PatternLink.h>
+
+namespace opencog {
+
+class AtomSpace;
+
+/**
+ * A query that is kept up to date, as atoms are added to and removed
+ * from the atomspace.
+ *
+ * The results are those of bindlink() for a BindLink, and those of
+ * satisfying_set() for a GetLink or SatisfactionLink, except that they
+ * are not wrapped in a SetLink.  The query calls the callback with each
+ * result that appears (with `true`), starting with those found when it
+ * is created, and with each result that is no longer supported by any
+ * grounding (with `false`).  To do so, it listens to the atom-added and
+ * atom-removed signals of the atomspace.  Results that are no longer
+ * supported are not removed from the atomspace.
+ *
+ * When an atom is added, any new grounding must ground one of the
+ * clauses to it; so only the clauses that it can ground are searched,
+ * starting at the new atom, and going out from there to the rest of
+ * the pattern.  The work done is proportional to the neighbourhood of
+ * the new atom, not to the size of the atomspace.  When an atom is
+ * removed, the groundings that made use of it are dropped; this needs
+ * no search at all.
+ *
+ * This does not work for patterns whose groundings may disappear when
+ * an atom is added: those with AbsentLinks, or with several components
+ * joined by virtual clauses, or with definitions or globs.  These are
+ * searched in full, and the results compared, after each change; this
+ * is no faster than polling.  A removal that makes some AbsentLink
+ * satisfied is noticed only at the next change.  The evaluatable
+ * clauses are evaluated when a grounding is found, and not again.
+ *
+ * The callback is called from the thread that changed the atomspace,
+ * while the query is locked; it may change the atomspace, but it must
+ * not wait for other threads to do so.  Atoms created by the query
+ * itself (the implicands of a BindLink) are matched against it in turn.
+ * The query may be destroyed while other threads change the atomspace;
+ * the destructor waits for the callback to return, and it is not called
+ * again afterwards.  The query must not be destroyed by its callback.
+ */
+class StandingQuery
+{
+public:
+	typedef std::function<void (const Handle&, bool)> Callback;
+
+	StandingQuery(AtomSpace*, const Handle&, Callback);
+	StandingQuery(const StandingQuery&) = delete;
+	StandingQuery& operator=(const StandingQuery&) = delete;
+	~StandingQuery();
+
+	/// The current results.
+	HandleSeq get_results(void);
+
+	/// True if the query is maintained incrementally, false if it is
+	/// searched in full after each change.
+	bool is_incremental(void) const { return _incremental; }
+
+private:
+	AtomSpace* _as;
+	PatternLinkPtr _pattern;
+	Handle _implicand;
+	Callback _callback;
+
+	// The clauses that a new atom might ground, and start a search at.
+	HandleSeq _seeds;
+	bool _incremental;
+
+	// A grounding is identified by the groundings of the variables and
+	// of the clauses, in the order of the variables and the clauses.
+	typedef HandleSeq Key;
+	std::map<Key, Handle> _groundings;
+	std::multimap<Handle, Key> _by_atom;
+	std::map<Handle, size_t> _support;  // Number of groundings per result.
+
+	// The signal handlers hold the guard, and not the query: a handler
+	// may still be running, or waiting for the lock, when the query is
+	// destroyed.  The destructor sets the query to null, under the lock.
+	struct Guard
+	{
+		std::recursive_mutex mtx;
+		StandingQuery* query;
+	};
+	std::shared_ptr<Guard> _guard;
+
+	std::deque<Handle> _pending;
+	bool _busy;
+
+	boost::signals2::connection _add_connection;
+	boost::signals2::connection _remove_connection;
+
+	void atom_added(const Handle&);
+	void atom_removed(const AtomPtr&);
+
+	typedef std::map<Handle, Handle> HandleMap;
+	typedef std::pair<HandleMap, HandleMap> Grounding;
+	bool search(const Handle& seed, std::vector<Grounding>&);
+	void refresh(const Handle& removed);
+	void drain(void);
+
+	Key make_key(const Grounding&) const;
+	bool is_dying(const Key&) const;
+	Handle make_result(const HandleMap&);
+	void insert(const Key&, const Handle&);
+	void erase(const Key&);
+};
+
+} // namespace opencog
+
+#endif // _OPENCOG_STANDING_QUERY_H
@@ -0,0 +1,162 @@
+/*
+ * Trail.h
+ *
+ * Copyright (C) 2015 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _OPENCOG_TRAIL_H
+#define _OPENCOG_TRAIL_H
+
+#include <vector>
+
+namespace opencog {
+
+/**
+ * Undo log for a std::map, used for backtracking.
+ *
+ * Instead of copying the whole map onto a stack at every branchpoint,
+ * each change made through the trail records what it overwrote.
+ * push() marks the current position; pop() undoes every change made
+ * since the matching push(), and drop() forgets the mark, while
+ * keeping the changes (they will be undone by an enclosing pop()).
+ * Thus, push and pop cost is proportional to the number of changes
+ * made in between, and not to the size of the map.
+ *
+ * Changes made while there are no marks are not logged, since there
+ * is nothing that they could be rolled back to.  The log and mark
+ * vectors keep their capacity across clear(), so that, once warmed
+ * up, backtracking does no memory allocation of its own.
+ */
+template<class Map>
+class MapTrail
+{
+	typedef typename Map::key_type Key;
+	typedef typename Map::mapped_type Value;
+
+	struct Entry
+	{
+		Key key;
+		Value old;
+		bool had;    // false if the key was absent.
+	};
+
+	Map& _map;
+	std::vector<Entry> _log;
+	std::vector<size_t> _marks;
+
+public:
+	MapTrail(Map& m) : _map(m) {}
+
+	void set(const Key& k, const Value& v)
+	{
+		auto it = _map.find(k);
+		if (_map.end() == it)
+		{
+			if (not _marks.empty()) _log.push_back({k, Value(), false});
+			_map.emplace(k, v);
+			return;
+		}
+		if (it->second == v) return;
+		if (not _marks.empty()) _log.push_back({k, it->second, true});
+		it->second = v;
+	}
+
+	void erase(const Key& k)
+	{
+		auto it = _map.find(k);
+		if (_map.end() == it) return;
+		if (not _marks.empty()) _log.push_back({k, it->second, true});
+		_map.erase(it);
+	}
+
+	void push(void) { _marks.push_back(_log.size()); }
+
+	void pop(void)
+	{
+		size_t mark = _marks.back();
+		_marks.pop_back();
+		while (mark < _log.size())
+		{
+			Entry& e = _log.back();
+			if (e.had) _map[e.key] = e.old;
+			else _map.erase(e.key);
+			_log.pop_back();
+		}
+	}
+
+	void drop(void) { _marks.pop_back(); }
+
+	size_t depth(void) const { return _marks.size(); }
+
+	/// Empty the map, and forget all marks.
+	void clear(void)
+	{
+		_map.clear();
+		_log.clear();
+		_marks.clear();
+	}
+};
+
+/**
+ * Undo log for a std::set; same as MapTrail above.
+ */
+template<class Set>
+class SetTrail
+{
+	typedef typename Set::key_type Key;
+
+	Set& _set;
+	std::vector<Key> _log;
+	std::vector<size_t> _marks;
+
+public:
+	SetTrail(Set& s) : _set(s) {}
+
+	void insert(const Key& k)
+	{
+		if (not _set.insert(k).second) return;
+		if (not _marks.empty()) _log.push_back(k);
+	}
+
+	void push(void) { _marks.push_back(_log.size()); }
+
+	void pop(void)
+	{
+		size_t mark = _marks.back();
+		_marks.pop_back();
+		while (mark < _log.size())
+		{
+			_set.erase(_log.back());
+			_log.pop_back();
+		}
+	}
+
+	void drop(void) { _marks.pop_back(); }
+
+	void clear(void)
+	{
+		_set.clear();
+		_log.clear();
+		_marks.clear();
+	}
+};
+
+} // namespace opencog
+
+#endif // _OPENCOG_TRAIL_H
@@ -21,6 +21,8 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <memory>
+
 #include <boost/range/algorithm/find.hpp>
 
 #include <opencog/atoms/execution/Instantiator.h>
@@ -153,12 +155,9 @@ void ForwardChainer::do_step(void)
 
     _log->debug("Derived rule size = %d", derived_rhandles.size());
 
-    UnorderedHandleSet products;
     //Applying all partial/full groundings.
-    for (Handle rhandle : derived_rhandles) {
-        HandleSeq hs = apply_rule(rhandle, _search_focus_Set);
-        products.insert(hs.begin(), hs.end());
-    }
+    HandleSeq hs = apply_rules(derived_rhandles, _search_focus_Set);
+    UnorderedHandleSet products(hs.begin(), hs.end());
 
     //Finally store source partial groundings and inference results.
     if (not derived_rhandles.empty()) {
@@ -426,6 +425,63 @@ HandleSeq ForwardChainer::apply_rule(Handle rhandle,bool search_in_focus_set /*=
     return result;
 }
 
+/**
+ * Applies many rules at once; the results are those of apply_rule() on
+ * each of them, all put together.
+ *
+ * The rules derived from the same source mostly start their searches
+ * at the same atoms, so, when searching the whole atomspace, they are
+ * run together with bindlink_batch(), which scans the incoming set of
+ * each of these atoms once, for all of the rules.  The one difference
+ * with apply_rule() is that a batched rule is not searched for in the
+ * atoms of the rules themselves; see below.
+ */
+HandleSeq ForwardChainer::apply_rules(const HandleSeq& rhandles,
+                                      bool search_in_focus_set /*=false*/)
+{
+    HandleSeq result;
+    HandleSeq batch;
+
+    for (const Handle& rhandle : rhandles) {
+        if (search_in_focus_set or
+            not contains_atomtype(rhandle, VARIABLE_NODE)) {
+            HandleSeq hs = apply_rule(rhandle, search_in_focus_set);
+            result.insert(result.end(), hs.begin(), hs.end());
+        } else {
+            batch.push_back(rhandle);
+        }
+    }
+
+    if (batch.empty())
+        return result;
+
+    //Unlike in apply_rule, where the rule goes in the very atomspace
+    //that is searched, each rule goes in a child atomspace of its own,
+    //and the search is made in yet another child, that holds none of
+    //the rules.  A searched atomspace holding all of them would let
+    //each rule be matched by the others, which apply_rule never does;
+    //so here no rule is matched by any rule, itself included.
+    //ForwardChainerUTest checks that the products are the same.
+    std::vector<std::unique_ptr<AtomSpace>> rule_as;
+    HandleSeq rhcpys;
+    for (const Handle& rhandle : batch) {
+        rule_as.emplace_back(new AtomSpace(&_as));
+        rhcpys.push_back(rule_as.back()->add_atom(rhandle));
+    }
+    AtomSpace derived_rule_as(&_as);
+
+    _log->debug("Applying %d rules on atomspace", rhcpys.size());
+
+    for (const Handle& h : bindlink_batch(&derived_rule_as, rhcpys)) {
+        for (Handle hr : derived_rule_as.get_outgoing(h)) {
+            _as.add_atom(hr);
+            result.push_back(hr);
+        }
+    }
+
+    return result;
+}
+
 /**
  * Derives new rules by replacing variables that are unfiable in @param target
  * with source.The rule handles are not added to any atomspace.
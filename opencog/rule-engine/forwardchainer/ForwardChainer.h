@@ -115,6 +115,16 @@ protected:
     virtual HandleSeq apply_rule(Handle rhandle, bool search_focus_set_only =
             false);
 
+    /**
+     * Apply many rules at once, sharing the searches where possible.
+     * Unlike apply_rule(), the rules are not searched for in the atoms
+     * of the rules themselves.
+     *
+     * @return  All of the handles created by applying the rules.
+     */
+    HandleSeq apply_rules(const HandleSeq& rhandles,
+                          bool search_focus_set_only = false);
+
     HandleSeq derive_rules(Handle source, const Rule* rule, bool subatomic = false);
 
 public:
@@ -0,0 +1,7 @@
+;
+; OpenCog memory-mapped file Persistance module
+;
+
+(define-module (opencog persist-mmap))
+
+(load-extension "libpersist-mmap" "opencog_persist_mmap_init")
@@ -25,6 +25,211 @@
     The search is terminated after the first match is found.
 ")
 
+(set-procedure-property! cog-bind-parallel 'documentation
+"
+ cog-bind-parallel handle
+    Run pattern matcher on handle.  handle must be a BindLink.
+    Same as cog-bind, except that the search is spread over one
+    thread per CPU core.  Only worthwhile for large searches.
+")
+
+(set-procedure-property! cog-bind-explain 'documentation
+"
+ cog-bind-explain handle
+    Return a string describing how the pattern matcher would search
+    for groundings of handle (a BindLink, GetLink or SatisfactionLink):
+    the atom the search would start at, and the order in which the
+    clauses would be grounded, with the estimated number of candidates
+    examined and kept at each step. No search is performed.
+    Example:
+       (display (cog-bind-explain (GetLink ...)))
+")
+
+; ----------------------------------------------------------
+(define-public (cog-bind-stream handle)
+"
+ cog-bind-stream handle
+    Return a procedure that returns the results of the pattern matcher
+    on handle, one at a time; #f once there are no more.  handle may be
+    a BindLink, a GetLink or a SatisfactionLink: the results are the
+    same as those of cog-bind and cog-satisfying-set, except that they
+    are not wrapped in a SetLink, and each is returned as soon as it is
+    found; a result found more than once is returned more than once.
+    The search runs only a little ahead of the caller.  Call the
+    procedure with the argument 'close to stop the search early; a
+    procedure that is dropped without that is closed after the next
+    garbage collection.
+    Example:
+       (define next (cog-bind-stream (BindLink ...)))
+       (next)          ; the first result
+       (next)          ; the second result
+       (next 'close)   ; done with it
+"
+	; The stream number is kept in a box, that only the procedure
+	; refers to; the guardian hands the box back once the procedure
+	; is gone.
+	(define box (list (cog-stream-open handle)))
+	(define (close-box)
+		(if (car box) (begin (cog-stream-close (car box)) (set-car! box #f))))
+	(stream-guardian box)
+	(case-lambda
+		(()
+			(if (not (car box)) #f
+				(let ((h (cog-stream-next (car box))))
+					(if (not (null? h)) h
+						(begin (close-box) #f)))))
+		((cmd)
+			(if (eq? cmd 'close) (close-box))
+			#f)))
+
+; Close the streams of the cog-bind-stream procedures that were
+; garbage-collected without being run dry, or closed.
+(define stream-guardian (make-guardian))
+(define (close-dropped-streams)
+	(let ((box (stream-guardian)))
+		(if box
+			(begin
+				(if (car box) (cog-stream-close (car box)))
+				(close-dropped-streams)))))
+(add-hook! after-gc-hook close-dropped-streams)
+
+(set-procedure-property! cog-stream-open 'documentation
+"
+ cog-stream-open handle
+    Start streaming the results of the pattern matcher on handle; return
+    the number of the stream.  The stream lives on until it is closed
+    with cog-stream-close; cog-bind-stream does that by itself.
+")
+
+(set-procedure-property! cog-stream-next 'documentation
+"
+ cog-stream-next id
+    Return the next result of the stream id, or the empty list if there
+    are no more.  See cog-bind-stream.
+")
+
+(set-procedure-property! cog-stream-close 'documentation
+"
+ cog-stream-close id
+    Stop the search of the stream id, and forget it.
+")
+
+; ----------------------------------------------------------
+(define-public (cog-bind-with-budget handle msecs max-candidates)
+"
+ cog-bind-with-budget handle msecs max-candidates
+    Run the pattern matcher on handle, a BindLink, GetLink or
+    SatisfactionLink, the same as cog-bind or cog-satisfying-set, but
+    give up after msecs milliseconds, or after max-candidates atoms to
+    start the search at; zero means no limit.  Return two values: the
+    SetLink of the results found, and #t if the search was cut short,
+    so that there may be more.  Use cog-budget-new directly, to be
+    able to cancel the search from another thread.
+    Example:
+       (call-with-values
+          (lambda () (cog-bind-with-budget (BindLink ...) 500 0))
+          (lambda (results truncated) ...))
+"
+	(define id (cog-budget-new msecs max-candidates))
+	(dynamic-wind
+		(lambda () #f)
+		(lambda ()
+			(let ((results
+					(if (cog-subtype? 'BindLink (cog-type handle))
+						(cog-bind-bounded handle id)
+						(cog-satisfying-set-bounded handle id))))
+				(values results (cog-budget-truncated? id))))
+		(lambda () (cog-budget-delete id))))
+
+(set-procedure-property! cog-budget-new 'documentation
+"
+ cog-budget-new msecs max-candidates
+    Make a budget for a search: at most msecs milliseconds, and at most
+    max-candidates atoms to start the search at; zero means no limit.
+    Return the number of the budget.  The clock starts when a search
+    using it begins.  See cog-bind-with-budget.
+")
+
+(set-procedure-property! cog-bind-bounded 'documentation
+"
+ cog-bind-bounded handle id
+    Same as cog-bind, but search only within the budget id.  The
+    results found until the budget is used up are returned.
+")
+
+(set-procedure-property! cog-satisfying-set-bounded 'documentation
+"
+ cog-satisfying-set-bounded handle id
+    Same as cog-satisfying-set, but search only within the budget id.
+")
+
+(set-procedure-property! cog-budget-cancel 'documentation
+"
+ cog-budget-cancel id
+    Stop the search using the budget id, as soon as possible; the
+    results found so far are returned.  May be called from any thread,
+    before or during the search.
+")
+
+(set-procedure-property! cog-budget-truncated? 'documentation
+"
+ cog-budget-truncated? id
+    Return #t if the last search with the budget id was cut short.
+")
+
+(set-procedure-property! cog-budget-delete 'documentation
+"
+ cog-budget-delete id
+    Forget the budget id.
+")
+
+; ----------------------------------------------------------
+(define-public (cog-bind-profile handle)
+"
+ cog-bind-profile handle
+    Run the pattern matcher on handle, a BindLink, GetLink or
+    SatisfactionLink, the same as cog-bind or cog-satisfying-set, and
+    count what the search does.  Return two values: the SetLink of the
+    results, and an association list of the counts: the candidate atoms
+    the search started at, the calls to tree-compare, those made to
+    narrow down the permutations of large unordered links, the
+    backtracks, the permutations tried, the clauses accepted and
+    rejected, the evaluations and the groundings; and of the times, in
+    seconds: in evaluations, in groundings, and in all.
+    Example:
+       (call-with-values
+          (lambda () (cog-bind-profile (BindLink ...)))
+          (lambda (results profile)
+             (assq-ref profile 'tree-compares)))
+"
+	(let ((results
+			(if (cog-subtype? 'BindLink (cog-type handle))
+				(cog-bind-profiled handle)
+				(cog-satisfying-set-profiled handle))))
+		(values results
+			(with-input-from-string (cog-profile-report handle) read))))
+
+(set-procedure-property! cog-bind-profiled 'documentation
+"
+ cog-bind-profiled handle
+    Same as cog-bind, but count what the search does.  The counts are
+    kept until cog-profile-report is called.  See cog-bind-profile.
+")
+
+(set-procedure-property! cog-satisfying-set-profiled 'documentation
+"
+ cog-satisfying-set-profiled handle
+    Same as cog-satisfying-set, but count what the search does.  See
+    cog-bind-profile.
+")
+
+(set-procedure-property! cog-profile-report 'documentation
+"
+ cog-profile-report handle
+    Return the counts of the last profiled search for handle, as the
+    text of an association list, and forget them.  See cog-bind-profile.
+")
+
 (set-procedure-property! cog-bind-af 'documentation
 "
  cog-bind-af handle
@@ -38,3 +243,11 @@
     Run pattern matcher on handle.  handle must be a SatisfactionLink.
     Return a TV. Only satisfaction is performed, no implication.
 ")
+
+(set-procedure-property! cog-satisfying-set-parallel 'documentation
+"
+ cog-satisfying-set-parallel handle
+    Run pattern matcher on handle.  handle must be a GetLink.
+    Same as cog-satisfying-set, except that the search is spread
+    over one thread per CPU core.
+")
@@ -3,7 +3,11 @@ import os
 
 from opencog.atomspace import AtomSpace, TruthValue, Atom, Handle, types
 from opencog.bindlink import    stub_bindlink, bindlink, single_bindlink,\
-                                af_bindlink, satisfaction_link,\
+                                af_bindlink, parallel_bindlink,\
+                                bindlink_stream,\
+                                SearchBudget, bounded_bindlink,\
+                                SearchProfile, profiled_bindlink,\
+                                satisfaction_link,\
                                 execute_atom, evaluate_atom
 
 from opencog.utilities import initialize_opencog, finalize_opencog
@@ -135,6 +139,69 @@ class BindlinkTest(TestCase):
         self.assertEquals(atom.arity, 0)
         self.assertEquals(atom.type, types.SetLink)
 
+    def test_parallel_bindlink(self):
+
+        # Run bindlink, with several threads.
+        result = parallel_bindlink(self.atomspace, self.bindlink_handle)
+        self.assertTrue(result is not None and result.value() > 0)
+
+        # The same three items as found by the plain bindlink.
+        atom = self.atomspace[result]
+        self.assertEquals(atom.arity, 3)
+        self.assertEquals(atom.type, types.SetLink)
+
+    def test_bindlink_stream(self):
+
+        # Remember the starting atomspace size.
+        starting_size = self.atomspace.size()
+
+        # The same three items as found by the plain bindlink, one
+        # at a time, and without a SetLink.
+        results = list(bindlink_stream(self.atomspace, self.bindlink_handle))
+        self.assertEquals(len(results), 3)
+        self.assertEquals(self.atomspace.size(), starting_size)
+        for h in results:
+            self.assertEquals(self.atomspace[h].type, types.ConceptNode)
+
+        # Stop after the first one.
+        stream = bindlink_stream(self.atomspace, self.bindlink_handle)
+        self.assertTrue(next(stream) in results)
+        stream.close()
+        self.assertRaises(StopIteration, next, stream)
+
+    def test_bounded_bindlink(self):
+
+        # Enough for all three.
+        budget = SearchBudget(10.0)
+        result = bounded_bindlink(self.atomspace, self.bindlink_handle, budget)
+        self.assertEquals(self.atomspace[result].arity, 3)
+        self.assertFalse(budget.truncated)
+
+        # Only two candidates to start the search at; one of them may
+        # be the pattern itself, which is not a match.
+        budget = SearchBudget(0.0, 2)
+        result = bounded_bindlink(self.atomspace, self.bindlink_handle, budget)
+        self.assertTrue(1 <= self.atomspace[result].arity <= 2)
+        self.assertTrue(budget.truncated)
+
+        # Cancelled before it began.
+        budget = SearchBudget()
+        budget.cancel()
+        result = bounded_bindlink(self.atomspace, self.bindlink_handle, budget)
+        self.assertEquals(self.atomspace[result].arity, 0)
+        self.assertTrue(budget.truncated)
+        self.assertTrue(budget.cancelled)
+
+    def test_profiled_bindlink(self):
+
+        profile = SearchProfile()
+        result = profiled_bindlink(self.atomspace, self.bindlink_handle, profile)
+        self.assertEquals(self.atomspace[result].arity, 3)
+        report = profile.report
+        self.assertTrue(report['groundings'] >= 3)
+        self.assertTrue(report['candidates'] >= 3)
+        self.assertTrue(report['elapsed-time'] >= 0.0)
+
     def test_satisfy(self):
         satisfaction_handle = SatisfactionLink(
             VariableList(),  # no variables